@@ -0,0 +1,618 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Algebra library micro-benchmarks
+ *
+ * Times matrix, vector, quaternion and quaternion differentiation operations at sizes used by EKF and LMA.
+ * Every case is warmed up, calibrated to a batch of calls lasting at least BENCH_MIN_SAMPLE_NS
+ * and then sampled. Median and 99th percentile of time per call are reported.
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <matrix.h>
+#include <quat.h>
+#include <vec.h>
+#include <qdiff.h>
+
+
+#define BENCH_MIN_SAMPLE_NS 20000
+#define BENCH_MAX_BATCH     (1 << 20)
+
+#define BENCH_DEFAULT_SAMPLES 1000
+#define BENCH_DEFAULT_WARMUP  100 /* milliseconds */
+
+/* Sizes used by EKF and LMA */
+#define STATE_LEN    16  /* EKF state length */
+#define IMU_MEAS_LEN 6   /* EKF IMU measurement length */
+#define GPS_MEAS_LEN 4   /* EKF GPS measurement length */
+#define LMA_PARAMS   12  /* ellipsoid fitting parameters */
+#define LMA_SAMPLES  256 /* ellipsoid fitting samples */
+
+
+typedef struct {
+	const char *name;
+	const char *size;
+	void (*run)(void);
+} bench_case_t;
+
+
+static struct {
+	/* EKF prediction: F * P * F^T */
+	matrix_t F, Ft, P, Pt, C, tmp;
+	matrix_sparsity_t Fpattern;
+	matrix_sym_t Psym, Csym;
+
+	/* EKF update: H * P and S = H * P * H^T */
+	matrix_t H, Ht, HP, S;
+
+	/* LMA: J^T * J */
+	matrix_t J, Jt, JtJ;
+
+	/* inversions */
+	matrix_t inv4, inv6, inv12, invOut4, invOut6, invOut12;
+	float invBuf[2 * LMA_PARAMS * LMA_PARAMS];
+
+	/* quaternions */
+	quat_t q, p, qres;
+	vec_t v;
+	matrix_t d33, d34, d43, d44;
+
+	/* sample mesh in structure of arrays layout */
+	float xs[LMA_SAMPLES], ys[LMA_SAMPLES], zs[LMA_SAMPLES], dots[LMA_SAMPLES];
+
+	volatile float sink;
+} bench_common;
+
+
+static uint64_t bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+static float bench_rand(void)
+{
+	return (float)rand() / RAND_MAX - 0.5f;
+}
+
+
+static void bench_randFill(matrix_t *A)
+{
+	unsigned int i;
+
+	for (i = 0; i < A->rows * A->cols; i++) {
+		A->data[i] = bench_rand();
+	}
+}
+
+
+/* Fills square A with random symmetric, diagonally dominant matrix */
+static void bench_spdFill(matrix_t *A)
+{
+	unsigned int row, col;
+
+	for (row = 0; row < A->rows; row++) {
+		for (col = row; col < A->cols; col++) {
+			MATRIX_DATA(A, row, col) = MATRIX_DATA(A, col, row) = bench_rand();
+		}
+		MATRIX_DATA(A, row, row) = A->rows;
+	}
+}
+
+
+/* Fills F with EKF-like state transition: identity with off-diagonal blocks for integrated states */
+static void bench_transitionFill(matrix_t *F)
+{
+	static const unsigned int blocks[][4] = {
+		/* row, col, rows, cols */
+		{ 0, 3, 3, 3 },  /* position from velocity */
+		{ 3, 6, 3, 4 },  /* velocity from attitude */
+		{ 3, 10, 3, 3 }, /* velocity from accelerometer bias */
+		{ 6, 6, 4, 4 },  /* attitude propagation */
+		{ 6, 13, 4, 3 }, /* attitude from gyroscope bias */
+	};
+	unsigned int i, row, col;
+
+	matrix_diag(F);
+	for (i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++) {
+		for (row = blocks[i][0]; row < blocks[i][0] + blocks[i][2]; row++) {
+			for (col = blocks[i][1]; col < blocks[i][1] + blocks[i][3]; col++) {
+				MATRIX_DATA(F, row, col) += 0.01f * bench_rand();
+			}
+		}
+	}
+}
+
+
+/* Returns alias of A buffer with transposition flag set */
+static matrix_t bench_trpAlias(const matrix_t *A)
+{
+	matrix_t T = *A;
+
+	T.transposed = 1;
+
+	return T;
+}
+
+
+static int bench_init(void)
+{
+	unsigned int i;
+	int err = 0;
+
+	srand(1);
+
+	err |= matrix_bufAlloc(&bench_common.F, STATE_LEN, STATE_LEN);
+	err |= matrix_bufAlloc(&bench_common.P, STATE_LEN, STATE_LEN);
+	err |= matrix_bufAlloc(&bench_common.C, STATE_LEN, STATE_LEN);
+	err |= matrix_bufAlloc(&bench_common.tmp, STATE_LEN, STATE_LEN);
+	err |= matrix_bufAlloc(&bench_common.H, IMU_MEAS_LEN, STATE_LEN);
+	err |= matrix_bufAlloc(&bench_common.HP, IMU_MEAS_LEN, STATE_LEN);
+	err |= matrix_bufAlloc(&bench_common.S, IMU_MEAS_LEN, IMU_MEAS_LEN);
+	err |= matrix_bufAlloc(&bench_common.J, LMA_SAMPLES, LMA_PARAMS);
+	err |= matrix_bufAlloc(&bench_common.JtJ, LMA_PARAMS, LMA_PARAMS);
+	err |= matrix_bufAlloc(&bench_common.inv4, GPS_MEAS_LEN, GPS_MEAS_LEN);
+	err |= matrix_bufAlloc(&bench_common.inv6, IMU_MEAS_LEN, IMU_MEAS_LEN);
+	err |= matrix_bufAlloc(&bench_common.inv12, LMA_PARAMS, LMA_PARAMS);
+	err |= matrix_bufAlloc(&bench_common.invOut4, GPS_MEAS_LEN, GPS_MEAS_LEN);
+	err |= matrix_bufAlloc(&bench_common.invOut6, IMU_MEAS_LEN, IMU_MEAS_LEN);
+	err |= matrix_bufAlloc(&bench_common.invOut12, LMA_PARAMS, LMA_PARAMS);
+	err |= matrix_bufAlloc(&bench_common.d33, 3, 3);
+	err |= matrix_bufAlloc(&bench_common.d34, 3, 4);
+	err |= matrix_bufAlloc(&bench_common.d43, 4, 3);
+	err |= matrix_bufAlloc(&bench_common.d44, 4, 4);
+
+	if (err != 0) {
+		return -1;
+	}
+
+	bench_transitionFill(&bench_common.F);
+	bench_spdFill(&bench_common.P);
+	bench_randFill(&bench_common.H);
+	bench_randFill(&bench_common.J);
+	bench_spdFill(&bench_common.inv4);
+	bench_spdFill(&bench_common.inv6);
+	bench_spdFill(&bench_common.inv12);
+
+	bench_common.Ft = bench_trpAlias(&bench_common.F);
+	bench_common.Pt = bench_trpAlias(&bench_common.P);
+	bench_common.Ht = bench_trpAlias(&bench_common.H);
+	bench_common.Jt = bench_trpAlias(&bench_common.J);
+
+	if (matrix_sparsityAlloc(&bench_common.Fpattern, &bench_common.F) != 0) {
+		return -1;
+	}
+
+	if (matrix_symAlloc(&bench_common.Psym, STATE_LEN) != 0 || matrix_symAlloc(&bench_common.Csym, STATE_LEN) != 0) {
+		return -1;
+	}
+	matrix_symPack(&bench_common.P, &bench_common.Psym);
+
+	matrix_prod(&bench_common.H, &bench_common.P, &bench_common.HP);
+
+	bench_common.q = (quat_t) { .a = 0.8f, .i = 0.1f, .j = -0.4f, .k = 0.2f };
+	quat_normalize(&bench_common.q);
+	bench_common.p = (quat_t) { .a = 0.3f, .i = -0.6f, .j = 0.5f, .k = 0.1f };
+	quat_normalize(&bench_common.p);
+	bench_common.v = (vec_t) { .x = 0.3f, .y = -1.2f, .z = 9.8f };
+
+	for (i = 0; i < LMA_SAMPLES; i++) {
+		bench_common.xs[i] = bench_rand();
+		bench_common.ys[i] = bench_rand();
+		bench_common.zs[i] = bench_rand();
+	}
+
+	return 0;
+}
+
+
+static void bench_done(void)
+{
+	matrix_bufFree(&bench_common.F);
+	matrix_bufFree(&bench_common.P);
+	matrix_bufFree(&bench_common.C);
+	matrix_bufFree(&bench_common.tmp);
+	matrix_bufFree(&bench_common.H);
+	matrix_bufFree(&bench_common.HP);
+	matrix_bufFree(&bench_common.S);
+	matrix_bufFree(&bench_common.J);
+	matrix_bufFree(&bench_common.JtJ);
+	matrix_bufFree(&bench_common.inv4);
+	matrix_bufFree(&bench_common.inv6);
+	matrix_bufFree(&bench_common.inv12);
+	matrix_bufFree(&bench_common.invOut4);
+	matrix_bufFree(&bench_common.invOut6);
+	matrix_bufFree(&bench_common.invOut12);
+	matrix_bufFree(&bench_common.d33);
+	matrix_bufFree(&bench_common.d34);
+	matrix_bufFree(&bench_common.d43);
+	matrix_bufFree(&bench_common.d44);
+	matrix_sparsityFree(&bench_common.Fpattern);
+	matrix_symFree(&bench_common.Psym);
+	matrix_symFree(&bench_common.Csym);
+}
+
+
+/* Benchmarked operations */
+
+static void bench_prodNN(void)
+{
+	matrix_prod(&bench_common.F, &bench_common.P, &bench_common.C);
+}
+
+
+static void bench_prodTN(void)
+{
+	matrix_prod(&bench_common.Ft, &bench_common.P, &bench_common.C);
+}
+
+
+static void bench_prodNT(void)
+{
+	matrix_prod(&bench_common.F, &bench_common.Pt, &bench_common.C);
+}
+
+
+static void bench_prodTT(void)
+{
+	matrix_prod(&bench_common.Ft, &bench_common.Pt, &bench_common.C);
+}
+
+
+static void bench_prodHP(void)
+{
+	matrix_prod(&bench_common.H, &bench_common.P, &bench_common.HP);
+}
+
+
+static void bench_prodJtJ(void)
+{
+	matrix_prod(&bench_common.Jt, &bench_common.J, &bench_common.JtJ);
+}
+
+
+static void bench_sandwitch(void)
+{
+	matrix_sandwitch(&bench_common.F, &bench_common.P, &bench_common.C, &bench_common.tmp);
+}
+
+
+static void bench_sparseSandwitch(void)
+{
+	matrix_sparseSandwitch(&bench_common.F, &bench_common.P, &bench_common.C, &bench_common.tmp);
+}
+
+
+static void bench_symSandwitch(void)
+{
+	matrix_symSandwitch(&bench_common.F, &bench_common.P, &bench_common.C, &bench_common.tmp);
+}
+
+
+static void bench_patternSandwitch(void)
+{
+	matrix_patternSandwitch(&bench_common.Fpattern, &bench_common.F, &bench_common.P, &bench_common.C, &bench_common.tmp);
+}
+
+
+static void bench_symPatternSandwitch(void)
+{
+	matrix_symPatternSandwitch(&bench_common.Fpattern, &bench_common.F, &bench_common.Psym, &bench_common.Csym, &bench_common.tmp);
+}
+
+
+/* EKF covariance decimation: transition accumulation Phi = F * Phi */
+static void bench_patternProd(void)
+{
+	matrix_patternProd(&bench_common.Fpattern, &bench_common.F, &bench_common.P, &bench_common.C);
+}
+
+
+/* EKF covariance decimation: process noise accumulation Qd += Q */
+static void bench_add(void)
+{
+	matrix_add(&bench_common.C, &bench_common.P, NULL);
+}
+
+
+static void bench_gemmSym(void)
+{
+	matrix_gemmSym(1, &bench_common.HP, &bench_common.Ht, 0, &bench_common.S);
+}
+
+
+static void bench_inv4(void)
+{
+	matrix_inv(&bench_common.inv4, &bench_common.invOut4, NULL, 0);
+}
+
+
+static void bench_inv6(void)
+{
+	matrix_inv(&bench_common.inv6, &bench_common.invOut6, bench_common.invBuf, sizeof(bench_common.invBuf) / sizeof(float));
+}
+
+
+static void bench_inv12(void)
+{
+	matrix_inv(&bench_common.inv12, &bench_common.invOut12, bench_common.invBuf, sizeof(bench_common.invBuf) / sizeof(float));
+}
+
+
+static void bench_quatMlt(void)
+{
+	quat_mlt(&bench_common.q, &bench_common.p, &bench_common.qres);
+}
+
+
+/* Rotation by unit quaternion preserves vector length, so repeated calls stay in range */
+static void bench_quatVecRot(void)
+{
+	quat_vecRot(&bench_common.v, &bench_common.q);
+}
+
+
+static void bench_quatVecRotBatch(void)
+{
+	quat_vecRotBatch(&bench_common.q, bench_common.xs, bench_common.ys, bench_common.zs, LMA_SAMPLES);
+}
+
+
+static void bench_vecDotBatch(void)
+{
+	vec_dotBatch(bench_common.xs, bench_common.ys, bench_common.zs, bench_common.zs, bench_common.xs, bench_common.ys, bench_common.dots, LMA_SAMPLES);
+}
+
+
+static void bench_quatEuler(void)
+{
+	float roll, pitch, yaw;
+
+	quat_quat2euler(&bench_common.q, &roll, &pitch, &yaw);
+	bench_common.sink = roll + pitch + yaw;
+}
+
+
+static void bench_qvqDiffQ(void)
+{
+	qvdiff_qvqDiffQ(&bench_common.q, &bench_common.v, &bench_common.d34);
+}
+
+
+static void bench_cqvqDiffQ(void)
+{
+	qvdiff_cqvqDiffQ(&bench_common.q, &bench_common.v, &bench_common.d34);
+}
+
+
+static void bench_qvqDiffV(void)
+{
+	qvdiff_qvqDiffV(&bench_common.q, &bench_common.d33);
+}
+
+
+static void bench_qpDiffQ(void)
+{
+	qvdiff_qpDiffQ(&bench_common.p, &bench_common.d44);
+}
+
+
+static void bench_qpDiffP(void)
+{
+	qvdiff_qpDiffP(&bench_common.q, &bench_common.d43);
+}
+
+
+static const bench_case_t bench_cases[] = {
+	{ "matrix_prod/NN", "16x16*16x16", bench_prodNN },
+	{ "matrix_prod/TN", "16x16*16x16", bench_prodTN },
+	{ "matrix_prod/NT", "16x16*16x16", bench_prodNT },
+	{ "matrix_prod/TT", "16x16*16x16", bench_prodTT },
+	{ "matrix_prod/HP", "6x16*16x16", bench_prodHP },
+	{ "matrix_prod/JtJ", "12x256*256x12", bench_prodJtJ },
+	{ "matrix_sandwitch", "16x16", bench_sandwitch },
+	{ "matrix_sparseSandwitch", "16x16", bench_sparseSandwitch },
+	{ "matrix_symSandwitch", "16x16", bench_symSandwitch },
+	{ "matrix_patternSandwitch", "16x16", bench_patternSandwitch },
+	{ "matrix_symPatternSandwitch", "16x16", bench_symPatternSandwitch },
+	{ "matrix_patternProd", "16x16*16x16", bench_patternProd },
+	{ "matrix_add", "16x16", bench_add },
+	{ "matrix_gemmSym/HPHt", "6x16*16x6", bench_gemmSym },
+	{ "matrix_inv", "4x4", bench_inv4 },
+	{ "matrix_inv", "6x6", bench_inv6 },
+	{ "matrix_inv", "12x12", bench_inv12 },
+	{ "quat_mlt", "4", bench_quatMlt },
+	{ "quat_vecRot", "3", bench_quatVecRot },
+	{ "quat_vecRotBatch", "256x3", bench_quatVecRotBatch },
+	{ "vec_dotBatch", "256x3", bench_vecDotBatch },
+	{ "quat_quat2euler", "4", bench_quatEuler },
+	{ "qvdiff_qvqDiffQ", "3x4", bench_qvqDiffQ },
+	{ "qvdiff_cqvqDiffQ", "3x4", bench_cqvqDiffQ },
+	{ "qvdiff_qvqDiffV", "3x3", bench_qvqDiffV },
+	{ "qvdiff_qpDiffQ", "4x4", bench_qpDiffQ },
+	{ "qvdiff_qpDiffP", "4x3", bench_qpDiffP },
+};
+
+
+/* Returns duration of `batch` calls of `run` in nanoseconds */
+static uint64_t bench_batch(void (*run)(void), unsigned int batch)
+{
+	uint64_t start;
+	unsigned int i;
+
+	start = bench_now();
+	for (i = 0; i < batch; i++) {
+		run();
+	}
+
+	return bench_now() - start;
+}
+
+
+static int bench_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+
+/* Measures one case. `res` have to hold `samples` elements and is left sorted */
+static unsigned int bench_run(const bench_case_t *bc, double *res, unsigned int samples, unsigned int warmupMs)
+{
+	unsigned int batch = 1, i;
+	uint64_t end;
+
+	/* warmup before calibration, so cold caches do not shrink the batch */
+	end = bench_now() + (uint64_t)warmupMs * 1000000ull;
+	do {
+		bc->run();
+	} while (bench_now() < end);
+
+	/* batch long enough to make clock resolution and call overhead negligible */
+	while (batch < BENCH_MAX_BATCH && bench_batch(bc->run, batch) < BENCH_MIN_SAMPLE_NS) {
+		batch *= 2;
+	}
+
+	for (i = 0; i < samples; i++) {
+		res[i] = (double)bench_batch(bc->run, batch) / batch;
+	}
+
+	qsort(res, samples, sizeof(*res), bench_cmp);
+
+	return batch;
+}
+
+
+static int bench_pin(int cpu)
+{
+#ifdef __linux__
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	return sched_setaffinity(0, sizeof(set), &set);
+#else
+	return -1;
+#endif
+}
+
+
+static void bench_usage(const char *progname)
+{
+	printf("Usage: %s [-s samples] [-w warmup_ms] [-c cpu] [-f filter] [-j] [-h]\n\n", progname);
+	printf("  -s  number of samples per case (default %d)\n", BENCH_DEFAULT_SAMPLES);
+	printf("  -w  warmup time per case in milliseconds (default %d)\n", BENCH_DEFAULT_WARMUP);
+	printf("  -c  cpu to pin to, -1 disables pinning (default 0)\n");
+	printf("  -f  run only cases with name containing `filter`\n");
+	printf("  -j  print results as JSON, one object per line\n");
+	printf("  -h  shows this help info\n");
+}
+
+
+int main(int argc, char **argv)
+{
+	unsigned int samples = BENCH_DEFAULT_SAMPLES, warmupMs = BENCH_DEFAULT_WARMUP, i, batch;
+	const char *filter = NULL;
+	int cpu = 0, json = 0, opt;
+	double *res, median, p99;
+
+	while ((opt = getopt(argc, argv, "s:w:c:f:jh")) != -1) {
+		switch (opt) {
+			case 's':
+				samples = strtoul(optarg, NULL, 10);
+				break;
+
+			case 'w':
+				warmupMs = strtoul(optarg, NULL, 10);
+				break;
+
+			case 'c':
+				cpu = atoi(optarg);
+				break;
+
+			case 'f':
+				filter = optarg;
+				break;
+
+			case 'j':
+				json = 1;
+				break;
+
+			case 'h':
+				bench_usage(argv[0]);
+				return EXIT_SUCCESS;
+
+			default:
+				bench_usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (samples == 0) {
+		fprintf(stderr, "algebra_bench: number of samples must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Pinning failure is not fatal, but results are less stable */
+	if (cpu >= 0 && bench_pin(cpu) != 0) {
+		fprintf(stderr, "algebra_bench: cannot pin to cpu %d\n", cpu);
+	}
+
+	res = malloc(samples * sizeof(*res));
+	if (res == NULL || bench_init() != 0) {
+		fprintf(stderr, "algebra_bench: allocation failed\n");
+		free(res);
+		return EXIT_FAILURE;
+	}
+
+	if (json == 0) {
+		printf("%-26s %-14s %12s %12s %8s\n", "name", "size", "median[ns]", "p99[ns]", "batch");
+	}
+
+	for (i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+		if (filter != NULL && strstr(bench_cases[i].name, filter) == NULL) {
+			continue;
+		}
+
+		batch = bench_run(&bench_cases[i], res, samples, warmupMs);
+		median = res[samples / 2];
+		p99 = res[(samples * 99 + 99) / 100 - 1];
+
+		if (json != 0) {
+			printf("{\"name\":\"%s\",\"size\":\"%s\",\"median_ns\":%.1f,\"p99_ns\":%.1f,\"samples\":%u,\"batch\":%u}\n",
+				bench_cases[i].name, bench_cases[i].size, median, p99, samples, batch);
+		}
+		else {
+			printf("%-26s %-14s %12.1f %12.1f %8u\n", bench_cases[i].name, bench_cases[i].size, median, p99, batch);
+		}
+		fflush(stdout);
+	}
+
+	bench_done();
+	free(res);
+
+	return EXIT_SUCCESS;
+}
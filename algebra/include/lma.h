@@ -78,8 +78,6 @@ typedef struct {
 
 	/* helper matrices */
 	matrix_t helpPxP[2];
-	float *invBuf;
-	unsigned int invBufLen;
 
 	lmaJacobian solveJ;
 	lmaResiduum solveR;
@@ -21,17 +21,58 @@ typedef struct {
 	unsigned int cols;
 	unsigned int transposed;
 	float *data;
+	unsigned int stride; /* distance between rows of `data`. 0 for dense matrices (stride equal to cols) */
 } matrix_t;
 
 
+/* Fixed sparsity pattern of a matrix: column indices of nonzero elements stored row by row (CSR) */
+typedef struct {
+	unsigned int rows;
+	unsigned int cols;
+	unsigned int nnz;       /* number of nonzero elements */
+	unsigned int *rowStart; /* `rows + 1` offsets into `colIdx`. Nonzeros of row `r` are at [rowStart[r], rowStart[r + 1]) */
+	unsigned int *colIdx;   /* column of each nonzero element */
+} matrix_sparsity_t;
+
+
+/* Symmetric matrix storing only elements on and above diagonal, packed row by row */
+typedef struct {
+	unsigned int n; /* number of rows and columns */
+	float *data;    /* MATRIX_SYM_LEN(n) elements. Row `r` holds elements (r, r) ... (r, n - 1) */
+} matrix_sym_t;
+
+
+/* Number of elements of packed symmetric n x n matrix */
+#define MATRIX_SYM_LEN(n) ((n) * ((n) + 1) / 2)
+
+
+/* Alignment of buffers allocated by matrix_bufAlloc() in bytes */
+#define MATRIX_ALIGN 64
+
+
+/* returns distance between consecutive rows of A buffer */
+static inline unsigned int matrix_strideGet(const matrix_t *A)
+{
+	return (A->stride != 0) ? A->stride : A->cols;
+}
+
+
+/* returns index of element (`row`, `col`) in `data` of packed symmetric matrix. Order of `row` and `col` does not matter */
+static inline unsigned int matrix_symIdx(const matrix_sym_t *A, unsigned int row, unsigned int col)
+{
+	return (row <= col) ? row * (2 * A->n - row - 1) / 2 + col : col * (2 * A->n - col - 1) / 2 + row;
+}
+
+
 /* Direct access macro. works only for untransposed matrices */
-#define MATRIX_DATA(m, x, y) (m)->data[((x) * (m)->cols) + (y)]
+#define MATRIX_DATA(m, x, y) (m)->data[((x) * matrix_strideGet(m)) + (y)]
 
 
 /* sets all matrix to zeroes */
 extern void matrix_zeroes(matrix_t *A);
 
 
+/* allocates zeroed, dense matrix with buffer aligned to MATRIX_ALIGN */
 extern int matrix_bufAlloc(matrix_t *matrix, unsigned int rows, unsigned int cols);
 
 
@@ -42,7 +83,7 @@ extern void matrix_bufFree(matrix_t *matrix);
  * if row or column exceeds matrix size NULL is returned */
 static inline float *matrix_at(const matrix_t *A, unsigned int row, unsigned int col)
 {
-	return (A->transposed) ? ((row < A->cols && col < A->rows) ? &(A->data[A->cols * col + row]) : NULL) : ((row < A->rows && col < A->cols) ? &(A->data[A->cols * row + col]) : NULL);
+	return (A->transposed) ? ((row < A->cols && col < A->rows) ? &(A->data[matrix_strideGet(A) * col + row]) : NULL) : ((row < A->rows && col < A->cols) ? &(A->data[matrix_strideGet(A) * row + col]) : NULL);
 }
 
 
@@ -58,6 +99,15 @@ static inline unsigned int matrix_colsGet(const matrix_t *A)
 }
 
 
+/*
+ * Sets `view` to `rows` x `cols` submatrix of A starting at (`row`, `col`), sharing memory with A.
+ * Views can be passed to matrix_at(), MATRIX_DATA, matrix_zeroes(), matrix_diag(), matrix_times(), matrix_add(), matrix_sub(),
+ * matrix_cmp(), matrix_writeSubmatrix(), matrix_print() and as any argument of matrix_prod(). Untransposed views can also be
+ * written by matrix_prod() and qvdiff_* functions. Other functions return -1 for views. Returns -1 if submatrix exceeds A.
+ */
+extern int matrix_view(const matrix_t *A, unsigned int row, unsigned int col, unsigned int rows, unsigned int cols, matrix_t *view);
+
+
 /* sets the matrix data to diagonal 1s, rest is 0 */
 extern void matrix_diag(matrix_t *A);
 
@@ -74,10 +124,21 @@ extern void matrix_print(const matrix_t *A);
 extern void matrix_trp(matrix_t *A);
 
 
-/* overwrites C with A * B */
+/* overwrites C with A * B. Matrix sizes used by EKF are computed with fixed-size kernels */
 extern int matrix_prod(const matrix_t *A, const matrix_t *B, matrix_t *C);
 
 
+/*
+ * overwrites C with alpha * A * B + beta * C in a single pass. Transposition flags of A, B and C are honored and C keeps its own.
+ * C is not read if beta is 0. C may be a view, but must not share memory with A or B
+ */
+extern int matrix_gemm(float alpha, const matrix_t *A, const matrix_t *B, float beta, matrix_t *C);
+
+
+/* matrix_gemm() for symmetric C and A * B. Only upper triangle of C is read and computed, then mirrored, so C is exactly symmetric */
+extern int matrix_gemmSym(float alpha, const matrix_t *A, const matrix_t *B, float beta, matrix_t *C);
+
+
 /* overwrites C with A * B, optimized for sparse A matrix */
 extern int matrix_sparseProd(const matrix_t *A, const matrix_t *B, matrix_t *C);
 
@@ -90,6 +151,66 @@ extern int matrix_sandwitch(const matrix_t *A, const matrix_t *B, matrix_t *C, m
 extern int matrix_sparseSandwitch(const matrix_t *A, const matrix_t *B, matrix_t *C, matrix_t *tempC);
 
 
+/* allocates sparsity pattern S of nonzero elements of A. Elements that may become nonzero later must be nonzero in A */
+extern int matrix_sparsityAlloc(matrix_sparsity_t *S, const matrix_t *A);
+
+
+extern void matrix_sparsityFree(matrix_sparsity_t *S);
+
+
+/*
+ * overwrites C with A * B, reading only elements of A present in pattern S, other are treated as zeroes.
+ * Cost depends only on S, not on values of A. C may be untransposed view
+ */
+extern int matrix_patternProd(const matrix_sparsity_t *S, const matrix_t *A, const matrix_t *B, matrix_t *C);
+
+
+/* matrix_symSandwitch() reading only elements of A present in pattern S. On return tempC holds A * B */
+extern int matrix_patternSandwitch(const matrix_sparsity_t *S, const matrix_t *A, const matrix_t *B, matrix_t *C, matrix_t *tempC);
+
+
+/* allocates zeroed packed symmetric n x n matrix with buffer aligned to MATRIX_ALIGN */
+extern int matrix_symAlloc(matrix_sym_t *A, unsigned int n);
+
+
+extern void matrix_symFree(matrix_sym_t *A);
+
+
+/* prints packed symmetric matrix A as full matrix to standard output */
+extern void matrix_symPrint(const matrix_sym_t *A);
+
+
+/* writes elements on and above diagonal of dense symmetric A into S. Transposition flag of A is ignored */
+extern int matrix_symPack(const matrix_t *A, matrix_sym_t *S);
+
+
+/* writes full symmetric matrix S into A, which may be a view */
+extern int matrix_symUnpack(const matrix_sym_t *S, matrix_t *A);
+
+
+extern int matrix_symCopy(matrix_sym_t *dst, const matrix_sym_t *src);
+
+
+/* A += B for symmetric B. Only elements on and above diagonal of B buffer are read */
+extern int matrix_symAdd(matrix_sym_t *A, const matrix_t *B);
+
+
+/* matrix_patternProd() for packed symmetric B = P. C may be untransposed view */
+extern int matrix_symPatternProd(const matrix_sparsity_t *S, const matrix_t *A, const matrix_sym_t *P, matrix_t *C);
+
+
+/* overwrites C with A * P * transposed(A), reading only elements of A present in pattern S. On return tempC holds A * P */
+extern int matrix_symPatternSandwitch(const matrix_sparsity_t *S, const matrix_t *A, const matrix_sym_t *P, matrix_sym_t *C, matrix_t *tempC);
+
+
+/* matrix_gemmSym() for packed C. Only upper triangle of A * B is computed */
+extern int matrix_symGemm(float alpha, const matrix_t *A, const matrix_t *B, float beta, matrix_sym_t *C);
+
+
+/* overwrites C with A * B * transposed(A) for symmetric B. Only upper triangle of C is computed and mirrored, so C is exactly symmetric */
+extern int matrix_symSandwitch(const matrix_t *A, const matrix_t *B, matrix_t *C, matrix_t *tempC);
+
+
 /* if C is not null perform C = A + B, otherwise A += B */
 extern int matrix_add(matrix_t *A, const matrix_t *B, matrix_t *C);
 
@@ -102,10 +223,48 @@ extern int matrix_sub(matrix_t *A, const matrix_t *B, matrix_t *C);
 extern int matrix_cmp(const matrix_t *A, const matrix_t *B);
 
 
-/* calculates inverse matrix, `buf` have to be twice as big as matrix `A`, bufLen >= A->rows * A->cols * 2 */
+/* calculates inverse matrix, `buf` have to be twice as big as matrix `A`, bufLen >= A->rows * A->cols * 2.
+ * Matrices up to 4x4 are inverted with matrix_inv1() - matrix_inv4() and `buf` is not used */
 extern int matrix_inv(const matrix_t *A, matrix_t *B, float *buf, int buflen);
 
 
+/*
+ * closed form inverses of 1x1 - 4x4 matrices. B may be the same matrix as A.
+ * Returns -1 and leaves B unchanged if A is singular or its inverse is out of float range
+ */
+extern int matrix_inv1(const matrix_t *A, matrix_t *B);
+
+
+extern int matrix_inv2(const matrix_t *A, matrix_t *B);
+
+
+extern int matrix_inv3(const matrix_t *A, matrix_t *B);
+
+
+extern int matrix_inv4(const matrix_t *A, matrix_t *B);
+
+
+/*
+ * Solvers for symmetric matrix A. Only elements on and below diagonal of A buffer are read and A is overwritten with its factorization.
+ * X may be the same matrix as B if B is not transposed. X is not changed if A is not positive definite (Cholesky) or is singular (LDL^T).
+ */
+
+/* overwrites X with inv(A) * B using Cholesky decomposition of positive definite A */
+extern int matrix_cholSolve(matrix_t *A, const matrix_t *B, matrix_t *X);
+
+
+/* overwrites X with B * inv(A) using Cholesky decomposition of positive definite A */
+extern int matrix_cholSolveRight(matrix_t *A, const matrix_t *B, matrix_t *X);
+
+
+/* overwrites X with inv(A) * B using LDL^T decomposition of A */
+extern int matrix_ldltSolve(matrix_t *A, const matrix_t *B, matrix_t *X);
+
+
+/* overwrites X with B * inv(A) using LDL^T decomposition of A */
+extern int matrix_ldltSolveRight(matrix_t *A, const matrix_t *B, matrix_t *X);
+
+
 /* writes submatrix `src` into matrix `dst` beginning from position dst(row, col). Works only for non-transposed matrices */
 extern int matrix_writeSubmatrix(matrix_t *dst, unsigned int row, unsigned int col, const matrix_t *src);
 
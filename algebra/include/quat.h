@@ -111,6 +111,11 @@ extern void quat_uvec2uvec(const vec_t *v1, const vec_t *v2, quat_t *q);
 extern void quat_vecRot(vec_t *vec, const quat_t *qRot);
 
 
+/* rotates `n` vectors stored as separate coordinate arrays in place, as quat_vecRot() does.
+ * Rotation matrix is calculated once for all vectors */
+extern void quat_vecRotBatch(const quat_t *qRot, float *xs, float *ys, float *zs, unsigned int n);
+
+
 /* calculate quaternion, which rotates about `angle` in radians along `axis` */
 extern void quat_rotQuat(const vec_t *axis, float angle, quat_t *q);
 
@@ -52,6 +52,11 @@ extern void vec_cross(const vec_t *A, const vec_t *B, vec_t *C);
 extern float vec_dot(const vec_t *A, const vec_t *B);
 
 
+/* out[i] = dot product of vectors (ax[i], ay[i], az[i]) and (bx[i], by[i], bz[i]) for i in [0, n).
+ * `out` may be the same array as `ax` or `bx` */
+extern void vec_dotBatch(const float *ax, const float *ay, const float *az, const float *bx, const float *by, const float *bz, float *out, unsigned int n);
+
+
 /* multiplies each vector element times scalar 'a' */
 extern void vec_times(vec_t *A, float a);
 
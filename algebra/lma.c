@@ -68,7 +68,8 @@ static void lma_log(unsigned int type, unsigned int flags, fit_lma_t *lma, unsig
 * Solves the delta equation: lma->delta = inv(trp(J) * J + lambda * I) (trp(J) * R)
 *
 * This function manipulates sizes of matrices on its own to minimize the amount of initialized memory needed for calculations.
-* Invalidates contents of: lma->helpPxP[0], lma->helPxP[1], lma->helpPx1 and lma->invBuf.
+* Invalidates contents of: lma->helpPxP[0] and lma->helpPxP[1].
+* Returns -1 if (trp(J) * J + lambda * I) is not positive definite.
 */
 static int lma_solveDelta(float lambda, fit_lma_t *lma)
 {
@@ -83,21 +84,20 @@ static int lma_solveDelta(float lambda, fit_lma_t *lma)
 	matrix_t localPx1;
 	int i;
 
-	/* Storing inverse of (J^t * J + lambda * I)^-1 into helpPxP[1] matrix */
+	/* Storing (J^t * J + lambda * I) into helpPxP[0] matrix */
 	matrix_prod(&Jt, &lma->jacobian, &lma->helpPxP[0]);
 	for (i = 0; i < lma->nparams; i++) {
 		MATRIX_DATA(&lma->helpPxP[0], i, i) += lambda;
 	}
-	matrix_inv(&lma->helpPxP[0], &lma->helpPxP[1], lma->invBuf, lma->invBufLen);
 
-	/* lma->helpPxP[0] is not used anymore. Aliasing it with localPx1 of smaller size */
-	localPx1 = lma->helpPxP[0];
+	/* Aliasing lma->helpPxP[1] with localPx1 of smaller size */
+	localPx1 = lma->helpPxP[1];
 	localPx1.cols = 1;
 
 	matrix_prod(&Jt, &lma->residua, &localPx1);
-	matrix_prod(&lma->helpPxP[1], &localPx1, &lma->delta);
 
-	return 0;
+	/* System matrix is symmetric and positive definite for lambda > 0, so it is solved without inversion */
+	return matrix_cholSolve(&lma->helpPxP[0], &localPx1, &lma->delta);
 }
 
 
@@ -213,7 +213,11 @@ int lma_fit(unsigned int maxSteps, fit_lma_t *lma, unsigned int logFlags)
 		}
 
 		/* (6) */
-		lma_solveDelta(lambda, lma);
+		if (lma_solveDelta(lambda, lma) < 0) {
+			/* system is not positive definite, bigger lambda makes it more diagonally dominant */
+			lambda *= LMA_LAMBDA_PENALTY;
+			continue;
+		}
 
 		/* (7) */
 		matrix_trp(&lma->delta);
@@ -264,10 +268,6 @@ int lma_done(fit_lma_t *lma)
 	matrix_bufFree(&lma->helpPxP[0]);
 	matrix_bufFree(&lma->helpPxP[1]);
 
-	free(lma->invBuf);
-	lma->invBuf = NULL;
-	lma->invBufLen = 0;
-
 	return 0;
 }
 
@@ -300,10 +300,7 @@ int lma_init(unsigned int nvars, unsigned int nparams, unsigned int n, lmaJacobi
 	err |= matrix_bufAlloc(&tmp.helpPxP[0], tmp.nparams, tmp.nparams);
 	err |= matrix_bufAlloc(&tmp.helpPxP[1], tmp.nparams, tmp.nparams);
 
-	tmp.invBufLen = 2 * tmp.nparams * tmp.nparams;
-	tmp.invBuf = calloc(tmp.invBufLen, sizeof(float));
-
-	if (tmp.invBuf == NULL || err != 0) {
+	if (err != 0) {
 		lma_done(&tmp);
 		return -1;
 	}
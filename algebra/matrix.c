@@ -15,8 +15,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <math.h>
+#include <float.h>
 
 #include "matrix.h"
+#include "matrix_simd.h"
 
 float *buf = NULL;
 unsigned int buflen = 0;
@@ -30,20 +33,22 @@ int matrix_bufAlloc(matrix_t *matrix, unsigned int rows, unsigned int cols)
 		return -1;
 	}
 
-	/* check for calloc 'nitems' overflow */
-	if (SIZE_MAX / rows < cols) {
+	/* check for allocation size overflow */
+	if (SIZE_MAX / sizeof(float) / rows < cols) {
 		return -1;
 	}
 
-	data = calloc(rows * cols, sizeof(float));
-	if (data == NULL) {
+	/* aligned buffer lets SIMD kernels start rows of square and vector matrices on aligned addresses */
+	if (posix_memalign((void **)&data, MATRIX_ALIGN, rows * cols * sizeof(float)) != 0) {
 		return -1;
 	}
+	memset(data, 0, rows * cols * sizeof(float));
 
 	matrix->rows = rows;
 	matrix->cols = cols;
 	matrix->transposed = 0;
 	matrix->data = data;
+	matrix->stride = 0;
 
 	return 0;
 }
@@ -62,7 +67,7 @@ void matrix_print(const matrix_t *A)
 	if (A->transposed) {
 		for (row = 0; row < A->cols; row++) {
 			for (col = 0; col < A->rows; col++) {
-				printf("%f ", A->data[row + A->cols * col]);
+				printf("%f ", A->data[row + matrix_strideGet(A) * col]);
 			}
 			printf("\n");
 		}
@@ -70,7 +75,7 @@ void matrix_print(const matrix_t *A)
 	else {
 		for (row = 0; row < A->rows; row++) {
 			for (col = 0; col < A->cols; col++) {
-				printf("%f ", A->data[col + A->cols * row]);
+				printf("%f ", A->data[col + matrix_strideGet(A) * row]);
 			}
 			printf("\n");
 		}
@@ -81,14 +86,46 @@ void matrix_print(const matrix_t *A)
 /* get element (row, col) from M that is transposed */
 static inline float pos_trpd(const matrix_t *M, unsigned int row, unsigned int col)
 {
-	return M->data[M->cols * col + row];
+	return M->data[matrix_strideGet(M) * col + row];
 }
 
 
 /* get element (row, col) from M that is not transposed */
 static inline float pos_norm(const matrix_t *M, unsigned int row, unsigned int col)
 {
-	return M->data[M->cols * row + col];
+	return M->data[matrix_strideGet(M) * row + col];
+}
+
+
+/* returns 1 if rows of M buffer are stored without gaps */
+static inline int matrix_isDense(const matrix_t *M)
+{
+	return M->stride == 0 || M->stride == M->cols;
+}
+
+
+int matrix_view(const matrix_t *A, unsigned int row, unsigned int col, unsigned int rows, unsigned int cols, matrix_t *view)
+{
+	if (row + rows > matrix_rowsGet(A) || col + cols > matrix_colsGet(A)) {
+		return -1;
+	}
+
+	view->stride = matrix_strideGet(A);
+	view->transposed = A->transposed;
+
+	/* transposed view is a transposed submatrix of A buffer */
+	if (A->transposed) {
+		view->rows = cols;
+		view->cols = rows;
+		view->data = &A->data[view->stride * col + row];
+	}
+	else {
+		view->rows = rows;
+		view->cols = cols;
+		view->data = &A->data[view->stride * row + col];
+	}
+
+	return 0;
 }
 
 
@@ -98,30 +135,203 @@ void matrix_trp(matrix_t *A)
 }
 
 
+/*
+ * Product kernels, one for each transposition variant of A and B.
+ * `a` and `b` are data buffers of A and B with row strides `lda` and `ldb`, `c` is data buffer of non-transposed result
+ * of size `rows` x `cols` with row stride `ldc` and `steps` is the common dimension of A and B.
+ * Inner loops are done by vector primitives from matrix_simd.h.
+ */
+
+/* no matrix is transposed: rows of C are accumulated from rows of B */
+static inline void matrix_prodNN(const float *a, unsigned int lda, const float *b, unsigned int ldb, float *c, unsigned int ldc, unsigned int rows, unsigned int steps, unsigned int cols)
+{
+	unsigned int row, step;
+
+	for (row = 0; row < rows; row++) {
+		memset(&c[ldc * row], 0, cols * sizeof(float));
+		for (step = 0; step < steps; step++) {
+			matrix_vecAxpy(&c[ldc * row], &b[ldb * step], a[lda * row + step], cols);
+		}
+	}
+}
+
+
+/* only A is transposed: rows of C are accumulated from rows of B */
+static inline void matrix_prodTN(const float *a, unsigned int lda, const float *b, unsigned int ldb, float *c, unsigned int ldc, unsigned int rows, unsigned int steps, unsigned int cols)
+{
+	unsigned int row, step;
+
+	for (row = 0; row < rows; row++) {
+		memset(&c[ldc * row], 0, cols * sizeof(float));
+		for (step = 0; step < steps; step++) {
+			matrix_vecAxpy(&c[ldc * row], &b[ldb * step], a[lda * step + row], cols);
+		}
+	}
+}
+
+
+/* only B is transposed: elements of C are dot products of rows of A and B buffers */
+static inline void matrix_prodNT(const float *a, unsigned int lda, const float *b, unsigned int ldb, float *c, unsigned int ldc, unsigned int rows, unsigned int steps, unsigned int cols)
+{
+	unsigned int row, col;
+
+	for (row = 0; row < rows; row++) {
+		for (col = 0; col < cols; col++) {
+			c[ldc * row + col] = matrix_vecDot(&a[lda * row], &b[ldb * col], steps);
+		}
+	}
+}
+
+
+/* both matrices transposed: columns of C are accumulated from rows of A buffer, MATRIX_PROD_BLOCK rows at once */
+#define MATRIX_PROD_BLOCK 16
+
+static inline void matrix_prodTT(const float *a, unsigned int lda, const float *b, unsigned int ldb, float *c, unsigned int ldc, unsigned int rows, unsigned int steps, unsigned int cols)
+{
+	unsigned int row, col, step, i, len;
+	float part[MATRIX_PROD_BLOCK];
+
+	for (col = 0; col < cols; col++) {
+		for (row = 0; row < rows; row += MATRIX_PROD_BLOCK) {
+			len = (rows - row < MATRIX_PROD_BLOCK) ? rows - row : MATRIX_PROD_BLOCK;
+
+			memset(part, 0, len * sizeof(float));
+			for (step = 0; step < steps; step++) {
+				matrix_vecAxpy(part, &a[lda * step + row], b[ldb * col + step], len);
+			}
+
+			for (i = 0; i < len; i++) {
+				c[ldc * (row + i) + col] = part[i];
+			}
+		}
+	}
+}
+
+
+/*
+ * Fixed-size product kernels.
+ *
+ * EKF multiplies only a handful of constant shapes (state length 16, measurement lengths 6, 4 and 1).
+ * Every shape listed in MATRIX_PROD_FIXED_SHAPES gets its own kernel in which all loop bounds and strides
+ * are compile-time constants, so the compiler is free to unroll and schedule them.
+ * Shapes are given as (rows of A, cols of A/rows of B, cols of B).
+ */
+#define MATRIX_PROD_FIXED_SHAPES(X) \
+	X(16, 16, 16) \
+	X(6, 16, 16) \
+	X(6, 16, 6) \
+	X(16, 16, 6) \
+	X(16, 6, 6) \
+	X(16, 6, 1) \
+	X(16, 6, 16) \
+	X(4, 16, 16) \
+	X(4, 16, 4) \
+	X(16, 16, 4) \
+	X(16, 4, 4) \
+	X(16, 4, 1) \
+	X(16, 4, 16) \
+	X(1, 16, 16) \
+	X(1, 16, 1) \
+	X(16, 16, 1) \
+	X(16, 1, 1) \
+	X(16, 1, 16)
+
+
+typedef void (*matrix_prodKernel)(const matrix_t *A, const matrix_t *B, float *c);
+
+
+#define MATRIX_PROD_FIXED_DEFINE(R, K, C) \
+	static void matrix_prod_##R##x##K##x##C(const matrix_t *A, const matrix_t *B, float *c) \
+	{ \
+		if (A->transposed) { \
+			if (B->transposed) { \
+				matrix_prodTT(A->data, R, B->data, K, c, C, R, K, C); \
+			} \
+			else { \
+				matrix_prodTN(A->data, R, B->data, C, c, C, R, K, C); \
+			} \
+		} \
+		else { \
+			if (B->transposed) { \
+				matrix_prodNT(A->data, K, B->data, K, c, C, R, K, C); \
+			} \
+			else { \
+				matrix_prodNN(A->data, K, B->data, C, c, C, R, K, C); \
+			} \
+		} \
+	}
+
+
+#define MATRIX_PROD_FIXED_ENTRY(R, K, C) { R, K, C, matrix_prod_##R##x##K##x##C },
+
+
+MATRIX_PROD_FIXED_SHAPES(MATRIX_PROD_FIXED_DEFINE)
+
+
+static const struct {
+	unsigned int rows;
+	unsigned int steps;
+	unsigned int cols;
+	matrix_prodKernel kernel;
+} matrix_prodFixedTable[] = { MATRIX_PROD_FIXED_SHAPES(MATRIX_PROD_FIXED_ENTRY) };
+
+
+/* Returns fixed-size kernel computing A * B into dense matrix of `rows` x `cols` size, NULL if there is none or sizes are invalid */
+static matrix_prodKernel matrix_prodFixedGet(const matrix_t *A, const matrix_t *B, unsigned int rows, unsigned int cols)
+{
+	const unsigned int steps = matrix_colsGet(A);
+	unsigned int i;
+
+	if (steps != matrix_rowsGet(B) || rows != matrix_rowsGet(A) || cols != matrix_colsGet(B)) {
+		return NULL;
+	}
+
+	/* kernels use strides derived from sizes */
+	if (!matrix_isDense(A) || !matrix_isDense(B)) {
+		return NULL;
+	}
+
+	for (i = 0; i < sizeof(matrix_prodFixedTable) / sizeof(matrix_prodFixedTable[0]); i++) {
+		if (matrix_prodFixedTable[i].rows == rows && matrix_prodFixedTable[i].steps == steps && matrix_prodFixedTable[i].cols == cols) {
+			return matrix_prodFixedTable[i].kernel;
+		}
+	}
+
+	return NULL;
+}
+
+
 int matrix_prod(const matrix_t *A, const matrix_t *B, matrix_t *C)
 {
-	unsigned int row, col;                               /* represent position in output C matrix */
-	unsigned int step;                                   /* represent stepping down over rows/columns in A and B */
-	const unsigned int Acols = A->cols, Bcols = B->cols; /* rewritten Acols and Bcols for better performance */
-	float currC;
 	matrix_t tmp = { .data = C->data, .rows = matrix_rowsGet(C), .cols = matrix_colsGet(C), .transposed = 0 };
+	const unsigned int lda = matrix_strideGet(A), ldb = matrix_strideGet(B);
+	unsigned int ldc = tmp.cols;
+	matrix_prodKernel kernel = NULL;
 
-	if (A->transposed) {
+	/* result is written as non-transposed, which is not possible for transposed view */
+	if (!matrix_isDense(C)) {
+		if (C->transposed) {
+			return -1;
+		}
+		ldc = C->stride;
+	}
+
+	/* Shapes known at compile time are handled by specialized kernels */
+	if (ldc == tmp.cols) {
+		kernel = matrix_prodFixedGet(A, B, tmp.rows, tmp.cols);
+	}
+
+	if (kernel != NULL) {
+		kernel(A, B, tmp.data);
+	}
+	else if (A->transposed) {
 		if (B->transposed) {
 			/* both transposed logic */
 			if (A->rows != B->cols || tmp.cols != B->rows || tmp.rows != A->cols) {
 				return -1;
 			}
 
-			for (row = 0; row < tmp.rows; row++) {
-				for (col = 0; col < tmp.cols; col++) {
-					currC = 0;
-					for (step = 0; step < A->rows; step++) {
-						currC += A->data[row + Acols * step] * B->data[step + Bcols * col];
-					}
-					tmp.data[col + tmp.cols * row] = currC;
-				}
-			}
+			matrix_prodTT(A->data, lda, B->data, ldb, tmp.data, ldc, tmp.rows, A->rows, tmp.cols);
 		}
 		else {
 			/* only A is transposed */
@@ -129,34 +339,17 @@ int matrix_prod(const matrix_t *A, const matrix_t *B, matrix_t *C)
 				return -1;
 			}
 
-			for (row = 0; row < tmp.rows; row++) {
-				for (col = 0; col < tmp.cols; col++) {
-					currC = 0;
-					for (step = 0; step < A->rows; step++) {
-						currC += A->data[row + Acols * step] * B->data[col + Bcols * step];
-					}
-					tmp.data[col + tmp.cols * row] = currC;
-				}
-			}
+			matrix_prodTN(A->data, lda, B->data, ldb, tmp.data, ldc, tmp.rows, A->rows, tmp.cols);
 		}
 	}
 	else {
-		row = A->rows;
 		if (B->transposed) {
 			/* only B transposed logic */
 			if (A->cols != B->cols || tmp.cols != B->rows || tmp.rows != A->rows) {
 				return -1;
 			}
 
-			for (row = 0; row < tmp.rows; row++) {
-				for (col = 0; col < tmp.cols; col++) {
-					currC = 0;
-					for (step = 0; step < Acols; step++) {
-						currC += A->data[step + Acols * row] * B->data[step + Bcols * col];
-					}
-					tmp.data[col + tmp.cols * row] = currC;
-				}
-			}
+			matrix_prodNT(A->data, lda, B->data, ldb, tmp.data, ldc, tmp.rows, A->cols, tmp.cols);
 		}
 		else {
 			/* no matrix is transposed */
@@ -164,15 +357,7 @@ int matrix_prod(const matrix_t *A, const matrix_t *B, matrix_t *C)
 				return -1;
 			}
 
-			for (row = 0; row < tmp.rows; row++) {
-				for (col = 0; col < tmp.cols; col++) {
-					currC = 0;
-					for (step = 0; step < A->cols; step++) {
-						currC += A->data[step + Acols * row] * B->data[col + Bcols * step];
-					}
-					tmp.data[col + tmp.cols * row] = currC;
-				}
-			}
+			matrix_prodNN(A->data, lda, B->data, ldb, tmp.data, ldc, tmp.rows, A->cols, tmp.cols);
 		}
 	}
 
@@ -184,6 +369,144 @@ int matrix_prod(const matrix_t *A, const matrix_t *B, matrix_t *C)
 }
 
 
+/* returns logical element (`row`, `col`) of M */
+static inline float matrix_elemGet(const matrix_t *M, unsigned int row, unsigned int col)
+{
+	return (M->transposed) ? pos_trpd(M, row, col) : pos_norm(M, row, col);
+}
+
+
+/* returns alpha * `ab` + beta * `c`, `c` is not read if beta is 0 */
+static inline float matrix_gemmElem(float alpha, float ab, float beta, float c)
+{
+	return (beta == 0) ? alpha * ab : alpha * ab + beta * c;
+}
+
+
+/* returns (`row`, `col`) element of A * B. A rows and B columns are contiguous only for untransposed A and transposed B */
+static inline float matrix_prodElem(const matrix_t *A, const matrix_t *B, unsigned int row, unsigned int col, unsigned int steps)
+{
+	unsigned int step;
+	float sum = 0;
+
+	if (!A->transposed && B->transposed) {
+		return matrix_vecDot(&A->data[matrix_strideGet(A) * row], &B->data[matrix_strideGet(B) * col], steps);
+	}
+
+	for (step = 0; step < steps; step++) {
+		sum += matrix_elemGet(A, row, step) * matrix_elemGet(B, step, col);
+	}
+
+	return sum;
+}
+
+
+/* `c` = alpha * A * B + beta * `c`, where `c` is untransposed buffer of `rows` x `cols` size with row stride `ldc` */
+static void matrix_gemmKernel(float alpha, const matrix_t *A, const matrix_t *B, float beta, float *c, unsigned int ldc, unsigned int rows, unsigned int steps, unsigned int cols)
+{
+	const unsigned int ldb = matrix_strideGet(B);
+	unsigned int row, col, step;
+	float *cRow;
+
+	for (row = 0; row < rows; row++) {
+		cRow = &c[ldc * row];
+
+		if (B->transposed) {
+			for (col = 0; col < cols; col++) {
+				cRow[col] = matrix_gemmElem(alpha, matrix_prodElem(A, B, row, col, steps), beta, cRow[col]);
+			}
+			continue;
+		}
+
+		/* rows of B are contiguous, so row of C is scaled by beta and accumulated from them */
+		if (beta == 0) {
+			memset(cRow, 0, cols * sizeof(float));
+		}
+		else if (beta != 1) {
+			matrix_vecScale(cRow, cRow, beta, cols);
+		}
+
+		for (step = 0; step < steps; step++) {
+			matrix_vecAxpy(cRow, &B->data[ldb * step], alpha * matrix_elemGet(A, row, step), cols);
+		}
+	}
+}
+
+
+int matrix_gemm(float alpha, const matrix_t *A, const matrix_t *B, float beta, matrix_t *C)
+{
+	matrix_t trpA = *A, trpB = *B;
+
+	if (matrix_colsGet(A) != matrix_rowsGet(B) || matrix_rowsGet(C) != matrix_rowsGet(A) || matrix_colsGet(C) != matrix_colsGet(B)) {
+		return -1;
+	}
+
+	if (!C->transposed) {
+		matrix_gemmKernel(alpha, A, B, beta, C->data, matrix_strideGet(C), C->rows, matrix_colsGet(A), C->cols);
+		return 0;
+	}
+
+	/* buffer of transposed C is untransposed C^T = alpha * B^T * A^T + beta * C^T */
+	trpA.transposed = !A->transposed;
+	trpB.transposed = !B->transposed;
+	matrix_gemmKernel(alpha, &trpB, &trpA, beta, C->data, matrix_strideGet(C), C->rows, matrix_colsGet(A), C->cols);
+
+	return 0;
+}
+
+
+/* `c` = alpha * A * B + beta * `c` on elements [`row`, `n`) of row `row`, which is the upper part of the row of symmetric product */
+static void matrix_gemmUpperRow(float alpha, const matrix_t *A, const matrix_t *B, float beta, float *c, unsigned int row, unsigned int n, unsigned int steps)
+{
+	const unsigned int ldb = matrix_strideGet(B), len = n - row;
+	unsigned int col, step;
+
+	if (B->transposed) {
+		for (col = 0; col < len; col++) {
+			c[col] = matrix_gemmElem(alpha, matrix_prodElem(A, B, row, row + col, steps), beta, c[col]);
+		}
+		return;
+	}
+
+	/* upper part of the row is accumulated from contiguous rows of B, as in matrix_gemmKernel() */
+	if (beta == 0) {
+		memset(c, 0, len * sizeof(float));
+	}
+	else if (beta != 1) {
+		matrix_vecScale(c, c, beta, len);
+	}
+
+	for (step = 0; step < steps; step++) {
+		matrix_vecAxpy(c, &B->data[ldb * step + row], alpha * matrix_elemGet(A, row, step), len);
+	}
+}
+
+
+int matrix_gemmSym(float alpha, const matrix_t *A, const matrix_t *B, float beta, matrix_t *C)
+{
+	const unsigned int n = C->rows, ldc = matrix_strideGet(C), steps = matrix_colsGet(A);
+	unsigned int row, col;
+	float *cRow;
+
+	if (C->rows != C->cols || matrix_rowsGet(A) != n || matrix_colsGet(B) != n || matrix_rowsGet(B) != steps) {
+		return -1;
+	}
+
+	/* C is symmetric, so its transposition flag does not change element positions */
+	for (row = 0; row < n; row++) {
+		cRow = &C->data[ldc * row];
+		matrix_gemmUpperRow(alpha, A, B, beta, &cRow[row], row, n, steps);
+
+		/* lower part of following rows is never read, so it is filled right away */
+		for (col = row + 1; col < n; col++) {
+			C->data[ldc * col + row] = cRow[col];
+		}
+	}
+
+	return 0;
+}
+
+
 int matrix_sparseProd(const matrix_t *A, const matrix_t *B, matrix_t *C)
 {
 	unsigned int row, col; /* represent position in output A matrix */
@@ -191,6 +514,10 @@ int matrix_sparseProd(const matrix_t *A, const matrix_t *B, matrix_t *C)
 	float currA;
 	matrix_t tmp = { .data = C->data, .rows = matrix_rowsGet(C), .cols = matrix_colsGet(C), .transposed = 0 };
 
+	if (!matrix_isDense(A) || !matrix_isDense(B) || !matrix_isDense(C)) {
+		return -1;
+	}
+
 	if (A->transposed) {
 		if (B->transposed) {
 			/* both matrix transposed */
@@ -221,9 +548,7 @@ int matrix_sparseProd(const matrix_t *A, const matrix_t *B, matrix_t *C)
 				for (col = 0; col < A->rows; col++) {
 					currA = A->data[A->cols * col + row];
 					if (currA != 0) {
-						for (step = 0; step < tmp.cols; step++) {
-							tmp.data[row * tmp.cols + step] += currA * B->data[B->cols * col + step];
-						}
+						matrix_vecAxpy(&tmp.data[row * tmp.cols], &B->data[B->cols * col], currA, tmp.cols);
 					}
 				}
 			}
@@ -260,37 +585,412 @@ int matrix_sparseProd(const matrix_t *A, const matrix_t *B, matrix_t *C)
 				for (col = 0; col < A->cols; col++) {
 					currA = A->data[A->cols * row + col];
 
-					if (currA != 0) {
-						for (step = 0; step < tmp.cols; step++) {
-							tmp.data[row * tmp.cols + step] += currA * B->data[B->cols * col + step];
-						}
-					}
-				}
+					if (currA != 0) {
+						matrix_vecAxpy(&tmp.data[row * tmp.cols], &B->data[B->cols * col], currA, tmp.cols);
+					}
+				}
+			}
+		}
+	}
+
+	C->cols = tmp.cols;
+	C->rows = tmp.rows;
+	C->transposed = tmp.transposed;
+
+	return 0;
+}
+
+
+static inline int matrix_sandwitchValid(const matrix_t *A, const matrix_t *B, const matrix_t *C, const matrix_t *tempC)
+{
+	unsigned int colsA = matrix_colsGet(A), rowsA = matrix_rowsGet(A);
+	unsigned int colsB = matrix_colsGet(B), rowsB = matrix_rowsGet(B);
+	unsigned int colsC = matrix_colsGet(C), rowsC = matrix_rowsGet(C);
+	unsigned int colsTempC = matrix_colsGet(tempC), rowsTempC = matrix_rowsGet(tempC);
+
+	if (!matrix_isDense(A) || !matrix_isDense(B) || !matrix_isDense(C) || !matrix_isDense(tempC)) {
+		return 0;
+	}
+
+	return colsA == rowsB && rowsA == rowsTempC && colsB == colsTempC && /* First multiplication */
+		colsTempC == colsA && rowsTempC == rowsC && rowsA == colsC;      /* Second multiplication */
+}
+
+
+int matrix_sparseSandwitch(const matrix_t *A, const matrix_t *B, matrix_t *C, matrix_t *tempC)
+{
+	const matrix_t trpA = { .data = A->data, .rows = A->rows, .cols = A->cols, .transposed = !A->transposed };
+
+	if (!matrix_sandwitchValid(A, B, C, tempC)) {
+		return -1;
+	}
+
+	matrix_sparseProd(A, B, tempC);
+	matrix_sparseProd(tempC, &trpA, C);
+	return 0;
+}
+
+
+int matrix_sparsityAlloc(matrix_sparsity_t *S, const matrix_t *A)
+{
+	const unsigned int rows = matrix_rowsGet(A), cols = matrix_colsGet(A);
+	unsigned int row, col, nnz = 0;
+
+	for (row = 0; row < rows; row++) {
+		for (col = 0; col < cols; col++) {
+			if (*matrix_at(A, row, col) != 0) {
+				nnz++;
+			}
+		}
+	}
+
+	/* row offsets and column indices share one buffer */
+	S->rowStart = malloc((rows + 1 + nnz) * sizeof(unsigned int));
+	if (S->rowStart == NULL) {
+		return -1;
+	}
+	S->colIdx = &S->rowStart[rows + 1];
+	S->rows = rows;
+	S->cols = cols;
+	S->nnz = 0;
+
+	for (row = 0; row < rows; row++) {
+		S->rowStart[row] = S->nnz;
+		for (col = 0; col < cols; col++) {
+			if (*matrix_at(A, row, col) != 0) {
+				S->colIdx[S->nnz++] = col;
+			}
+		}
+	}
+	S->rowStart[rows] = S->nnz;
+
+	return 0;
+}
+
+
+void matrix_sparsityFree(matrix_sparsity_t *S)
+{
+	free(S->rowStart);
+	S->rowStart = NULL;
+	S->colIdx = NULL;
+}
+
+
+/* Writes row `row` of A * B into `c` of length `cols`. Only elements of A present in S are read */
+static inline void matrix_patternRow(const matrix_sparsity_t *S, const matrix_t *A, const matrix_t *B, unsigned int row, float *c, unsigned int cols)
+{
+	const unsigned int ldb = matrix_strideGet(B), first = S->rowStart[row], end = S->rowStart[row + 1];
+	unsigned int i, k, col;
+	float sum;
+
+	if (first == end) {
+		memset(c, 0, cols * sizeof(float));
+		return;
+	}
+
+	if (B->transposed) {
+		/* row `k` of transposed B is a column of its buffer, so sparse dot products are used */
+		for (col = 0; col < cols; col++) {
+			sum = 0;
+			for (i = first; i < end; i++) {
+				k = S->colIdx[i];
+				sum += matrix_elemGet(A, row, k) * B->data[ldb * col + k];
+			}
+			c[col] = sum;
+		}
+		return;
+	}
+
+	/* first nonzero initializes `c`, so no memset is needed */
+	k = S->colIdx[first];
+	matrix_vecScale(c, &B->data[ldb * k], matrix_elemGet(A, row, k), cols);
+
+	for (i = first + 1; i < end; i++) {
+		k = S->colIdx[i];
+		matrix_vecAxpy(c, &B->data[ldb * k], matrix_elemGet(A, row, k), cols);
+	}
+}
+
+
+int matrix_patternProd(const matrix_sparsity_t *S, const matrix_t *A, const matrix_t *B, matrix_t *C)
+{
+	const unsigned int rows = matrix_rowsGet(A), steps = matrix_colsGet(A), cols = matrix_colsGet(B);
+	unsigned int row, ldc = cols;
+
+	if (S->rows != rows || S->cols != steps || matrix_rowsGet(B) != steps) {
+		return -1;
+	}
+
+	if (matrix_rowsGet(C) != rows || matrix_colsGet(C) != cols) {
+		return -1;
+	}
+
+	/* result is written as non-transposed, which is not possible for transposed view */
+	if (!matrix_isDense(C)) {
+		if (C->transposed) {
+			return -1;
+		}
+		ldc = C->stride;
+	}
+
+	for (row = 0; row < rows; row++) {
+		matrix_patternRow(S, A, B, row, &C->data[ldc * row], cols);
+	}
+
+	if (matrix_isDense(C)) {
+		C->rows = rows;
+		C->cols = cols;
+		C->transposed = 0;
+	}
+
+	return 0;
+}
+
+
+int matrix_patternSandwitch(const matrix_sparsity_t *S, const matrix_t *A, const matrix_t *B, matrix_t *C, matrix_t *tempC)
+{
+	const unsigned int n = matrix_rowsGet(A);
+	unsigned int row, col, i, k;
+	const float *t;
+	float sum;
+
+	if (!matrix_sandwitchValid(A, B, C, tempC) || S->rows != n || S->cols != matrix_colsGet(A)) {
+		return -1;
+	}
+
+	matrix_patternProd(S, A, B, tempC);
+
+	/* element (row, col) of tempC * transposed(A) is a dot product of tempC row and A row `col` over nonzeros of the latter */
+	for (row = 0; row < n; row++) {
+		t = &tempC->data[tempC->cols * row];
+		for (col = row; col < n; col++) {
+			sum = 0;
+			for (i = S->rowStart[col]; i < S->rowStart[col + 1]; i++) {
+				k = S->colIdx[i];
+				sum += t[k] * matrix_elemGet(A, col, k);
+			}
+			C->data[n * row + col] = sum;
+			C->data[n * col + row] = sum;
+		}
+	}
+
+	C->rows = n;
+	C->cols = n;
+	C->transposed = 0;
+
+	return 0;
+}
+
+
+int matrix_symAlloc(matrix_sym_t *A, unsigned int n)
+{
+	size_t len;
+
+	if (n == 0) {
+		return -1;
+	}
+
+	/* check for allocation size overflow, n * (n + 1) is twice the packed length */
+	if (SIZE_MAX / sizeof(float) / n < (size_t)n + 1) {
+		return -1;
+	}
+	len = MATRIX_SYM_LEN((size_t)n) * sizeof(float);
+
+	if (posix_memalign((void **)&A->data, MATRIX_ALIGN, len) != 0) {
+		A->data = NULL;
+		return -1;
+	}
+	memset(A->data, 0, len);
+	A->n = n;
+
+	return 0;
+}
+
+
+void matrix_symFree(matrix_sym_t *A)
+{
+	free(A->data);
+	A->data = NULL;
+}
+
+
+void matrix_symPrint(const matrix_sym_t *A)
+{
+	unsigned int row, col;
+
+	for (row = 0; row < A->n; row++) {
+		for (col = 0; col < A->n; col++) {
+			printf("%.7g  ", A->data[matrix_symIdx(A, row, col)]);
+		}
+		printf("\n");
+	}
+}
+
+
+int matrix_symPack(const matrix_t *A, matrix_sym_t *S)
+{
+	const unsigned int n = S->n, lda = matrix_strideGet(A);
+	unsigned int row;
+	float *s = S->data;
+
+	if (A->rows != n || A->cols != n) {
+		return -1;
+	}
+
+	/* A is symmetric, so its transposition flag does not change element positions */
+	for (row = 0; row < n; row++) {
+		memcpy(s, &A->data[lda * row + row], (n - row) * sizeof(float));
+		s += n - row;
+	}
+
+	return 0;
+}
+
+
+int matrix_symUnpack(const matrix_sym_t *S, matrix_t *A)
+{
+	const unsigned int n = S->n, lda = matrix_strideGet(A);
+	unsigned int row, col;
+	const float *s = S->data;
+
+	if (A->rows != n || A->cols != n) {
+		return -1;
+	}
+
+	for (row = 0; row < n; row++) {
+		for (col = row; col < n; col++, s++) {
+			A->data[lda * row + col] = *s;
+			A->data[lda * col + row] = *s;
+		}
+	}
+
+	return 0;
+}
+
+
+int matrix_symCopy(matrix_sym_t *dst, const matrix_sym_t *src)
+{
+	if (dst->n != src->n) {
+		return -1;
+	}
+
+	memcpy(dst->data, src->data, MATRIX_SYM_LEN(src->n) * sizeof(float));
+
+	return 0;
+}
+
+
+int matrix_symAdd(matrix_sym_t *A, const matrix_t *B)
+{
+	const unsigned int n = A->n, ldb = matrix_strideGet(B);
+	unsigned int row, col;
+	float *a = A->data;
+
+	if (B->rows != n || B->cols != n) {
+		return -1;
+	}
+
+	for (row = 0; row < n; row++) {
+		for (col = row; col < n; col++) {
+			*(a++) += B->data[ldb * row + col];
+		}
+	}
+
+	return 0;
+}
+
+
+int matrix_symPatternProd(const matrix_sparsity_t *S, const matrix_t *A, const matrix_sym_t *P, matrix_t *C)
+{
+	const unsigned int rows = matrix_rowsGet(A), n = P->n, ldc = matrix_strideGet(C);
+	unsigned int row, i, k, l, idx;
+	float a, *c;
+
+	if (S->rows != rows || S->cols != n || matrix_colsGet(A) != n) {
+		return -1;
+	}
+
+	/* result is written as non-transposed, so transposed C is accepted only if it is dense and gets overwritten */
+	if (matrix_rowsGet(C) != rows || matrix_colsGet(C) != n || (C->transposed && !matrix_isDense(C))) {
+		return -1;
+	}
+
+	if (matrix_isDense(C)) {
+		C->rows = rows;
+		C->cols = n;
+		C->transposed = 0;
+	}
+
+	for (row = 0; row < rows; row++) {
+		c = &C->data[ldc * row];
+		memset(c, 0, n * sizeof(float));
+
+		/* row `k` of P is its packed part from diagonal to the right, followed by column `k` read downwards above the diagonal */
+		for (i = S->rowStart[row]; i < S->rowStart[row + 1]; i++) {
+			k = S->colIdx[i];
+			a = matrix_elemGet(A, row, k);
+
+			idx = k;
+			for (l = 0; l < k; l++) {
+				c[l] += a * P->data[idx];
+				idx += n - l - 1;
+			}
+			matrix_vecAxpy(&c[k], &P->data[idx], a, n - k);
+		}
+	}
+
+	return 0;
+}
+
+
+int matrix_symPatternSandwitch(const matrix_sparsity_t *S, const matrix_t *A, const matrix_sym_t *P, matrix_sym_t *C, matrix_t *tempC)
+{
+	const unsigned int n = matrix_rowsGet(A);
+	unsigned int row, col, i, k;
+	const float *t;
+	float sum, *c = C->data;
+
+	if (C->n != n || matrix_symPatternProd(S, A, P, tempC) < 0) {
+		return -1;
+	}
+
+	/* element (row, col) of tempC * transposed(A) is a dot product of tempC row and A row `col` over nonzeros of the latter */
+	for (row = 0; row < n; row++) {
+		t = &tempC->data[matrix_strideGet(tempC) * row];
+		for (col = row; col < n; col++) {
+			sum = 0;
+			for (i = S->rowStart[col]; i < S->rowStart[col + 1]; i++) {
+				k = S->colIdx[i];
+				sum += t[k] * matrix_elemGet(A, col, k);
 			}
+			*(c++) = sum;
 		}
 	}
 
-	C->cols = tmp.cols;
-	C->rows = tmp.rows;
-	C->transposed = tmp.transposed;
-
 	return 0;
 }
 
 
-static inline int matrix_sandwitchValid(const matrix_t *A, const matrix_t *B, const matrix_t *C, const matrix_t *tempC)
+int matrix_symGemm(float alpha, const matrix_t *A, const matrix_t *B, float beta, matrix_sym_t *C)
 {
-	unsigned int colsA = matrix_colsGet(A), rowsA = matrix_rowsGet(A);
-	unsigned int colsB = matrix_colsGet(B), rowsB = matrix_rowsGet(B);
-	unsigned int colsC = matrix_colsGet(C), rowsC = matrix_rowsGet(C);
-	unsigned int colsTempC = matrix_colsGet(tempC), rowsTempC = matrix_rowsGet(tempC);
+	const unsigned int n = C->n, steps = matrix_colsGet(A);
+	unsigned int row;
+	float *c = C->data;
 
-	return colsA == rowsB && rowsA == rowsTempC && colsB == colsTempC && /* First multiplication */
-		colsTempC == colsA && rowsTempC == rowsC && rowsA == colsC;      /* Second multiplication */
+	if (matrix_rowsGet(A) != n || matrix_colsGet(B) != n || matrix_rowsGet(B) != steps) {
+		return -1;
+	}
+
+	for (row = 0; row < n; row++) {
+		matrix_gemmUpperRow(alpha, A, B, beta, c, row, n, steps);
+		c += n - row;
+	}
+
+	return 0;
 }
 
 
-int matrix_sparseSandwitch(const matrix_t *A, const matrix_t *B, matrix_t *C, matrix_t *tempC)
+int matrix_sandwitch(const matrix_t *A, const matrix_t *B, matrix_t *C, matrix_t *tempC)
 {
 	const matrix_t trpA = { .data = A->data, .rows = A->rows, .cols = A->cols, .transposed = !A->transposed };
 
@@ -298,22 +998,60 @@ int matrix_sparseSandwitch(const matrix_t *A, const matrix_t *B, matrix_t *C, ma
 		return -1;
 	}
 
-	matrix_sparseProd(A, B, tempC);
-	matrix_sparseProd(tempC, &trpA, C);
+	matrix_prod(A, B, tempC);
+	matrix_prod(tempC, &trpA, C);
 	return 0;
 }
 
 
-int matrix_sandwitch(const matrix_t *A, const matrix_t *B, matrix_t *C, matrix_t *tempC)
+/* Computes upper triangle of C = T * transposed(A), where T is non-transposed buffer of size rowsA x colsA, and mirrors it */
+static void matrix_symProdTrp(const matrix_t *A, const float *t, matrix_t *C)
 {
-	const matrix_t trpA = { .data = A->data, .rows = A->rows, .cols = A->cols, .transposed = !A->transposed };
+	const unsigned int n = matrix_rowsGet(A), m = matrix_colsGet(A);
+	unsigned int row, col, step;
+
+	if (A->transposed) {
+		/* row of C is accumulated from contiguous rows of A buffer */
+		for (row = 0; row < n; row++) {
+			memset(&C->data[n * row + row], 0, (n - row) * sizeof(float));
+			for (step = 0; step < m; step++) {
+				matrix_vecAxpy(&C->data[n * row + row], &A->data[n * step + row], t[m * row + step], n - row);
+			}
+		}
+	}
+	else {
+		/* elements of C are dot products of rows of T and A, four at once */
+		for (row = 0; row < n; row++) {
+			for (col = row; col + 4 <= n; col += 4) {
+				matrix_vecDot4(&t[m * row], &A->data[m * col], m, m, &C->data[n * row + col]);
+			}
+			for (; col < n; col++) {
+				C->data[n * row + col] = matrix_vecDot(&t[m * row], &A->data[m * col], m);
+			}
+		}
+	}
 
+	for (row = 0; row < n; row++) {
+		for (col = row + 1; col < n; col++) {
+			C->data[n * col + row] = C->data[n * row + col];
+		}
+	}
+
+	C->rows = n;
+	C->cols = n;
+	C->transposed = 0;
+}
+
+
+int matrix_symSandwitch(const matrix_t *A, const matrix_t *B, matrix_t *C, matrix_t *tempC)
+{
 	if (!matrix_sandwitchValid(A, B, C, tempC)) {
 		return -1;
 	}
 
 	matrix_prod(A, B, tempC);
-	matrix_prod(tempC, &trpA, C);
+	matrix_symProdTrp(A, tempC->data, C);
+
 	return 0;
 }
 
@@ -324,7 +1062,7 @@ void matrix_diag(matrix_t *A)
 
 	matrix_zeroes(A);
 	for (i = 0; i < A->cols && i < A->rows; i++) {
-		A->data[A->cols * i + i] = 1.F;
+		A->data[matrix_strideGet(A) * i + i] = 1.F;
 	}
 }
 
@@ -333,15 +1071,25 @@ void matrix_diag(matrix_t *A)
 int matrix_add(matrix_t *A, const matrix_t *B, matrix_t *C)
 {
 	unsigned int row, col; /* represent position in output C matrix */
-	unsigned int rowsC = A->rows, colsC = A->cols;
+	unsigned int rowsC = A->rows, colsC = A->cols, ldc = colsC;
+	const unsigned int lda = matrix_strideGet(A), ldb = matrix_strideGet(B);
 
 	if (C != NULL) {
 		if (!(C->rows == A->rows && C->cols == A->cols) && !(C->rows == A->cols && C->cols == A->rows)) {
 			return -1;
 		}
+
+		/* view can't be reshaped, so its layout must match A */
+		if (!matrix_isDense(C)) {
+			if (C->rows != rowsC || C->cols != colsC || C->transposed != A->transposed) {
+				return -1;
+			}
+			ldc = C->stride;
+		}
 	}
 	else {
 		C = A;
+		ldc = lda;
 	}
 
 	/* different B matrix indexing only if one of B or A is transposed */
@@ -352,7 +1100,7 @@ int matrix_add(matrix_t *A, const matrix_t *B, matrix_t *C)
 
 		for (row = 0; row < rowsC; row++) {
 			for (col = 0; col < colsC; col++) {
-				C->data[colsC * row + col] = A->data[A->cols * row + col] + B->data[B->cols * row + col];
+				C->data[ldc * row + col] = A->data[lda * row + col] + B->data[ldb * row + col];
 			}
 		}
 	}
@@ -363,15 +1111,16 @@ int matrix_add(matrix_t *A, const matrix_t *B, matrix_t *C)
 
 		for (row = 0; row < rowsC; row++) {
 			for (col = 0; col < colsC; col++) {
-				C->data[colsC * row + col] = A->data[A->cols * row + col] + B->data[B->cols * col + row];
+				C->data[ldc * row + col] = A->data[lda * row + col] + B->data[ldb * col + row];
 			}
 		}
 	}
 
-	if (C != A) {
+	if (C != A && matrix_isDense(C)) {
 		C->rows = rowsC;
 		C->cols = colsC;
 		C->transposed = A->transposed;
+		C->stride = 0;
 	}
 
 	return 0;
@@ -381,15 +1130,25 @@ int matrix_add(matrix_t *A, const matrix_t *B, matrix_t *C)
 int matrix_sub(matrix_t *A, const matrix_t *B, matrix_t *C)
 {
 	unsigned int row, col; /* represent position in output C matrix */
-	unsigned int rowsC = A->rows, colsC = A->cols;
+	unsigned int rowsC = A->rows, colsC = A->cols, ldc = colsC;
+	const unsigned int lda = matrix_strideGet(A), ldb = matrix_strideGet(B);
 
 	if (C != NULL) {
 		if (!(C->rows == A->rows && C->cols == A->cols) && !(C->rows == A->cols && C->cols == A->rows)) {
 			return -1;
 		}
+
+		/* view can't be reshaped, so its layout must match A */
+		if (!matrix_isDense(C)) {
+			if (C->rows != rowsC || C->cols != colsC || C->transposed != A->transposed) {
+				return -1;
+			}
+			ldc = C->stride;
+		}
 	}
 	else {
 		C = A;
+		ldc = lda;
 	}
 
 	/* different B matrix indexing only if one of B or A is transposed */
@@ -400,7 +1159,7 @@ int matrix_sub(matrix_t *A, const matrix_t *B, matrix_t *C)
 
 		for (row = 0; row < rowsC; row++) {
 			for (col = 0; col < colsC; col++) {
-				C->data[colsC * row + col] = A->data[A->cols * row + col] - B->data[B->cols * row + col];
+				C->data[ldc * row + col] = A->data[lda * row + col] - B->data[ldb * row + col];
 			}
 		}
 	}
@@ -411,15 +1170,16 @@ int matrix_sub(matrix_t *A, const matrix_t *B, matrix_t *C)
 
 		for (row = 0; row < rowsC; row++) {
 			for (col = 0; col < colsC; col++) {
-				C->data[colsC * row + col] = A->data[A->cols * row + col] - B->data[B->cols * col + row];
+				C->data[ldc * row + col] = A->data[lda * row + col] - B->data[ldb * col + row];
 			}
 		}
 	}
 
-	if (C != A) {
+	if (C != A && matrix_isDense(C)) {
 		C->rows = rowsC;
 		C->cols = colsC;
 		C->transposed = A->transposed;
+		C->stride = 0;
 	}
 
 	return 0;
@@ -491,16 +1251,225 @@ int matrix_cmp(const matrix_t *A, const matrix_t *B)
 }
 
 
+/* Range of the largest element of small matrix which is inverted without scaling */
+#define MATRIX_SMALL_MIN 0x1p-16f
+#define MATRIX_SMALL_MAX 0x1p16f
+
+
+/*
+ * Copies logical content of `n` x `n` matrix A into row-major array `a`. Returns -1 if A or B is not `n` x `n` or B is a view.
+ * Products of up to four elements overflow or underflow for elements far from 1, so `a` is then scaled by 2^-`*scale` to make
+ * its largest element lie in [0.5, 1). Power of two scaling is exact.
+ */
+static int matrix_smallLoad(const matrix_t *A, const matrix_t *B, float *a, unsigned int n, int *scale)
+{
+	unsigned int row, col, i;
+	float max = 0.f, val;
+
+	if (A->rows != n || A->cols != n || B->rows != n || B->cols != n || !matrix_isDense(B)) {
+		return -1;
+	}
+
+	for (row = 0; row < n; row++) {
+		for (col = 0; col < n; col++) {
+			val = (A->transposed) ? pos_trpd(A, row, col) : pos_norm(A, row, col);
+			a[n * row + col] = val;
+			if (fabsf(val) > max) {
+				max = fabsf(val);
+			}
+		}
+	}
+
+	/* elements of common magnitudes are left as they are */
+	*scale = 0;
+	if (max == 0.f || (max >= MATRIX_SMALL_MIN && max <= MATRIX_SMALL_MAX) || !isfinite(max)) {
+		return 0;
+	}
+
+	frexpf(max, scale);
+
+	for (i = 0; i < n * n; i++) {
+		a[i] = ldexpf(a[i], -*scale);
+	}
+
+	return 0;
+}
+
+
+/*
+ * Writes `n` x `n` adjugate `adj` divided by `det` and by 2^`scale` of matrix_smallLoad() into B.
+ * Returns -1 and leaves B unchanged if matrix `a` is singular, or if its inverse is out of float range.
+ * Matrix is treated as singular when `det` is within rounding error of zero, relative to the Hadamard bound of `a`.
+ */
+static int matrix_smallStore(matrix_t *B, const float *a, const float *adj, float det, unsigned int n, int scale)
+{
+	const float invDet = 1.f / det;
+	float bound = 1.f;
+	unsigned int row, i;
+
+	for (row = 0; row < n; row++) {
+		bound *= sqrtf(matrix_vecDot(&a[n * row], &a[n * row], n));
+	}
+
+	if (!isfinite(det) || !isfinite(invDet) || fabsf(det) <= n * FLT_EPSILON * bound) {
+		return -1;
+	}
+
+	if (scale == 0) {
+		for (i = 0; i < n * n; i++) {
+			B->data[i] = adj[i] * invDet;
+		}
+		B->transposed = 0;
+
+		return 0;
+	}
+
+	/* inverse of `a` scaled by 2^-scale is 2^scale times the inverse of A. B is written only after range check */
+	for (i = 0; i < n * n; i++) {
+		if (!isfinite(ldexpf(adj[i] * invDet, -scale))) {
+			return -1;
+		}
+	}
+
+	for (i = 0; i < n * n; i++) {
+		B->data[i] = ldexpf(adj[i] * invDet, -scale);
+	}
+	B->transposed = 0;
+
+	return 0;
+}
+
+
+int matrix_inv1(const matrix_t *A, matrix_t *B)
+{
+	float a[1], adj[1] = { 1.f };
+	int scale;
+
+	if (matrix_smallLoad(A, B, a, 1, &scale) < 0) {
+		return -1;
+	}
+
+	return matrix_smallStore(B, a, adj, a[0], 1, scale);
+}
+
+
+int matrix_inv2(const matrix_t *A, matrix_t *B)
+{
+	float a[4], adj[4];
+	int scale;
+
+	if (matrix_smallLoad(A, B, a, 2, &scale) < 0) {
+		return -1;
+	}
+
+	adj[0] = a[3];
+	adj[1] = -a[1];
+	adj[2] = -a[2];
+	adj[3] = a[0];
+
+	return matrix_smallStore(B, a, adj, a[0] * a[3] - a[1] * a[2], 2, scale);
+}
+
+
+int matrix_inv3(const matrix_t *A, matrix_t *B)
+{
+	float a[9], adj[9];
+	int scale;
+
+	if (matrix_smallLoad(A, B, a, 3, &scale) < 0) {
+		return -1;
+	}
+
+	adj[0] = a[4] * a[8] - a[5] * a[7];
+	adj[1] = a[2] * a[7] - a[1] * a[8];
+	adj[2] = a[1] * a[5] - a[2] * a[4];
+	adj[3] = a[5] * a[6] - a[3] * a[8];
+	adj[4] = a[0] * a[8] - a[2] * a[6];
+	adj[5] = a[2] * a[3] - a[0] * a[5];
+	adj[6] = a[3] * a[7] - a[4] * a[6];
+	adj[7] = a[1] * a[6] - a[0] * a[7];
+	adj[8] = a[0] * a[4] - a[1] * a[3];
+
+	return matrix_smallStore(B, a, adj, a[0] * adj[0] + a[1] * adj[3] + a[2] * adj[6], 3, scale);
+}
+
+
+int matrix_inv4(const matrix_t *A, matrix_t *B)
+{
+	float a[16], adj[16], s[6], c[6];
+	int scale;
+
+	if (matrix_smallLoad(A, B, a, 4, &scale) < 0) {
+		return -1;
+	}
+
+	/* 2x2 minors of two upper rows (s) and two lower rows (c) */
+	s[0] = a[0] * a[5] - a[4] * a[1];
+	s[1] = a[0] * a[6] - a[4] * a[2];
+	s[2] = a[0] * a[7] - a[4] * a[3];
+	s[3] = a[1] * a[6] - a[5] * a[2];
+	s[4] = a[1] * a[7] - a[5] * a[3];
+	s[5] = a[2] * a[7] - a[6] * a[3];
+
+	c[0] = a[8] * a[13] - a[12] * a[9];
+	c[1] = a[8] * a[14] - a[12] * a[10];
+	c[2] = a[8] * a[15] - a[12] * a[11];
+	c[3] = a[9] * a[14] - a[13] * a[10];
+	c[4] = a[9] * a[15] - a[13] * a[11];
+	c[5] = a[10] * a[15] - a[14] * a[11];
+
+	adj[0] = a[5] * c[5] - a[6] * c[4] + a[7] * c[3];
+	adj[1] = -a[1] * c[5] + a[2] * c[4] - a[3] * c[3];
+	adj[2] = a[13] * s[5] - a[14] * s[4] + a[15] * s[3];
+	adj[3] = -a[9] * s[5] + a[10] * s[4] - a[11] * s[3];
+
+	adj[4] = -a[4] * c[5] + a[6] * c[2] - a[7] * c[1];
+	adj[5] = a[0] * c[5] - a[2] * c[2] + a[3] * c[1];
+	adj[6] = -a[12] * s[5] + a[14] * s[2] - a[15] * s[1];
+	adj[7] = a[8] * s[5] - a[10] * s[2] + a[11] * s[1];
+
+	adj[8] = a[4] * c[4] - a[5] * c[2] + a[7] * c[0];
+	adj[9] = -a[0] * c[4] + a[1] * c[2] - a[3] * c[0];
+	adj[10] = a[12] * s[4] - a[13] * s[2] + a[15] * s[0];
+	adj[11] = -a[8] * s[4] + a[9] * s[2] - a[11] * s[0];
+
+	adj[12] = -a[4] * c[3] + a[5] * c[1] - a[6] * c[0];
+	adj[13] = a[0] * c[3] - a[1] * c[1] + a[2] * c[0];
+	adj[14] = -a[12] * s[3] + a[13] * s[1] - a[14] * s[0];
+	adj[15] = a[8] * s[3] - a[9] * s[1] + a[10] * s[0];
+
+	return matrix_smallStore(B, a, adj, s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0], 4, scale);
+}
+
+
 int matrix_inv(const matrix_t *A, matrix_t *B, float *buf, int buflen)
 {
 	matrix_t C = { 0 };
 	int rows, cols, row, col, step;
 	float base;
 
-	if (A->rows != A->cols || B->rows != B->cols || A->rows != B->rows) {
+	if (A->rows != A->cols || B->rows != B->cols || A->rows != B->rows || !matrix_isDense(B)) {
 		return -1;
 	}
 
+	/* small matrices are inverted in closed form */
+	switch (A->rows) {
+		case 1:
+			return matrix_inv1(A, B);
+
+		case 2:
+			return matrix_inv2(A, B);
+
+		case 3:
+			return matrix_inv3(A, B);
+
+		case 4:
+			return matrix_inv4(A, B);
+
+		default:
+			break;
+	}
+
 	if (buflen < A->rows * A->cols * 2) {
 		return -1;
 	}
@@ -567,8 +1536,206 @@ int matrix_inv(const matrix_t *A, matrix_t *B, float *buf, int buflen)
 	return 0;
 }
 
+/*
+ * Factorizes symmetric matrix of size `n` stored in `f` in place. Only elements on and below diagonal are read.
+ * Cholesky: f = L * L^T, LDL^T: f = L * D * L^T with unit L and D stored on diagonal.
+ * L is stored below diagonal and L^T above it, so both triangular solves read contiguous rows.
+ */
+static int matrix_factorize(float *f, unsigned int n, int ldlt)
+{
+	unsigned int row, col;
+	float sum, l;
+
+	for (row = 0; row < n; row++) {
+		/* for LDL^T elements of `row` first hold L(row, col) * D(col) and are scaled after diagonal element is known */
+		for (col = 0; col < row; col++) {
+			sum = f[n * row + col] - matrix_vecDot(&f[n * row], &f[n * col], col);
+			f[n * row + col] = (ldlt) ? sum : sum / f[n * col + col];
+		}
+
+		sum = f[n * row + row];
+		if (ldlt) {
+			for (col = 0; col < row; col++) {
+				l = f[n * row + col] / f[n * col + col];
+				sum -= l * f[n * row + col];
+				f[n * row + col] = l;
+			}
+
+			if (sum == 0 || !isfinite(sum)) {
+				return -1;
+			}
+			f[n * row + row] = sum;
+		}
+		else {
+			sum -= matrix_vecDot(&f[n * row], &f[n * row], row);
+
+			/* also rejects NaN */
+			if (!(sum > 0) || !isfinite(sum)) {
+				return -1;
+			}
+			f[n * row + row] = sqrtf(sum);
+		}
+	}
+
+	for (row = 0; row < n; row++) {
+		for (col = row + 1; col < n; col++) {
+			f[n * row + col] = f[n * col + row];
+		}
+	}
+
+	return 0;
+}
+
+
+/* Solves f * X = X in place for factorized `f` of size `n`. X has `n` rows of length `len` */
+static void matrix_factSolveLeft(const float *f, unsigned int n, float *x, unsigned int len, int ldlt)
+{
+	unsigned int row, col, i;
+	float scale;
+
+	/* forward substitution with L */
+	for (row = 0; row < n; row++) {
+		for (col = 0; col < row; col++) {
+			matrix_vecAxpy(&x[len * row], &x[len * col], -f[n * row + col], len);
+		}
+
+		if (!ldlt) {
+			scale = 1.f / f[n * row + row];
+			for (i = 0; i < len; i++) {
+				x[len * row + i] *= scale;
+			}
+		}
+	}
+
+	if (ldlt) {
+		for (row = 0; row < n; row++) {
+			scale = 1.f / f[n * row + row];
+			for (i = 0; i < len; i++) {
+				x[len * row + i] *= scale;
+			}
+		}
+	}
+
+	/* backward substitution with L^T */
+	for (row = n; row-- > 0;) {
+		for (col = row + 1; col < n; col++) {
+			matrix_vecAxpy(&x[len * row], &x[len * col], -f[n * row + col], len);
+		}
+
+		if (!ldlt) {
+			scale = 1.f / f[n * row + row];
+			for (i = 0; i < len; i++) {
+				x[len * row + i] *= scale;
+			}
+		}
+	}
+}
+
+
+/* Solves X * f = X in place for factorized `f` of size `n`. X has `rows` rows of length `n` */
+static void matrix_factSolveRight(const float *f, unsigned int n, float *x, unsigned int rows, int ldlt)
+{
+	unsigned int row, i;
+	float *xr;
+
+	/* f is symmetric, so every row of X is solved independently as f * transposed(xr) = transposed(xr) */
+	for (row = 0; row < rows; row++) {
+		xr = &x[n * row];
+
+		for (i = 0; i < n; i++) {
+			xr[i] -= matrix_vecDot(&f[n * i], xr, i);
+			if (!ldlt) {
+				xr[i] /= f[n * i + i];
+			}
+		}
+
+		if (ldlt) {
+			for (i = 0; i < n; i++) {
+				xr[i] /= f[n * i + i];
+			}
+		}
+
+		for (i = n; i-- > 0;) {
+			xr[i] -= matrix_vecDot(&f[n * i + i + 1], &xr[i + 1], n - i - 1);
+			if (!ldlt) {
+				xr[i] /= f[n * i + i];
+			}
+		}
+	}
+}
+
+
+static int matrix_factSolve(matrix_t *A, const matrix_t *B, matrix_t *X, int ldlt, int right)
+{
+	const unsigned int n = A->rows, rows = matrix_rowsGet(B), cols = matrix_colsGet(B);
+	unsigned int row, col;
+
+	if (A->rows != A->cols || X == A || X->data == A->data || !matrix_isDense(A) || !matrix_isDense(X)) {
+		return -1;
+	}
+
+	if ((right && cols != n) || (!right && rows != n)) {
+		return -1;
+	}
+
+	if (matrix_rowsGet(X) != rows || matrix_colsGet(X) != cols || (X == B && B->transposed)) {
+		return -1;
+	}
+
+	if (matrix_factorize(A->data, n, ldlt) < 0) {
+		return -1;
+	}
+
+	if (X != B) {
+		for (row = 0; row < rows; row++) {
+			for (col = 0; col < cols; col++) {
+				X->data[cols * row + col] = *matrix_at(B, row, col);
+			}
+		}
+	}
+
+	X->rows = rows;
+	X->cols = cols;
+	X->transposed = 0;
+
+	if (right) {
+		matrix_factSolveRight(A->data, n, X->data, rows, ldlt);
+	}
+	else {
+		matrix_factSolveLeft(A->data, n, X->data, cols, ldlt);
+	}
+
+	return 0;
+}
+
+
+int matrix_cholSolve(matrix_t *A, const matrix_t *B, matrix_t *X)
+{
+	return matrix_factSolve(A, B, X, 0, 0);
+}
+
+
+int matrix_cholSolveRight(matrix_t *A, const matrix_t *B, matrix_t *X)
+{
+	return matrix_factSolve(A, B, X, 0, 1);
+}
+
+
+int matrix_ldltSolve(matrix_t *A, const matrix_t *B, matrix_t *X)
+{
+	return matrix_factSolve(A, B, X, 1, 0);
+}
+
+
+int matrix_ldltSolveRight(matrix_t *A, const matrix_t *B, matrix_t *X)
+{
+	return matrix_factSolve(A, B, X, 1, 1);
+}
+
+
 int matrix_writeSubmatrix(matrix_t *dst, unsigned int row, unsigned int col, const matrix_t *src)
 {
+	const unsigned int ldd = matrix_strideGet(dst), lds = matrix_strideGet(src);
 	int cprow;
 
 	if (col + src->cols > dst->cols || row + src->rows > dst->rows) {
@@ -576,7 +1743,7 @@ int matrix_writeSubmatrix(matrix_t *dst, unsigned int row, unsigned int col, con
 	}
 
 	for (cprow = 0; cprow < src->rows; cprow++) {
-		memcpy((char *)&dst->data[dst->cols * (cprow + row) + col], (char *)&src->data[src->cols * cprow], sizeof(float) * src->cols);
+		memcpy((char *)&dst->data[ldd * (cprow + row) + col], (char *)&src->data[lds * cprow], sizeof(float) * src->cols);
 	}
 
 	return 0;
@@ -585,14 +1752,27 @@ int matrix_writeSubmatrix(matrix_t *dst, unsigned int row, unsigned int col, con
 
 void matrix_zeroes(matrix_t *A)
 {
-	memset(A->data, 0, sizeof(float) * A->rows * A->cols);
+	unsigned int row;
+
+	if (matrix_isDense(A)) {
+		memset(A->data, 0, sizeof(float) * A->rows * A->cols);
+		return;
+	}
+
+	for (row = 0; row < A->rows; row++) {
+		memset(&A->data[A->stride * row], 0, sizeof(float) * A->cols);
+	}
 }
 
 
 void matrix_times(matrix_t *A, float scalar)
 {
-	int i;
-	for (i = 0; i < A->rows * A->cols; i++) {
-		A->data[i] *= scalar;
+	const unsigned int stride = matrix_strideGet(A);
+	unsigned int row, col;
+
+	for (row = 0; row < A->rows; row++) {
+		for (col = 0; col < A->cols; col++) {
+			A->data[stride * row + col] *= scalar;
+		}
 	}
 }
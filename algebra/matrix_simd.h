@@ -0,0 +1,250 @@
+/*
+ * Phoenix-Pilot
+ *
+ * matrix - vector primitives used by matrix products and batched vector operations
+ *
+ * Backend is selected at compile time:
+ *  - AVX if compiled with __AVX__ (e.g. `-mavx` on host-generic-pilot),
+ *  - SSE if compiled with __SSE__ (default on x86_64 hosts),
+ *  - NEON if compiled with __ARM_NEON (e.g. `-mfpu=neon` on zynq targets),
+ *  - scalar loops otherwise.
+ *
+ * Defining MATRIX_SIMD_DISABLE forces the scalar reference implementation.
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#ifndef PHMATRIX_SIMD_H
+#define PHMATRIX_SIMD_H
+
+
+#if !defined(MATRIX_SIMD_DISABLE) && defined(__AVX__)
+#include <immintrin.h>
+#define MATRIX_SIMD_AVX
+#elif !defined(MATRIX_SIMD_DISABLE) && defined(__SSE__)
+#include <xmmintrin.h>
+#define MATRIX_SIMD_SSE
+#elif !defined(MATRIX_SIMD_DISABLE) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MATRIX_SIMD_NEON
+#endif
+
+
+/* c[i] += s * b[i] for i in [0, n). Order of additions into each c[i] is the same as in scalar loop */
+static inline void matrix_vecAxpy(float *c, const float *b, float s, unsigned int n)
+{
+	unsigned int i = 0;
+
+#if defined(MATRIX_SIMD_AVX)
+	const __m256 s8 = _mm256_set1_ps(s);
+
+	for (; i + 8 <= n; i += 8) {
+		_mm256_storeu_ps(&c[i], _mm256_add_ps(_mm256_loadu_ps(&c[i]), _mm256_mul_ps(s8, _mm256_loadu_ps(&b[i]))));
+	}
+#endif
+
+#if defined(MATRIX_SIMD_AVX) || defined(MATRIX_SIMD_SSE)
+	const __m128 s4 = _mm_set1_ps(s);
+
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(&c[i], _mm_add_ps(_mm_loadu_ps(&c[i]), _mm_mul_ps(s4, _mm_loadu_ps(&b[i]))));
+	}
+#elif defined(MATRIX_SIMD_NEON)
+	const float32x4_t s4 = vdupq_n_f32(s);
+
+	for (; i + 4 <= n; i += 4) {
+		vst1q_f32(&c[i], vaddq_f32(vld1q_f32(&c[i]), vmulq_f32(s4, vld1q_f32(&b[i]))));
+	}
+#endif
+
+	for (; i < n; i++) {
+		c[i] += s * b[i];
+	}
+}
+
+
+/* c[i] = s * b[i] for i in [0, n) */
+static inline void matrix_vecScale(float *c, const float *b, float s, unsigned int n)
+{
+	unsigned int i = 0;
+
+#if defined(MATRIX_SIMD_AVX)
+	const __m256 s8 = _mm256_set1_ps(s);
+
+	for (; i + 8 <= n; i += 8) {
+		_mm256_storeu_ps(&c[i], _mm256_mul_ps(s8, _mm256_loadu_ps(&b[i])));
+	}
+#endif
+
+#if defined(MATRIX_SIMD_AVX) || defined(MATRIX_SIMD_SSE)
+	const __m128 s4 = _mm_set1_ps(s);
+
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(&c[i], _mm_mul_ps(s4, _mm_loadu_ps(&b[i])));
+	}
+#elif defined(MATRIX_SIMD_NEON)
+	const float32x4_t s4 = vdupq_n_f32(s);
+
+	for (; i + 4 <= n; i += 4) {
+		vst1q_f32(&c[i], vmulq_f32(s4, vld1q_f32(&b[i])));
+	}
+#endif
+
+	for (; i < n; i++) {
+		c[i] = s * b[i];
+	}
+}
+
+
+/* c[i] = a[i] * b[i] for i in [0, n) */
+static inline void matrix_vecMul(float *c, const float *a, const float *b, unsigned int n)
+{
+	unsigned int i = 0;
+
+#if defined(MATRIX_SIMD_AVX)
+	for (; i + 8 <= n; i += 8) {
+		_mm256_storeu_ps(&c[i], _mm256_mul_ps(_mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&b[i])));
+	}
+#endif
+
+#if defined(MATRIX_SIMD_AVX) || defined(MATRIX_SIMD_SSE)
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(&c[i], _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+	}
+#elif defined(MATRIX_SIMD_NEON)
+	for (; i + 4 <= n; i += 4) {
+		vst1q_f32(&c[i], vmulq_f32(vld1q_f32(&a[i]), vld1q_f32(&b[i])));
+	}
+#endif
+
+	for (; i < n; i++) {
+		c[i] = a[i] * b[i];
+	}
+}
+
+
+/* c[i] += a[i] * b[i] for i in [0, n) */
+static inline void matrix_vecMulAdd(float *c, const float *a, const float *b, unsigned int n)
+{
+	unsigned int i = 0;
+
+#if defined(MATRIX_SIMD_AVX)
+	for (; i + 8 <= n; i += 8) {
+		_mm256_storeu_ps(&c[i], _mm256_add_ps(_mm256_loadu_ps(&c[i]), _mm256_mul_ps(_mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&b[i]))));
+	}
+#endif
+
+#if defined(MATRIX_SIMD_AVX) || defined(MATRIX_SIMD_SSE)
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(&c[i], _mm_add_ps(_mm_loadu_ps(&c[i]), _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i]))));
+	}
+#elif defined(MATRIX_SIMD_NEON)
+	for (; i + 4 <= n; i += 4) {
+		vst1q_f32(&c[i], vaddq_f32(vld1q_f32(&c[i]), vmulq_f32(vld1q_f32(&a[i]), vld1q_f32(&b[i]))));
+	}
+#endif
+
+	for (; i < n; i++) {
+		c[i] += a[i] * b[i];
+	}
+}
+
+
+/* returns sum of a[i] * b[i] for i in [0, n). Vectorized backends use partial sums, so rounding may differ from scalar loop */
+static inline float matrix_vecDot(const float *a, const float *b, unsigned int n)
+{
+	unsigned int i = 0;
+	float sum = 0;
+
+#if defined(MATRIX_SIMD_AVX) || defined(MATRIX_SIMD_SSE)
+	float part[4];
+	__m128 sum4 = _mm_setzero_ps();
+
+	for (; i + 4 <= n; i += 4) {
+		sum4 = _mm_add_ps(sum4, _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+	}
+
+	_mm_storeu_ps(part, sum4);
+	sum = (part[0] + part[1]) + (part[2] + part[3]);
+#elif defined(MATRIX_SIMD_NEON)
+	float32x4_t sum4 = vdupq_n_f32(0);
+	float32x2_t sum2;
+
+	for (; i + 4 <= n; i += 4) {
+		sum4 = vaddq_f32(sum4, vmulq_f32(vld1q_f32(&a[i]), vld1q_f32(&b[i])));
+	}
+
+	sum2 = vadd_f32(vget_low_f32(sum4), vget_high_f32(sum4));
+	sum = vget_lane_f32(sum2, 0) + vget_lane_f32(sum2, 1);
+#endif
+
+	for (; i < n; i++) {
+		sum += a[i] * b[i];
+	}
+
+	return sum;
+}
+
+
+
+/* out[r] = sum of a[i] * b[bStep * r + i] for i in [0, n) and r in [0, 4). Four independent sums hide addition latency */
+static inline void matrix_vecDot4(const float *a, const float *b, unsigned int bStep, unsigned int n, float *out)
+{
+	const float *b0 = b, *b1 = b + bStep, *b2 = b + 2 * bStep, *b3 = b + 3 * bStep;
+	unsigned int i = 0;
+
+#if defined(MATRIX_SIMD_AVX) || defined(MATRIX_SIMD_SSE)
+	__m128 a4, sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps(), sum3 = _mm_setzero_ps();
+
+	for (; i + 4 <= n; i += 4) {
+		a4 = _mm_loadu_ps(&a[i]);
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(a4, _mm_loadu_ps(&b0[i])));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(a4, _mm_loadu_ps(&b1[i])));
+		sum2 = _mm_add_ps(sum2, _mm_mul_ps(a4, _mm_loadu_ps(&b2[i])));
+		sum3 = _mm_add_ps(sum3, _mm_mul_ps(a4, _mm_loadu_ps(&b3[i])));
+	}
+
+	/* transposition of partial sums, so lane r of sum0 holds horizontal sum for b_r */
+	_MM_TRANSPOSE4_PS(sum0, sum1, sum2, sum3);
+	_mm_storeu_ps(out, _mm_add_ps(_mm_add_ps(sum0, sum1), _mm_add_ps(sum2, sum3)));
+#elif defined(MATRIX_SIMD_NEON)
+	float32x4_t a4, sum0 = vdupq_n_f32(0), sum1 = vdupq_n_f32(0), sum2 = vdupq_n_f32(0), sum3 = vdupq_n_f32(0);
+
+	for (; i + 4 <= n; i += 4) {
+		a4 = vld1q_f32(&a[i]);
+		sum0 = vaddq_f32(sum0, vmulq_f32(a4, vld1q_f32(&b0[i])));
+		sum1 = vaddq_f32(sum1, vmulq_f32(a4, vld1q_f32(&b1[i])));
+		sum2 = vaddq_f32(sum2, vmulq_f32(a4, vld1q_f32(&b2[i])));
+		sum3 = vaddq_f32(sum3, vmulq_f32(a4, vld1q_f32(&b3[i])));
+	}
+
+	out[0] = vgetq_lane_f32(sum0, 0) + vgetq_lane_f32(sum0, 1) + vgetq_lane_f32(sum0, 2) + vgetq_lane_f32(sum0, 3);
+	out[1] = vgetq_lane_f32(sum1, 0) + vgetq_lane_f32(sum1, 1) + vgetq_lane_f32(sum1, 2) + vgetq_lane_f32(sum1, 3);
+	out[2] = vgetq_lane_f32(sum2, 0) + vgetq_lane_f32(sum2, 1) + vgetq_lane_f32(sum2, 2) + vgetq_lane_f32(sum2, 3);
+	out[3] = vgetq_lane_f32(sum3, 0) + vgetq_lane_f32(sum3, 1) + vgetq_lane_f32(sum3, 2) + vgetq_lane_f32(sum3, 3);
+#else
+	out[0] = out[1] = out[2] = out[3] = 0;
+#endif
+
+	if (i < n) {
+		float sum[4] = { 0 };
+
+		for (; i < n; i++) {
+			sum[0] += a[i] * b0[i];
+			sum[1] += a[i] * b1[i];
+			sum[2] += a[i] * b2[i];
+			sum[3] += a[i] * b3[i];
+		}
+
+		out[0] += sum[0];
+		out[1] += sum[1];
+		out[2] += sum[2];
+		out[3] += sum[3];
+	}
+}
+
+#endif /* PHMATRIX_SIMD_H */
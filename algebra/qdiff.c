@@ -37,18 +37,36 @@ static void qvdiff_crossMat(const vec_t *v, matrix_t *out)
 }
 
 
-int qvdiff_qvqDiffQ(const quat_t *q, const vec_t *v, matrix_t *out)
+/*
+ * Sets `out` as untransposed `rows` x `cols` matrix. Returns -1 if `out` has other size, or it is transposed view,
+ * as resetting transposition of a view would change layout of its parent matrix.
+ */
+static int qvdiff_outPrepare(matrix_t *out, unsigned int rows, unsigned int cols)
 {
-	float val1, val2, val3, val4;
-
-	if (matrix_rowsGet(out) != 3 || matrix_colsGet(out) != 4) {
+	if (matrix_rowsGet(out) != rows || matrix_colsGet(out) != cols) {
 		return -1;
 	}
 
 	if (out->transposed != 0) {
+		if (out->stride != 0) {
+			return -1;
+		}
+
 		out->transposed = 0;
-		out->cols = 4;
-		out->rows = 3;
+		out->cols = cols;
+		out->rows = rows;
+	}
+
+	return 0;
+}
+
+
+int qvdiff_qvqDiffQ(const quat_t *q, const vec_t *v, matrix_t *out)
+{
+	float val1, val2, val3, val4;
+
+	if (qvdiff_outPrepare(out, 3, 4) < 0) {
+		return -1;
 	}
 
 	val1 = 2 * (q->a * v->x + q->j * v->z - q->k * v->y);
@@ -80,16 +98,10 @@ int qvdiff_cqvqDiffQ(const quat_t *q, const vec_t *v, matrix_t *out)
 {
 	float val1, val2, val3, val4;
 
-	if (matrix_rowsGet(out) != 3 || matrix_colsGet(out) != 4) {
+	if (qvdiff_outPrepare(out, 3, 4) < 0) {
 		return -1;
 	}
 
-	if (out->transposed != 0) {
-		out->transposed = 0;
-		out->cols = 4;
-		out->rows = 3;
-	}
-
 	/*
 	 * Difference from qvqDiffQ is that all terms where cross product is used must be negative.
 	 * This is achieved with switching q->a sign to negative in val1/2/3/4,
@@ -127,12 +139,10 @@ int qvdiff_qvqDiffV(const quat_t *q, matrix_t *out)
 	matrix_t qqt = { .data = qqtData, .rows = 3, .cols = 3, .transposed = 0 };
 	const vec_t qVec = { .x = q->i, .y = q->j, .z = q->k };
 
-	if (matrix_rowsGet(out) != 3 || matrix_colsGet(out) != 3) {
+	if (qvdiff_outPrepare(out, 3, 3) < 0) {
 		return -1;
 	}
 
-	out->transposed = 0;
-
 	qvdiff_crossMat(&qVec, out);
 	matrix_times(out, 2 * q->a);
 	/* Diagonal terms of `out` are now set to zeroes by `qvdiff_crossMat`. Proceed with diagonal terms */
@@ -166,12 +176,10 @@ int qvdiff_qvqDiffV(const quat_t *q, matrix_t *out)
 
 int qvdiff_qpDiffQ(const quat_t *p, matrix_t *out)
 {
-	if (out->cols != 4 || out->rows != 4) {
+	if (qvdiff_outPrepare(out, 4, 4) < 0) {
 		return -1;
 	}
 
-	out->transposed = 0;
-
 	MATRIX_DATA(out, 0, 0) = p->a;
 	MATRIX_DATA(out, 1, 1) = p->a;
 	MATRIX_DATA(out, 2, 2) = p->a;
@@ -198,16 +206,10 @@ int qvdiff_qpDiffQ(const quat_t *p, matrix_t *out)
 
 int qvdiff_qpDiffP(const quat_t *q, matrix_t *out)
 {
-	if (matrix_rowsGet(out) != 4 || matrix_colsGet(out) != 3) {
+	if (qvdiff_outPrepare(out, 4, 3) < 0) {
 		return -1;
 	}
 
-	if (out->transposed != 0) {
-		out->transposed = 0;
-		out->cols = 3;
-		out->rows = 4;
-	}
-
 	MATRIX_DATA(out, 1, 0) = q->a;
 	MATRIX_DATA(out, 2, 1) = q->a;
 	MATRIX_DATA(out, 3, 2) = q->a;
@@ -12,11 +12,17 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include <vec.h>
 
 #include "quat.h"
+#include "matrix_simd.h"
+
+
+/* Number of vectors processed at once by quat_vecRotBatch() */
+#define QUAT_ROT_CHUNK 64
 
 
 void quat_sum(const quat_t *A, const quat_t *B, quat_t *C)
@@ -208,6 +214,56 @@ void quat_vecRot(vec_t *vec, const quat_t *qRot)
 }
 
 
+/* Writes matrix R of rotation by `q`. For not unit `q` vectors are also scaled by squared length of `q`, as in quat_sandwichFast() */
+static void quat_rotMat(const quat_t *q, float R[3][3])
+{
+	float aa = q->a * q->a, ii = q->i * q->i, jj = q->j * q->j, kk = q->k * q->k;
+	float ai = q->a * q->i, aj = q->a * q->j, ak = q->a * q->k;
+	float ij = q->i * q->j, ik = q->i * q->k, jk = q->j * q->k;
+
+	R[0][0] = aa + ii - jj - kk;
+	R[0][1] = 2 * (ij - ak);
+	R[0][2] = 2 * (ik + aj);
+
+	R[1][0] = 2 * (ij + ak);
+	R[1][1] = aa - ii + jj - kk;
+	R[1][2] = 2 * (jk - ai);
+
+	R[2][0] = 2 * (ik - aj);
+	R[2][1] = 2 * (jk + ai);
+	R[2][2] = aa - ii - jj + kk;
+}
+
+
+void quat_vecRotBatch(const quat_t *qRot, float *xs, float *ys, float *zs, unsigned int n)
+{
+	float R[3][3], x[QUAT_ROT_CHUNK], y[QUAT_ROT_CHUNK];
+	unsigned int i, len;
+
+	quat_rotMat(qRot, R);
+
+	for (i = 0; i < n; i += len) {
+		len = (n - i < QUAT_ROT_CHUNK) ? n - i : QUAT_ROT_CHUNK;
+
+		/* `xs` and `ys` are overwritten before their last use */
+		memcpy(x, &xs[i], len * sizeof(float));
+		memcpy(y, &ys[i], len * sizeof(float));
+
+		matrix_vecScale(&xs[i], x, R[0][0], len);
+		matrix_vecAxpy(&xs[i], y, R[0][1], len);
+		matrix_vecAxpy(&xs[i], &zs[i], R[0][2], len);
+
+		matrix_vecScale(&ys[i], x, R[1][0], len);
+		matrix_vecAxpy(&ys[i], y, R[1][1], len);
+		matrix_vecAxpy(&ys[i], &zs[i], R[1][2], len);
+
+		matrix_vecScale(&zs[i], &zs[i], R[2][2], len);
+		matrix_vecAxpy(&zs[i], x, R[2][0], len);
+		matrix_vecAxpy(&zs[i], y, R[2][1], len);
+	}
+}
+
+
 void quat_rotQuat(const vec_t *axis, float angle, quat_t *q)
 {
 	float coeff, len;
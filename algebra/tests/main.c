@@ -30,13 +30,27 @@ void runner(void)
 	RUN_TEST_GROUP(group_matrix_times);
 	RUN_TEST_GROUP(group_matrix_prod);
 	RUN_TEST_GROUP(group_matrix_sparseProd);
+	RUN_TEST_GROUP(group_matrix_gemm);
+	RUN_TEST_GROUP(group_matrix_gemmSym);
 	RUN_TEST_GROUP(group_matrix_sandwitch);
 	RUN_TEST_GROUP(group_matrix_sparseSandwitch);
+	RUN_TEST_GROUP(group_matrix_symSandwitch);
+	RUN_TEST_GROUP(group_matrix_sparsity);
+	RUN_TEST_GROUP(group_matrix_patternProd);
+	RUN_TEST_GROUP(group_matrix_patternSandwitch);
+	RUN_TEST_GROUP(group_matrix_sym);
+	RUN_TEST_GROUP(group_matrix_symPatternProd);
+	RUN_TEST_GROUP(group_matrix_symPatternSandwitch);
+	RUN_TEST_GROUP(group_matrix_symGemm);
 	RUN_TEST_GROUP(group_matrix_add);
 	RUN_TEST_GROUP(group_matrix_sub);
 	RUN_TEST_GROUP(group_matrix_writeSubmatrix);
 	RUN_TEST_GROUP(group_matrix_cmp);
 	RUN_TEST_GROUP(group_matrix_inv);
+	RUN_TEST_GROUP(group_matrix_cholSolve);
+	RUN_TEST_GROUP(group_matrix_ldltSolve);
+	RUN_TEST_GROUP(group_matrix_view);
+	RUN_TEST_GROUP(group_matrix_simd);
 
 	/* Vectors library tests */
 	RUN_TEST_GROUP(group_vec_cmp);
@@ -47,6 +61,7 @@ void runner(void)
 	RUN_TEST_GROUP(group_vec_times);
 	RUN_TEST_GROUP(group_vec_cross);
 	RUN_TEST_GROUP(group_vec_dot);
+	RUN_TEST_GROUP(group_vec_dotBatch);
 	RUN_TEST_GROUP(group_vec_len);
 	RUN_TEST_GROUP(group_vec_normal);
 	RUN_TEST_GROUP(group_vec_normalize);
@@ -68,6 +83,7 @@ void runner(void)
 	RUN_TEST_GROUP(group_quat_normalize);
 	RUN_TEST_GROUP(group_quat_quat2euler);
 	RUN_TEST_GROUP(group_quat_vecRot);
+	RUN_TEST_GROUP(group_quat_vecRotBatch);
 	RUN_TEST_GROUP(group_quat_rotQuat);
 	RUN_TEST_GROUP(group_quat_uvec2uvec);
 	RUN_TEST_GROUP(group_quat_frameRot);
@@ -14,6 +14,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <unity_fixture.h>
 
@@ -359,6 +360,15 @@ TEST(group_matrix_bufAlloc, matrix_bufAlloc_structElems)
 }
 
 
+TEST(group_matrix_bufAlloc, matrix_bufAlloc_alignment)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&dynMat, ROWS, COLS));
+
+	TEST_ASSERT_EQUAL_INT(0, (uintptr_t)dynMat.data % MATRIX_ALIGN);
+	TEST_ASSERT_EQUAL_INT(COLS, matrix_strideGet(&dynMat));
+}
+
+
 TEST(group_matrix_bufAlloc, matrix_bufAlloc_validSeek)
 {
 	int row, col;
@@ -439,6 +449,7 @@ TEST(group_matrix_bufAlloc, matrix_bufAlloc_invalidArgs)
 TEST_GROUP_RUNNER(group_matrix_bufAlloc)
 {
 	RUN_TEST_CASE(group_matrix_bufAlloc, matrix_bufAlloc_structElems);
+	RUN_TEST_CASE(group_matrix_bufAlloc, matrix_bufAlloc_alignment);
 	RUN_TEST_CASE(group_matrix_bufAlloc, matrix_bufAlloc_validSeek);
 	RUN_TEST_CASE(group_matrix_bufAlloc, matrix_bufAlloc_invalidSeek);
 	RUN_TEST_CASE(group_matrix_bufAlloc, matrix_bufAlloc_initVal);
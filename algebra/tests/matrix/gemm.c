@@ -0,0 +1,403 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Unit tests for matrix library
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <math.h>
+
+#include <unity_fixture.h>
+
+#include <matrix.h>
+
+#include "../tools.h"
+#include "buffs.h"
+
+
+#define DELTA 1e-4f
+
+/* Sizes of EKF state and IMU measurement */
+#define EKF_STATE_LEN 16
+#define EKF_MEAS_LEN  6
+
+#define GEMM_ALPHA -0.5f
+#define GEMM_BETA  2.f
+
+/* Defines for gemm results */
+#define MAT_GEMM_OK   0
+#define MAT_GEMM_FAIL -1
+
+
+static matrix_t A, B, C, Expected;
+
+
+/* Allocates A (rows x steps), B (steps x cols), C and Expected = alpha * A * B + beta * C */
+static void gemm_prepare(unsigned int rows, unsigned int steps, unsigned int cols, float alpha, float beta)
+{
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, rows, steps));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&B, steps, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&C, rows, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, rows, cols));
+
+	algebraTests_pseudoFill(&A, 1);
+	algebraTests_pseudoFill(&B, 2);
+	algebraTests_pseudoFill(&C, 3);
+
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&A, &B, &Expected));
+
+	for (row = 0; row < rows; row++) {
+		for (col = 0; col < cols; col++) {
+			MATRIX_DATA(&Expected, row, col) = alpha * MATRIX_DATA(&Expected, row, col) + beta * MATRIX_DATA(&C, row, col);
+		}
+	}
+}
+
+
+/* Checks logical content of C against Expected */
+static void gemm_check(void)
+{
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_UINT(matrix_rowsGet(&Expected), matrix_rowsGet(&C));
+	TEST_ASSERT_EQUAL_UINT(matrix_colsGet(&Expected), matrix_colsGet(&C));
+
+	for (row = 0; row < matrix_rowsGet(&C); row++) {
+		for (col = 0; col < matrix_colsGet(&C); col++) {
+			TEST_ASSERT_FLOAT_WITHIN(DELTA, MATRIX_DATA(&Expected, row, col), *matrix_at(&C, row, col));
+		}
+	}
+}
+
+
+/* ##############################################################################
+ * ------------------------        matrix_gemm tests       -----------------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_matrix_gemm);
+
+
+TEST_SETUP(group_matrix_gemm)
+{
+	A.data = NULL;
+	B.data = NULL;
+	C.data = NULL;
+	Expected.data = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_gemm)
+{
+	matrix_bufFree(&A);
+	matrix_bufFree(&B);
+	matrix_bufFree(&C);
+	matrix_bufFree(&Expected);
+}
+
+
+TEST(group_matrix_gemm, matrix_gemm_std)
+{
+	gemm_prepare(EKF_STATE_LEN, EKF_MEAS_LEN, EKF_STATE_LEN, GEMM_ALPHA, GEMM_BETA);
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+
+	gemm_check();
+}
+
+
+TEST(group_matrix_gemm, matrix_gemm_firstMatTrp)
+{
+	gemm_prepare(EKF_STATE_LEN, EKF_MEAS_LEN, EKF_STATE_LEN, GEMM_ALPHA, GEMM_BETA);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&A));
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+
+	gemm_check();
+}
+
+
+TEST(group_matrix_gemm, matrix_gemm_secondMatTrp)
+{
+	gemm_prepare(EKF_STATE_LEN, EKF_MEAS_LEN, EKF_STATE_LEN, GEMM_ALPHA, GEMM_BETA);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&B));
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+
+	gemm_check();
+}
+
+
+TEST(group_matrix_gemm, matrix_gemm_firstAndSecondMatTrp)
+{
+	gemm_prepare(EKF_STATE_LEN, EKF_MEAS_LEN, EKF_STATE_LEN, GEMM_ALPHA, GEMM_BETA);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&A));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&B));
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+
+	gemm_check();
+}
+
+
+/* Transposed C keeps its transposition */
+TEST(group_matrix_gemm, matrix_gemm_resultMatTrp)
+{
+	gemm_prepare(EKF_MEAS_LEN, EKF_STATE_LEN, EKF_STATE_LEN, GEMM_ALPHA, GEMM_BETA);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&C));
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+
+	TEST_ASSERT_EQUAL_UINT(1, C.transposed);
+	gemm_check();
+}
+
+
+TEST(group_matrix_gemm, matrix_gemm_allMatTrp)
+{
+	gemm_prepare(EKF_MEAS_LEN, EKF_STATE_LEN, EKF_STATE_LEN, GEMM_ALPHA, GEMM_BETA);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&A));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&B));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&C));
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+
+	gemm_check();
+}
+
+
+/* With beta equal to 0, C is not read, so NaN in it does not propagate */
+TEST(group_matrix_gemm, matrix_gemm_zeroBeta)
+{
+	unsigned int i;
+
+	gemm_prepare(EKF_STATE_LEN, EKF_STATE_LEN, EKF_MEAS_LEN, 1.f, 0.f);
+	for (i = 0; i < C.rows * C.cols; i++) {
+		C.data[i] = NAN;
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemm(1.f, &A, &B, 0.f, &C));
+	gemm_check();
+
+	/* same for dot product path */
+	for (i = 0; i < C.rows * C.cols; i++) {
+		C.data[i] = NAN;
+	}
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&B));
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemm(1.f, &A, &B, 0.f, &C));
+	gemm_check();
+}
+
+
+TEST(group_matrix_gemm, matrix_gemm_unitBeta)
+{
+	gemm_prepare(EKF_STATE_LEN, EKF_MEAS_LEN, 1, GEMM_ALPHA, 1.f);
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemm(GEMM_ALPHA, &A, &B, 1.f, &C));
+
+	gemm_check();
+}
+
+
+TEST(group_matrix_gemm, matrix_gemm_viewResult)
+{
+	matrix_t parent, view;
+
+	gemm_prepare(EKF_MEAS_LEN, EKF_MEAS_LEN, EKF_MEAS_LEN, GEMM_ALPHA, GEMM_BETA);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&parent, EKF_STATE_LEN, EKF_STATE_LEN));
+	TEST_ASSERT_EQUAL_INT(0, matrix_view(&parent, 2, 3, EKF_MEAS_LEN, EKF_MEAS_LEN, &view));
+	TEST_ASSERT_EQUAL_INT(MAT_WRITE_SUBMAT_OK, matrix_writeSubmatrix(&view, 0, 0, &C));
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &view));
+	TEST_ASSERT_EQUAL_INT(MAT_WRITE_SUBMAT_OK, matrix_writeSubmatrix(&C, 0, 0, &view));
+
+	gemm_check();
+	TEST_ASSERT_EQUAL_FLOAT(0, MATRIX_DATA(&parent, 2, 2));
+	TEST_ASSERT_EQUAL_FLOAT(0, MATRIX_DATA(&parent, 1, 3));
+
+	matrix_bufFree(&parent);
+}
+
+
+TEST(group_matrix_gemm, matrix_gemm_badMats)
+{
+	gemm_prepare(EKF_STATE_LEN, EKF_MEAS_LEN, EKF_STATE_LEN, GEMM_ALPHA, GEMM_BETA);
+
+	matrix_trp(&A);
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_FAIL, matrix_gemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+	matrix_trp(&A);
+
+	C.cols = EKF_MEAS_LEN;
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_FAIL, matrix_gemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_gemm)
+{
+	RUN_TEST_CASE(group_matrix_gemm, matrix_gemm_std);
+	RUN_TEST_CASE(group_matrix_gemm, matrix_gemm_firstMatTrp);
+	RUN_TEST_CASE(group_matrix_gemm, matrix_gemm_secondMatTrp);
+	RUN_TEST_CASE(group_matrix_gemm, matrix_gemm_firstAndSecondMatTrp);
+	RUN_TEST_CASE(group_matrix_gemm, matrix_gemm_resultMatTrp);
+	RUN_TEST_CASE(group_matrix_gemm, matrix_gemm_allMatTrp);
+	RUN_TEST_CASE(group_matrix_gemm, matrix_gemm_zeroBeta);
+	RUN_TEST_CASE(group_matrix_gemm, matrix_gemm_unitBeta);
+	RUN_TEST_CASE(group_matrix_gemm, matrix_gemm_viewResult);
+	RUN_TEST_CASE(group_matrix_gemm, matrix_gemm_badMats);
+}
+
+
+/* ##############################################################################
+ * ----------------------        matrix_gemmSym tests       ---------------------
+ * ############################################################################## */
+
+
+/* Allocates A (rows x steps), B = trp(A) as transposed A buffer copy, symmetric C and Expected */
+static void gemmSym_prepare(unsigned int rows, unsigned int steps)
+{
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, rows, steps));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&B, rows, steps));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&C, rows, rows));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, rows, rows));
+
+	algebraTests_pseudoFill(&A, 4);
+	algebraTests_pseudoFill(&B, 4);
+	matrix_trp(&B);
+
+	algebraTests_pseudoFill(&C, 5);
+	for (row = 0; row < rows; row++) {
+		for (col = row + 1; col < rows; col++) {
+			MATRIX_DATA(&C, col, row) = MATRIX_DATA(&C, row, col);
+		}
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&A, &B, &Expected));
+
+	for (row = 0; row < rows; row++) {
+		for (col = 0; col < rows; col++) {
+			MATRIX_DATA(&Expected, row, col) = GEMM_ALPHA * MATRIX_DATA(&Expected, row, col) + GEMM_BETA * MATRIX_DATA(&C, row, col);
+		}
+	}
+}
+
+
+TEST_GROUP(group_matrix_gemmSym);
+
+
+TEST_SETUP(group_matrix_gemmSym)
+{
+	A.data = NULL;
+	B.data = NULL;
+	C.data = NULL;
+	Expected.data = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_gemmSym)
+{
+	matrix_bufFree(&A);
+	matrix_bufFree(&B);
+	matrix_bufFree(&C);
+	matrix_bufFree(&Expected);
+}
+
+
+TEST(group_matrix_gemmSym, matrix_gemmSym_measMats)
+{
+	unsigned int row, col;
+
+	gemmSym_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemmSym(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+
+	gemm_check();
+	for (row = 0; row < C.rows; row++) {
+		for (col = row + 1; col < C.cols; col++) {
+			TEST_ASSERT_EQUAL_FLOAT(MATRIX_DATA(&C, row, col), MATRIX_DATA(&C, col, row));
+		}
+	}
+}
+
+
+TEST(group_matrix_gemmSym, matrix_gemmSym_stdMats)
+{
+	gemmSym_prepare(EKF_STATE_LEN, EKF_MEAS_LEN);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&A));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&B));
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemmSym(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+
+	gemm_check();
+}
+
+
+/* Elements below diagonal of C must not be read */
+TEST(group_matrix_gemmSym, matrix_gemmSym_lowerIgnored)
+{
+	unsigned int row, col;
+
+	gemmSym_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+	for (row = 0; row < C.rows; row++) {
+		for (col = 0; col < row; col++) {
+			MATRIX_DATA(&C, row, col) = NAN;
+		}
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemmSym(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+
+	gemm_check();
+}
+
+
+/* Rank-1 update of sequential EKF measurement processing: C = alpha * trp(b) * b + beta * C with lower triangle of C not read */
+TEST(group_matrix_gemmSym, matrix_gemmSym_rank1)
+{
+	unsigned int row, col;
+
+	gemmSym_prepare(EKF_STATE_LEN, 1);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&A));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&B));
+	for (row = 0; row < C.rows; row++) {
+		for (col = 0; col < row; col++) {
+			MATRIX_DATA(&C, row, col) = NAN;
+		}
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_OK, matrix_gemmSym(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+
+	gemm_check();
+}
+
+
+TEST(group_matrix_gemmSym, matrix_gemmSym_badMats)
+{
+	gemmSym_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+
+	matrix_trp(&B);
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_FAIL, matrix_gemmSym(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+	matrix_trp(&B);
+
+	C.cols = 1;
+	TEST_ASSERT_EQUAL_INT(MAT_GEMM_FAIL, matrix_gemmSym(GEMM_ALPHA, &A, &B, GEMM_BETA, &C));
+	C.cols = EKF_MEAS_LEN;
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_gemmSym)
+{
+	RUN_TEST_CASE(group_matrix_gemmSym, matrix_gemmSym_measMats);
+	RUN_TEST_CASE(group_matrix_gemmSym, matrix_gemmSym_stdMats);
+	RUN_TEST_CASE(group_matrix_gemmSym, matrix_gemmSym_lowerIgnored);
+	RUN_TEST_CASE(group_matrix_gemmSym, matrix_gemmSym_rank1);
+	RUN_TEST_CASE(group_matrix_gemmSym, matrix_gemmSym_badMats);
+}
@@ -16,6 +16,7 @@
 #include <matrix.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "../tools.h"
 #include "buffs.h"
@@ -255,12 +256,11 @@ TEST_TEAR_DOWN(group_matrix_inv_otherMats)
 TEST(group_matrix_inv_otherMats, matrix_inv_zeroOnDiag)
 {
 	/*
-		Currently we are using algorithm to inverse matrix, which fails when finds zero on main diagonal
+		Elimination used for bigger matrices fails when finds zero on main diagonal
 		even if mathematically it is possible to inverse this matrix.
-		Such a case is presented in this test. It has been wrote for the future when we decide to use another method.
+		This 3x3 matrix is inverted in closed form, which does not have this limitation.
 		Reference: https://github.com/phoenix-pilot/phoenix-pilot-core/issues/110
 	*/
-	TEST_IGNORE();
 
 	/* M1 = K */
 	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK,
@@ -293,6 +293,222 @@ TEST(group_matrix_inv_otherMats, matrix_inv_zeroOnDiag)
 }
 
 
+/* This group tests closed form inverses of small matrices */
+TEST_GROUP(group_matrix_inv_smallMat);
+
+
+TEST_SETUP(group_matrix_inv_smallMat)
+{
+	M1.data = NULL;
+	M2.data = NULL;
+	M3.data = NULL;
+	Expected.data = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_inv_smallMat)
+{
+	matrix_bufFree(&M1);
+	matrix_bufFree(&M2);
+	matrix_bufFree(&M3);
+	matrix_bufFree(&Expected);
+}
+
+
+static int (*const smallInv[])(const matrix_t *, matrix_t *) = { matrix_inv1, matrix_inv2, matrix_inv3, matrix_inv4 };
+
+
+/* Allocates well conditioned M1 of size `n`, result matrix M2, product matrix M3 and identity Expected */
+static void smallMat_prepare(unsigned int n)
+{
+	unsigned int i;
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M1, n, n));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M2, n, n));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M3, n, n));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, n, n));
+
+	algebraTests_pseudoFill(&M1, n);
+	for (i = 0; i < n; i++) {
+		MATRIX_DATA(&M1, i, i) += n;
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUFFILL_OK, algebraTests_buffFill(&M2, initVal, BUFFILL_WRITE_ALL));
+	matrix_diag(&Expected);
+}
+
+
+TEST(group_matrix_inv_smallMat, matrix_inv_smallMats)
+{
+	unsigned int n;
+
+	for (n = 1; n <= 4; n++) {
+		smallMat_prepare(n);
+
+		TEST_ASSERT_EQUAL_INT(MAT_INV_OK, smallInv[n - 1](&M1, &M2));
+		TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&M1, &M2, &M3));
+		TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, M3);
+
+		/* matrix_inv() dispatches to closed form and does not need buffer */
+		TEST_ASSERT_EQUAL_INT(MAT_BUFFILL_OK, algebraTests_buffFill(&M2, initVal, BUFFILL_WRITE_ALL));
+		TEST_ASSERT_EQUAL_INT(MAT_INV_OK, matrix_inv(&M1, &M2, NULL, 0));
+		TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&M1, &M2, &M3));
+		TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, M3);
+
+		matrix_bufFree(&M1);
+		matrix_bufFree(&M2);
+		matrix_bufFree(&M3);
+		matrix_bufFree(&Expected);
+	}
+}
+
+
+TEST(group_matrix_inv_smallMat, matrix_inv_smallMatsTrp)
+{
+	unsigned int n;
+
+	for (n = 1; n <= 4; n++) {
+		smallMat_prepare(n);
+
+		TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&M1));
+		TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&M2));
+
+		TEST_ASSERT_EQUAL_INT(MAT_INV_OK, smallInv[n - 1](&M1, &M2));
+		TEST_ASSERT_EQUAL_UINT(0, M2.transposed);
+		TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&M1, &M2, &M3));
+		TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, M3);
+
+		matrix_bufFree(&M1);
+		matrix_bufFree(&M2);
+		matrix_bufFree(&M3);
+		matrix_bufFree(&Expected);
+	}
+}
+
+
+TEST(group_matrix_inv_smallMat, matrix_inv_smallMatsInPlace)
+{
+	unsigned int n;
+
+	for (n = 1; n <= 4; n++) {
+		smallMat_prepare(n);
+		memcpy(M2.data, M1.data, sizeof(float) * n * n);
+
+		TEST_ASSERT_EQUAL_INT(MAT_INV_OK, smallInv[n - 1](&M2, &M2));
+		TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&M1, &M2, &M3));
+		TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, M3);
+
+		matrix_bufFree(&M1);
+		matrix_bufFree(&M2);
+		matrix_bufFree(&M3);
+		matrix_bufFree(&Expected);
+	}
+}
+
+
+TEST(group_matrix_inv_smallMat, matrix_inv_smallMatsSingular)
+{
+	unsigned int n, col;
+
+	for (n = 1; n <= 4; n++) {
+		smallMat_prepare(n);
+
+		/* Last row is copy of the first one, or zero for 1x1 matrix */
+		for (col = 0; col < n; col++) {
+			MATRIX_DATA(&M1, n - 1, col) = (n == 1) ? 0 : MATRIX_DATA(&M1, 0, col);
+		}
+		memcpy(M3.data, M2.data, sizeof(float) * n * n);
+
+		TEST_ASSERT_EQUAL_INT(MAT_INV_FAIL, smallInv[n - 1](&M1, &M2));
+		TEST_ASSERT_EQUAL_FLOAT_ARRAY(M3.data, M2.data, n * n);
+
+		matrix_bufFree(&M1);
+		matrix_bufFree(&M2);
+		matrix_bufFree(&M3);
+		matrix_bufFree(&Expected);
+	}
+}
+
+
+/* Determinant and adjugate of unscaled elements far from 1 would overflow or underflow */
+TEST(group_matrix_inv_smallMat, matrix_inv_smallMatsLargeScale)
+{
+	static const float scales[] = { 1e10f, 3e9f, 1e19f, 1e-12f, 1e-20f };
+	unsigned int n, i, s;
+
+	for (n = 1; n <= 4; n++) {
+		for (s = 0; s < sizeof(scales) / sizeof(scales[0]); s++) {
+			smallMat_prepare(n);
+
+			for (i = 0; i < n * n; i++) {
+				M1.data[i] *= scales[s];
+			}
+
+			TEST_ASSERT_EQUAL_INT(MAT_INV_OK, smallInv[n - 1](&M1, &M2));
+			TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&M1, &M2, &M3));
+			TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, M3);
+
+			TEST_ASSERT_EQUAL_INT(MAT_BUFFILL_OK, algebraTests_buffFill(&M2, initVal, BUFFILL_WRITE_ALL));
+			TEST_ASSERT_EQUAL_INT(MAT_INV_OK, matrix_inv(&M1, &M2, NULL, 0));
+			TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&M1, &M2, &M3));
+			TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, M3);
+
+			matrix_bufFree(&M1);
+			matrix_bufFree(&M2);
+			matrix_bufFree(&M3);
+			matrix_bufFree(&Expected);
+		}
+	}
+}
+
+
+/* Scaled singular matrices are still singular, and inverse which does not fit in float is not written */
+TEST(group_matrix_inv_smallMat, matrix_inv_smallMatsLargeScaleFail)
+{
+	unsigned int n, i, col;
+
+	for (n = 2; n <= 4; n++) {
+		smallMat_prepare(n);
+
+		for (col = 0; col < n; col++) {
+			MATRIX_DATA(&M1, n - 1, col) = MATRIX_DATA(&M1, 0, col);
+		}
+		for (i = 0; i < n * n; i++) {
+			M1.data[i] *= 1e15f;
+		}
+		memcpy(M3.data, M2.data, sizeof(float) * n * n);
+
+		TEST_ASSERT_EQUAL_INT(MAT_INV_FAIL, smallInv[n - 1](&M1, &M2));
+		TEST_ASSERT_EQUAL_FLOAT_ARRAY(M3.data, M2.data, n * n);
+
+		matrix_bufFree(&M1);
+		matrix_bufFree(&M2);
+		matrix_bufFree(&M3);
+		matrix_bufFree(&Expected);
+	}
+
+	/* inverse of 1e-40 is above float range */
+	smallMat_prepare(1);
+	M1.data[0] = 1e-40f;
+	M2.data[0] = 7.f;
+
+	TEST_ASSERT_EQUAL_INT(MAT_INV_FAIL, matrix_inv1(&M1, &M2));
+	TEST_ASSERT_EQUAL_FLOAT(7.f, M2.data[0]);
+}
+
+
+TEST(group_matrix_inv_smallMat, matrix_inv_smallMatsBadSize)
+{
+	smallMat_prepare(3);
+
+	TEST_ASSERT_EQUAL_INT(MAT_INV_FAIL, matrix_inv2(&M1, &M2));
+	TEST_ASSERT_EQUAL_INT(MAT_INV_FAIL, matrix_inv4(&M1, &M2));
+
+	M2.cols--;
+	TEST_ASSERT_EQUAL_INT(MAT_INV_FAIL, matrix_inv3(&M1, &M2));
+}
+
+
 TEST_GROUP(group_matrix_inv_badMat);
 
 
@@ -426,6 +642,14 @@ TEST_GROUP_RUNNER(group_matrix_inv)
 
 	RUN_TEST_CASE(group_matrix_inv_otherMats, matrix_inv_zeroOnDiag);
 
+	RUN_TEST_CASE(group_matrix_inv_smallMat, matrix_inv_smallMats);
+	RUN_TEST_CASE(group_matrix_inv_smallMat, matrix_inv_smallMatsTrp);
+	RUN_TEST_CASE(group_matrix_inv_smallMat, matrix_inv_smallMatsInPlace);
+	RUN_TEST_CASE(group_matrix_inv_smallMat, matrix_inv_smallMatsSingular);
+	RUN_TEST_CASE(group_matrix_inv_smallMat, matrix_inv_smallMatsLargeScale);
+	RUN_TEST_CASE(group_matrix_inv_smallMat, matrix_inv_smallMatsLargeScaleFail);
+	RUN_TEST_CASE(group_matrix_inv_smallMat, matrix_inv_smallMatsBadSize);
+
 	RUN_TEST_CASE(group_matrix_inv_badMat, matrix_inv_detIsZero);
 	RUN_TEST_CASE(group_matrix_inv_badMat, matrix_inv_notSqrMat);
 	RUN_TEST_CASE(group_matrix_inv_badMat, matrix_inv_badResMat);
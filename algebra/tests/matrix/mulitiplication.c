@@ -22,8 +22,15 @@
 /* Must be bigger than 1 */
 #define SQUARE_MAT_SIZE 4
 
+/* Sizes of EKF matrices, for which fixed-size kernels are used */
+#define EKF_STATE_LEN 16
+#define EKF_MEAS_LEN  6
 
-static matrix_t M1, M2, M3, M4, M5, Expected;
+/* Allowed difference between fixed-size kernel and reference product */
+#define EKF_PROD_DELTA 1e-5f
+
+
+static matrix_t M1, M2, M3, M4, M5, Expected, Scale;
 
 
 /* ##############################################################################
@@ -168,6 +175,10 @@ TEST_SETUP(group_matrix_prod_bigMat)
 	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M3, Expected.rows, Expected.cols));
 	TEST_ASSERT_EQUAL_INT(MAT_BUFFILL_OK, algebraTests_buffFill(&M3, initVal, BUFFILL_WRITE_ALL));
 
+	/* Scale = |E| * |F|, products of big matrices are compared relatively to it, as vectorized kernels may sum terms in different order */
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Scale, Expected.rows, Expected.cols));
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProdAbs(&M1, &M2, &Scale));
+
 	M4.data = NULL;
 	M5.data = NULL;
 }
@@ -181,6 +192,7 @@ TEST_TEAR_DOWN(group_matrix_prod_bigMat)
 	matrix_bufFree(&M4);
 	matrix_bufFree(&M5);
 	matrix_bufFree(&Expected);
+	matrix_bufFree(&Scale);
 }
 
 
@@ -188,7 +200,7 @@ TEST(group_matrix_prod_bigMat, matrix_prod_bigMatsStd)
 {
 	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
 
-	TEST_ASSERT_EQUAL_MATRIX(Expected, M3);
+	TEST_ASSERT_MATRIX_REL_WITHIN(PROD_REL_DELTA(buffs_colsE), Expected, Scale, M3);
 }
 
 
@@ -198,7 +210,7 @@ TEST(group_matrix_prod_bigMat, matrix_prod_bigMatsFirstMatTrp)
 
 	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
 
-	TEST_ASSERT_EQUAL_MATRIX(Expected, M3);
+	TEST_ASSERT_MATRIX_REL_WITHIN(PROD_REL_DELTA(buffs_colsE), Expected, Scale, M3);
 }
 
 
@@ -208,7 +220,7 @@ TEST(group_matrix_prod_bigMat, matrix_prod_bigMatsSecondMatTrp)
 
 	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
 
-	TEST_ASSERT_EQUAL_MATRIX(Expected, M3);
+	TEST_ASSERT_MATRIX_REL_WITHIN(PROD_REL_DELTA(buffs_colsE), Expected, Scale, M3);
 }
 
 
@@ -219,7 +231,7 @@ TEST(group_matrix_prod_bigMat, matrix_prod_bigMatsFirstAndSecondMatTrp)
 
 	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
 
-	TEST_ASSERT_EQUAL_MATRIX(Expected, M3);
+	TEST_ASSERT_MATRIX_REL_WITHIN(PROD_REL_DELTA(buffs_colsE), Expected, Scale, M3);
 }
 
 
@@ -229,7 +241,7 @@ TEST(group_matrix_prod_bigMat, matrix_prod_bigMatsResultMatTrp)
 
 	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
 
-	TEST_ASSERT_EQUAL_MATRIX(Expected, M3);
+	TEST_ASSERT_MATRIX_REL_WITHIN(PROD_REL_DELTA(buffs_colsE), Expected, Scale, M3);
 }
 
 
@@ -240,7 +252,7 @@ TEST(group_matrix_prod_bigMat, matrix_prod_bigMatsResultAndFirstMatTrp)
 
 	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
 
-	TEST_ASSERT_EQUAL_MATRIX(Expected, M3);
+	TEST_ASSERT_MATRIX_REL_WITHIN(PROD_REL_DELTA(buffs_colsE), Expected, Scale, M3);
 }
 
 
@@ -251,7 +263,7 @@ TEST(group_matrix_prod_bigMat, matrix_prod_bigMatsResultAndSecondMatTrp)
 
 	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
 
-	TEST_ASSERT_EQUAL_MATRIX(Expected, M3);
+	TEST_ASSERT_MATRIX_REL_WITHIN(PROD_REL_DELTA(buffs_colsE), Expected, Scale, M3);
 }
 
 
@@ -263,7 +275,7 @@ TEST(group_matrix_prod_bigMat, matrix_prod_bigMatsAllMatTrp)
 
 	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
 
-	TEST_ASSERT_EQUAL_MATRIX(Expected, M3);
+	TEST_ASSERT_MATRIX_REL_WITHIN(PROD_REL_DELTA(buffs_colsE), Expected, Scale, M3);
 }
 
 
@@ -280,6 +292,97 @@ TEST(group_matrix_prod_bigMat, matrix_prod_sourceRetain)
 }
 
 
+TEST_GROUP(group_matrix_prod_ekfMat);
+
+
+/* Matrices of sizes used by EKF are multiplied by fixed-size kernels. They are checked against reference product */
+TEST_SETUP(group_matrix_prod_ekfMat)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M1, EKF_STATE_LEN, EKF_STATE_LEN));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M2, EKF_STATE_LEN, EKF_MEAS_LEN));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M3, EKF_STATE_LEN, EKF_MEAS_LEN));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, EKF_STATE_LEN, EKF_MEAS_LEN));
+
+	algebraTests_pseudoFill(&M1, 1);
+	algebraTests_pseudoFill(&M2, 2);
+	TEST_ASSERT_EQUAL_INT(MAT_BUFFILL_OK, algebraTests_buffFill(&M3, initVal, BUFFILL_WRITE_ALL));
+
+	/* Expected = M1 * M2 */
+	TEST_ASSERT_EQUAL_INT(0, algebraTests_refProd(&M1, &M2, &Expected));
+}
+
+
+TEST_TEAR_DOWN(group_matrix_prod_ekfMat)
+{
+	matrix_bufFree(&M1);
+	matrix_bufFree(&M2);
+	matrix_bufFree(&M3);
+	matrix_bufFree(&Expected);
+}
+
+
+TEST(group_matrix_prod_ekfMat, matrix_prod_ekfMatsStd)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
+
+	TEST_ASSERT_MATRIX_WITHIN(EKF_PROD_DELTA, Expected, M3);
+}
+
+
+TEST(group_matrix_prod_ekfMat, matrix_prod_ekfMatsFirstMatTrp)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&M1));
+
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
+
+	TEST_ASSERT_MATRIX_WITHIN(EKF_PROD_DELTA, Expected, M3);
+}
+
+
+TEST(group_matrix_prod_ekfMat, matrix_prod_ekfMatsSecondMatTrp)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&M2));
+
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
+
+	TEST_ASSERT_MATRIX_WITHIN(EKF_PROD_DELTA, Expected, M3);
+}
+
+
+TEST(group_matrix_prod_ekfMat, matrix_prod_ekfMatsAllMatTrp)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&M1));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&M2));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&M3));
+
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
+
+	TEST_ASSERT_MATRIX_WITHIN(EKF_PROD_DELTA, Expected, M3);
+}
+
+
+TEST(group_matrix_prod_ekfMat, matrix_prod_ekfSquareMats)
+{
+	/* M2 and Expected are reused as 16x16 matrices */
+	matrix_bufFree(&M2);
+	matrix_bufFree(&Expected);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M2, EKF_STATE_LEN, EKF_STATE_LEN));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, EKF_STATE_LEN, EKF_STATE_LEN));
+	algebraTests_pseudoFill(&M2, 3);
+
+	matrix_bufFree(&M3);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M3, EKF_STATE_LEN, EKF_STATE_LEN));
+
+	/* Expected = M1 * trp(M2) */
+	matrix_trp(&M2);
+	TEST_ASSERT_EQUAL_INT(0, algebraTests_refProd(&M1, &M2, &Expected));
+
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&M1, &M2, &M3));
+
+	TEST_ASSERT_MATRIX_WITHIN(EKF_PROD_DELTA, Expected, M3);
+}
+
+
 TEST_GROUP(group_matrix_prod_badMats);
 
 
@@ -390,6 +493,12 @@ TEST_GROUP_RUNNER(group_matrix_prod)
 
 	RUN_TEST_CASE(group_matrix_prod_bigMat, matrix_prod_sourceRetain);
 
+	RUN_TEST_CASE(group_matrix_prod_ekfMat, matrix_prod_ekfMatsStd);
+	RUN_TEST_CASE(group_matrix_prod_ekfMat, matrix_prod_ekfMatsFirstMatTrp);
+	RUN_TEST_CASE(group_matrix_prod_ekfMat, matrix_prod_ekfMatsSecondMatTrp);
+	RUN_TEST_CASE(group_matrix_prod_ekfMat, matrix_prod_ekfMatsAllMatTrp);
+	RUN_TEST_CASE(group_matrix_prod_ekfMat, matrix_prod_ekfSquareMats);
+
 	RUN_TEST_CASE(group_matrix_prod_badMats, matrix_prod_badInputMats);
 	RUN_TEST_CASE(group_matrix_prod_badMats, matrix_prod_badResMat);
 	RUN_TEST_CASE(group_matrix_prod_badMats, matrix_prod_failureRetain);
@@ -841,3 +841,160 @@ TEST_GROUP_RUNNER(group_matrix_sparseSandwitch)
 	RUN_TEST_CASE(group_matrix_sparseSandwitch_badMats, matrix_sparseSandwitch_badTmpMat);
 	RUN_TEST_CASE(group_matrix_sparseSandwitch_badMats, matrix_sparseSandwitch_failureRetain);
 }
+
+
+/* ##############################################################################
+ * -----------------        matrix_symSandwitch tests       ---------------------
+ * ############################################################################## */
+
+
+#define EKF_STATE_LEN 16
+#define EKF_MEAS_LEN  6
+
+#define SYM_SANDWITCH_DELTA 1e-4f
+
+
+/* Computes Expected = M1 * M2 * M1^T with reference product, M2 is made symmetric before */
+static void symSandwitch_prepare(unsigned int rows, unsigned int cols)
+{
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M1, rows, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M2, cols, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M3, rows, rows));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&M4, cols, rows));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, rows, rows));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&tmp, rows, cols));
+
+	algebraTests_pseudoFill(&M1, 3);
+	algebraTests_pseudoFill(&M2, 5);
+	TEST_ASSERT_EQUAL_INT(MAT_BUFFILL_OK, algebraTests_buffFill(&M3, initVal, BUFFILL_WRITE_ALL));
+
+	for (row = 0; row < cols; row++) {
+		for (col = row + 1; col < cols; col++) {
+			MATRIX_DATA(&M2, col, row) = MATRIX_DATA(&M2, row, col);
+		}
+	}
+
+	matrix_trp(&M1);
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&M2, &M1, &M4));
+	matrix_trp(&M1);
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&M1, &M4, &Expected));
+}
+
+
+static void symSandwitch_symmetryCheck(const matrix_t *M)
+{
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_UINT(M->rows, M->cols);
+
+	for (row = 0; row < M->rows; row++) {
+		for (col = row + 1; col < M->cols; col++) {
+			TEST_ASSERT_EQUAL_FLOAT(MATRIX_DATA(M, row, col), MATRIX_DATA(M, col, row));
+		}
+	}
+}
+
+
+TEST_GROUP(group_matrix_symSandwitch_ekfMat);
+
+
+TEST_SETUP(group_matrix_symSandwitch_ekfMat)
+{
+	M1.data = NULL;
+	M2.data = NULL;
+	M3.data = NULL;
+	M4.data = NULL;
+	M5.data = NULL;
+	Expected.data = NULL;
+	tmp.data = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_symSandwitch_ekfMat)
+{
+	matrix_bufFree(&M1);
+	matrix_bufFree(&M2);
+	matrix_bufFree(&M3);
+	matrix_bufFree(&M4);
+	matrix_bufFree(&M5);
+	matrix_bufFree(&Expected);
+	matrix_bufFree(&tmp);
+}
+
+
+TEST(group_matrix_symSandwitch_ekfMat, matrix_symSandwitch_stateMats)
+{
+	symSandwitch_prepare(EKF_STATE_LEN, EKF_STATE_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_OK, matrix_symSandwitch(&M1, &M2, &M3, &tmp));
+
+	TEST_ASSERT_MATRIX_WITHIN(SYM_SANDWITCH_DELTA, Expected, M3);
+	symSandwitch_symmetryCheck(&M3);
+}
+
+
+TEST(group_matrix_symSandwitch_ekfMat, matrix_symSandwitch_measMats)
+{
+	symSandwitch_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_OK, matrix_symSandwitch(&M1, &M2, &M3, &tmp));
+
+	TEST_ASSERT_MATRIX_WITHIN(SYM_SANDWITCH_DELTA, Expected, M3);
+	symSandwitch_symmetryCheck(&M3);
+}
+
+
+TEST(group_matrix_symSandwitch_ekfMat, matrix_symSandwitch_measMatsFirstMatTrp)
+{
+	symSandwitch_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&M1));
+
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_OK, matrix_symSandwitch(&M1, &M2, &M3, &tmp));
+
+	TEST_ASSERT_MATRIX_WITHIN(SYM_SANDWITCH_DELTA, Expected, M3);
+	symSandwitch_symmetryCheck(&M3);
+}
+
+
+TEST(group_matrix_symSandwitch_ekfMat, matrix_symSandwitch_resultMatTrp)
+{
+	symSandwitch_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+	matrix_trp(&M3);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_OK, matrix_symSandwitch(&M1, &M2, &M3, &tmp));
+
+	TEST_ASSERT_MATRIX_WITHIN(SYM_SANDWITCH_DELTA, Expected, M3);
+}
+
+
+TEST(group_matrix_symSandwitch_ekfMat, matrix_symSandwitch_badMats)
+{
+	symSandwitch_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_matrixCopy(&M5, &M3));
+
+	M3.rows--;
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_FAIL, matrix_symSandwitch(&M1, &M2, &M3, &tmp));
+	M3.rows++;
+
+	tmp.cols--;
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_FAIL, matrix_symSandwitch(&M1, &M2, &M3, &tmp));
+	tmp.cols++;
+
+	matrix_trp(&M1);
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_FAIL, matrix_symSandwitch(&M1, &M2, &M3, &tmp));
+
+	TEST_ASSERT_EQUAL_MATRIX(M5, M3);
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_symSandwitch)
+{
+	RUN_TEST_CASE(group_matrix_symSandwitch_ekfMat, matrix_symSandwitch_stateMats);
+	RUN_TEST_CASE(group_matrix_symSandwitch_ekfMat, matrix_symSandwitch_measMats);
+	RUN_TEST_CASE(group_matrix_symSandwitch_ekfMat, matrix_symSandwitch_measMatsFirstMatTrp);
+	RUN_TEST_CASE(group_matrix_symSandwitch_ekfMat, matrix_symSandwitch_resultMatTrp);
+	RUN_TEST_CASE(group_matrix_symSandwitch_ekfMat, matrix_symSandwitch_badMats);
+}
@@ -0,0 +1,285 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Unit tests for matrix library
+ *
+ * Vector primitives and product kernels of backend selected at compile time (AVX, SSE, NEON or scalar)
+ * are compared with scalar reference. Vectorized backends sum terms in different order and may use fused
+ * multiply-add, so results are compared with tolerance relative to sum of absolute values of terms.
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <unity_fixture.h>
+
+#include <matrix.h>
+
+#include "../../matrix_simd.h"
+#include "../tools.h"
+
+
+/* Longer than two AVX registers with tail, so every loop of every backend is used */
+#define SIMD_VEC_LEN 37
+
+/* Value written past the end of output buffers, it must not be changed by primitives */
+#define SIMD_GUARD 1234.5f
+
+/* Bound of rounding error of a single multiplication followed by addition, relative to absolute values of terms */
+#define SIMD_ELEM_REL (2 * FLT_EPSILON)
+
+
+static float a[SIMD_VEC_LEN + 1], b[4 * SIMD_VEC_LEN + 1], c[SIMD_VEC_LEN + 1], orig[SIMD_VEC_LEN + 1];
+static matrix_t A, B, C, Expected, Scale;
+
+
+/* Fills `buf` of `n` elements the same way as algebraTests_pseudoFill() fills matrices */
+static void simd_fill(float *buf, unsigned int n, unsigned int seed)
+{
+	matrix_t M = { .rows = 1, .cols = n, .transposed = 0, .data = buf, .stride = 0 };
+
+	algebraTests_pseudoFill(&M, seed);
+}
+
+
+/* Multiplies A and B of given shape and transpositions by matrix_prod() and compares result with reference */
+static void simd_prodCheck(unsigned int rows, unsigned int steps, unsigned int cols, int trpA, int trpB)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, rows, steps));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&B, steps, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&C, rows, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, rows, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Scale, rows, cols));
+
+	algebraTests_pseudoFill(&A, rows);
+	algebraTests_pseudoFill(&B, cols);
+
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&A, &B, &Expected));
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProdAbs(&A, &B, &Scale));
+
+	/* Transposition with swapped memory does not change A and B in mathematical meaning */
+	if (trpA) {
+		TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&A));
+	}
+	if (trpB) {
+		TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&B));
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&A, &B, &C));
+
+	TEST_ASSERT_MATRIX_REL_WITHIN(PROD_REL_DELTA(steps), Expected, Scale, C);
+
+	matrix_bufFree(&A);
+	matrix_bufFree(&B);
+	matrix_bufFree(&C);
+	matrix_bufFree(&Expected);
+	matrix_bufFree(&Scale);
+}
+
+
+/* Checks matrix_prod() for all transpositions on EKF shapes (fixed-size kernels) and on shapes with vector tails */
+static void simd_prodShapesCheck(int trpA, int trpB)
+{
+	simd_prodCheck(1, 1, 1, trpA, trpB);
+	simd_prodCheck(3, 5, 7, trpA, trpB);
+	simd_prodCheck(16, 16, 16, trpA, trpB);
+	simd_prodCheck(16, 16, 6, trpA, trpB);
+	simd_prodCheck(6, 16, 16, trpA, trpB);
+	simd_prodCheck(16, 6, 16, trpA, trpB);
+	simd_prodCheck(17, 9, 33, trpA, trpB);
+	simd_prodCheck(SIMD_VEC_LEN, 29, 23, trpA, trpB);
+}
+
+
+/* ##############################################################################
+ * -----------------------        matrix_simd tests       -----------------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_matrix_simd);
+
+
+TEST_SETUP(group_matrix_simd)
+{
+	simd_fill(a, sizeof(a) / sizeof(a[0]), 1);
+	simd_fill(b, sizeof(b) / sizeof(b[0]), 2);
+	simd_fill(orig, sizeof(orig) / sizeof(orig[0]), 3);
+
+	A.data = NULL;
+	B.data = NULL;
+	C.data = NULL;
+	Expected.data = NULL;
+	Scale.data = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_simd)
+{
+	matrix_bufFree(&A);
+	matrix_bufFree(&B);
+	matrix_bufFree(&C);
+	matrix_bufFree(&Expected);
+	matrix_bufFree(&Scale);
+}
+
+
+TEST(group_matrix_simd, matrix_simd_vecAxpy)
+{
+	const float s = -0.75f;
+	unsigned int n, i;
+
+	for (n = 0; n <= SIMD_VEC_LEN; n++) {
+		memcpy(c, orig, sizeof(c));
+		c[n] = SIMD_GUARD;
+
+		/* unaligned source, as rows of matrices are not aligned to vector registers */
+		matrix_vecAxpy(c, &b[1], s, n);
+
+		for (i = 0; i < n; i++) {
+			TEST_ASSERT_FLOAT_WITHIN(SIMD_ELEM_REL * (fabsf(orig[i]) + fabsf(s * b[i + 1])), orig[i] + s * b[i + 1], c[i]);
+		}
+		TEST_ASSERT_EQUAL_FLOAT(SIMD_GUARD, c[n]);
+	}
+}
+
+
+TEST(group_matrix_simd, matrix_simd_vecScale)
+{
+	const float s = 3.25f;
+	unsigned int n, i;
+
+	for (n = 0; n <= SIMD_VEC_LEN; n++) {
+		c[n] = SIMD_GUARD;
+
+		matrix_vecScale(c, &b[1], s, n);
+
+		for (i = 0; i < n; i++) {
+			TEST_ASSERT_EQUAL_FLOAT(s * b[i + 1], c[i]);
+		}
+		TEST_ASSERT_EQUAL_FLOAT(SIMD_GUARD, c[n]);
+	}
+}
+
+
+TEST(group_matrix_simd, matrix_simd_vecMul)
+{
+	unsigned int n, i;
+
+	for (n = 0; n <= SIMD_VEC_LEN; n++) {
+		c[n] = SIMD_GUARD;
+
+		matrix_vecMul(c, a, &b[1], n);
+
+		for (i = 0; i < n; i++) {
+			TEST_ASSERT_EQUAL_FLOAT(a[i] * b[i + 1], c[i]);
+		}
+		TEST_ASSERT_EQUAL_FLOAT(SIMD_GUARD, c[n]);
+	}
+}
+
+
+TEST(group_matrix_simd, matrix_simd_vecMulAdd)
+{
+	unsigned int n, i;
+
+	for (n = 0; n <= SIMD_VEC_LEN; n++) {
+		memcpy(c, orig, sizeof(c));
+		c[n] = SIMD_GUARD;
+
+		matrix_vecMulAdd(c, a, &b[1], n);
+
+		for (i = 0; i < n; i++) {
+			TEST_ASSERT_FLOAT_WITHIN(SIMD_ELEM_REL * (fabsf(orig[i]) + fabsf(a[i] * b[i + 1])), orig[i] + a[i] * b[i + 1], c[i]);
+		}
+		TEST_ASSERT_EQUAL_FLOAT(SIMD_GUARD, c[n]);
+	}
+}
+
+
+TEST(group_matrix_simd, matrix_simd_vecDot)
+{
+	unsigned int n, i;
+	float sum, scale;
+
+	for (n = 0; n <= SIMD_VEC_LEN; n++) {
+		sum = 0;
+		scale = 0;
+		for (i = 0; i < n; i++) {
+			sum += a[i] * b[i + 1];
+			scale += fabsf(a[i] * b[i + 1]);
+		}
+
+		TEST_ASSERT_FLOAT_WITHIN(PROD_REL_DELTA(n) * scale, sum, matrix_vecDot(a, &b[1], n));
+	}
+}
+
+
+TEST(group_matrix_simd, matrix_simd_vecDot4)
+{
+	unsigned int n, i, r;
+	float out[5], sum, scale;
+
+	for (n = 0; n <= SIMD_VEC_LEN; n++) {
+		out[4] = SIMD_GUARD;
+
+		/* rows of `b` are `n` elements apart, as rows of transposed matrix of EKF kernels */
+		matrix_vecDot4(a, &b[1], n, n, out);
+
+		for (r = 0; r < 4; r++) {
+			sum = 0;
+			scale = 0;
+			for (i = 0; i < n; i++) {
+				sum += a[i] * b[1 + n * r + i];
+				scale += fabsf(a[i] * b[1 + n * r + i]);
+			}
+
+			TEST_ASSERT_FLOAT_WITHIN(PROD_REL_DELTA(n) * scale, sum, out[r]);
+		}
+		TEST_ASSERT_EQUAL_FLOAT(SIMD_GUARD, out[4]);
+	}
+}
+
+
+TEST(group_matrix_simd, matrix_simd_prodNN)
+{
+	simd_prodShapesCheck(0, 0);
+}
+
+
+TEST(group_matrix_simd, matrix_simd_prodTN)
+{
+	simd_prodShapesCheck(1, 0);
+}
+
+
+TEST(group_matrix_simd, matrix_simd_prodNT)
+{
+	simd_prodShapesCheck(0, 1);
+}
+
+
+TEST(group_matrix_simd, matrix_simd_prodTT)
+{
+	simd_prodShapesCheck(1, 1);
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_simd)
+{
+	RUN_TEST_CASE(group_matrix_simd, matrix_simd_vecAxpy);
+	RUN_TEST_CASE(group_matrix_simd, matrix_simd_vecScale);
+	RUN_TEST_CASE(group_matrix_simd, matrix_simd_vecMul);
+	RUN_TEST_CASE(group_matrix_simd, matrix_simd_vecMulAdd);
+	RUN_TEST_CASE(group_matrix_simd, matrix_simd_vecDot);
+	RUN_TEST_CASE(group_matrix_simd, matrix_simd_vecDot4);
+	RUN_TEST_CASE(group_matrix_simd, matrix_simd_prodNN);
+	RUN_TEST_CASE(group_matrix_simd, matrix_simd_prodTN);
+	RUN_TEST_CASE(group_matrix_simd, matrix_simd_prodNT);
+	RUN_TEST_CASE(group_matrix_simd, matrix_simd_prodTT);
+}
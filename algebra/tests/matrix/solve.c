@@ -0,0 +1,326 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Unit tests for matrix library
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <string.h>
+
+#include <unity_fixture.h>
+
+#include <matrix.h>
+
+#include "../tools.h"
+#include "buffs.h"
+
+
+#define DELTA 1e-4f
+
+/* Sizes of innovation covariance and Kalman gain used by EKF */
+#define SOLVE_SYS_SIZE 6
+#define SOLVE_RHS_SIZE 16
+
+/* Defines for solvers results */
+#define MAT_SOLVE_OK   0
+#define MAT_SOLVE_FAIL -1
+
+
+static matrix_t A, Acopy, B, X, Check;
+
+
+/* Fills `M` with symmetric positive definite matrix R * R^T + size * I */
+static void solve_spdFill(matrix_t *M, unsigned int seed)
+{
+	matrix_t R = { 0 }, Rt;
+	unsigned int i;
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&R, M->rows, M->cols));
+	algebraTests_pseudoFill(&R, seed);
+
+	Rt = R;
+	matrix_trp(&Rt);
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&R, &Rt, M));
+
+	for (i = 0; i < M->rows; i++) {
+		MATRIX_DATA(M, i, i) += M->rows;
+	}
+
+	matrix_bufFree(&R);
+}
+
+
+/* Allocates matrices for left solve (right == 0) or right solve (right == 1) and fills them */
+static void solve_prepare(int right)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, SOLVE_SYS_SIZE, SOLVE_SYS_SIZE));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Acopy, SOLVE_SYS_SIZE, SOLVE_SYS_SIZE));
+
+	if (right) {
+		TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&B, SOLVE_RHS_SIZE, SOLVE_SYS_SIZE));
+		TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&X, SOLVE_RHS_SIZE, SOLVE_SYS_SIZE));
+		TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Check, SOLVE_RHS_SIZE, SOLVE_SYS_SIZE));
+	}
+	else {
+		TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&B, SOLVE_SYS_SIZE, SOLVE_RHS_SIZE));
+		TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&X, SOLVE_SYS_SIZE, SOLVE_RHS_SIZE));
+		TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Check, SOLVE_SYS_SIZE, SOLVE_RHS_SIZE));
+	}
+
+	solve_spdFill(&A, 7);
+	algebraTests_pseudoFill(&B, 11);
+	TEST_ASSERT_EQUAL_INT(MAT_BUFFILL_OK, algebraTests_buffFill(&X, initVal, BUFFILL_WRITE_ALL));
+
+	memcpy(Acopy.data, A.data, sizeof(float) * A.rows * A.cols);
+}
+
+
+/* Checks if A * X == B for left solve or X * A == B for right solve, using copy of A made before solving */
+static void solve_check(int right)
+{
+	if (right) {
+		TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&X, &Acopy, &Check));
+	}
+	else {
+		TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&Acopy, &X, &Check));
+	}
+
+	TEST_ASSERT_EQUAL_UINT(0, X.transposed);
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, B, Check);
+}
+
+
+static void solve_clear(void)
+{
+	A.data = NULL;
+	Acopy.data = NULL;
+	B.data = NULL;
+	X.data = NULL;
+	Check.data = NULL;
+}
+
+
+static void solve_free(void)
+{
+	matrix_bufFree(&A);
+	matrix_bufFree(&Acopy);
+	matrix_bufFree(&B);
+	matrix_bufFree(&X);
+	matrix_bufFree(&Check);
+}
+
+
+/* ##############################################################################
+ * -------------------        matrix_cholSolve tests       -----------------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_matrix_cholSolve);
+
+
+TEST_SETUP(group_matrix_cholSolve)
+{
+	solve_clear();
+}
+
+
+TEST_TEAR_DOWN(group_matrix_cholSolve)
+{
+	solve_free();
+}
+
+
+TEST(group_matrix_cholSolve, matrix_cholSolve_std)
+{
+	solve_prepare(0);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_OK, matrix_cholSolve(&A, &B, &X));
+
+	solve_check(0);
+}
+
+
+TEST(group_matrix_cholSolve, matrix_cholSolve_right)
+{
+	solve_prepare(1);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_OK, matrix_cholSolveRight(&A, &B, &X));
+
+	solve_check(1);
+}
+
+
+TEST(group_matrix_cholSolve, matrix_cholSolve_secondMatTrp)
+{
+	solve_prepare(0);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&B));
+
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_OK, matrix_cholSolve(&A, &B, &X));
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&B));
+	solve_check(0);
+}
+
+
+TEST(group_matrix_cholSolve, matrix_cholSolve_inPlace)
+{
+	solve_prepare(1);
+	memcpy(X.data, B.data, sizeof(float) * B.rows * B.cols);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_OK, matrix_cholSolveRight(&A, &X, &X));
+
+	solve_check(1);
+}
+
+
+/* Elements above diagonal of A must not be used */
+TEST(group_matrix_cholSolve, matrix_cholSolve_upperIgnored)
+{
+	unsigned int row, col;
+
+	solve_prepare(0);
+	for (row = 0; row < A.rows; row++) {
+		for (col = row + 1; col < A.cols; col++) {
+			MATRIX_DATA(&A, row, col) = NEG_SCALAR;
+		}
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_OK, matrix_cholSolve(&A, &B, &X));
+
+	solve_check(0);
+}
+
+
+TEST(group_matrix_cholSolve, matrix_cholSolve_notPosDef)
+{
+	solve_prepare(1);
+
+	/* Symmetric but indefinite matrix */
+	matrix_zeroes(&A);
+	MATRIX_DATA(&A, 0, 0) = POS_SCALAR;
+	MATRIX_DATA(&A, 1, 1) = NEG_SCALAR;
+	memcpy(Check.data, X.data, sizeof(float) * X.rows * X.cols);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_FAIL, matrix_cholSolveRight(&A, &B, &X));
+
+	/* Result matrix is retained on failure */
+	TEST_ASSERT_EQUAL_FLOAT_ARRAY(Check.data, X.data, X.rows * X.cols);
+}
+
+
+TEST(group_matrix_cholSolve, matrix_cholSolve_badMats)
+{
+	solve_prepare(0);
+
+	/* Right solve needs B with as many columns as A */
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_FAIL, matrix_cholSolveRight(&A, &B, &X));
+
+	/* Result of incorrect size */
+	X.rows--;
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_FAIL, matrix_cholSolve(&A, &B, &X));
+	X.rows++;
+
+	/* A is not square */
+	A.rows--;
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_FAIL, matrix_cholSolve(&A, &B, &X));
+	A.rows++;
+
+	/* In place solve with transposed B */
+	matrix_trp(&B);
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_FAIL, matrix_cholSolveRight(&A, &B, &B));
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_cholSolve)
+{
+	RUN_TEST_CASE(group_matrix_cholSolve, matrix_cholSolve_std);
+	RUN_TEST_CASE(group_matrix_cholSolve, matrix_cholSolve_right);
+	RUN_TEST_CASE(group_matrix_cholSolve, matrix_cholSolve_secondMatTrp);
+	RUN_TEST_CASE(group_matrix_cholSolve, matrix_cholSolve_inPlace);
+	RUN_TEST_CASE(group_matrix_cholSolve, matrix_cholSolve_upperIgnored);
+	RUN_TEST_CASE(group_matrix_cholSolve, matrix_cholSolve_notPosDef);
+	RUN_TEST_CASE(group_matrix_cholSolve, matrix_cholSolve_badMats);
+}
+
+
+/* ##############################################################################
+ * -------------------        matrix_ldltSolve tests       -----------------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_matrix_ldltSolve);
+
+
+TEST_SETUP(group_matrix_ldltSolve)
+{
+	solve_clear();
+}
+
+
+TEST_TEAR_DOWN(group_matrix_ldltSolve)
+{
+	solve_free();
+}
+
+
+TEST(group_matrix_ldltSolve, matrix_ldltSolve_std)
+{
+	solve_prepare(0);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_OK, matrix_ldltSolve(&A, &B, &X));
+
+	solve_check(0);
+}
+
+
+TEST(group_matrix_ldltSolve, matrix_ldltSolve_right)
+{
+	solve_prepare(1);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_OK, matrix_ldltSolveRight(&A, &B, &X));
+
+	solve_check(1);
+}
+
+
+/* LDL^T does not need positive definite matrix */
+TEST(group_matrix_ldltSolve, matrix_ldltSolve_indefinite)
+{
+	unsigned int i;
+
+	solve_prepare(0);
+	for (i = 0; i < A.rows; i += 2) {
+		MATRIX_DATA(&A, i, i) = -MATRIX_DATA(&A, i, i);
+	}
+	memcpy(Acopy.data, A.data, sizeof(float) * A.rows * A.cols);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_OK, matrix_ldltSolve(&A, &B, &X));
+
+	solve_check(0);
+}
+
+
+TEST(group_matrix_ldltSolve, matrix_ldltSolve_singular)
+{
+	solve_prepare(0);
+	matrix_zeroes(&A);
+	memcpy(Check.data, X.data, sizeof(float) * X.rows * X.cols);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SOLVE_FAIL, matrix_ldltSolve(&A, &B, &X));
+
+	TEST_ASSERT_EQUAL_FLOAT_ARRAY(Check.data, X.data, X.rows * X.cols);
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_ldltSolve)
+{
+	RUN_TEST_CASE(group_matrix_ldltSolve, matrix_ldltSolve_std);
+	RUN_TEST_CASE(group_matrix_ldltSolve, matrix_ldltSolve_right);
+	RUN_TEST_CASE(group_matrix_ldltSolve, matrix_ldltSolve_indefinite);
+	RUN_TEST_CASE(group_matrix_ldltSolve, matrix_ldltSolve_singular);
+}
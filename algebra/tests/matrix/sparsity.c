@@ -0,0 +1,419 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Unit tests for matrix library
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <unity_fixture.h>
+
+#include <matrix.h>
+
+#include "../tools.h"
+#include "buffs.h"
+
+
+#define DELTA 1e-4f
+
+/* Sizes of EKF state and IMU measurement */
+#define EKF_STATE_LEN 16
+#define EKF_MEAS_LEN  6
+
+/* Defines for pattern functions results */
+#define MAT_PATTERN_OK   0
+#define MAT_PATTERN_FAIL -1
+
+
+static matrix_t A, B, C, Expected, tmp;
+static matrix_sparsity_t S;
+
+
+/* Fills `M` with pseudo random values and zeroes about two thirds of elements. First row is left empty */
+static void sparsity_sparseFill(matrix_t *M, unsigned int seed)
+{
+	unsigned int row, col;
+
+	algebraTests_pseudoFill(M, seed);
+
+	for (row = 0; row < matrix_rowsGet(M); row++) {
+		for (col = 0; col < matrix_colsGet(M); col++) {
+			if (row == 0 || (row * 7 + col) % 3 != 0) {
+				*matrix_at(M, row, col) = 0;
+			}
+		}
+	}
+}
+
+
+/* Allocates A (rows x steps) with its pattern S, B (steps x cols), C and Expected = A * B */
+static void patternProd_prepare(unsigned int rows, unsigned int steps, unsigned int cols)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, rows, steps));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&B, steps, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&C, rows, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, rows, cols));
+
+	sparsity_sparseFill(&A, 1);
+	algebraTests_pseudoFill(&B, 2);
+	algebraTests_pseudoFill(&C, 3);
+
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_OK, matrix_sparsityAlloc(&S, &A));
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&A, &B, &Expected));
+}
+
+
+/* ##############################################################################
+ * --------------------        matrix_sparsityAlloc tests       -----------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_matrix_sparsity);
+
+
+TEST_SETUP(group_matrix_sparsity)
+{
+	A.data = NULL;
+	S.rowStart = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_sparsity)
+{
+	matrix_bufFree(&A);
+	matrix_sparsityFree(&S);
+}
+
+
+TEST(group_matrix_sparsity, matrix_sparsity_std)
+{
+	static const float vals[] = {
+		0, 1, 0, 2,
+		0, 0, 0, 0,
+		3, 0, 0, 4
+	};
+	static const unsigned int rowStart[] = { 0, 2, 2, 4 };
+	static const unsigned int colIdx[] = { 1, 3, 0, 3 };
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_createAndFill(&A, 3, 4, vals, sizeof(vals) / sizeof(vals[0])));
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_OK, matrix_sparsityAlloc(&S, &A));
+
+	TEST_ASSERT_EQUAL_UINT(3, S.rows);
+	TEST_ASSERT_EQUAL_UINT(4, S.cols);
+	TEST_ASSERT_EQUAL_UINT(4, S.nnz);
+	TEST_ASSERT_EQUAL_UINT_ARRAY(rowStart, S.rowStart, 4);
+	TEST_ASSERT_EQUAL_UINT_ARRAY(colIdx, S.colIdx, 4);
+}
+
+
+TEST(group_matrix_sparsity, matrix_sparsity_trp)
+{
+	static const float vals[] = {
+		0, 1, 0, 2,
+		0, 0, 0, 0,
+		3, 0, 0, 4
+	};
+	static const unsigned int rowStart[] = { 0, 1, 2, 2, 4 };
+	static const unsigned int colIdx[] = { 2, 0, 0, 2 };
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_createAndFill(&A, 3, 4, vals, sizeof(vals) / sizeof(vals[0])));
+	matrix_trp(&A);
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_OK, matrix_sparsityAlloc(&S, &A));
+
+	TEST_ASSERT_EQUAL_UINT(4, S.rows);
+	TEST_ASSERT_EQUAL_UINT(3, S.cols);
+	TEST_ASSERT_EQUAL_UINT(4, S.nnz);
+	TEST_ASSERT_EQUAL_UINT_ARRAY(rowStart, S.rowStart, 5);
+	TEST_ASSERT_EQUAL_UINT_ARRAY(colIdx, S.colIdx, 4);
+}
+
+
+TEST(group_matrix_sparsity, matrix_sparsity_zeroMat)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, 3, 4));
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_OK, matrix_sparsityAlloc(&S, &A));
+
+	TEST_ASSERT_EQUAL_UINT(0, S.nnz);
+	TEST_ASSERT_EQUAL_UINT(0, S.rowStart[3]);
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_sparsity)
+{
+	RUN_TEST_CASE(group_matrix_sparsity, matrix_sparsity_std);
+	RUN_TEST_CASE(group_matrix_sparsity, matrix_sparsity_trp);
+	RUN_TEST_CASE(group_matrix_sparsity, matrix_sparsity_zeroMat);
+}
+
+
+/* ##############################################################################
+ * ---------------------        matrix_patternProd tests       ------------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_matrix_patternProd);
+
+
+TEST_SETUP(group_matrix_patternProd)
+{
+	A.data = NULL;
+	B.data = NULL;
+	C.data = NULL;
+	Expected.data = NULL;
+	S.rowStart = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_patternProd)
+{
+	matrix_bufFree(&A);
+	matrix_bufFree(&B);
+	matrix_bufFree(&C);
+	matrix_bufFree(&Expected);
+	matrix_sparsityFree(&S);
+}
+
+
+TEST(group_matrix_patternProd, matrix_patternProd_std)
+{
+	patternProd_prepare(EKF_STATE_LEN, EKF_STATE_LEN, EKF_MEAS_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_OK, matrix_patternProd(&S, &A, &B, &C));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+}
+
+
+TEST(group_matrix_patternProd, matrix_patternProd_firstMatTrp)
+{
+	patternProd_prepare(EKF_STATE_LEN, EKF_MEAS_LEN, EKF_STATE_LEN);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&A));
+
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_OK, matrix_patternProd(&S, &A, &B, &C));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+}
+
+
+TEST(group_matrix_patternProd, matrix_patternProd_secondMatTrp)
+{
+	patternProd_prepare(EKF_MEAS_LEN, EKF_STATE_LEN, EKF_STATE_LEN);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&B));
+
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_OK, matrix_patternProd(&S, &A, &B, &C));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+}
+
+
+TEST(group_matrix_patternProd, matrix_patternProd_resultMatTrp)
+{
+	patternProd_prepare(EKF_STATE_LEN, EKF_STATE_LEN, EKF_MEAS_LEN);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&C));
+
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_OK, matrix_patternProd(&S, &A, &B, &C));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+}
+
+
+/* Elements of A outside of pattern are treated as zeroes, even if they are nonzero */
+TEST(group_matrix_patternProd, matrix_patternProd_outsideIgnored)
+{
+	unsigned int row, col;
+
+	patternProd_prepare(EKF_STATE_LEN, EKF_STATE_LEN, EKF_STATE_LEN);
+
+	for (row = 0; row < A.rows; row++) {
+		for (col = 0; col < A.cols; col++) {
+			if (MATRIX_DATA(&A, row, col) == 0) {
+				MATRIX_DATA(&A, row, col) = 1000;
+			}
+		}
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_OK, matrix_patternProd(&S, &A, &B, &C));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+}
+
+
+TEST(group_matrix_patternProd, matrix_patternProd_viewResult)
+{
+	matrix_t view, parent;
+
+	patternProd_prepare(EKF_MEAS_LEN, EKF_STATE_LEN, EKF_MEAS_LEN);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&parent, EKF_STATE_LEN, EKF_STATE_LEN));
+	TEST_ASSERT_EQUAL_INT(0, matrix_view(&parent, 1, 2, EKF_MEAS_LEN, EKF_MEAS_LEN, &view));
+
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_OK, matrix_patternProd(&S, &A, &B, &view));
+	TEST_ASSERT_EQUAL_INT(MAT_WRITE_SUBMAT_OK, matrix_writeSubmatrix(&C, 0, 0, &view));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+	TEST_ASSERT_EQUAL_FLOAT(0, MATRIX_DATA(&parent, 1, 1));
+	TEST_ASSERT_EQUAL_FLOAT(0, MATRIX_DATA(&parent, 0, 2));
+
+	matrix_bufFree(&parent);
+}
+
+
+TEST(group_matrix_patternProd, matrix_patternProd_badMats)
+{
+	patternProd_prepare(EKF_MEAS_LEN, EKF_STATE_LEN, EKF_MEAS_LEN);
+
+	/* pattern of different size than A */
+	matrix_trp(&A);
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_FAIL, matrix_patternProd(&S, &A, &B, &C));
+	matrix_trp(&A);
+
+	/* B of bad size */
+	matrix_trp(&B);
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_FAIL, matrix_patternProd(&S, &A, &B, &C));
+	matrix_trp(&B);
+
+	/* C of bad size */
+	C.rows = EKF_STATE_LEN;
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_FAIL, matrix_patternProd(&S, &A, &B, &C));
+	C.rows = EKF_MEAS_LEN;
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_patternProd)
+{
+	RUN_TEST_CASE(group_matrix_patternProd, matrix_patternProd_std);
+	RUN_TEST_CASE(group_matrix_patternProd, matrix_patternProd_firstMatTrp);
+	RUN_TEST_CASE(group_matrix_patternProd, matrix_patternProd_secondMatTrp);
+	RUN_TEST_CASE(group_matrix_patternProd, matrix_patternProd_resultMatTrp);
+	RUN_TEST_CASE(group_matrix_patternProd, matrix_patternProd_outsideIgnored);
+	RUN_TEST_CASE(group_matrix_patternProd, matrix_patternProd_viewResult);
+	RUN_TEST_CASE(group_matrix_patternProd, matrix_patternProd_badMats);
+}
+
+
+/* ##############################################################################
+ * -------------------        matrix_patternSandwitch tests       ---------------
+ * ############################################################################## */
+
+
+/* Allocates sparse A (rows x cols) with pattern S, symmetric B (cols x cols), C, tmp and Expected = A * B * trp(A) */
+static void patternSandwitch_prepare(unsigned int rows, unsigned int cols)
+{
+	matrix_t BAt = { 0 };
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, rows, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&B, cols, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&C, rows, rows));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&tmp, rows, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, rows, rows));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&BAt, cols, rows));
+
+	sparsity_sparseFill(&A, 4);
+	algebraTests_pseudoFill(&B, 5);
+	for (row = 0; row < cols; row++) {
+		for (col = row + 1; col < cols; col++) {
+			MATRIX_DATA(&B, col, row) = MATRIX_DATA(&B, row, col);
+		}
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_PATTERN_OK, matrix_sparsityAlloc(&S, &A));
+
+	matrix_trp(&A);
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&B, &A, &BAt));
+	matrix_trp(&A);
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&A, &BAt, &Expected));
+
+	matrix_bufFree(&BAt);
+}
+
+
+TEST_GROUP(group_matrix_patternSandwitch);
+
+
+TEST_SETUP(group_matrix_patternSandwitch)
+{
+	A.data = NULL;
+	B.data = NULL;
+	C.data = NULL;
+	tmp.data = NULL;
+	Expected.data = NULL;
+	S.rowStart = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_patternSandwitch)
+{
+	matrix_bufFree(&A);
+	matrix_bufFree(&B);
+	matrix_bufFree(&C);
+	matrix_bufFree(&tmp);
+	matrix_bufFree(&Expected);
+	matrix_sparsityFree(&S);
+}
+
+
+TEST(group_matrix_patternSandwitch, matrix_patternSandwitch_stateMats)
+{
+	unsigned int row, col;
+
+	patternSandwitch_prepare(EKF_STATE_LEN, EKF_STATE_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_OK, matrix_patternSandwitch(&S, &A, &B, &C, &tmp));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+	for (row = 0; row < C.rows; row++) {
+		for (col = row + 1; col < C.cols; col++) {
+			TEST_ASSERT_EQUAL_FLOAT(MATRIX_DATA(&C, row, col), MATRIX_DATA(&C, col, row));
+		}
+	}
+}
+
+
+TEST(group_matrix_patternSandwitch, matrix_patternSandwitch_measMats)
+{
+	patternSandwitch_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_OK, matrix_patternSandwitch(&S, &A, &B, &C, &tmp));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+}
+
+
+TEST(group_matrix_patternSandwitch, matrix_patternSandwitch_firstMatTrp)
+{
+	patternSandwitch_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&A));
+
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_OK, matrix_patternSandwitch(&S, &A, &B, &C, &tmp));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+}
+
+
+TEST(group_matrix_patternSandwitch, matrix_patternSandwitch_badMats)
+{
+	patternSandwitch_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+
+	/* pattern of different size than A */
+	S.rows = EKF_STATE_LEN;
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_FAIL, matrix_patternSandwitch(&S, &A, &B, &C, &tmp));
+	S.rows = EKF_MEAS_LEN;
+
+	/* bad temporary matrix */
+	tmp.rows = EKF_STATE_LEN;
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_FAIL, matrix_patternSandwitch(&S, &A, &B, &C, &tmp));
+	tmp.rows = EKF_MEAS_LEN;
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_patternSandwitch)
+{
+	RUN_TEST_CASE(group_matrix_patternSandwitch, matrix_patternSandwitch_stateMats);
+	RUN_TEST_CASE(group_matrix_patternSandwitch, matrix_patternSandwitch_measMats);
+	RUN_TEST_CASE(group_matrix_patternSandwitch, matrix_patternSandwitch_firstMatTrp);
+	RUN_TEST_CASE(group_matrix_patternSandwitch, matrix_patternSandwitch_badMats);
+}
@@ -0,0 +1,548 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Unit tests for matrix library
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <unity_fixture.h>
+
+#include <matrix.h>
+
+#include "../tools.h"
+#include "buffs.h"
+
+
+#define DELTA 1e-4f
+
+/* Sizes of EKF state and IMU measurement */
+#define EKF_STATE_LEN 16
+#define EKF_MEAS_LEN  6
+
+#define GEMM_ALPHA -0.5f
+#define GEMM_BETA  2.f
+
+/* Defines for packed symmetric functions results */
+#define MAT_SYM_OK   0
+#define MAT_SYM_FAIL -1
+
+
+static matrix_t A, B, C, Expected, tmp;
+static matrix_sym_t P, Psym;
+static matrix_sparsity_t S;
+
+
+/* Fills `M` with pseudo random values and mirrors its upper triangle, so it is symmetric */
+static void sym_symFill(matrix_t *M, unsigned int seed)
+{
+	unsigned int row, col;
+
+	algebraTests_pseudoFill(M, seed);
+
+	for (row = 0; row < M->rows; row++) {
+		for (col = row + 1; col < M->cols; col++) {
+			MATRIX_DATA(M, col, row) = MATRIX_DATA(M, row, col);
+		}
+	}
+}
+
+
+/* Fills `M` with pseudo random values and zeroes about two thirds of elements. First row is left empty */
+static void sym_sparseFill(matrix_t *M, unsigned int seed)
+{
+	unsigned int row, col;
+
+	algebraTests_pseudoFill(M, seed);
+
+	for (row = 0; row < matrix_rowsGet(M); row++) {
+		for (col = 0; col < matrix_colsGet(M); col++) {
+			if (row == 0 || (row * 7 + col) % 3 != 0) {
+				*matrix_at(M, row, col) = 0;
+			}
+		}
+	}
+}
+
+
+/* Checks that packed `Sym` holds upper triangle of symmetric `M` */
+static void sym_check(const matrix_t *M, const matrix_sym_t *Sym)
+{
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_UINT(M->rows, Sym->n);
+
+	for (row = 0; row < Sym->n; row++) {
+		for (col = 0; col < Sym->n; col++) {
+			TEST_ASSERT_FLOAT_WITHIN(DELTA, MATRIX_DATA(M, row, col), Sym->data[matrix_symIdx(Sym, row, col)]);
+		}
+	}
+}
+
+
+/* Allocates sparse A (rows x n) with its pattern S, symmetric B (n x n) packed into P, C (rows x n) and Expected = A * B */
+static void symPatternProd_prepare(unsigned int rows, unsigned int n)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, rows, n));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&B, n, n));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&C, rows, n));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, rows, n));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_symAlloc(&P, n));
+
+	sym_sparseFill(&A, 1);
+	sym_symFill(&B, 2);
+	algebraTests_pseudoFill(&C, 3);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symPack(&B, &P));
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_sparsityAlloc(&S, &A));
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&A, &B, &Expected));
+}
+
+
+/* ##############################################################################
+ * ----------------------        matrix_sym* basic tests       ------------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_matrix_sym);
+
+
+TEST_SETUP(group_matrix_sym)
+{
+	A.data = NULL;
+	B.data = NULL;
+	P.data = NULL;
+	Psym.data = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_sym)
+{
+	matrix_bufFree(&A);
+	matrix_bufFree(&B);
+	matrix_symFree(&P);
+	matrix_symFree(&Psym);
+}
+
+
+TEST(group_matrix_sym, matrix_sym_alloc)
+{
+	unsigned int i;
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_symAlloc(&P, EKF_STATE_LEN));
+
+	TEST_ASSERT_EQUAL_UINT(EKF_STATE_LEN, P.n);
+	TEST_ASSERT_NOT_NULL(P.data);
+	for (i = 0; i < MATRIX_SYM_LEN(EKF_STATE_LEN); i++) {
+		TEST_ASSERT_EQUAL_FLOAT(0, P.data[i]);
+	}
+
+	matrix_symFree(&P);
+	TEST_ASSERT_NULL(P.data);
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_FAIL, matrix_symAlloc(&P, 0));
+}
+
+
+TEST(group_matrix_sym, matrix_sym_idx)
+{
+	unsigned int row, col, expected = 0;
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_symAlloc(&P, EKF_MEAS_LEN));
+
+	/* elements on and above diagonal are stored contiguously row by row */
+	for (row = 0; row < P.n; row++) {
+		for (col = row; col < P.n; col++) {
+			TEST_ASSERT_EQUAL_UINT(expected, matrix_symIdx(&P, row, col));
+			TEST_ASSERT_EQUAL_UINT(expected, matrix_symIdx(&P, col, row));
+			expected++;
+		}
+	}
+	TEST_ASSERT_EQUAL_UINT(MATRIX_SYM_LEN(EKF_MEAS_LEN), expected);
+}
+
+
+TEST(group_matrix_sym, matrix_sym_packUnpack)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, EKF_STATE_LEN, EKF_STATE_LEN));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&B, EKF_STATE_LEN, EKF_STATE_LEN));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_symAlloc(&P, EKF_STATE_LEN));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_symAlloc(&Psym, EKF_STATE_LEN));
+	sym_symFill(&A, 1);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symPack(&A, &P));
+	sym_check(&A, &P);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symCopy(&Psym, &P));
+	TEST_ASSERT_EQUAL_FLOAT_ARRAY(P.data, Psym.data, MATRIX_SYM_LEN(EKF_STATE_LEN));
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symUnpack(&Psym, &B));
+	TEST_ASSERT_EQUAL_FLOAT_ARRAY(A.data, B.data, EKF_STATE_LEN * EKF_STATE_LEN);
+}
+
+
+TEST(group_matrix_sym, matrix_sym_lowerIgnored)
+{
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, EKF_MEAS_LEN, EKF_MEAS_LEN));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_symAlloc(&P, EKF_MEAS_LEN));
+	sym_symFill(&A, 1);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_matrixCopy(&B, &A));
+
+	/* lower triangle of packed matrix source is not read */
+	for (row = 1; row < B.rows; row++) {
+		for (col = 0; col < row; col++) {
+			MATRIX_DATA(&B, row, col) = 1000.f;
+		}
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symPack(&B, &P));
+	sym_check(&A, &P);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symAdd(&P, &B));
+	matrix_times(&A, 2.f);
+	sym_check(&A, &P);
+}
+
+
+TEST(group_matrix_sym, matrix_sym_badMats)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, EKF_MEAS_LEN, EKF_STATE_LEN));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_symAlloc(&P, EKF_STATE_LEN));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_symAlloc(&Psym, EKF_MEAS_LEN));
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_FAIL, matrix_symPack(&A, &P));
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_FAIL, matrix_symUnpack(&P, &A));
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_FAIL, matrix_symAdd(&P, &A));
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_FAIL, matrix_symCopy(&Psym, &P));
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_sym)
+{
+	RUN_TEST_CASE(group_matrix_sym, matrix_sym_alloc);
+	RUN_TEST_CASE(group_matrix_sym, matrix_sym_idx);
+	RUN_TEST_CASE(group_matrix_sym, matrix_sym_packUnpack);
+	RUN_TEST_CASE(group_matrix_sym, matrix_sym_lowerIgnored);
+	RUN_TEST_CASE(group_matrix_sym, matrix_sym_badMats);
+}
+
+
+/* ##############################################################################
+ * ------------------        matrix_symPatternProd tests       ------------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_matrix_symPatternProd);
+
+
+TEST_SETUP(group_matrix_symPatternProd)
+{
+	A.data = NULL;
+	B.data = NULL;
+	C.data = NULL;
+	Expected.data = NULL;
+	P.data = NULL;
+	S.rowStart = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_symPatternProd)
+{
+	matrix_bufFree(&A);
+	matrix_bufFree(&B);
+	matrix_bufFree(&C);
+	matrix_bufFree(&Expected);
+	matrix_symFree(&P);
+	matrix_sparsityFree(&S);
+}
+
+
+TEST(group_matrix_symPatternProd, matrix_symPatternProd_stateMats)
+{
+	symPatternProd_prepare(EKF_STATE_LEN, EKF_STATE_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symPatternProd(&S, &A, &P, &C));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+}
+
+
+TEST(group_matrix_symPatternProd, matrix_symPatternProd_measMats)
+{
+	symPatternProd_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symPatternProd(&S, &A, &P, &C));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+}
+
+
+TEST(group_matrix_symPatternProd, matrix_symPatternProd_firstMatTrp)
+{
+	symPatternProd_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&A));
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symPatternProd(&S, &A, &P, &C));
+
+	TEST_ASSERT_MATRIX_WITHIN(DELTA, Expected, C);
+}
+
+
+TEST(group_matrix_symPatternProd, matrix_symPatternProd_viewResult)
+{
+	matrix_t big = { 0 }, view;
+	unsigned int row, col;
+
+	symPatternProd_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&big, EKF_MEAS_LEN + 2, EKF_STATE_LEN + 2));
+	matrix_view(&big, 1, 1, EKF_MEAS_LEN, EKF_STATE_LEN, &view);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symPatternProd(&S, &A, &P, &view));
+
+	for (row = 0; row < EKF_MEAS_LEN; row++) {
+		for (col = 0; col < EKF_STATE_LEN; col++) {
+			TEST_ASSERT_FLOAT_WITHIN(DELTA, MATRIX_DATA(&Expected, row, col), MATRIX_DATA(&view, row, col));
+		}
+	}
+
+	matrix_bufFree(&big);
+}
+
+
+TEST(group_matrix_symPatternProd, matrix_symPatternProd_badMats)
+{
+	symPatternProd_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+
+	/* pattern of different size than A */
+	S.rows = EKF_STATE_LEN;
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_FAIL, matrix_symPatternProd(&S, &A, &P, &C));
+	S.rows = EKF_MEAS_LEN;
+
+	/* result of wrong size */
+	C.cols = EKF_MEAS_LEN;
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_FAIL, matrix_symPatternProd(&S, &A, &P, &C));
+	C.cols = EKF_STATE_LEN;
+
+	/* packed matrix of wrong size */
+	P.n = EKF_MEAS_LEN;
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_FAIL, matrix_symPatternProd(&S, &A, &P, &C));
+	P.n = EKF_STATE_LEN;
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_symPatternProd)
+{
+	RUN_TEST_CASE(group_matrix_symPatternProd, matrix_symPatternProd_stateMats);
+	RUN_TEST_CASE(group_matrix_symPatternProd, matrix_symPatternProd_measMats);
+	RUN_TEST_CASE(group_matrix_symPatternProd, matrix_symPatternProd_firstMatTrp);
+	RUN_TEST_CASE(group_matrix_symPatternProd, matrix_symPatternProd_viewResult);
+	RUN_TEST_CASE(group_matrix_symPatternProd, matrix_symPatternProd_badMats);
+}
+
+
+/* ##############################################################################
+ * ----------------        matrix_symPatternSandwitch tests       ---------------
+ * ############################################################################## */
+
+
+/* Allocates sparse A (rows x cols) with pattern S, symmetric B packed into P, tmp, C and Expected = A * B * A^T */
+static void symPatternSandwitch_prepare(unsigned int rows, unsigned int cols)
+{
+	matrix_t BAt = { 0 };
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, rows, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&B, cols, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&tmp, rows, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, rows, rows));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&BAt, cols, rows));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_symAlloc(&P, cols));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_symAlloc(&Psym, rows));
+
+	sym_sparseFill(&A, 4);
+	sym_symFill(&B, 5);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symPack(&B, &P));
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_sparsityAlloc(&S, &A));
+
+	matrix_trp(&A);
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&B, &A, &BAt));
+	matrix_trp(&A);
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&A, &BAt, &Expected));
+
+	matrix_bufFree(&BAt);
+}
+
+
+TEST_GROUP(group_matrix_symPatternSandwitch);
+
+
+TEST_SETUP(group_matrix_symPatternSandwitch)
+{
+	A.data = NULL;
+	B.data = NULL;
+	tmp.data = NULL;
+	Expected.data = NULL;
+	P.data = NULL;
+	Psym.data = NULL;
+	S.rowStart = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_symPatternSandwitch)
+{
+	matrix_bufFree(&A);
+	matrix_bufFree(&B);
+	matrix_bufFree(&tmp);
+	matrix_bufFree(&Expected);
+	matrix_symFree(&P);
+	matrix_symFree(&Psym);
+	matrix_sparsityFree(&S);
+}
+
+
+TEST(group_matrix_symPatternSandwitch, matrix_symPatternSandwitch_stateMats)
+{
+	symPatternSandwitch_prepare(EKF_STATE_LEN, EKF_STATE_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_OK, matrix_symPatternSandwitch(&S, &A, &P, &Psym, &tmp));
+
+	sym_check(&Expected, &Psym);
+}
+
+
+TEST(group_matrix_symPatternSandwitch, matrix_symPatternSandwitch_measMats)
+{
+	symPatternSandwitch_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_OK, matrix_symPatternSandwitch(&S, &A, &P, &Psym, &tmp));
+
+	sym_check(&Expected, &Psym);
+}
+
+
+TEST(group_matrix_symPatternSandwitch, matrix_symPatternSandwitch_badMats)
+{
+	symPatternSandwitch_prepare(EKF_MEAS_LEN, EKF_STATE_LEN);
+
+	/* packed result of wrong size */
+	Psym.n = EKF_STATE_LEN;
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_FAIL, matrix_symPatternSandwitch(&S, &A, &P, &Psym, &tmp));
+	Psym.n = EKF_MEAS_LEN;
+
+	/* bad temporary matrix */
+	tmp.rows = EKF_STATE_LEN;
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_FAIL, matrix_symPatternSandwitch(&S, &A, &P, &Psym, &tmp));
+	tmp.rows = EKF_MEAS_LEN;
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_symPatternSandwitch)
+{
+	RUN_TEST_CASE(group_matrix_symPatternSandwitch, matrix_symPatternSandwitch_stateMats);
+	RUN_TEST_CASE(group_matrix_symPatternSandwitch, matrix_symPatternSandwitch_measMats);
+	RUN_TEST_CASE(group_matrix_symPatternSandwitch, matrix_symPatternSandwitch_badMats);
+}
+
+
+/* ##############################################################################
+ * ----------------------        matrix_symGemm tests       ---------------------
+ * ############################################################################## */
+
+
+/* Allocates A (n x steps), B = A^T as untransposed buffer, C packed from symmetric matrix and Expected = alpha * A * B + beta * C */
+static void symGemm_prepare(unsigned int n, unsigned int steps)
+{
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&A, n, steps));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&B, steps, n));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&C, n, n));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, n, n));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_symAlloc(&P, n));
+
+	algebraTests_pseudoFill(&A, 1);
+	for (row = 0; row < steps; row++) {
+		for (col = 0; col < n; col++) {
+			MATRIX_DATA(&B, row, col) = MATRIX_DATA(&A, col, row);
+		}
+	}
+	sym_symFill(&C, 3);
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symPack(&C, &P));
+
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(&A, &B, &Expected));
+	for (row = 0; row < n; row++) {
+		for (col = 0; col < n; col++) {
+			MATRIX_DATA(&Expected, row, col) = GEMM_ALPHA * MATRIX_DATA(&Expected, row, col) + GEMM_BETA * MATRIX_DATA(&C, row, col);
+		}
+	}
+}
+
+
+TEST_GROUP(group_matrix_symGemm);
+
+
+TEST_SETUP(group_matrix_symGemm)
+{
+	A.data = NULL;
+	B.data = NULL;
+	C.data = NULL;
+	Expected.data = NULL;
+	P.data = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_symGemm)
+{
+	matrix_bufFree(&A);
+	matrix_bufFree(&B);
+	matrix_bufFree(&C);
+	matrix_bufFree(&Expected);
+	matrix_symFree(&P);
+}
+
+
+TEST(group_matrix_symGemm, matrix_symGemm_stateMats)
+{
+	symGemm_prepare(EKF_STATE_LEN, EKF_MEAS_LEN);
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symGemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &P));
+
+	sym_check(&Expected, &P);
+}
+
+
+TEST(group_matrix_symGemm, matrix_symGemm_secondMatTrp)
+{
+	symGemm_prepare(EKF_STATE_LEN, EKF_MEAS_LEN);
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, algebraTests_transposeSwap(&B));
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_OK, matrix_symGemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &P));
+
+	sym_check(&Expected, &P);
+}
+
+
+TEST(group_matrix_symGemm, matrix_symGemm_badMats)
+{
+	symGemm_prepare(EKF_STATE_LEN, EKF_MEAS_LEN);
+
+	P.n = EKF_MEAS_LEN;
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_FAIL, matrix_symGemm(GEMM_ALPHA, &A, &B, GEMM_BETA, &P));
+	P.n = EKF_STATE_LEN;
+
+	TEST_ASSERT_EQUAL_INT(MAT_SYM_FAIL, matrix_symGemm(GEMM_ALPHA, &A, &A, GEMM_BETA, &P));
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_symGemm)
+{
+	RUN_TEST_CASE(group_matrix_symGemm, matrix_symGemm_stateMats);
+	RUN_TEST_CASE(group_matrix_symGemm, matrix_symGemm_secondMatTrp);
+	RUN_TEST_CASE(group_matrix_symGemm, matrix_symGemm_badMats);
+}
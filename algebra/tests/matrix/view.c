@@ -0,0 +1,400 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Unit tests for matrix library
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <string.h>
+
+#include <unity_fixture.h>
+
+#include <matrix.h>
+#include <qdiff.h>
+
+#include "../tools.h"
+#include "buffs.h"
+
+
+#define DELTA 1e-4f
+
+/* Parent matrix is bigger than any EKF matrix, so views of EKF sizes fit inside it */
+#define PARENT_SIZE 20
+#define VIEW_ROW    3
+#define VIEW_COL    2
+
+/* Defines for `matrix_view` results */
+#define MAT_VIEW_OK   0
+#define MAT_VIEW_FAIL -1
+
+
+static matrix_t P1, P2, P3, Orig, Expected;
+
+
+/* Allocates `Expected` of given size and fills it with reference product of A and B */
+static void view_refProd(const matrix_t *A, const matrix_t *B)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, matrix_rowsGet(A), matrix_colsGet(B)));
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, algebraTests_refProd(A, B, &Expected));
+}
+
+
+/* Checks if logical content of `M` equals `Exp` within DELTA */
+static void view_contentCheck(const matrix_t *Exp, const matrix_t *M)
+{
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_UINT(matrix_rowsGet(Exp), matrix_rowsGet(M));
+	TEST_ASSERT_EQUAL_UINT(matrix_colsGet(Exp), matrix_colsGet(M));
+
+	for (row = 0; row < matrix_rowsGet(Exp); row++) {
+		for (col = 0; col < matrix_colsGet(Exp); col++) {
+			TEST_ASSERT_FLOAT_WITHIN(DELTA, *matrix_at(Exp, row, col), *matrix_at(M, row, col));
+		}
+	}
+}
+
+
+/* Multiplies views of P1 and P2 into view of P3 and checks result and that P3 outside of view is untouched */
+static void view_prodCheck(unsigned int rows, unsigned int steps, unsigned int cols, int trpA, int trpB)
+{
+	matrix_t A, B, C;
+
+	if (trpA) {
+		matrix_trp(&P1);
+	}
+	if (trpB) {
+		matrix_trp(&P2);
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P1, VIEW_ROW, VIEW_COL, rows, steps, &A));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P2, VIEW_COL, VIEW_ROW, steps, cols, &B));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P3, VIEW_ROW, VIEW_COL, rows, cols, &C));
+
+	view_refProd(&A, &B);
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_OK, matrix_prod(&A, &B, &C));
+
+	view_contentCheck(&Expected, &C);
+	TEST_ASSERT_EQUAL_INT(CHECK_OK, algebraTests_submatCheck(&Orig, VIEW_ROW, VIEW_COL, &C, &P3));
+}
+
+
+/* ##############################################################################
+ * ----------------------        matrix_view tests       ------------------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_matrix_view);
+
+
+TEST_SETUP(group_matrix_view)
+{
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&P1, PARENT_SIZE, PARENT_SIZE));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&P2, PARENT_SIZE, PARENT_SIZE));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&P3, PARENT_SIZE, PARENT_SIZE));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Orig, PARENT_SIZE, PARENT_SIZE));
+
+	algebraTests_pseudoFill(&P1, 1);
+	algebraTests_pseudoFill(&P2, 2);
+	algebraTests_pseudoFill(&P3, 3);
+	memcpy(Orig.data, P3.data, sizeof(float) * PARENT_SIZE * PARENT_SIZE);
+
+	Expected.data = NULL;
+}
+
+
+TEST_TEAR_DOWN(group_matrix_view)
+{
+	matrix_bufFree(&P1);
+	matrix_bufFree(&P2);
+	matrix_bufFree(&P3);
+	matrix_bufFree(&Orig);
+	matrix_bufFree(&Expected);
+}
+
+
+TEST(group_matrix_view, matrix_view_fields)
+{
+	matrix_t V;
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P1, VIEW_ROW, VIEW_COL, 4, 3, &V));
+
+	TEST_ASSERT_EQUAL_UINT(4, matrix_rowsGet(&V));
+	TEST_ASSERT_EQUAL_UINT(3, matrix_colsGet(&V));
+	TEST_ASSERT_EQUAL_UINT(PARENT_SIZE, matrix_strideGet(&V));
+	TEST_ASSERT_EQUAL_PTR(matrix_at(&P1, VIEW_ROW, VIEW_COL), matrix_at(&V, 0, 0));
+	TEST_ASSERT_EQUAL_PTR(matrix_at(&P1, VIEW_ROW + 3, VIEW_COL + 2), matrix_at(&V, 3, 2));
+	TEST_ASSERT_NULL(matrix_at(&V, 4, 0));
+	TEST_ASSERT_NULL(matrix_at(&V, 0, 3));
+}
+
+
+TEST(group_matrix_view, matrix_view_trpParent)
+{
+	matrix_t V;
+	unsigned int row, col;
+
+	matrix_trp(&P1);
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P1, VIEW_ROW, VIEW_COL, 4, 3, &V));
+
+	TEST_ASSERT_EQUAL_UINT(4, matrix_rowsGet(&V));
+	TEST_ASSERT_EQUAL_UINT(3, matrix_colsGet(&V));
+
+	for (row = 0; row < 4; row++) {
+		for (col = 0; col < 3; col++) {
+			TEST_ASSERT_EQUAL_PTR(matrix_at(&P1, VIEW_ROW + row, VIEW_COL + col), matrix_at(&V, row, col));
+		}
+	}
+}
+
+
+TEST(group_matrix_view, matrix_view_bounds)
+{
+	matrix_t V, P = { .rows = 3, .cols = 5, .transposed = 0, .data = P1.data };
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P, 0, 0, 3, 5, &V));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P, 2, 4, 1, 1, &V));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_FAIL, matrix_view(&P, 1, 0, 3, 5, &V));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_FAIL, matrix_view(&P, 0, 1, 3, 5, &V));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_FAIL, matrix_view(&P, 0, 0, 5, 3, &V));
+
+	/* logical size of transposed matrix is checked */
+	matrix_trp(&P);
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P, 0, 0, 5, 3, &V));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_FAIL, matrix_view(&P, 0, 0, 3, 5, &V));
+}
+
+
+TEST(group_matrix_view, matrix_view_ofView)
+{
+	matrix_t V, W;
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P1, VIEW_ROW, VIEW_COL, 8, 8, &V));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&V, 1, 2, 3, 3, &W));
+
+	TEST_ASSERT_EQUAL_PTR(matrix_at(&P1, VIEW_ROW + 1, VIEW_COL + 2), matrix_at(&W, 0, 0));
+	TEST_ASSERT_EQUAL_PTR(matrix_at(&P1, VIEW_ROW + 3, VIEW_COL + 4), matrix_at(&W, 2, 2));
+}
+
+
+TEST(group_matrix_view, matrix_view_zeroes)
+{
+	matrix_t V;
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P3, VIEW_ROW, VIEW_COL, 4, 3, &V));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, 4, 3));
+
+	matrix_zeroes(&V);
+
+	TEST_ASSERT_EQUAL_INT(CHECK_OK, algebraTests_submatCheck(&Orig, VIEW_ROW, VIEW_COL, &Expected, &P3));
+}
+
+
+TEST(group_matrix_view, matrix_view_diag)
+{
+	matrix_t V;
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P3, VIEW_ROW, VIEW_COL, 4, 4, &V));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, 4, 4));
+
+	matrix_diag(&V);
+	matrix_diag(&Expected);
+
+	TEST_ASSERT_EQUAL_INT(CHECK_OK, algebraTests_submatCheck(&Orig, VIEW_ROW, VIEW_COL, &Expected, &P3));
+}
+
+
+TEST(group_matrix_view, matrix_view_times)
+{
+	matrix_t V;
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P3, VIEW_ROW, VIEW_COL, 4, 3, &V));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, 4, 3));
+
+	for (row = 0; row < 4; row++) {
+		for (col = 0; col < 3; col++) {
+			*matrix_at(&Expected, row, col) = 2 * *matrix_at(&V, row, col);
+		}
+	}
+
+	matrix_times(&V, 2);
+
+	TEST_ASSERT_EQUAL_INT(CHECK_OK, algebraTests_submatCheck(&Orig, VIEW_ROW, VIEW_COL, &Expected, &P3));
+}
+
+
+TEST(group_matrix_view, matrix_view_add)
+{
+	matrix_t A, B, C;
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P1, 0, 0, 4, 3, &A));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P2, 1, 1, 3, 4, &B));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P3, VIEW_ROW, VIEW_COL, 4, 3, &C));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, 4, 3));
+
+	/* B is transposed view to use different indexing of A and B */
+	matrix_trp(&B);
+
+	for (row = 0; row < 4; row++) {
+		for (col = 0; col < 3; col++) {
+			*matrix_at(&Expected, row, col) = *matrix_at(&A, row, col) + *matrix_at(&B, row, col);
+		}
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_ADD_OK, matrix_add(&A, &B, &C));
+
+	view_contentCheck(&Expected, &C);
+	TEST_ASSERT_EQUAL_INT(CHECK_OK, algebraTests_submatCheck(&Orig, VIEW_ROW, VIEW_COL, &Expected, &P3));
+
+	/* view can't be reshaped into transposed output */
+	matrix_view(&P3, VIEW_ROW, VIEW_COL, 3, 4, &C);
+	TEST_ASSERT_EQUAL_INT(MAT_ADD_FAIL, matrix_add(&A, &B, &C));
+}
+
+
+TEST(group_matrix_view, matrix_view_sub)
+{
+	matrix_t A, B;
+	unsigned int row, col;
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P3, VIEW_ROW, VIEW_COL, 4, 3, &A));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P2, 1, 1, 4, 3, &B));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, 4, 3));
+
+	for (row = 0; row < 4; row++) {
+		for (col = 0; col < 3; col++) {
+			*matrix_at(&Expected, row, col) = *matrix_at(&A, row, col) - *matrix_at(&B, row, col);
+		}
+	}
+
+	TEST_ASSERT_EQUAL_INT(MAT_SUB_OK, matrix_sub(&A, &B, NULL));
+
+	TEST_ASSERT_EQUAL_INT(CHECK_OK, algebraTests_submatCheck(&Orig, VIEW_ROW, VIEW_COL, &Expected, &P3));
+}
+
+
+TEST(group_matrix_view, matrix_view_writeSubmatrix)
+{
+	matrix_t src, dst;
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P1, 5, 5, 3, 3, &src));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P3, VIEW_ROW, VIEW_COL, 6, 6, &dst));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, 3, 3));
+	TEST_ASSERT_EQUAL_INT(MAT_WRITE_SUBMAT_OK, matrix_writeSubmatrix(&Expected, 0, 0, &src));
+
+	TEST_ASSERT_EQUAL_INT(MAT_WRITE_SUBMAT_OK, matrix_writeSubmatrix(&dst, 1, 2, &src));
+
+	TEST_ASSERT_EQUAL_INT(CHECK_OK, algebraTests_submatCheck(&Orig, VIEW_ROW + 1, VIEW_COL + 2, &Expected, &P3));
+}
+
+
+TEST(group_matrix_view, matrix_view_prodNN)
+{
+	view_prodCheck(5, 7, 9, 0, 0);
+}
+
+
+TEST(group_matrix_view, matrix_view_prodTN)
+{
+	view_prodCheck(5, 7, 9, 1, 0);
+}
+
+
+TEST(group_matrix_view, matrix_view_prodNT)
+{
+	view_prodCheck(5, 7, 9, 0, 1);
+}
+
+
+TEST(group_matrix_view, matrix_view_prodTT)
+{
+	view_prodCheck(5, 7, 9, 1, 1);
+}
+
+
+/* Shape of EKF covariance propagation, which has fixed-size kernel for dense matrices */
+TEST(group_matrix_view, matrix_view_prodFixedShape)
+{
+	view_prodCheck(16, 16, 16, 0, 1);
+}
+
+
+TEST(group_matrix_view, matrix_view_prodTrpOutput)
+{
+	matrix_t A, B, C;
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P1, 0, 0, 3, 3, &A));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P2, 0, 0, 3, 3, &B));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P3, 0, 0, 3, 3, &C));
+	matrix_trp(&C);
+
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_FAIL, matrix_prod(&A, &B, &C));
+	TEST_ASSERT_EQUAL_MEMORY(Orig.data, P3.data, sizeof(float) * PARENT_SIZE * PARENT_SIZE);
+}
+
+
+TEST(group_matrix_view, matrix_view_qvdiff)
+{
+	const quat_t q = { .a = 0.5f, .i = -0.5f, .j = 0.5f, .k = 0.5f };
+	matrix_t V;
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P3, VIEW_ROW, VIEW_COL, 4, 4, &V));
+	TEST_ASSERT_EQUAL_INT(MAT_BUF_ALLOC_OK, matrix_bufAlloc(&Expected, 4, 4));
+
+	TEST_ASSERT_EQUAL_INT(0, qvdiff_qpDiffQ(&q, &Expected));
+	TEST_ASSERT_EQUAL_INT(0, qvdiff_qpDiffQ(&q, &V));
+	TEST_ASSERT_EQUAL_INT(CHECK_OK, algebraTests_submatCheck(&Orig, VIEW_ROW, VIEW_COL, &Expected, &P3));
+
+	/* untransposing a view would change layout of its parent */
+	matrix_trp(&V);
+	TEST_ASSERT_EQUAL_INT(-1, qvdiff_qpDiffQ(&q, &V));
+}
+
+
+TEST(group_matrix_view, matrix_view_denseOnly)
+{
+	float buf[2 * PARENT_SIZE * PARENT_SIZE];
+	matrix_t A, B, C, T;
+
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P1, 0, 0, 3, 3, &A));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P2, 0, 0, 3, 3, &B));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&P3, 0, 0, 3, 3, &C));
+	TEST_ASSERT_EQUAL_INT(MAT_VIEW_OK, matrix_view(&Orig, 0, 0, 3, 3, &T));
+
+	TEST_ASSERT_EQUAL_INT(MAT_PRODUCT_FAIL, matrix_sparseProd(&A, &B, &C));
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_FAIL, matrix_sandwitch(&A, &B, &C, &T));
+	TEST_ASSERT_EQUAL_INT(MAT_SANDWITCH_FAIL, matrix_symSandwitch(&A, &B, &C, &T));
+	TEST_ASSERT_EQUAL_INT(MAT_INV_FAIL, matrix_inv(&A, &C, buf, sizeof(buf) / sizeof(buf[0])));
+	TEST_ASSERT_EQUAL_INT(MAT_INV_FAIL, matrix_inv3(&A, &C));
+	TEST_ASSERT_EQUAL_INT(-1, matrix_cholSolve(&A, &B, &C));
+}
+
+
+TEST_GROUP_RUNNER(group_matrix_view)
+{
+	RUN_TEST_CASE(group_matrix_view, matrix_view_fields);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_trpParent);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_bounds);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_ofView);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_zeroes);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_diag);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_times);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_add);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_sub);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_writeSubmatrix);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_prodNN);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_prodTN);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_prodNT);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_prodTT);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_prodFixedShape);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_prodTrpOutput);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_qvdiff);
+	RUN_TEST_CASE(group_matrix_view, matrix_view_denseOnly);
+}
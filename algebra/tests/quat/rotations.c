@@ -217,6 +217,119 @@ TEST_GROUP_RUNNER(group_quat_vecRot)
 }
 
 
+/* ##############################################################################
+ * ------------------        quat_vecRotBatch tests       --------------------
+ * ############################################################################## */
+
+
+/* More than one chunk of quat_vecRotBatch() and not a multiple of vector register width */
+#define ROT_BATCH_LEN 67
+
+
+TEST_GROUP(group_quat_vecRotBatch);
+
+
+TEST_SETUP(group_quat_vecRotBatch)
+{
+}
+
+
+TEST_TEAR_DOWN(group_quat_vecRotBatch)
+{
+}
+
+
+TEST(group_quat_vecRotBatch, quat_vecRotBatch_baseQuaternions)
+{
+	float xs[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	float ys[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	float zs[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const quat_t *q[4] = { &QA, &QI, &QJ, &QK };
+	const float expectedX[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
+	int i;
+
+	/* Same expectations as in quat_vecRot_baseQuaternions */
+	for (i = 0; i < 4; i++) {
+		quat_vecRotBatch(q[i], &xs[i], &ys[i], &zs[i], 1);
+
+		TEST_ASSERT_EQUAL_FLOAT(expectedX[i], xs[i]);
+		TEST_ASSERT_EQUAL_FLOAT(0.0f, ys[i]);
+		TEST_ASSERT_EQUAL_FLOAT(0.0f, zs[i]);
+	}
+}
+
+
+TEST(group_quat_vecRotBatch, quat_vecRotBatch_std)
+{
+	float xs[2] = { V1.x, V2.x };
+	float ys[2] = { V1.y, V2.y };
+	float zs[2] = { V1.z, V2.z };
+
+	quat_vecRotBatch(&Q8, xs, ys, zs, 2);
+
+	TEST_ASSERT_FLOAT_WITHIN(1e-5, V1rotQ8.x, xs[0]);
+	TEST_ASSERT_FLOAT_WITHIN(1e-5, V1rotQ8.y, ys[0]);
+	TEST_ASSERT_FLOAT_WITHIN(1e-5, V1rotQ8.z, zs[0]);
+
+	TEST_ASSERT_FLOAT_WITHIN(1e-3, V2rotQ8.x, xs[1]);
+	TEST_ASSERT_FLOAT_WITHIN(1e-3, V2rotQ8.y, ys[1]);
+	TEST_ASSERT_FLOAT_WITHIN(1e-3, V2rotQ8.z, zs[1]);
+}
+
+
+TEST(group_quat_vecRotBatch, quat_vecRotBatch_sameAsVecRot)
+{
+	/* Not unit quaternion checks also scaling */
+	const quat_t *q[2] = { &Q8, &Q7 };
+	float xs[ROT_BATCH_LEN], ys[ROT_BATCH_LEN], zs[ROT_BATCH_LEN];
+	vec_t v[ROT_BATCH_LEN];
+	float delta;
+	int i, j;
+
+	for (j = 0; j < 2; j++) {
+		for (i = 0; i < ROT_BATCH_LEN; i++) {
+			v[i] = (vec_t) { .x = V2.x + i, .y = V1.y * i, .z = V2.z / (i + 1) };
+			xs[i] = v[i].x;
+			ys[i] = v[i].y;
+			zs[i] = v[i].z;
+
+			quat_vecRot(&v[i], q[j]);
+		}
+
+		quat_vecRotBatch(q[j], xs, ys, zs, ROT_BATCH_LEN);
+
+		for (i = 0; i < ROT_BATCH_LEN; i++) {
+			delta = 1e-5 * vec_len(&v[i]);
+
+			TEST_ASSERT_FLOAT_WITHIN(delta, v[i].x, xs[i]);
+			TEST_ASSERT_FLOAT_WITHIN(delta, v[i].y, ys[i]);
+			TEST_ASSERT_FLOAT_WITHIN(delta, v[i].z, zs[i]);
+		}
+	}
+}
+
+
+TEST(group_quat_vecRotBatch, quat_vecRotBatch_empty)
+{
+	float xs[1] = { V1.x }, ys[1] = { V1.y }, zs[1] = { V1.z };
+
+	quat_vecRotBatch(&Q8, xs, ys, zs, 0);
+
+	TEST_ASSERT_EQUAL_FLOAT(V1.x, xs[0]);
+	TEST_ASSERT_EQUAL_FLOAT(V1.y, ys[0]);
+	TEST_ASSERT_EQUAL_FLOAT(V1.z, zs[0]);
+}
+
+
+TEST_GROUP_RUNNER(group_quat_vecRotBatch)
+{
+	RUN_TEST_CASE(group_quat_vecRotBatch, quat_vecRotBatch_baseQuaternions);
+	RUN_TEST_CASE(group_quat_vecRotBatch, quat_vecRotBatch_std);
+	RUN_TEST_CASE(group_quat_vecRotBatch, quat_vecRotBatch_sameAsVecRot);
+	RUN_TEST_CASE(group_quat_vecRotBatch, quat_vecRotBatch_empty);
+}
+
+
 /* ##############################################################################
  * ------------------        quat_rotQuat tests       --------------------
  * ############################################################################## */
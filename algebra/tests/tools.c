@@ -13,6 +13,7 @@
 
 #include "tools.h"
 
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -27,6 +28,16 @@ void test_assert_float_array_within(float delta, float *expected, float *actual,
 }
 
 
+void test_assert_float_array_rel(float rel, float *expected, float *actual, float *scale, unsigned int elemNum, int line, char *message)
+{
+	unsigned int i;
+
+	for (i = 0; i < elemNum; i++) {
+		UNITY_TEST_ASSERT_FLOAT_WITHIN(rel * scale[i], expected[i], actual[i], line, message);
+	}
+}
+
+
 int algebraTests_buffFill(matrix_t *M, const float *vals, int n)
 {
 	int rowsNum, colsNum, row, col;
@@ -113,6 +124,64 @@ int algebraTests_transposeSwap(matrix_t *M)
 }
 
 
+void algebraTests_pseudoFill(matrix_t *M, unsigned int seed)
+{
+	unsigned int i;
+
+	for (i = 0; i < M->rows * M->cols; i++) {
+		/* Simple linear congruential generator, so results do not depend on libc rand() implementation */
+		seed = seed * 1103515245u + 12345u;
+		M->data[i] = (float)((seed >> 16) & 0x7fff) / 16383.5f - 1.f;
+	}
+}
+
+
+int algebraTests_refProd(const matrix_t *A, const matrix_t *B, matrix_t *C)
+{
+	unsigned int row, col, step;
+	float sum;
+
+	if (matrix_colsGet(A) != matrix_rowsGet(B) || C->transposed || C->rows != matrix_rowsGet(A) || C->cols != matrix_colsGet(B)) {
+		return -1;
+	}
+
+	for (row = 0; row < C->rows; row++) {
+		for (col = 0; col < C->cols; col++) {
+			sum = 0;
+			for (step = 0; step < matrix_colsGet(A); step++) {
+				sum += *matrix_at(A, row, step) * *matrix_at(B, step, col);
+			}
+			*matrix_at(C, row, col) = sum;
+		}
+	}
+
+	return 0;
+}
+
+
+int algebraTests_refProdAbs(const matrix_t *A, const matrix_t *B, matrix_t *Abs)
+{
+	unsigned int row, col, step;
+	float sum;
+
+	if (matrix_colsGet(A) != matrix_rowsGet(B) || Abs->transposed || Abs->rows != matrix_rowsGet(A) || Abs->cols != matrix_colsGet(B)) {
+		return -1;
+	}
+
+	for (row = 0; row < Abs->rows; row++) {
+		for (col = 0; col < Abs->cols; col++) {
+			sum = 0;
+			for (step = 0; step < matrix_colsGet(A); step++) {
+				sum += fabsf(*matrix_at(A, row, step) * *matrix_at(B, step, col));
+			}
+			*matrix_at(Abs, row, col) = sum;
+		}
+	}
+
+	return 0;
+}
+
+
 int algebraTests_invalidSeekCheck(matrix_t *M)
 {
 	int rowsNum, colsNum, row, col;
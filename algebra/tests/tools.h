@@ -20,6 +20,8 @@
 
 #include <unity_fixture.h>
 
+#include <float.h>
+
 
 /* ##############################################################################
  * ---------------------        defines used in tests       ---------------------
@@ -27,6 +29,10 @@
 
 /* --------------------------        matrix tests       ------------------------- */
 
+/* Bound of rounding error of `steps`-long sum of products relative to sum of absolute values of its terms.
+ * It holds for any summation order and with fused multiply-add, so it is used to compare vectorized kernels with reference */
+#define PROD_REL_DELTA(steps) ((float)(steps) * FLT_EPSILON)
+
 /* Defines for `matrix_bufAlloc` results */
 #define MAT_BUF_ALLOC_OK   0
 #define MAT_BUF_ALLOC_FAIL -1
@@ -107,6 +113,13 @@
 	TEST_ASSERT_EQUAL_UINT_MESSAGE((expected).cols, (actual).cols, "Different colspan"); \
 	test_assert_float_array_within((delta), (expected).data, (actual).data, (actual).rows *(actual).cols, __LINE__, "Different matrix element");
 
+/* Checks if every element of `actual` is within +/- `rel` times corresponding element of `scale` from the value from `expected` */
+#define TEST_ASSERT_MATRIX_REL_WITHIN(rel, expected, scale, actual) \
+	TEST_ASSERT_EQUAL_UINT_MESSAGE((expected).transposed, (actual).transposed, "Transposition flag is not equal"); \
+	TEST_ASSERT_EQUAL_UINT_MESSAGE((expected).rows, (actual).rows, "Different rowspan"); \
+	TEST_ASSERT_EQUAL_UINT_MESSAGE((expected).cols, (actual).cols, "Different colspan"); \
+	test_assert_float_array_rel((rel), (expected).data, (actual).data, (scale).data, (actual).rows *(actual).cols, __LINE__, "Different matrix element");
+
 #define TEST_ASSERT_EQUAL_QUAT(expected, actual) \
 	TEST_ASSERT_EQUAL_FLOAT_MESSAGE((expected).a, (actual).a, "Different real part of quaternion"); \
 	TEST_ASSERT_EQUAL_FLOAT_MESSAGE((expected).i, (actual).i, "Different `i` part of quaternion"); \
@@ -140,6 +153,10 @@
 extern void test_assert_float_array_within(float delta, float *expected, float *actual, unsigned int elemNum, int line, char *message);
 
 
+/* This function is used in definition of TEST_ASSERT_MATRIX_REL_WITHIN macro */
+extern void test_assert_float_array_rel(float rel, float *expected, float *actual, float *scale, unsigned int elemNum, int line, char *message);
+
+
 /* ##############################################################################
  * ---------------------        matrix modification       -----------------------
  * ############################################################################## */
@@ -165,6 +182,18 @@ extern int algebraTests_realTrp(matrix_t *M);
 extern int algebraTests_transposeSwap(matrix_t *M);
 
 
+/* Fills `M` with deterministic pseudo-random values from range [-1, 1] generated from `seed` */
+extern void algebraTests_pseudoFill(matrix_t *M, unsigned int seed);
+
+
+/* Reference product C = A * B computed element by element with matrix_at(). C must be non-transposed and have proper size */
+extern int algebraTests_refProd(const matrix_t *A, const matrix_t *B, matrix_t *C);
+
+
+/* Sums of absolute values of terms of product A * B: Abs = |A| * |B|. Abs must be non-transposed and have proper size */
+extern int algebraTests_refProdAbs(const matrix_t *A, const matrix_t *B, matrix_t *Abs);
+
+
 /* ##############################################################################
  * ------------------------        matrix checks       --------------------------
  * ############################################################################## */
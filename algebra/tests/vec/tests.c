@@ -564,6 +564,84 @@ TEST_GROUP_RUNNER(group_vec_dot)
 }
 
 
+/* ##############################################################################
+ * -----------------------        vec_dotBatch tests       ----------------------
+ * ############################################################################## */
+
+
+/* Not a multiple of vector register width */
+#define DOT_BATCH_LEN 11
+
+
+TEST_GROUP(group_vec_dotBatch);
+
+
+TEST_SETUP(group_vec_dotBatch)
+{
+}
+
+
+TEST_TEAR_DOWN(group_vec_dotBatch)
+{
+}
+
+
+TEST(group_vec_dotBatch, vec_dotBatch_sameAsVecDot)
+{
+	const vec_t *va[DOT_BATCH_LEN] = { &V1, &V3, &V5, &V2, &V0, &V7, &VX, &V4, &V6, &VY, &V3 };
+	const vec_t *vb[DOT_BATCH_LEN] = { &V2, &V4, &V6, &V2, &V1, &V7, &VY, &V4, &V5, &V3, &V3 };
+	float ax[DOT_BATCH_LEN], ay[DOT_BATCH_LEN], az[DOT_BATCH_LEN];
+	float bx[DOT_BATCH_LEN], by[DOT_BATCH_LEN], bz[DOT_BATCH_LEN];
+	float out[DOT_BATCH_LEN];
+	int i;
+
+	for (i = 0; i < DOT_BATCH_LEN; i++) {
+		ax[i] = va[i]->x;
+		ay[i] = va[i]->y;
+		az[i] = va[i]->z;
+		bx[i] = vb[i]->x;
+		by[i] = vb[i]->y;
+		bz[i] = vb[i]->z;
+	}
+
+	vec_dotBatch(ax, ay, az, bx, by, bz, out, DOT_BATCH_LEN);
+
+	for (i = 0; i < DOT_BATCH_LEN; i++) {
+		TEST_ASSERT_EQUAL_FLOAT(vec_dot(va[i], vb[i]), out[i]);
+	}
+}
+
+
+TEST(group_vec_dotBatch, vec_dotBatch_outIsInput)
+{
+	float ax[2] = { V1.x, V5.x }, ay[2] = { V1.y, V5.y }, az[2] = { V1.z, V5.z };
+	float bx[2] = { V2.x, V6.x }, by[2] = { V2.y, V6.y }, bz[2] = { V2.z, V6.z };
+
+	vec_dotBatch(ax, ay, az, bx, by, bz, ax, 2);
+
+	TEST_ASSERT_EQUAL_FLOAT(vec_dot(&V1, &V2), ax[0]);
+	TEST_ASSERT_EQUAL_FLOAT(0.0f, ax[1]);
+}
+
+
+TEST(group_vec_dotBatch, vec_dotBatch_empty)
+{
+	float a[1] = { 1.0f }, out[1] = { 2.0f };
+
+	vec_dotBatch(a, a, a, a, a, a, out, 0);
+
+	TEST_ASSERT_EQUAL_FLOAT(2.0f, out[0]);
+}
+
+
+TEST_GROUP_RUNNER(group_vec_dotBatch)
+{
+	RUN_TEST_CASE(group_vec_dotBatch, vec_dotBatch_sameAsVecDot);
+	RUN_TEST_CASE(group_vec_dotBatch, vec_dotBatch_outIsInput);
+	RUN_TEST_CASE(group_vec_dotBatch, vec_dotBatch_empty);
+}
+
+
 /* ##############################################################################
  * -------------------------        vec_len tests       -------------------------
  * ############################################################################## */
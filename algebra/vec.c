@@ -15,6 +15,7 @@
 #include <math.h>
 
 #include "vec.h"
+#include "matrix_simd.h"
 
 
 void vec_sum(const vec_t *A, const vec_t *B, vec_t *C)
@@ -63,6 +64,14 @@ float vec_dot(const vec_t *A, const vec_t *B)
 }
 
 
+void vec_dotBatch(const float *ax, const float *ay, const float *az, const float *bx, const float *by, const float *bz, float *out, unsigned int n)
+{
+	matrix_vecMul(out, ax, bx, n);
+	matrix_vecMulAdd(out, ay, by, n);
+	matrix_vecMulAdd(out, az, bz, n);
+}
+
+
 void vec_times(vec_t *A, float a)
 {
 	A->x *= a;
@@ -417,11 +417,11 @@ static void accorth_meshGet(vec_t *buf, size_t n)
 /* Calculating S3 and H3 from S1, S2, H1, H2. Returns -1 on calculation error, 0 otherwise. */
 static int accorth_paramsCombine(const matrix_t *S1, const matrix_t *H1, const matrix_t *S2, const matrix_t *H2, matrix_t *S3, matrix_t *H3)
 {
-	float invBuf[18], dataTmp[3];
+	float dataTmp[3];
 	matrix_t tmp = { .data = dataTmp, .rows = 3, .cols = 1, .transposed = 0 };
 
 	/* Using S3 as temporary storage for inv(S1) */
-	if (matrix_inv(S1, S3, invBuf, sizeof(invBuf) / sizeof(*invBuf)) < 0) {
+	if (matrix_inv3(S1, S3) < 0) {
 		printf("Cannot calculate S1 inverse\n");
 		return -1;
 	}
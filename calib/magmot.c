@@ -85,7 +85,6 @@ static void magmot_qlsmFit(float *x, float *y, unsigned int n, float *a, float *
 	matrix_t A = { .cols = 3, .rows = 3, .transposed = 0, .data = bufA };
 	matrix_t B = { .cols = 1, .rows = 3, .transposed = 0, .data = bufB };
 	matrix_t X = { .cols = 1, .rows = 3, .transposed = 0, .data = bufX };
-	float bufInv[2 * 9];
 
 	matrix_zeroes(&A);
 	matrix_zeroes(&B);
@@ -117,7 +116,7 @@ static void magmot_qlsmFit(float *x, float *y, unsigned int n, float *a, float *
 	*matrix_at(&B, 2, 0) = SY;
 
 	/* calculate column matrix X from prepared matrices */
-	matrix_inv(&A, &A, bufInv, 2 * 9);
+	matrix_inv3(&A, &A);
 	matrix_prod(&A, &B, &X);
 
 	/* copy coefficients outside */
@@ -26,6 +26,8 @@
 #include "kalman_implem.h"
 #include "logs/writer.h"
 #include "meas.h"
+#include "statepub.h"
+#include "warm.h"
 
 #include <sensc.h>
 #include <vec.h>
@@ -33,7 +35,6 @@
 #include <matrix.h>
 
 #include "ekflib.h"
-#include "filters.h"
 
 #define EKF_CONFIG_FILE "etc/ekf.conf"
 #define EKF_LOG_FILE    "ekf_log.bin"
@@ -41,8 +42,21 @@
 
 #define STACK_SIZE 16384
 
+#define EKF_UPDATES_CNT 3
 
-struct {
+
+/* Measurement source of an update engine with its rate limit */
+typedef struct {
+	update_engine_t *engine;
+	int (*poll)(meas_ctx_t *meas, time_t *timestamp); /* NULL if measurement is polled every loop regardless of updates */
+	time_t period;                                    /* minimal time between update steps */
+	time_t lastUpdate;                                /* loop time of last update step */
+	time_t measTime;                                  /* timestamp of last polled measurement */
+	time_t usedTime;                                  /* timestamp of last measurement used in update step */
+} ekf_updateSrc_t;
+
+
+struct ekf_ctx {
 	kalman_init_t initVals;
 	int status;
 
@@ -51,17 +65,34 @@ struct {
 	update_engine_t gpsEngine;
 	state_engine_t stateEngine;
 
-	pthread_t tid;
-	volatile unsigned int run; /* proceed with ekf loop */
-	time_t lastTime;           /* last kalman loop time */
-	time_t currTime;           /* current kalman loop time */
+	kmn_ctx_t model;
+	meas_ctx_t meas;
+	ekflog_writer_t log;
 
-	pthread_mutex_t lock;
-	pthread_attr_t threadAttr;
+	ekf_updateSrc_t updates[EKF_UPDATES_CNT];
+
+	volatile int run; /* proceed with ekf loop */
+	bool started;     /* first loop step was done */
+	bool finished;    /* final state was published after loop end */
+	time_t lastTime;  /* last kalman loop time */
+	time_t currTime;  /* current kalman loop time */
+	time_t loopStep;  /* last kalman loop step */
+	time_t sleepTime; /* sleep before loop step in KMN_LOOP_SLEEP mode */
+
+	statepub_t published; /* state snapshot published by the stepping thread */
 
 	/* benchmarking */
 	time_t stateTime; /* last state estimation timestamp */
 	time_t imuTime;   /* timestamp of last used IMU sample */
+};
+
+
+/* Global API runs single EKF instance in a dedicated thread */
+static struct {
+	ekf_ctx_t *ctx;
+
+	pthread_t tid;
+	pthread_attr_t threadAttr;
 
 	char stack[STACK_SIZE] __attribute__((aligned(8)));
 } ekf_common;
@@ -98,10 +129,19 @@ static int ekf_threadAttrInit(void)
 }
 
 
+static void ekf_enginesDealloc(ekf_ctx_t *ctx)
+{
+	kalman_predictDealloc(&ctx->stateEngine);
+	kalman_updateDealloc(&ctx->imuEngine);
+	kalman_updateDealloc(&ctx->baroEngine);
+	kalman_updateDealloc(&ctx->gpsEngine);
+}
+
+
 /* Function wraps meas initialization. Adds some additional security checks. */
-static int ekf_measGate(int initFlags)
+static int ekf_measGate(ekf_ctx_t *ctx, const char *logFile, int initFlags)
 {
-	switch (ekf_common.initVals.measSource) {
+	switch (ctx->initVals.measSource) {
 		case srcSens:
 			/*
 			 * Initializing with sensors as data source only if EKF_INIT_SENC_SCR init flag is specified
@@ -113,7 +153,7 @@ static int ekf_measGate(int initFlags)
 				return -1;
 			}
 
-			return meas_init(srcSens, SENSOR_FILE, SENSC_INIT_IMU | SENSC_INIT_BARO | SENSC_INIT_GPS);
+			return meas_init(&ctx->meas, srcSens, SENSOR_FILE, SENSC_INIT_IMU | SENSC_INIT_BARO | SENSC_INIT_GPS, &ctx->log);
 
 		case srcLog:
 			/*
@@ -127,12 +167,12 @@ static int ekf_measGate(int initFlags)
 				return -1;
 			}
 
-			if (strcmp(EKF_LOG_FILE, ekf_common.initVals.sourceFile) == 0) {
-				fprintf(stderr, "Ekf config: %s cannot be a data source file\n", EKF_LOG_FILE);
+			if (logFile != NULL && strcmp(logFile, ctx->initVals.sourceFile) == 0) {
+				fprintf(stderr, "Ekf config: %s cannot be a data source file\n", logFile);
 				return -1;
 			}
 
-			return meas_init(srcLog, ekf_common.initVals.sourceFile, SENSC_INIT_IMU | SENSC_INIT_BARO | SENSC_INIT_GPS);
+			return meas_init(&ctx->meas, srcLog, ctx->initVals.sourceFile, SENSC_INIT_IMU | SENSC_INIT_BARO | SENSC_INIT_GPS, &ctx->log);
 
 		default:
 			fprintf(stderr, "Ekf config: unknown meas source type\n");
@@ -141,129 +181,442 @@ static int ekf_measGate(int initFlags)
 }
 
 
-int ekf_init(int initFlags)
+/* Derives `ekf_state_t` from current state and publishes it for ekf_ctxStateGet(). Called only by the stepping thread or before stepping starts */
+static void ekf_statePublish(ekf_ctx_t *ctx)
 {
+	const matrix_t *state = &ctx->stateEngine.state;
+	ekf_state_t ekfState;
+	vec_t accel, accelRaw, gyro, gyroRaw;
+	quat_t q;
+
+	ekfState.status = ctx->status;
+
+	/* save quaternion attitude */
+	q.a = ekfState.q0 = state->data[QA];
+	q.i = ekfState.q1 = state->data[QB];
+	q.j = ekfState.q2 = state->data[QC];
+	q.k = ekfState.q3 = state->data[QD];
+
+	/* save newtonian motion parameters with frame change from NED to ENU */
+	ekfState.enuX = kmn_vecAt(state, RY);
+	ekfState.enuY = kmn_vecAt(state, RX);
+	ekfState.enuZ = -kmn_vecAt(state, RZ);
+
+	ekfState.veloX = kmn_vecAt(state, VY);
+	ekfState.veloY = kmn_vecAt(state, VX);
+	ekfState.veloZ = -kmn_vecAt(state, VZ);
+
+	meas_gyroGet(&ctx->meas, &gyro, &gyroRaw);
+	ekfState.rollDot = gyro.x - state->data[BWX];
+	ekfState.pitchDot = gyro.y - state->data[BWY];
+	ekfState.yawDot = gyro.z - state->data[BWZ];
+
+	ekfState.accelBiasZ = 0;
+
+	ekfState.stateTime = ctx->stateTime;
+	ekfState.imuTime = ctx->imuTime;
+
+	meas_accelGet(&ctx->meas, &accel, &accelRaw);
+	quat_vecRot(&accel, &q);
+	ekfState.accelX = accel.x;
+	ekfState.accelY = accel.y;
+	ekfState.accelZ = accel.z;
+
+	/* calculate and save euler attitude */
+	quat_quat2euler(&q, &ekfState.roll, &ekfState.pitch, &ekfState.yaw);
+
+	statepub_write(&ctx->published, &ekfState);
+}
+
+
+/* Calibration of one sensor, run in its own thread */
+typedef struct {
+	const char *name;
+	int (*calib)(meas_ctx_t *meas, time_t timeout);
+	time_t timeout;
+	const meas_calibProgress_t *progress;
+	meas_ctx_t *meas;
+	update_engine_t *engine; /* optional engine disabled if calibration fails, NULL for obligatory one */
+	int modelFlag;           /* flag of `engine` in `modelFlags` */
+
+	pthread_t tid;
+	bool threaded;
 	int err;
+} ekf_calibJob_t;
 
-	if (ekf_threadAttrInit() != 0) {
+
+static void *ekf_calibThread(void *arg)
+{
+	ekf_calibJob_t *job = arg;
+
+	job->err = job->calib(job->meas, job->timeout);
+
+	return NULL;
+}
+
+
+/* Prints progress of all calibrations in one line. Returns true if all of them are finished */
+static bool ekf_calibProgressPrint(const ekf_calibJob_t *jobs, unsigned int jobsCnt)
+{
+	const meas_calibProgress_t *progress;
+	meas_calibStage_t stage;
+	unsigned int i;
+	bool finished = true;
+
+	printf("ekf: calibration");
+	for (i = 0; i < jobsCnt; i++) {
+		progress = jobs[i].progress;
+		printf(" %s ", jobs[i].name);
+
+		/* acquire pairs with release store of calibration thread, so `total` written before the stage is visible */
+		stage = __atomic_load_n(&progress->stage, __ATOMIC_ACQUIRE);
+		switch (stage) {
+			case calibPending:
+				printf("pending");
+				break;
+
+			case calibWaiting:
+				printf("waiting");
+				break;
+
+			case calibSampling:
+				printf("%u/%u", __atomic_load_n(&progress->samples, __ATOMIC_RELAXED), progress->total);
+				break;
+
+			case calibDone:
+				printf("done");
+				break;
+
+			case calibFailed:
+				printf("failed");
+				break;
+
+			case calibTimeout:
+				printf("timeout");
+				break;
+		}
+
+		if (stage == calibPending || stage == calibWaiting || stage == calibSampling) {
+			finished = false;
+		}
+	}
+	printf("\n");
+
+	return finished;
+}
+
+
+/*
+ * Full calibration of sensors of active update engines. On sensors each calibration runs in its own thread,
+ * so initialization takes as long as the longest of them. Logs have single reader, so they are calibrated one by one.
+ * Failure or timeout of IMU calibration is an error, barometer and GPS engines are disabled if their calibration fails.
+ */
+static int ekf_calibrate(ekf_ctx_t *ctx)
+{
+	ekf_calibJob_t jobs[EKF_UPDATES_CNT];
+	unsigned int i, jobsCnt = 0;
+	int err = 0;
+
+	/* IMU calibration is obligatory */
+	jobs[jobsCnt++] = (ekf_calibJob_t) { .name = "IMU", .calib = meas_imuCalib, .timeout = ctx->initVals.imuCalibTimeout, .progress = &ctx->meas.calibProgress.imu };
+
+	if (ctx->baroEngine.active) {
+		jobs[jobsCnt++] = (ekf_calibJob_t) { .name = "baro", .calib = meas_baroCalib, .timeout = ctx->initVals.baroCalibTimeout, .progress = &ctx->meas.calibProgress.baro, .engine = &ctx->baroEngine, .modelFlag = KMN_UPDT_BARO };
+	}
+
+	if (ctx->gpsEngine.active) {
+		jobs[jobsCnt++] = (ekf_calibJob_t) { .name = "GPS", .calib = meas_gpsCalib, .timeout = ctx->initVals.gpsCalibTimeout, .progress = &ctx->meas.calibProgress.gps, .engine = &ctx->gpsEngine, .modelFlag = KMN_UPDT_GPS };
+	}
+
+	for (i = 0; i < jobsCnt; i++) {
+		jobs[i].meas = &ctx->meas;
+
+		if (ctx->initVals.measSource == srcSens && pthread_create(&jobs[i].tid, NULL, ekf_calibThread, &jobs[i]) == 0) {
+			jobs[i].threaded = true;
+		}
+		else {
+			ekf_calibThread(&jobs[i]);
+		}
+	}
+
+	/* progress is reported until all calibrations finish */
+	if (ctx->initVals.measSource == srcSens) {
+		while (!ekf_calibProgressPrint(jobs, jobsCnt)) {
+			sleep(1);
+		}
+	}
+
+	for (i = 0; i < jobsCnt; i++) {
+		if (jobs[i].threaded) {
+			pthread_join(jobs[i].tid, NULL);
+		}
+
+		if (jobs[i].err == 0) {
+			continue;
+		}
+
+		if (jobs[i].engine == NULL) {
+			printf("ekf: error during %s calibration\n", jobs[i].name);
+			err = -1;
+		}
+		else {
+			/* cleared flag also keeps warm start data saved without this calibration from being used with this engine */
+			printf("ekf: %s calibration failed, %s update disabled\n", jobs[i].name, jobs[i].name);
+			jobs[i].engine->active = false;
+			ctx->initVals.modelFlags &= ~jobs[i].modelFlag;
+		}
+	}
+
+	return err;
+}
+
+
+/* Warm start is possible only on sensors, replayed logs always contain full calibration */
+static bool ekf_warmEnabled(const ekf_ctx_t *ctx)
+{
+	return ctx->initVals.warmFile[0] != '\0' && ctx->initVals.measSource == srcSens;
+}
+
+
+/* Loads persisted data to `warm` and sets calibration from it if quick check passes. Returns -1 if full calibration is needed */
+static int ekf_warmLoad(ekf_ctx_t *ctx, warm_data_t *warm)
+{
+	quat_t att;
+
+	if (!ekf_warmEnabled(ctx) || warm_load(ctx->initVals.warmFile, warm) != 0) {
 		return -1;
 	}
 
-	if (fltr_init() != 0) {
-		fprintf(stderr, "ekf: filter init failed\n");
+	/* calibration of engines that were not active is not valid */
+	if (warm->modelFlags != ctx->initVals.modelFlags) {
+		printf("ekf: warm start data saved with different models\n");
 		return -1;
 	}
 
-	if (pthread_mutex_init(&ekf_common.lock, NULL) < 0) {
-		printf("Cannot create mutex for ekf\n");
-		pthread_attr_destroy(&ekf_common.threadAttr);
+	att = (quat_t) { .a = warm->state[QA], .i = warm->state[QB], .j = warm->state[QC], .k = warm->state[QD] };
+
+	if (meas_warmCheck(&ctx->meas, &warm->calib, &att, ctx->baroEngine.active ? warm->press : 0) != 0) {
+		printf("ekf: warm start rejected\n");
 		return -1;
 	}
 
-	err = 0;
-	err |= kalman_predictAlloc(&ekf_common.stateEngine, STATE_LENGTH, CTRL_LENGTH);
-	err |= kalman_updateAlloc(&ekf_common.imuEngine, STATE_LENGTH, MEAS_IMU_LENGTH);
-	err |= kalman_updateAlloc(&ekf_common.baroEngine, STATE_LENGTH, MEAS_BARO_LENGTH);
-	err |= kalman_updateAlloc(&ekf_common.gpsEngine, STATE_LENGTH, MEAS_GPS_LENGTH);
+	meas_calibSet(&ctx->meas, &warm->calib);
 
-	err |= kmn_configRead(EKF_CONFIG_FILE, &ekf_common.initVals);
+	return 0;
+}
 
-	/* activate update models selected in `initVals` */
-	ekf_common.imuEngine.active = ((ekf_common.initVals.modelFlags & KMN_UPDT_IMU) != 0);
-	ekf_common.baroEngine.active = ((ekf_common.initVals.modelFlags & KMN_UPDT_BARO) != 0);
-	ekf_common.gpsEngine.active = ((ekf_common.initVals.modelFlags & KMN_UPDT_GPS) != 0);
 
-	/* IMU calibration is obligatory */
-	if (!ekf_common.imuEngine.active) {
-		fprintf(stderr, "ekf: imu update not enabled\n");
-		err = -1;
+/* Persists calibration and state of instance that finished without error */
+static void ekf_warmSave(ekf_ctx_t *ctx)
+{
+	warm_data_t *warm;
+	float temp;
+	uint64_t timestamp;
+
+	if (!ekf_warmEnabled(ctx) || !ctx->started || (ctx->status & EKF_ERROR) != 0) {
+		return;
 	}
 
-	if (err != 0) {
-		pthread_mutex_destroy(&ekf_common.lock);
-		pthread_attr_destroy(&ekf_common.threadAttr);
+	warm = malloc(sizeof(*warm));
+	if (warm == NULL) {
+		return;
+	}
 
-		kalman_predictDealloc(&ekf_common.stateEngine);
-		kalman_updateDealloc(&ekf_common.imuEngine);
-		kalman_updateDealloc(&ekf_common.baroEngine);
-		kalman_updateDealloc(&ekf_common.gpsEngine);
+	warm->modelFlags = ctx->initVals.modelFlags;
+	warm->calib = *meas_calibGet(&ctx->meas);
 
-		return -1;
+	warm->press = 0;
+	if (ctx->baroEngine.active) {
+		meas_baroGet(&ctx->meas, &warm->press, &temp, &timestamp);
 	}
 
-	ekf_common.run = 0;
-	ekf_common.status = 0;
+	kmn_warmGet(&ctx->stateEngine, warm->state, warm->cov);
 
-	if (ekf_measGate(initFlags) != 0) {
-		pthread_mutex_destroy(&ekf_common.lock);
-		pthread_attr_destroy(&ekf_common.threadAttr);
+	if (warm_save(ctx->initVals.warmFile, warm) == 0) {
+		printf("ekf: state saved for warm start to %s\n", ctx->initVals.warmFile);
+	}
 
-		kalman_predictDealloc(&ekf_common.stateEngine);
-		kalman_updateDealloc(&ekf_common.imuEngine);
-		kalman_updateDealloc(&ekf_common.baroEngine);
-		kalman_updateDealloc(&ekf_common.gpsEngine);
+	free(warm);
+}
 
-		return -1;
+
+/* Applies replay `input` to configuration read from file */
+static int ekf_replayInputApply(ekf_ctx_t *ctx, const ekf_replayInput_t *input)
+{
+	unsigned int i;
+
+	for (i = 0; i < input->paramsCnt; i++) {
+		if (kmn_paramSet(&ctx->initVals, input->params[i].name, input->params[i].value) != 0) {
+			return -1;
+		}
 	}
 
-	if (ekflog_writerInit(EKF_LOG_FILE, ekf_common.initVals.log | ekf_common.initVals.logMode) != 0) {
-		pthread_mutex_destroy(&ekf_common.lock);
-		pthread_attr_destroy(&ekf_common.threadAttr);
-		meas_done();
+	if (input->buf == NULL) {
+		if (input->path == NULL || strlen(input->path) > MAX_PATH_LEN) {
+			fprintf(stderr, "ekf: invalid replay file path\n");
+			return -1;
+		}
+		strcpy(ctx->initVals.sourceFile, input->path);
+	}
 
-		kalman_predictDealloc(&ekf_common.stateEngine);
-		kalman_updateDealloc(&ekf_common.imuEngine);
-		kalman_updateDealloc(&ekf_common.baroEngine);
-		kalman_updateDealloc(&ekf_common.gpsEngine);
+	/* logs are replayed as fast as possible */
+	ctx->initVals.measSource = srcLog;
+	ctx->initVals.loopMode = KMN_LOOP_EVENT;
 
-		return -1;
+	return 0;
+}
+
+
+/* Creates instance as ekf_ctxInit(). Non NULL `input` overrides data source and parameters of configuration */
+static ekf_ctx_t *ekf_ctxCreate(const char *configFile, const char *logFile, int initFlags, const ekf_replayInput_t *input)
+{
+	ekf_ctx_t *ctx;
+	warm_data_t *warm;
+	int err;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		fprintf(stderr, "ekf: cannot allocate context\n");
+		return NULL;
+	}
+
+	if (statepub_init(&ctx->published) != 0) {
+		printf("Cannot create state notification for ekf\n");
+		free(ctx);
+		return NULL;
 	}
 
-	if (meas_imuCalib() != 0) {
-		printf("ekf: error during IMU calibration\n");
+	err = 0;
+	err |= kalman_predictAlloc(&ctx->stateEngine, STATE_LENGTH, CTRL_LENGTH);
+	err |= kalman_updateAlloc(&ctx->imuEngine, STATE_LENGTH, MEAS_IMU_LENGTH);
+	err |= kalman_updateAlloc(&ctx->baroEngine, STATE_LENGTH, MEAS_BARO_LENGTH);
+	err |= kalman_updateAlloc(&ctx->gpsEngine, STATE_LENGTH, MEAS_GPS_LENGTH);
+
+	err |= kmn_configRead(configFile, &ctx->initVals);
+
+	if (input != NULL && ekf_replayInputApply(ctx, input) != 0) {
 		err = -1;
 	}
 
-	if (ekf_common.baroEngine.active) {
-		if (meas_baroCalib() != 0) {
-			printf("ekf: error during baro calibration\n");
-			err = -1;
-		}
+	/* there is nowhere to write logs to */
+	if (logFile == NULL) {
+		ctx->initVals.log = 0;
+		ctx->initVals.logMode = 0;
 	}
-	if (ekf_common.gpsEngine.active) {
-		if (meas_gpsCalib() != 0) {
-			printf("ekf: error during GPS calibration\n");
-			err = -1;
+
+	/* activate update models selected in `initVals` */
+	ctx->imuEngine.active = ((ctx->initVals.modelFlags & KMN_UPDT_IMU) != 0);
+	ctx->baroEngine.active = ((ctx->initVals.modelFlags & KMN_UPDT_BARO) != 0);
+	ctx->gpsEngine.active = ((ctx->initVals.modelFlags & KMN_UPDT_GPS) != 0);
+
+	ctx->updates[0] = (ekf_updateSrc_t) { .engine = &ctx->imuEngine, .poll = NULL, .period = ctx->initVals.imuUpdatePeriod };
+	ctx->updates[1] = (ekf_updateSrc_t) { .engine = &ctx->baroEngine, .poll = meas_baroPoll, .period = ctx->initVals.baroUpdatePeriod };
+	ctx->updates[2] = (ekf_updateSrc_t) { .engine = &ctx->gpsEngine, .poll = meas_gpsPoll, .period = ctx->initVals.gpsUpdatePeriod };
+
+	/* IMU calibration is obligatory */
+	if (!ctx->imuEngine.active) {
+		fprintf(stderr, "ekf: imu update not enabled\n");
+		err = -1;
+	}
+
+	if (err == 0) {
+		if (input != NULL && input->buf != NULL) {
+			err = meas_logBufInit(&ctx->meas, input->buf, input->bufSize, &ctx->log);
+		}
+		else {
+			err = ekf_measGate(ctx, logFile, initFlags);
 		}
 	}
 
 	if (err != 0) {
-		ekf_done();
-		return -1;
+		ekf_enginesDealloc(ctx);
+		statepub_done(&ctx->published);
+		free(ctx);
+
+		return NULL;
+	}
+
+	if (ekflog_writerInit(&ctx->log, logFile, ctx->initVals.log | ctx->initVals.logMode) != 0) {
+		meas_done(&ctx->meas);
+		ekf_enginesDealloc(ctx);
+		statepub_done(&ctx->published);
+		free(ctx);
+
+		return NULL;
+	}
+
+	ctx->run = 0;
+	ctx->status = 0;
+	ctx->loopStep = 1000;
+	ctx->sleepTime = 1000;
+
+	warm = malloc(sizeof(*warm));
+	if (warm != NULL && ekf_warmLoad(ctx, warm) == 0) {
+		ctx->status |= EKF_WARM_START;
+	}
+	else {
+		err = ekf_calibrate(ctx);
 	}
 
+	if (err != 0) {
+		free(warm);
+		ekf_ctxDone(ctx);
+		return NULL;
+	}
+
+	/* engines of this instance share its model data */
+	ctx->model.inits = &ctx->initVals;
+	ctx->model.meas = &ctx->meas;
+
 	/* obligatory engines initialization */
-	kmn_predInit(&ekf_common.stateEngine, meas_calibGet(), &ekf_common.initVals);
-	kmn_imuEngInit(&ekf_common.imuEngine, &ekf_common.initVals);
+	if (kmn_predInit(&ctx->stateEngine, &ctx->model, meas_calibGet(&ctx->meas)) != 0) {
+		printf("ekf: prediction engine init failed\n");
+		free(warm);
+		ekf_ctxDone(ctx);
+		return NULL;
+	}
+
+	if ((ctx->status & EKF_WARM_START) != 0) {
+		kmn_warmSet(&ctx->stateEngine, &ctx->initVals, warm->state, warm->cov);
+		printf("ekf: warm start from %s\n", ctx->initVals.warmFile);
+	}
+	free(warm);
+
+	err = kmn_imuEngInit(&ctx->imuEngine, &ctx->model);
 
 	/* supplementary engines initialization */
-	kmn_baroEngInit(&ekf_common.baroEngine, &ekf_common.initVals);
-	kmn_gpsEngInit(&ekf_common.gpsEngine, &ekf_common.initVals);
+	err |= kmn_baroEngInit(&ctx->baroEngine, &ctx->model);
+	err |= kmn_gpsEngInit(&ctx->gpsEngine, &ctx->model);
 
-	return 0;
+	if (err != 0) {
+		printf("ekf: update engine init failed\n");
+		ekf_ctxDone(ctx);
+		return NULL;
+	}
+
+	/* initial state is available before stepping starts */
+	ekf_statePublish(ctx);
+
+	return ctx;
 }
 
 
-static int ekf_dtGet(time_t *result)
+ekf_ctx_t *ekf_ctxInit(const char *configFile, const char *logFile, int initFlags)
+{
+	return ekf_ctxCreate(configFile, logFile, initFlags, NULL);
+}
+
+
+static int ekf_dtGet(ekf_ctx_t *ctx, time_t *result)
 {
 	time_t tmp;
 
-	if (meas_timeGet(&tmp) != 0) {
+	if (meas_timeGet(&ctx->meas, &tmp) != 0) {
 		return -1;
 	}
-	ekf_common.currTime = tmp;
-	*result = ekf_common.currTime - ekf_common.lastTime;
-	ekf_common.lastTime = ekf_common.currTime;
+	ctx->currTime = tmp;
+	*result = ctx->currTime - ctx->lastTime;
+	ctx->lastTime = ctx->currTime;
 
 	return 0;
 }
@@ -283,93 +636,310 @@ static time_t ekf_loopTimeOptimize(time_t loopStep, time_t sleepTime)
 }
 
 
-static int ekf_pollErrHandle(void)
+static int ekf_pollErrHandle(ekf_ctx_t *ctx)
 {
-	ekf_common.status |= (errno == 0) ? EKF_MEAS_EOF : EKF_ERROR;
+	ctx->status |= (errno == 0) ? EKF_MEAS_EOF : EKF_ERROR;
 
 	/* If EKF is running from logs, then EOF results in stopping main loop */
-	return (ekf_common.initVals.measSource == srcLog) ? -1 : 1;
+	return (ctx->initVals.measSource == srcLog) ? -1 : 1;
 }
 
 
-static void *ekf_thread(void *arg)
+/*
+ * Polls sources of active update engines whose rate limit allows update step and writes those with new measurements to `pending`,
+ * ordered by measurement timestamps. Returns number of pending sources.
+ */
+static unsigned int ekf_updatesCollect(ekf_ctx_t *ctx, ekf_updateSrc_t **pending)
 {
-	static time_t lastBaroUpdate = 0, lastGpsUpdate = 0;
-	time_t imuTime;
-	time_t loopStep = 1000, updateStep, sleepTime = 1000;
-	update_engine_t *currUpdate;
+	ekf_updateSrc_t *src;
+	unsigned int i, pos, cnt = 0;
 
-	printf("ekf: starting ekf thread\n");
+	for (i = 0; i < EKF_UPDATES_CNT; i++) {
+		src = &ctx->updates[i];
+
+		if (!src->engine->active || ctx->currTime - src->lastUpdate < src->period) {
+			continue;
+		}
+
+		if (src->poll != NULL && src->poll(&ctx->meas, &src->measTime) != 0) {
+			ctx->run = ekf_pollErrHandle(ctx);
+			continue;
+		}
+
+		/* no measurement arrived since the last update step */
+		if (src->measTime == src->usedTime) {
+			continue;
+		}
+
+		for (pos = cnt; pos > 0 && pending[pos - 1]->measTime > src->measTime; pos--) {
+			pending[pos] = pending[pos - 1];
+		}
+		pending[pos] = src;
+		cnt++;
+	}
+
+	return cnt;
+}
+
+
+static void ekf_loopStart(ekf_ctx_t *ctx)
+{
+	unsigned int i;
 
 	errno = 0;
-	ekf_common.run = 1;
+	ctx->started = true;
+	ctx->run = 1;
 
-	/* Kalman loop */
-	if (meas_timeGet(&ekf_common.lastTime) != 0) {
-		ekf_common.run = ekf_pollErrHandle();
+	if (meas_timeGet(&ctx->meas, &ctx->lastTime) != 0) {
+		ctx->run = ekf_pollErrHandle(ctx);
 	}
 
-	lastBaroUpdate = ekf_common.lastTime;
-	lastGpsUpdate = ekf_common.lastTime;
+	for (i = 0; i < EKF_UPDATES_CNT; i++) {
+		ctx->updates[i].lastUpdate = ctx->lastTime;
+	}
+}
 
-	while (ekf_common.run == 1) {
-		usleep(sleepTime);
 
-		if (ekf_dtGet(&loopStep) != 0) {
-			ekf_common.run = ekf_pollErrHandle();
-		}
-		sleepTime = ekf_loopTimeOptimize(loopStep, sleepTime);
+static int ekf_loopEnd(ekf_ctx_t *ctx)
+{
+	/* final snapshot carries status flags set on loop exit */
+	if (!ctx->finished) {
+		ekf_statePublish(ctx);
+		ctx->finished = true;
+	}
+	ctx->run = -1;
 
-		/* IMU polling is done regardless on update procedure */
-		if (meas_imuPoll(&imuTime) != 0) {
-			ekf_common.run = ekf_pollErrHandle();
-		}
-		currUpdate = &ekf_common.imuEngine;
-		updateStep = loopStep;
-
-		/* Update step selection */
-		if (ekf_common.currTime - lastBaroUpdate > BARO_UPDATE_TIMEOUT && ekf_common.baroEngine.active) {
-			if (meas_baroPoll() == 0) {
-				currUpdate = &ekf_common.baroEngine;
-				updateStep = ekf_common.currTime - lastBaroUpdate;
-				lastBaroUpdate = ekf_common.currTime;
-			}
-			else {
-				ekf_common.run = ekf_pollErrHandle();
-			}
-		}
+	return -1;
+}
 
-		if (ekf_common.currTime - lastGpsUpdate > GPS_UPDATE_TIMEOUT && ekf_common.gpsEngine.active) {
-			if (meas_gpsPoll() == 0) {
-				currUpdate = &ekf_common.gpsEngine;
-				updateStep = ekf_common.currTime - lastGpsUpdate;
-				lastGpsUpdate = ekf_common.currTime;
-			}
-			else {
-				ekf_common.run = ekf_pollErrHandle();
-			}
+
+int ekf_ctxStep(ekf_ctx_t *ctx)
+{
+	ekf_updateSrc_t *pending[EKF_UPDATES_CNT];
+	update_engine_t *engines[EKF_UPDATES_CNT];
+	time_t timeSteps[EKF_UPDATES_CNT];
+	time_t imuTime;
+	unsigned int i, pendingCnt;
+
+	if (!ctx->started) {
+		ekf_loopStart(ctx);
+	}
+
+	if (ctx->run != 1) {
+		return ekf_loopEnd(ctx);
+	}
+
+	if (ctx->initVals.loopMode == KMN_LOOP_SLEEP) {
+		usleep(ctx->sleepTime);
+	}
+	else {
+		/* on timeout iteration proceeds, so prediction keeps running if IMU data stops */
+		meas_imuWait(&ctx->meas, KMN_IMU_WAIT_TIMEOUT);
+	}
+
+	if (ekf_dtGet(ctx, &ctx->loopStep) != 0) {
+		ctx->run = ekf_pollErrHandle(ctx);
+	}
+
+	if (ctx->initVals.loopMode == KMN_LOOP_SLEEP) {
+		ctx->sleepTime = ekf_loopTimeOptimize(ctx->loopStep, ctx->sleepTime);
+	}
+
+	/* IMU polling is done regardless on update procedure */
+	if (meas_imuPoll(&ctx->meas, &imuTime) != 0) {
+		ctx->run = ekf_pollErrHandle(ctx);
+	}
+	ctx->updates[0].measTime = imuTime;
+
+	pendingCnt = ekf_updatesCollect(ctx, pending);
+
+	if (ctx->run != 1) {
+		return ekf_loopEnd(ctx);
+	}
+
+	/* State prediction procedure */
+	kalman_predict(&ctx->stateEngine, ctx->loopStep, 0);
+
+	/* all measurements are applied in order of their timestamps. Prediction is the state estimate if none of them was applied */
+	for (i = 0; i < pendingCnt; i++) {
+		engines[i] = pending[i]->engine;
+		timeSteps[i] = ctx->currTime - pending[i]->lastUpdate;
+
+		pending[i]->lastUpdate = ctx->currTime;
+		pending[i]->usedTime = pending[i]->measTime;
+	}
+	kalman_updateAll(timeSteps, 0, engines, pendingCnt, &ctx->stateEngine);
+
+	ctx->imuTime = imuTime;
+
+	/* using pre-calculation time as to not call meas_timeGet() */
+	ctx->stateTime = ctx->currTime;
+
+	ekf_statePublish(ctx);
+
+	ekflog_stateWrite(&ctx->log, &ctx->stateEngine.state, ctx->stateTime);
+
+	return 0;
+}
+
+
+void ekf_ctxDone(ekf_ctx_t *ctx)
+{
+	if (ctx == NULL) {
+		return;
+	}
+
+	ekf_warmSave(ctx);
+
+	ekf_enginesDealloc(ctx);
+
+	meas_done(&ctx->meas);
+	ekflog_writerDone(&ctx->log);
+	statepub_done(&ctx->published);
+
+	free(ctx);
+}
+
+
+void ekf_ctxStateGet(ekf_ctx_t *ctx, ekf_state_t *ekfState)
+{
+	statepub_read(&ctx->published, ekfState);
+
+	if (ctx->run == 1) {
+		ekfState->status |= EKF_RUNNING;
+	}
+}
+
+
+int ekf_ctxStateWait(ekf_ctx_t *ctx, ekf_state_t *ekfState, time_t timeoutUs, uint64_t *seq)
+{
+	int ret = statepub_wait(&ctx->published, ekfState, timeoutUs, seq);
+
+	if (ctx->run == 1) {
+		ekfState->status |= EKF_RUNNING;
+	}
+
+	return ret;
+}
+
+
+int ekf_ctxLatlon2en(ekf_ctx_t *ctx, double lat, double lon, float *east, float *north)
+{
+	return meas_latlon2en(&ctx->meas, lat, lon, east, north);
+}
+
+
+int ekf_replayInput(const char *configFile, const ekf_replayInput_t *input, const char *logFile, ekf_replayCb_t cb, void *arg, ekf_replayStats_t *stats)
+{
+	struct timespec start, end;
+	ekf_state_t ekfState;
+	unsigned long long int iterations = 0;
+	unsigned int gpsCnt = 0;
+	double gpsErrSum = 0;
+	float prevX, prevY, dx, dy;
+	meas_gps_t gps;
+	time_t durationUs, gpsTime, gpsTimeUsed;
+	ekf_ctx_t *ctx;
+	int err, stop = 0;
+
+	ctx = ekf_ctxCreate(configFile, logFile, EKF_INIT_LOG_SRC, input);
+	if (ctx == NULL) {
+		return -1;
+	}
+
+	prevX = kmn_vecAt(&ctx->stateEngine.state, RX);
+	prevY = kmn_vecAt(&ctx->stateEngine.state, RY);
+	meas_gpsGet(&ctx->meas, &gps, &gpsTimeUsed);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while (stop == 0 && ekf_ctxStep(ctx) == 0) {
+		iterations++;
+
+		/* each new GPS position is compared with state predicted before its update step */
+		meas_gpsGet(&ctx->meas, &gps, &gpsTime);
+		if (ctx->gpsEngine.active && gpsTime != gpsTimeUsed && gps.fix > 0) {
+			dx = gps.pos.x - prevX;
+			dy = gps.pos.y - prevY;
+			gpsErrSum += dx * dx + dy * dy;
+			gpsCnt++;
 		}
+		gpsTimeUsed = gpsTime;
+		prevX = kmn_vecAt(&ctx->stateEngine.state, RX);
+		prevY = kmn_vecAt(&ctx->stateEngine.state, RY);
 
-		if (ekf_common.run != 1) {
-			break;
+		if (cb != NULL) {
+			ekf_ctxStateGet(ctx, &ekfState);
+			stop = cb(ctx, &ekfState, arg);
 		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	ekf_ctxStateGet(ctx, &ekfState);
+	err = ((ctx->status & EKF_ERROR) != 0) ? -1 : 0;
+	ekf_ctxDone(ctx);
+
+	durationUs = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+
+	if (stats != NULL) {
+		stats->iterations = iterations;
+		stats->durationUs = durationUs;
+		stats->throughput = (durationUs > 0) ? (float)iterations * 1000000.f / (float)durationUs : 0.f;
+		stats->gpsCnt = gpsCnt;
+		stats->gpsRmse = (gpsCnt > 0) ? sqrt(gpsErrSum / gpsCnt) : 0.f;
+		stats->state = ekfState;
+	}
+
+	return err;
+}
+
+
+int ekf_replay(const char *configFile, const char *path, const char *logFile, ekf_replayCb_t cb, void *arg, ekf_replayStats_t *stats)
+{
+	ekf_replayStats_t replayStats;
+	const ekf_replayInput_t input = { .path = path };
+
+	if (ekf_replayInput(configFile, &input, logFile, cb, arg, &replayStats) != 0) {
+		return -1;
+	}
+
+	printf("ekf: replayed %llu iterations in %.3f s (%.0f iterations/s)\n", replayStats.iterations, (float)replayStats.durationUs / 1000000.f, replayStats.throughput);
+
+	if (stats != NULL) {
+		*stats = replayStats;
+	}
 
-		/* State prediction procedure */
-		kalman_predict(&ekf_common.stateEngine, loopStep, 0);
+	return 0;
+}
 
-		/* TODO: make critical section smaller and only on accesses to state and cov matrices */
-		pthread_mutex_lock(&ekf_common.lock);
-		kalman_update(updateStep, 0, currUpdate, &ekf_common.stateEngine); /* baro measurements update procedure */
-		ekf_common.imuTime = imuTime;                                      /* assigning here not at gettime to utilize locked mutex */
-		pthread_mutex_unlock(&ekf_common.lock);
 
-		/* using pre-calculation time as to not call meas_timeGet() */
-		ekf_common.stateTime = ekf_common.currTime;
+/* GLOBAL API */
 
-		ekflog_stateWrite(&ekf_common.stateEngine.state, ekf_common.stateTime);
+int ekf_init(int initFlags)
+{
+	if (ekf_threadAttrInit() != 0) {
+		return -1;
+	}
+
+	ekf_common.ctx = ekf_ctxInit(EKF_CONFIG_FILE, EKF_LOG_FILE, initFlags);
+	if (ekf_common.ctx == NULL) {
+		pthread_attr_destroy(&ekf_common.threadAttr);
+		return -1;
 	}
 
-	ekf_common.run = -1;
+	return 0;
+}
+
+
+static void *ekf_thread(void *arg)
+{
+	ekf_ctx_t *ctx = arg;
+
+	printf("ekf: starting ekf thread\n");
+
+	while (ekf_ctxStep(ctx) == 0) {
+	}
 
 	return NULL;
 }
@@ -379,7 +949,7 @@ int ekf_run(void)
 {
 	int res;
 
-	res = pthread_create(&ekf_common.tid, &ekf_common.threadAttr, ekf_thread, NULL);
+	res = pthread_create(&ekf_common.tid, &ekf_common.threadAttr, ekf_thread, ekf_common.ctx);
 	if (res != 0) {
 		fprintf(stderr, "ekf: failed to start\n");
 		return res;
@@ -387,8 +957,10 @@ int ekf_run(void)
 
 	pthread_attr_destroy(&ekf_common.threadAttr);
 
-	/* Wait to stabilize data in covariance matrixes */
-	sleep(3);
+	/* Wait to stabilize data in covariance matrixes, restored ones are already stable */
+	if ((ekf_common.ctx->status & EKF_WARM_START) == 0) {
+		sleep(3);
+	}
 
 	return res;
 }
@@ -396,8 +968,8 @@ int ekf_run(void)
 
 int ekf_stop(void)
 {
-	if (ekf_common.run == 1) {
-		ekf_common.run = 0;
+	if (ekf_common.ctx->run == 1) {
+		ekf_common.ctx->run = 0;
 	}
 
 	return pthread_join(ekf_common.tid, NULL);
@@ -406,14 +978,8 @@ int ekf_stop(void)
 
 void ekf_done(void)
 {
-	kalman_predictDealloc(&ekf_common.stateEngine);
-	kalman_updateDealloc(&ekf_common.imuEngine);
-	kalman_updateDealloc(&ekf_common.baroEngine);
-	kalman_updateDealloc(&ekf_common.gpsEngine);
-
-	meas_done();
-	ekflog_writerDone();
-	pthread_mutex_destroy(&ekf_common.lock);
+	ekf_ctxDone(ekf_common.ctx);
+	ekf_common.ctx = NULL;
 }
 
 
@@ -427,55 +993,17 @@ void ekf_boundsGet(float *bYaw, float *bRoll, float *bPitch)
 
 void ekf_stateGet(ekf_state_t *ekfState)
 {
-	quat_t q;
-	vec_t accel, accelRaw;
-	pthread_mutex_lock(&ekf_common.lock);
-
-	ekfState->status = 0;
-	ekfState->status |= ekf_common.status;
-
-	if (ekf_common.run == 1) {
-		ekfState->status |= EKF_RUNNING;
-	}
-
-	/* save quaternion attitude */
-	q.a = ekfState->q0 = ekf_common.stateEngine.state.data[QA];
-	q.i = ekfState->q1 = ekf_common.stateEngine.state.data[QB];
-	q.j = ekfState->q2 = ekf_common.stateEngine.state.data[QC];
-	q.k = ekfState->q3 = ekf_common.stateEngine.state.data[QD];
-
-	/* save newtonian motion parameters with frame change from NED to ENU */
-	ekfState->enuX = kmn_vecAt(&ekf_common.stateEngine.state, RY);
-	ekfState->enuY = kmn_vecAt(&ekf_common.stateEngine.state, RX);
-	ekfState->enuZ = -kmn_vecAt(&ekf_common.stateEngine.state, RZ);
-
-	ekfState->veloX = kmn_vecAt(&ekf_common.stateEngine.state, VY);
-	ekfState->veloY = kmn_vecAt(&ekf_common.stateEngine.state, VX);
-	ekfState->veloZ = -kmn_vecAt(&ekf_common.stateEngine.state, VZ);
-
-	ekfState->rollDot = ekf_common.stateEngine.U.data[UWX] - ekf_common.stateEngine.state.data[BWX];
-	ekfState->pitchDot = ekf_common.stateEngine.U.data[UWY] - ekf_common.stateEngine.state.data[BWY];
-	ekfState->yawDot = ekf_common.stateEngine.U.data[UWZ] - ekf_common.stateEngine.state.data[BWZ];
-
-	ekfState->accelBiasZ = 0;
-
-	ekfState->stateTime = ekf_common.stateTime;
-	ekfState->imuTime = ekf_common.imuTime;
-
-	pthread_mutex_unlock(&ekf_common.lock);
+	ekf_ctxStateGet(ekf_common.ctx, ekfState);
+}
 
-	meas_accelGet(&accel, &accelRaw);
-	quat_vecRot(&accel, &q);
-	ekfState->accelX = accel.x;
-	ekfState->accelY = accel.y;
-	ekfState->accelZ = accel.z;
 
-	/* calculate and save euler attitude */
-	quat_quat2euler(&q, &ekfState->roll, &ekfState->pitch, &ekfState->yaw);
+int ekf_stateWait(ekf_state_t *ekfState, time_t timeoutUs, uint64_t *seq)
+{
+	return ekf_ctxStateWait(ekf_common.ctx, ekfState, timeoutUs, seq);
 }
 
 
 extern int ekf_latlon2en(double lat, double lon, float *east, float *north)
 {
-	return meas_latlon2en(lat, lon, east, north);
+	return ekf_ctxLatlon2en(ekf_common.ctx, lat, lon, east, north);
 }
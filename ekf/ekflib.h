@@ -14,13 +14,18 @@
 #ifndef EKFLIB_H
 #define EKFLIB_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
 /* Ekf init flags */
 #define EKF_INIT_LOG_SRC (1 << 0) /* Sets logs as input data for EKF */
 
 /* Ekf status flags */
-#define EKF_RUNNING  (1 << 0) /* EKF is working */
-#define EKF_ERROR    (1 << 1) /* General purpose error flag */
-#define EKF_MEAS_EOF (1 << 2) /* Measurements module encountered end-of-file */
+#define EKF_RUNNING    (1 << 0) /* EKF is working */
+#define EKF_ERROR      (1 << 1) /* General purpose error flag */
+#define EKF_MEAS_EOF   (1 << 2) /* Measurements module encountered end-of-file */
+#define EKF_WARM_START (1 << 3) /* EKF was initialized with persisted calibration and state instead of calibration */
 
 
 typedef struct {
@@ -65,6 +70,88 @@ typedef struct {
 } ekf_state_t;
 
 
+/* EKF instance. Instances are independent, but sensor client is process-wide, so only one instance may use sensors as data source */
+typedef struct ekf_ctx ekf_ctx_t;
+
+
+/*
+ * Creates EKF instance configured with `configFile` and logging to `logFile`, calibrates it and publishes its initial state.
+ * NULL `logFile` disables logging regardless of configuration. Returns NULL on failure.
+ */
+extern ekf_ctx_t *ekf_ctxInit(const char *configFile, const char *logFile, int initFlags);
+
+
+/*
+ * Performs one iteration of EKF loop: waits for IMU data, predicts, applies pending updates and publishes new state.
+ * Steps of one instance have to be done by one thread at a time. Returns 0 if loop continues, -1 if it has ended.
+ */
+extern int ekf_ctxStep(ekf_ctx_t *ctx);
+
+
+/* Copies the latest state of `ctx`. Can be called from any thread */
+extern void ekf_ctxStateGet(ekf_ctx_t *ctx, ekf_state_t *ekfState);
+
+
+/* ekf_stateWait() for `ctx` instance */
+extern int ekf_ctxStateWait(ekf_ctx_t *ctx, ekf_state_t *ekfState, time_t timeoutUs, uint64_t *seq);
+
+
+/* ekf_latlon2en() for `ctx` instance */
+extern int ekf_ctxLatlon2en(ekf_ctx_t *ctx, double lat, double lon, float *east, float *north);
+
+
+/* Destroys `ctx`, it can not be stepped by any thread */
+extern void ekf_ctxDone(ekf_ctx_t *ctx);
+
+
+/* Called after each step of ekf_replay() with the instance and its new state. Returning non-zero stops the replay */
+typedef int (*ekf_replayCb_t)(ekf_ctx_t *ctx, const ekf_state_t *ekfState, void *arg);
+
+
+typedef struct {
+	unsigned long long int iterations; /* number of EKF loop iterations */
+	time_t durationUs;                 /* wall-clock duration of replay */
+	float throughput;                  /* iterations per second */
+	unsigned int gpsCnt;               /* number of GPS positions compared with state */
+	float gpsRmse;                     /* RMS of horizontal distance between GPS position and state predicted before its update */
+	ekf_state_t state;                 /* state after last step */
+} ekf_replayStats_t;
+
+
+/* EKF configuration parameter override, e.g. {"R_MATRIX/astdev", 0.5} */
+typedef struct {
+	const char *name;
+	float value;
+} ekf_param_t;
+
+
+typedef struct {
+	const char *path;           /* logs file, used if `buf` is NULL */
+	const void *buf;            /* logs file contents, shared read-only between replays */
+	size_t bufSize;             /* size of `buf` in bytes */
+	const ekf_param_t *params;  /* overrides of parameters read from configuration file */
+	unsigned int paramsCnt;     /* number of `params` */
+} ekf_replayInput_t;
+
+
+/*
+ * Replays EKF logs from `path` in the calling thread without any sleeps, so replay speed is bound only by CPU.
+ * EKF is configured with `configFile` with data source replaced by `path`. Its own logs are written to `logFile` if enabled.
+ * `cb`, `arg` and `stats` may be NULL. Throughput is printed and written to `stats`.
+ * Returns 0 if end of logs was reached or `cb` stopped the replay, -1 on error.
+ */
+extern int ekf_replay(const char *configFile, const char *path, const char *logFile, ekf_replayCb_t cb, void *arg, ekf_replayStats_t *stats);
+
+
+/*
+ * ekf_replay() of logs and parameters described by `input`. Throughput is not printed and NULL `logFile` disables EKF logs,
+ * so many replays may run concurrently in separate threads, e.g. with different `input->params`.
+ */
+extern int ekf_replayInput(const char *configFile, const ekf_replayInput_t *input, const char *logFile, ekf_replayCb_t cb, void *arg, ekf_replayStats_t *stats);
+
+
+/* Global API below runs single instance configured with `etc/ekf.conf` in a dedicated thread */
+
 extern int ekf_init(int initFlags);
 
 
@@ -80,6 +167,14 @@ extern void ekf_done(void);
 extern void ekf_stateGet(ekf_state_t *ekf_state);
 
 
+/*
+ * Waits up to `timeoutUs` microseconds for state with sequence number different from `*seq` and copies it to `ekf_state`.
+ * `*seq` is updated to sequence number of copied state. On timeout the latest state is copied anyway.
+ * Returns 0 on new state, -1 on timeout or error.
+ */
+extern int ekf_stateWait(ekf_state_t *ekf_state, time_t timeoutUs, uint64_t *seq);
+
+
 extern void ekf_boundsGet(float *bYaw, float *bRoll, float *bPitch);
 
 
@@ -19,29 +19,16 @@
 #include <stdlib.h>
 #include <vec.h>
 #include <errno.h>
+#include <string.h>
 
 #include "filters.h"
 
 
-#define FLTR_WINDOW_LEN 256
-
 #define GYRO_WINDOW_PATH  "etc/ekf_windows/gyro.txt"
 #define ACCEL_WINDOW_PATH "etc/ekf_windows/accel.txt"
 #define BARO_WINDOW_PATH  "etc/ekf_windows/baro.txt"
 
 
-typedef struct {
-	float window[FLTR_WINDOW_LEN]; /* filter window values */
-	unsigned int len;              /* length of window read from file */
-} fltr_t;
-
-struct {
-	fltr_t gyroFltr;
-	fltr_t accelFltr;
-	fltr_t baroFltr;
-} fltr_common;
-
-
 static void fltr_windowVec(vec_t *raw, vec_t *buf, int *bufPos, const float *window, int windowLen)
 {
 	vec_t part, full = { 0 };
@@ -112,33 +99,25 @@ static void fltr_windowScl(float *raw, float *buf, int *bufPos, const float *win
 }
 
 
-void fltr_accLpf(vec_t *raw)
+void fltr_accLpf(fltr_ctx_t *fltr, vec_t *raw)
 {
-	static vec_t buf[FLTR_WINDOW_LEN] = { 0 };
-	static int bufPos = 0;
-
-	fltr_windowVec(raw, buf, &bufPos, fltr_common.accelFltr.window, fltr_common.accelFltr.len);
+	fltr_windowVec(raw, fltr->accelBuf, &fltr->accelBufPos, fltr->accelFltr.window, fltr->accelFltr.len);
 }
 
 
-void fltr_vBaroLpf(float *raw)
+void fltr_vBaroLpf(fltr_ctx_t *fltr, float *raw)
 {
-	static float buf[FLTR_WINDOW_LEN] = { 0 };
-	static int bufPos = 0;
-
-	fltr_windowScl(raw, buf, &bufPos, fltr_common.baroFltr.window, fltr_common.baroFltr.len);
+	fltr_windowScl(raw, fltr->baroBuf, &fltr->baroBufPos, fltr->baroFltr.window, fltr->baroFltr.len);
 }
 
 
-void fltr_gyroLpf(vec_t *raw)
+void fltr_gyroLpf(fltr_ctx_t *fltr, vec_t *raw)
 {
-	static vec_t buf = { 0 };
-
-	vec_times(&buf, 0.5);
+	vec_times(&fltr->gyroBuf, 0.5);
 	vec_times(raw, 0.5);
-	vec_add(&buf, raw);
+	vec_add(&fltr->gyroBuf, raw);
 
-	*raw = buf;
+	*raw = fltr->gyroBuf;
 }
 
 
@@ -196,30 +175,32 @@ static int fltr_windowInit(const char *path, fltr_t *filter, char **buf, size_t
 }
 
 
-int fltr_init(void)
+int fltr_init(fltr_ctx_t *fltr)
 {
 	char *buf;
 	size_t bufSz = 64;
 
+	memset(fltr, 0, sizeof(*fltr));
+
 	buf = malloc(bufSz);
 	if (buf == NULL) {
 		fprintf(stderr, "filter: failed to malloc\n");
 		return -1;
 	}
 
-	if (fltr_windowInit(GYRO_WINDOW_PATH, &fltr_common.gyroFltr, &buf, &bufSz) < 0) {
+	if (fltr_windowInit(GYRO_WINDOW_PATH, &fltr->gyroFltr, &buf, &bufSz) < 0) {
 		fprintf(stderr, "filter: failed to init gyro filter\n");
 		free(buf);
 		return -1;
 	}
 
-	if (fltr_windowInit(ACCEL_WINDOW_PATH, &fltr_common.accelFltr, &buf, &bufSz) < 0) {
+	if (fltr_windowInit(ACCEL_WINDOW_PATH, &fltr->accelFltr, &buf, &bufSz) < 0) {
 		fprintf(stderr, "filter: failed to init accel filter\n");
 		free(buf);
 		return -1;
 	}
 
-	if (fltr_windowInit(BARO_WINDOW_PATH, &fltr_common.baroFltr, &buf, &bufSz) < 0) {
+	if (fltr_windowInit(BARO_WINDOW_PATH, &fltr->baroFltr, &buf, &bufSz) < 0) {
 		fprintf(stderr, "filter: failed to init bari filter\n");
 		free(buf);
 		return -1;
@@ -19,17 +19,43 @@
 #include <vec.h>
 
 
+#define FLTR_WINDOW_LEN 256
+
+
+typedef struct {
+	float window[FLTR_WINDOW_LEN]; /* filter window values */
+	unsigned int len;              /* length of window read from file */
+} fltr_t;
+
+
+/* Filters with their windows and signal buffers, one set per EKF instance */
+typedef struct {
+	fltr_t gyroFltr;
+	fltr_t accelFltr;
+	fltr_t baroFltr;
+
+	vec_t accelBuf[FLTR_WINDOW_LEN];
+	int accelBufPos;
+
+	float baroBuf[FLTR_WINDOW_LEN];
+	int baroBufPos;
+
+	vec_t gyroBuf;
+} fltr_ctx_t;
+
+
 /* Filters accelerometer signal using windowed-sinc FIR filter. Passing null clears the buffer. Thread unsafe! */
-void fltr_accLpf(vec_t *raw);
+void fltr_accLpf(fltr_ctx_t *fltr, vec_t *raw);
 
 /* Filters barometer speed signal using windowed-sinc FIR filter. Passing null clears the buffer. Thread unsafe! */
-void fltr_vBaroLpf(float *raw);
+void fltr_vBaroLpf(fltr_ctx_t *fltr, float *raw);
 
 
-void fltr_gyroLpf(vec_t *raw);
+void fltr_gyroLpf(fltr_ctx_t *fltr, vec_t *raw);
 
 
-int fltr_init(void);
+/* Reads filter windows and clears signal buffers of `fltr` */
+int fltr_init(fltr_ctx_t *fltr);
 
 
 #endif
@@ -19,26 +19,40 @@
 #include <math.h>
 #include <time.h>
 
-#include "kalman_implem.h"
+#include "kalman_core.h"
 
 #include <vec.h>
 #include <quat.h>
 #include <matrix.h>
 
 
+/* prints P_(k|k-1) if `est` is set, P_(k|k) otherwise */
+static void kalman_covPrint(const state_engine_t *engine, bool est)
+{
+	if (engine->packedCov) {
+		matrix_symPrint(est ? &engine->covEstSym : &engine->covSym);
+	}
+	else {
+		matrix_print(est ? &engine->cov_est : &engine->cov);
+	}
+}
+
+
 /* performs kalman prediction step given state engine */
 void kalman_predict(state_engine_t *engine, time_t timeStep, int verbose)
 {
+	matrix_t tmp;
+
 	/* get current value of control vector U */
-	engine->getControl(&engine->U);
+	engine->getControl(engine->model, &engine->U);
 
 	/* calculate current state transition jacobian */
-	engine->getJacobian(&engine->F, &engine->state, &engine->U, timeStep);
+	engine->getJacobian(engine->model, &engine->F, &engine->state, &engine->U, timeStep);
 
 	/* apriori estimation of state before measurement */
-	engine->estimateState(&engine->state, &engine->state_est, &engine->U, timeStep);
+	engine->estimateState(engine->model, &engine->state, &engine->state_est, &engine->U, timeStep);
 
-	engine->getNoiseQ(&engine->state, &engine->U, &engine->Q, timeStep);
+	engine->getNoiseQ(engine->model, &engine->state, &engine->U, &engine->Q, timeStep);
 
 	if (verbose) {
 		printf("stat_est:\n");
@@ -47,37 +61,276 @@ void kalman_predict(state_engine_t *engine, time_t timeStep, int verbose)
 		matrix_print(&engine->F);
 	}
 
-	/* apriori estimation of covariance matrix */
-	matrix_sandwitch(&engine->F, &engine->cov, &engine->cov_est, &engine->B);
-	matrix_add(&engine->cov_est, &engine->Q, NULL);
+	/*
+	 * Phi = F * Phi with only nonzeros of F used, and Qd = Qd + Q. Transition is accumulated exactly, while process noise
+	 * of earlier predictions is not propagated by F of later ones. This first order approximation is good as long as
+	 * F of accumulated predictions stays close to identity. Buffers of product and Phi are swapped instead of copied.
+	 */
+	if (engine->covDecim > 1) {
+		matrix_patternProd(&engine->Fpattern, &engine->F, &engine->Phi, &engine->B);
+		tmp = engine->Phi;
+		engine->Phi = engine->B;
+		engine->B = tmp;
+		matrix_add(&engine->Qd, &engine->Q, NULL);
+
+		if (++engine->covSteps >= engine->covDecim) {
+			kalman_covPropagate(engine);
+		}
+		return;
+	}
+
+	/* apriori estimation of covariance matrix, computed as exactly symmetric to prevent asymmetry drift. Only nonzeros of F are used */
+	if (engine->packedCov) {
+		matrix_symPatternSandwitch(&engine->Fpattern, &engine->F, &engine->covSym, &engine->covEstSym, &engine->B);
+		matrix_symAdd(&engine->covEstSym, &engine->Q);
+	}
+	else {
+		matrix_patternSandwitch(&engine->Fpattern, &engine->F, &engine->cov, &engine->cov_est, &engine->B);
+		matrix_add(&engine->cov_est, &engine->Q, NULL);
+	}
 
 	if (verbose) {
 		printf("cov:\n");
-		matrix_print(&engine->cov);
+		kalman_covPrint(engine, false);
 		printf("covest:\n");
-		matrix_print(&engine->cov_est);
+		kalman_covPrint(engine, true);
+	}
+}
+
+
+void kalman_covPropagate(state_engine_t *engine)
+{
+	if (engine->covSteps == 0) {
+		return;
+	}
+
+	/* P_(k|k-1) = Phi * P * transpose(Phi) + Qd, where P is the covariance at the start of accumulation */
+	if (engine->packedCov) {
+		matrix_symPatternSandwitch(&engine->Phipattern, &engine->Phi, &engine->covSym, &engine->covEstSym, &engine->B);
+		matrix_symAdd(&engine->covEstSym, &engine->Qd);
+	}
+	else {
+		matrix_patternSandwitch(&engine->Phipattern, &engine->Phi, &engine->cov, &engine->cov_est, &engine->B);
+		matrix_add(&engine->cov_est, &engine->Qd, NULL);
+	}
+
+	matrix_diag(&engine->Phi);
+	matrix_zeroes(&engine->Qd);
+	engine->covSteps = 0;
+}
+
+
+int kalman_covDecimSet(state_engine_t *engine, unsigned int n)
+{
+	matrix_t *ones = &engine->Qd, *M = &engine->Phi, *prod = &engine->B;
+	unsigned int i, j, k;
+	bool changed = true;
+
+	matrix_sparsityFree(&engine->Phipattern);
+	engine->covDecim = n;
+	engine->covSteps = 0;
+
+	if (n <= 1) {
+		return 0;
+	}
+
+	/* nonzeros of F as ones */
+	matrix_zeroes(ones);
+	for (i = 0; i < engine->Fpattern.rows; i++) {
+		for (k = engine->Fpattern.rowStart[i]; k < engine->Fpattern.rowStart[i + 1]; k++) {
+			MATRIX_DATA(ones, i, engine->Fpattern.colIdx[k]) = 1;
+		}
+	}
+
+	/* Phi pattern is the union of patterns of I, F, F^2, ... It stops growing after at most `rows` steps */
+	matrix_diag(M);
+	for (k = 0; k < M->rows && changed; k++) {
+		matrix_patternProd(&engine->Fpattern, ones, M, prod);
+
+		changed = false;
+		for (i = 0; i < M->rows; i++) {
+			for (j = 0; j < M->cols; j++) {
+				if (MATRIX_DATA(prod, i, j) != 0 && MATRIX_DATA(M, i, j) == 0) {
+					MATRIX_DATA(M, i, j) = 1;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	if (matrix_sparsityAlloc(&engine->Phipattern, M) != 0) {
+		engine->covDecim = 0;
+		matrix_zeroes(ones);
+		return -1;
+	}
+
+	matrix_diag(M);
+	matrix_zeroes(ones);
+
+	return 0;
+}
+
+
+/* C = A * P_(k|k), where only nonzeros of A present in S are used */
+static void kalman_covProd(const matrix_sparsity_t *S, const matrix_t *A, const state_engine_t *engine, matrix_t *C)
+{
+	if (engine->packedCov) {
+		matrix_symPatternProd(S, A, &engine->covSym, C);
+	}
+	else {
+		matrix_patternProd(S, A, &engine->cov, C);
 	}
 }
 
-/* performs kalman update step calculations */
+
+/* P_(k|k) += alpha * A * B for symmetric A * B, computed as exactly symmetric */
+static void kalman_covGemm(float alpha, const matrix_t *A, const matrix_t *B, state_engine_t *engine)
+{
+	if (engine->packedCov) {
+		matrix_symGemm(alpha, A, B, 1, &engine->covSym);
+	}
+	else {
+		matrix_gemmSym(alpha, A, B, 1, &engine->cov);
+	}
+}
+
+
+/* P_(k|k) = P_(k|k-1), starting point of covariance update */
+static void kalman_covEstCommit(state_engine_t *engine)
+{
+	if (engine->packedCov) {
+		matrix_symCopy(&engine->covSym, &engine->covEstSym);
+	}
+	else {
+		matrix_writeSubmatrix(&engine->cov, 0, 0, &engine->cov_est);
+	}
+}
+
+void kalman_estimateCommit(state_engine_t *engine)
+{
+	matrix_writeSubmatrix(&engine->state, 0, 0, &engine->state_est);
+
+	/* P_(k|k-1) is not computed while predictions are accumulated, P_(k|k) stays at the start of accumulation */
+	if (engine->covSteps == 0) {
+		kalman_covEstCommit(engine);
+	}
+}
+
+
+void kalman_updateChain(state_engine_t *engine)
+{
+	matrix_writeSubmatrix(&engine->state_est, 0, 0, &engine->state);
+
+	if (engine->packedCov) {
+		matrix_symCopy(&engine->covEstSym, &engine->covSym);
+	}
+	else {
+		matrix_writeSubmatrix(&engine->cov_est, 0, 0, &engine->cov);
+	}
+}
+
+
+/*
+ * Performs update as a sequence of scalar updates, one per measurement, for diagonal R. No matrix is inverted.
+ * All measurements use the same linearization point x_(k|k-1), so innovation of each one is corrected by the state change made by previous ones.
+ * Measurement with non-positive innovation variance is skipped. Returns -1 if all measurements were skipped, 0 otherwise.
+ */
+static int kalman_updateSequential(int verbose, update_engine_t *updateEngine, state_engine_t *stateEngine)
+{
+	matrix_t *x = &stateEngine->state, *x0 = &stateEngine->state_est;
+	matrix_sparsity_t hPattern = updateEngine->Hpattern;
+	matrix_t h, ph, pht;
+	unsigned int meas, i, col;
+	float s, y;
+	unsigned int applied = 0;
+
+	/* P and x are updated in place starting from the apriori estimates */
+	kalman_covEstCommit(stateEngine);
+	matrix_writeSubmatrix(x, 0, 0, x0);
+
+	for (meas = 0; meas < updateEngine->H.rows; meas++) {
+		/*
+		 * h is the measurement row of H_k, ph = h * P = transpose(P * transpose(h)) as P is symmetric. tmp3 rows are used as storage.
+		 * Single row pattern shares column indices with Hpattern, as its offsets index the whole `colIdx` array
+		 */
+		matrix_view(&updateEngine->H, meas, 0, 1, updateEngine->H.cols, &h);
+		matrix_view(&updateEngine->tmp3, meas, 0, 1, updateEngine->tmp3.cols, &ph);
+		hPattern.rows = 1;
+		hPattern.rowStart = &updateEngine->Hpattern.rowStart[meas];
+		kalman_covProd(&hPattern, &h, stateEngine, &ph);
+
+		/* s = h * P * transpose(h) + r, y = z - h(x_(k|k-1)) - h * (x - x_(k|k-1)) */
+		s = MATRIX_DATA(&updateEngine->R, meas, meas);
+		y = updateEngine->Y.data[meas];
+		for (i = hPattern.rowStart[0]; i < hPattern.rowStart[1]; i++) {
+			col = hPattern.colIdx[i];
+			s += h.data[col] * ph.data[col];
+			y -= h.data[col] * (x->data[col] - x0->data[col]);
+		}
+
+		if (!(s > 0)) {
+			continue;
+		}
+
+		/* x += transpose(ph) * y / s */
+		y /= s;
+		for (i = 0; i < ph.cols; i++) {
+			x->data[i] += ph.data[i] * y;
+		}
+
+		/* P -= transpose(ph) * ph / s, exactly symmetric rank-1 update */
+		pht = ph;
+		matrix_trp(&pht);
+		kalman_covGemm(-1 / s, &pht, &ph, stateEngine);
+		applied++;
+	}
+
+	if (verbose) {
+		printf("y:\n");
+		matrix_print(&updateEngine->Y);
+		printf("cov:\n");
+		kalman_covPrint(stateEngine, false);
+	}
+
+	return (applied > 0) ? 0 : -1;
+}
+
+
+/* performs kalman update step calculations. On failure x_(k|k) and P_(k|k) are not valid estimates, see kalman_core.h */
 int kalman_update(time_t timeStep, int verbose, update_engine_t *updateEngine, state_engine_t *stateEngine)
 {
+	int err;
+
 	/* no new measurement available = exit step */
-	if (updateEngine->getData(&updateEngine->Z, &stateEngine->state, &updateEngine->R, timeStep) == NULL) {
+	if (updateEngine->getData(updateEngine->model, &updateEngine->Z, &stateEngine->state, &updateEngine->R, timeStep) == NULL) {
 		return -1;
 	}
 
-	updateEngine->getJacobian(&updateEngine->H, &stateEngine->state_est, timeStep);
+	/* update step needs P_(k|k-1) of current prediction */
+	kalman_covPropagate(stateEngine);
 
-	/* prepare diag */
-	matrix_diag(&updateEngine->I);
+	updateEngine->getJacobian(updateEngine->model, &updateEngine->H, &stateEngine->state_est, timeStep);
 
 	/* y_k = z_k - h(x_(k|k-1)) */
-	matrix_sub(&updateEngine->Z, updateEngine->predictMeasurements(&stateEngine->state_est, &updateEngine->hx, timeStep), &updateEngine->Y);
+	matrix_sub(&updateEngine->Z, updateEngine->predictMeasurements(updateEngine->model, &stateEngine->state_est, &updateEngine->hx, timeStep), &updateEngine->Y);
 
-	/* S_k = H_k * P_(k|k-1) * transpose(H_k) + R*/
-	matrix_sandwitch(&updateEngine->H, &stateEngine->cov_est, &updateEngine->S, &updateEngine->tmp3);
-	matrix_add(&updateEngine->S, &updateEngine->R, NULL);
+	if (updateEngine->sequential) {
+		return kalman_updateSequential(verbose, updateEngine, stateEngine);
+	}
+
+	/* S_k = H_k * P_(k|k-1) * transpose(H_k) + R, computed as exactly symmetric from nonzeros of H_k only. tmp3 keeps H_k * P_(k|k-1) */
+	if (stateEngine->packedCov) {
+		matrix_symPatternProd(&updateEngine->Hpattern, &updateEngine->H, &stateEngine->covEstSym, &updateEngine->tmp3);
+		/* S_k = R + tmp3 * transpose(H_k) */
+		matrix_writeSubmatrix(&updateEngine->S, 0, 0, &updateEngine->R);
+		matrix_trp(&updateEngine->H);
+		matrix_gemmSym(1, &updateEngine->tmp3, &updateEngine->H, 1, &updateEngine->S);
+		matrix_trp(&updateEngine->H);
+	}
+	else {
+		matrix_patternSandwitch(&updateEngine->Hpattern, &updateEngine->H, &stateEngine->cov_est, &updateEngine->S, &updateEngine->tmp3);
+		matrix_add(&updateEngine->S, &updateEngine->R, NULL);
+	}
 
 	/* only for debug purposes */
 	if (verbose) {
@@ -92,15 +345,19 @@ int kalman_update(time_t timeStep, int verbose, update_engine_t *updateEngine, s
 		printf("H:\n");
 		matrix_print(&updateEngine->H);
 		printf("cov_est:\n");
-		matrix_print(&stateEngine->cov_est);
+		kalman_covPrint(stateEngine, true);
 	}
 
-	/* K_k = P_(k|k-1) * transpose(H_k) * inverse(S_k) */
-	matrix_trp(&updateEngine->H);
-	matrix_prod(&stateEngine->cov_est, &updateEngine->H, &updateEngine->tmp2);
-	matrix_trp(&updateEngine->H);
-	matrix_inv(&updateEngine->S, &updateEngine->tmp1, updateEngine->invBuf, updateEngine->invBufLen);
-	matrix_prod(&updateEngine->tmp2, &updateEngine->tmp1, &updateEngine->K);
+	/*
+	 * K_k = P_(k|k-1) * transpose(H_k) * inverse(S_k), solved without inverting S_k. Update is skipped if S_k is not positive definite.
+	 * P_(k|k-1) is symmetric, so P_(k|k-1) * transpose(H_k) is transposed tmp3
+	 */
+	matrix_trp(&updateEngine->tmp3);
+	err = matrix_cholSolveRight(&updateEngine->S, &updateEngine->tmp3, &updateEngine->K);
+	matrix_trp(&updateEngine->tmp3);
+	if (err < 0) {
+		return -1;
+	}
 
 	/* only for debug purposes */
 	if (verbose) {
@@ -112,35 +369,54 @@ int kalman_update(time_t timeStep, int verbose, update_engine_t *updateEngine, s
 	}
 
 	/* x_(k|k) = x_(k|k-1) + K_k * y_k */
-	matrix_prod(&updateEngine->K, &updateEngine->Y, &updateEngine->tmp5);
-	matrix_add(&stateEngine->state_est, &updateEngine->tmp5, &stateEngine->state);
+	matrix_writeSubmatrix(&stateEngine->state, 0, 0, &stateEngine->state_est);
+	matrix_gemm(1, &updateEngine->K, &updateEngine->Y, 1, &stateEngine->state);
 
-	/* P_(k|k) = (I - K_k * H_k) * P_(k|k-1) */
-	matrix_prod(&updateEngine->K, &updateEngine->H, &updateEngine->tmp4);
-	matrix_sub(&updateEngine->I, &updateEngine->tmp4, NULL);
-	matrix_prod(&updateEngine->I, &stateEngine->cov_est, &stateEngine->cov);
+	/* P_(k|k) = (I - K_k * H_k) * P_(k|k-1) = P_(k|k-1) - K_k * (H_k * P_(k|k-1)), low rank correction computed as exactly symmetric */
+	kalman_covEstCommit(stateEngine);
+	kalman_covGemm(-1, &updateEngine->K, &updateEngine->tmp3, stateEngine);
 
 	return 0;
 }
 
 
+int kalman_updateAll(const time_t *timeSteps, int verbose, update_engine_t *const *updateEngines, unsigned int n, state_engine_t *stateEngine)
+{
+	unsigned int i;
+	int updated = 0;
+	bool chain = false;
+
+	for (i = 0; i < n; i++) {
+		/* next update starts from result of the last successful one, failed update leaves apriori estimates intact */
+		if (chain) {
+			kalman_updateChain(stateEngine);
+		}
+		chain = (kalman_update(timeSteps[i], verbose, updateEngines[i], stateEngine) == 0);
+		if (chain) {
+			updated++;
+		}
+	}
+
+	/* prediction is the state estimate if no measurement was applied */
+	if (updated == 0) {
+		kalman_estimateCommit(stateEngine);
+	}
+
+	return updated;
+}
+
+
 void kalman_updateDealloc(update_engine_t *engine)
 {
 	matrix_bufFree(&engine->Z);
 	matrix_bufFree(&engine->Y);
 	matrix_bufFree(&engine->S);
 	matrix_bufFree(&engine->K);
-	matrix_bufFree(&engine->I);
 	matrix_bufFree(&engine->H);
 	matrix_bufFree(&engine->R);
 	matrix_bufFree(&engine->hx);
-	matrix_bufFree(&engine->tmp1);
-	matrix_bufFree(&engine->tmp2);
 	matrix_bufFree(&engine->tmp3);
-	matrix_bufFree(&engine->tmp4);
-	matrix_bufFree(&engine->tmp5);
-
-	free(engine->invBuf);
+	matrix_sparsityFree(&engine->Hpattern);
 }
 
 
@@ -153,24 +429,12 @@ int kalman_updateAlloc(update_engine_t *engine, unsigned int stateLen, unsigned
 	err |= matrix_bufAlloc(&engine->Y, measLen, 1);
 	err |= matrix_bufAlloc(&engine->S, measLen, measLen);
 	err |= matrix_bufAlloc(&engine->K, stateLen, measLen);
-	err |= matrix_bufAlloc(&engine->I, stateLen, stateLen);
 	err |= matrix_bufAlloc(&engine->H, measLen, stateLen);
 	err |= matrix_bufAlloc(&engine->R, measLen, measLen);
 	err |= matrix_bufAlloc(&engine->hx, measLen, 1);
 
 	/* temporary/helper matrices initialization */
-	err |= matrix_bufAlloc(&engine->tmp1, measLen, measLen);
-	err |= matrix_bufAlloc(&engine->tmp2, stateLen, measLen);
 	err |= matrix_bufAlloc(&engine->tmp3, measLen, stateLen);
-	err |= matrix_bufAlloc(&engine->tmp4, stateLen, stateLen);
-	err |= matrix_bufAlloc(&engine->tmp5, stateLen, 1);
-
-	/* non-matrix buffers */
-	engine->invBufLen = measLen * measLen * 2;
-	engine->invBuf = calloc(engine->invBufLen, sizeof(float));
-	if (engine->invBuf == NULL) {
-		err |= -1;
-	}
 
 	if (err != 0) {
 		kalman_updateDealloc(engine);
@@ -191,6 +455,12 @@ void kalman_predictDealloc(state_engine_t *engine)
 	matrix_bufFree(&engine->Q);
 	matrix_bufFree(&engine->U);
 	matrix_bufFree(&engine->B);
+	matrix_sparsityFree(&engine->Fpattern);
+	matrix_bufFree(&engine->Phi);
+	matrix_bufFree(&engine->Qd);
+	matrix_sparsityFree(&engine->Phipattern);
+	matrix_symFree(&engine->covSym);
+	matrix_symFree(&engine->covEstSym);
 }
 
 
@@ -198,6 +468,8 @@ int kalman_predictAlloc(state_engine_t *engine, int stateLen, int ctrlLen)
 {
 	int err = 0;
 
+	engine->Phipattern = (matrix_sparsity_t) { 0 };
+
 	/* State and covariance matrices */
 	err |= matrix_bufAlloc(&engine->state, stateLen, 1);
 	err |= matrix_bufAlloc(&engine->cov, stateLen, stateLen);
@@ -205,6 +477,8 @@ int kalman_predictAlloc(state_engine_t *engine, int stateLen, int ctrlLen)
 	/* State and covariance estimates matrices */
 	err |= matrix_bufAlloc(&engine->state_est, stateLen, 1);
 	err |= matrix_bufAlloc(&engine->cov_est, stateLen, stateLen);
+	err |= matrix_symAlloc(&engine->covSym, stateLen);
+	err |= matrix_symAlloc(&engine->covEstSym, stateLen);
 
 	/* Noise and state transition jacobian matrices */
 	err |= matrix_bufAlloc(&engine->F, stateLen, stateLen);
@@ -213,6 +487,10 @@ int kalman_predictAlloc(state_engine_t *engine, int stateLen, int ctrlLen)
 	/* Control vector matrix */
 	err |= matrix_bufAlloc(&engine->U, ctrlLen, 1);
 
+	/* covariance decimation accumulators */
+	err |= matrix_bufAlloc(&engine->Phi, stateLen, stateLen);
+	err |= matrix_bufAlloc(&engine->Qd, stateLen, stateLen);
+
 	/* temporary/helper matrices initialization */
 	err |= matrix_bufAlloc(&engine->B, stateLen, stateLen);
 
@@ -221,5 +499,8 @@ int kalman_predictAlloc(state_engine_t *engine, int stateLen, int ctrlLen)
 		return -1;
 	}
 
+	engine->covDecim = 0;
+	engine->covSteps = 0;
+
 	return 0;
 }
@@ -17,32 +17,35 @@
 #define PHKALMAN_CORE_H
 
 #include <stdbool.h>
+#include <time.h>
 #include <matrix.h>
 
+/* Model callbacks receive `model` pointer of their engine as the first argument, so one model implementation can serve many filter instances */
+
 /* UPDATE STEP FUNCTIONS */
 
 /* Function that acquires measurements and puts it into Z matrix */
-typedef matrix_t *(*dataGetter)(matrix_t *Z, matrix_t *state, matrix_t *R, time_t timeStep);
+typedef matrix_t *(*dataGetter)(void *model, matrix_t *Z, matrix_t *state, matrix_t *R, time_t timeStep);
 
 /*  function that fills jacobian matrix H based on data from state vector and dt */
-typedef void (*updateJacobian)(matrix_t *H, matrix_t *state, time_t timeStep);
+typedef void (*updateJacobian)(void *model, matrix_t *H, matrix_t *state, time_t timeStep);
 
 /*  function that fills jacobian matrix H based on data from state vector and dt */
-typedef void (*predJacobian)(matrix_t *F, matrix_t *state, matrix_t *U, time_t timeStep);
+typedef void (*predJacobian)(void *model, matrix_t *F, matrix_t *state, matrix_t *U, time_t timeStep);
 
 /* PREDICTION STEP FUNCTIONS */
 
 /* Function that acquires values of control vector and writes it to the U vector. On success returns pointer to U, NULL on fail */
-typedef matrix_t *(*controlVectorGetter)(matrix_t *U);
+typedef matrix_t *(*controlVectorGetter)(void *model, matrix_t *U);
 
 /* function that fills state estimation based on current state and dt */
-typedef void (*stateEstimation)(matrix_t *state, matrix_t *state_est, matrix_t *U, time_t timeStep);
+typedef void (*stateEstimation)(void *model, matrix_t *state, matrix_t *state_est, matrix_t *U, time_t timeStep);
 
 /* function that calculates measurements of some update model based on current state estimation */
-typedef matrix_t *(*predictMeasurements)(matrix_t *state_est, matrix_t *hx, time_t timestep);
+typedef matrix_t *(*predictMeasurements)(void *model, matrix_t *state_est, matrix_t *hx, time_t timestep);
 
 /* function calculates current process noise covariance matrix based on 'state` and `U` matrices */
-typedef void (*predNoiseGetter)(matrix_t *state, matrix_t *U, matrix_t *Q, time_t timestep);
+typedef void (*predNoiseGetter)(void *model, matrix_t *state, matrix_t *U, matrix_t *Q, time_t timestep);
 
 typedef void (*initMeasurementCov)(matrix_t *R);
 
@@ -58,28 +61,24 @@ typedef struct {
 	matrix_t Y;
 	matrix_t S;
 	matrix_t K;
-	matrix_t I;
 	matrix_t hx;
 
-	/* inversion helper elements */
-	matrix_t invS;
-	float *invBuf;
-	unsigned int invBufLen;
+	matrix_sparsity_t Hpattern; /* elements of H that can be nonzero, built once by the model. Only state columns present in it are used */
 
 	/* phmatrix calculation buffers */
-	matrix_t tmp1;
-	matrix_t tmp2;
-	matrix_t tmp3;
-	matrix_t tmp4;
-	matrix_t tmp5;
+	matrix_t tmp3; /* H * P, shared by S and K calculations */
 
 	dataGetter getData;                      /* data getter function */
 	updateJacobian getJacobian;              /* update step jacobian calculation */
 	predictMeasurements predictMeasurements; /* predict hx bector based on state estimation */
 	initMeasurementCov initMeasCov;
+	void *model;                             /* passed to model callbacks */
 
 	/* active/initialized flag */
 	bool active;
+
+	/* R is always diagonal, so measurements can be processed one by one as scalar updates without inverting S */
+	bool sequential;
 } update_engine_t;
 
 
@@ -94,21 +93,60 @@ typedef struct {
 	matrix_t F;
 	matrix_t Q;
 
+	matrix_sparsity_t Fpattern; /* elements of F that can be nonzero, built once by the model */
+
 	matrix_t B; /* buffer matrix for covariance estimate calculations */
 
+	/* covariance decimation: transition and process noise of predictions are accumulated and covariance is propagated once per `covDecim` predictions */
+	unsigned int covDecim;        /* 0 or 1 propagates covariance in every prediction */
+	unsigned int covSteps;        /* number of predictions accumulated in `Phi` and `Qd` */
+	matrix_t Phi;                 /* product of F of accumulated predictions */
+	matrix_t Qd;                  /* sum of process noise of accumulated predictions */
+	matrix_sparsity_t Phipattern; /* elements of Phi that can be nonzero, derived from Fpattern */
+
+	/* covariances stored as packed upper triangles, used instead of `cov` and `cov_est` if `packedCov` is set */
+	matrix_sym_t covSym;
+	matrix_sym_t covEstSym;
+	bool packedCov;
+
 	stateEstimation estimateState;
 	predJacobian getJacobian;
 	controlVectorGetter getControl;
 	predNoiseGetter getNoiseQ;
+	void *model; /* passed to model callbacks */
 } state_engine_t;
 
 
 /* performs kalman prediction step */
 extern void kalman_predict(state_engine_t *engine, time_t timeStep, int verbose);
 
-/* performs kalman measurement update step */
+/*
+ * Performs kalman measurement update step starting from apriori estimates x_(k|k-1) and P_(k|k-1).
+ * Returns 0 and writes updated estimates to x_(k|k) and P_(k|k) if any measurement was applied.
+ * Returns -1 if there is no new measurement or S_k is not positive definite. Then x_(k|k) and P_(k|k) are not valid estimates
+ * of the current step (they are left unchanged or hold apriori estimates), so caller must use kalman_estimateCommit()
+ * unless another update step of the same cycle succeeded.
+ */
 extern int kalman_update(time_t timeStep, int verbose, update_engine_t *updateEngine, state_engine_t *stateEngine);
 
+/*
+ * Performs update steps of `n` engines in order, each one starting from result of the last successful one. `timeSteps[i]` is passed
+ * to update of `updateEngines[i]`. If no update succeeds, apriori estimates are committed. Returns number of successful updates
+ */
+extern int kalman_updateAll(const time_t *timeSteps, int verbose, update_engine_t *const *updateEngines, unsigned int n, state_engine_t *stateEngine);
+
+/* sets x_(k|k) and P_(k|k) to apriori estimates. Used when no update step follows prediction */
+extern void kalman_estimateCommit(state_engine_t *engine);
+
+/* propagates P_(k|k-1) with predictions accumulated since last covariance propagation. Called by update step, no-op if nothing is accumulated */
+extern void kalman_covPropagate(state_engine_t *engine);
+
+/* sets covariance decimation `n` of engine with Fpattern already set. Returns 0 on success, -1 on allocation failure */
+extern int kalman_covDecimSet(state_engine_t *engine, unsigned int n);
+
+/* sets apriori estimates to x_(k|k) and P_(k|k), so next update step in the same cycle starts from result of the previous one */
+extern void kalman_updateChain(state_engine_t *engine);
+
 /* Deallocates update engine */
 extern void kalman_updateDealloc(update_engine_t *engine);
 
@@ -18,9 +18,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <math.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "kalman_implem.h"
 #include "meas.h"
@@ -32,15 +34,34 @@
 #include <matrix.h>
 #include <parser.h>
 
-#define KMN_CONFIG_HEADERS_CNT    7
+#define KMN_CONFIG_HEADERS_CNT    9
 #define KMN_CONFIG_MAX_FIELDS_CNT 9
 
 
-struct {
-	const kalman_init_t *inits;
-} pred_common;
-
-
+/* numeric fields of `kalman_init_t` that can be set with kmn_paramSet() */
+static const struct {
+	const char *name;
+	size_t offset;
+} kmn_params[] = {
+	{ "P_MATRIX/qerr", offsetof(kalman_init_t, P_qerr) },
+	{ "P_MATRIX/verr", offsetof(kalman_init_t, P_verr) },
+	{ "P_MATRIX/baerr", offsetof(kalman_init_t, P_baerr) },
+	{ "P_MATRIX/rerr", offsetof(kalman_init_t, P_rerr) },
+	{ "R_MATRIX/astdev", offsetof(kalman_init_t, R_astdev) },
+	{ "R_MATRIX/mstdev", offsetof(kalman_init_t, R_mstdev) },
+	{ "R_MATRIX/bwstdev", offsetof(kalman_init_t, R_bwstdev) },
+	{ "R_MATRIX/hstdev", offsetof(kalman_init_t, R_hstdev) },
+	{ "R_MATRIX/gpsxstdev", offsetof(kalman_init_t, R_gpsxstdev) },
+	{ "R_MATRIX/gpsvstdev", offsetof(kalman_init_t, R_gpsvstdev) },
+	{ "Q_MATRIX/astdev", offsetof(kalman_init_t, Q_astdev) },
+	{ "Q_MATRIX/wstdev", offsetof(kalman_init_t, Q_wstdev) },
+	{ "Q_MATRIX/baDotstdev", offsetof(kalman_init_t, Q_baDotstdev) },
+	{ "Q_MATRIX/bwDotstdev", offsetof(kalman_init_t, Q_bwDotstdev) },
+};
+
+
+/* parser converters have no user argument, so config reading is serialized to use `converterResult` */
+static pthread_mutex_t converterLock = PTHREAD_MUTEX_INITIALIZER;
 static kalman_init_t *converterResult;
 
 
@@ -221,6 +242,7 @@ static int kmn_miscConverter(const hmap_t *h)
 {
 	int err = 0;
 	float magDecl = 0;
+	char *str;
 
 	err |= parser_fieldGetFloat(h, "magDecl", &magDecl);
 
@@ -228,6 +250,42 @@ static int kmn_miscConverter(const hmap_t *h)
 		return err;
 	}
 
+	/* Parsing optional field `loop` */
+	str = hmap_get(h, "loop");
+	if (str == NULL || strcmp(str, "EVENT") == 0) {
+		converterResult->loopMode = KMN_LOOP_EVENT;
+	}
+	else if (strcmp(str, "SLEEP") == 0) {
+		converterResult->loopMode = KMN_LOOP_SLEEP;
+	}
+	else {
+		fprintf(stderr, "Ekf config: Invalid loop specifier: %s\n", str);
+		return -1;
+	}
+
+	/* Parsing optional field `covDecim` */
+	if (hmap_get(h, "covDecim") != NULL) {
+		if (parser_fieldGetInt(h, "covDecim", &converterResult->covDecim) != 0) {
+			return -1;
+		}
+
+		if (converterResult->covDecim < 1) {
+			fprintf(stderr, "Ekf config: covDecim must be positive\n");
+			return -1;
+		}
+	}
+
+	/* Parsing optional field `warmStart` */
+	str = hmap_get(h, "warmStart");
+	if (str != NULL) {
+		if (strlen(str) > MAX_PATH_LEN) {
+			fprintf(stderr, "Ekf config: warmStart file specification is too long\n");
+			return -1;
+		}
+
+		strcpy(converterResult->warmFile, str);
+	}
+
 	if (magDecl > 45 || magDecl < -45) {
 		fprintf(stderr, "Ekf config: magDecl outside of [-45 deg, +45 deg]");
 		return -1;
@@ -240,16 +298,108 @@ static int kmn_miscConverter(const hmap_t *h)
 }
 
 
+/* Parses optional update rate limit `field` in Hz into minimal period between updates. Missing field keeps `period` unchanged */
+static int kmn_updateRateGet(const hmap_t *h, const char *field, time_t *period)
+{
+	float rate;
+
+	if (hmap_get(h, field) == NULL) {
+		return 0;
+	}
+
+	if (parser_fieldGetFloat(h, field, &rate) != 0) {
+		return -1;
+	}
+
+	if (rate < 0) {
+		fprintf(stderr, "Ekf config: negative %s update rate\n", field);
+		return -1;
+	}
+
+	/* rate of 0 means no limit */
+	*period = (rate == 0) ? 0 : (time_t)(1000000.f / rate);
+
+	return 0;
+}
+
+
+static int kmn_updateRateConverter(const hmap_t *h)
+{
+	int err = 0;
+
+	err |= kmn_updateRateGet(h, "imu", &converterResult->imuUpdatePeriod);
+	err |= kmn_updateRateGet(h, "baro", &converterResult->baroUpdatePeriod);
+	err |= kmn_updateRateGet(h, "gps", &converterResult->gpsUpdatePeriod);
+
+	return err;
+}
+
+
+/* Parses optional calibration timeout `field` in seconds. Missing field keeps `timeout` unchanged */
+static int kmn_calibTimeoutGet(const hmap_t *h, const char *field, time_t *timeout)
+{
+	float seconds;
+
+	if (hmap_get(h, field) == NULL) {
+		return 0;
+	}
+
+	if (parser_fieldGetFloat(h, field, &seconds) != 0) {
+		return -1;
+	}
+
+	if (seconds < 0) {
+		fprintf(stderr, "Ekf config: negative %s calibration timeout\n", field);
+		return -1;
+	}
+
+	/* timeout of 0 means no limit */
+	*timeout = (time_t)(seconds * 1000000.f);
+
+	return 0;
+}
+
+
+static int kmn_calibTimeoutConverter(const hmap_t *h)
+{
+	int err = 0;
+
+	err |= kmn_calibTimeoutGet(h, "imu", &converterResult->imuCalibTimeout);
+	err |= kmn_calibTimeoutGet(h, "baro", &converterResult->baroCalibTimeout);
+	err |= kmn_calibTimeoutGet(h, "gps", &converterResult->gpsCalibTimeout);
+
+	return err;
+}
+
+
 /* reads config file named "config" from filesystem */
 int kmn_configRead(const char *configFile, kalman_init_t *initVals)
 {
 	int err = 0;
 	parser_t *p;
 
+	pthread_mutex_lock(&converterLock);
 	converterResult = initVals;
 
+	/* `UPDATE_RATE` header is optional */
+	initVals->imuUpdatePeriod = IMU_UPDATE_TIMEOUT;
+	initVals->baroUpdatePeriod = BARO_UPDATE_TIMEOUT;
+	initVals->gpsUpdatePeriod = GPS_UPDATE_TIMEOUT;
+
+	/* `CALIB_TIMEOUT` header is optional */
+	initVals->imuCalibTimeout = IMU_CALIB_TIMEOUT;
+	initVals->baroCalibTimeout = BARO_CALIB_TIMEOUT;
+	initVals->gpsCalibTimeout = GPS_CALIB_TIMEOUT;
+
+	/* covariance is propagated in every prediction by default */
+	initVals->covDecim = 1;
+
+	/* warm start is disabled by default */
+	initVals->warmFile[0] = '\0';
+
 	p = parser_alloc(KMN_CONFIG_HEADERS_CNT, KMN_CONFIG_MAX_FIELDS_CNT);
 	if (p == NULL) {
+		pthread_mutex_unlock(&converterLock);
 		return -1;
 	}
 
@@ -260,39 +410,65 @@ int kmn_configRead(const char *configFile, kalman_init_t *initVals)
 	err |= parser_headerAdd(p, "DATA_SOURCE", kmn_dataSourceConverter);
 	err |= parser_headerAdd(p, "MODEL", kmn_modelConverter);
 	err |= parser_headerAdd(p, "MISC", kmn_miscConverter);
+	err |= parser_headerAdd(p, "UPDATE_RATE", kmn_updateRateConverter);
+	err |= parser_headerAdd(p, "CALIB_TIMEOUT", kmn_calibTimeoutConverter);
 
 	if (err != 0) {
 		parser_free(p);
+		pthread_mutex_unlock(&converterLock);
 		return -1;
 	}
 
 	err = parser_execute(p, configFile, PARSER_IGN_UNKNOWN_HEADERS);
 	parser_free(p);
+	pthread_mutex_unlock(&converterLock);
 
 	return err == 0 ? 0 : -1;
 }
 
 
-static matrix_t *kmn_getCtrl(matrix_t *U)
+int kmn_paramSet(kalman_init_t *initVals, const char *name, float value)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(kmn_params) / sizeof(kmn_params[0]); i++) {
+		if (strcmp(kmn_params[i].name, name) == 0) {
+			*(float *)((char *)initVals + kmn_params[i].offset) = value;
+			return 0;
+		}
+	}
+
+	fprintf(stderr, "Ekf config: unknown parameter %s\n", name);
+
+	return -1;
+}
+
+
+static matrix_t *kmn_getCtrl(void *model, matrix_t *U)
 {
-	vec_t accel, gyro, accelRaw, gyroRaw;
+	kmn_ctx_t *kmn = model;
+	meas_imuPreint_t preint;
 
-	meas_accelGet(&accel, &accelRaw);
-	meas_gyroGet(&gyro, &gyroRaw);
+	meas_imuPreintGet(kmn->meas, &preint);
 
-	*matrix_at(U, UWX, 0) = gyro.x;
-	*matrix_at(U, UWY, 0) = gyro.y;
-	*matrix_at(U, UWZ, 0) = gyro.z;
-	*matrix_at(U, UAX, 0) = accelRaw.x;
-	*matrix_at(U, UAY, 0) = accelRaw.y;
-	*matrix_at(U, UAZ, 0) = accelRaw.z;
+	*matrix_at(U, UQA, 0) = preint.dq.a;
+	*matrix_at(U, UQB, 0) = preint.dq.i;
+	*matrix_at(U, UQC, 0) = preint.dq.j;
+	*matrix_at(U, UQD, 0) = preint.dq.k;
+	*matrix_at(U, UVX, 0) = preint.dv.x;
+	*matrix_at(U, UVY, 0) = preint.dv.y;
+	*matrix_at(U, UVZ, 0) = preint.dv.z;
+	*matrix_at(U, UDT, 0) = (float)preint.dt / 1000000.f;
 
 	return U;
 }
 
 
-/* State estimation function definition */
-static void kmn_stateEst(matrix_t *state, matrix_t *state_est, matrix_t *U, time_t timeStep)
+/*
+ * State estimation function definition.
+ * Attitude and velocity are propagated with IMU data preintegrated over `UDT` seconds, so `timeStep` of the loop is not used here.
+ */
+static void kmn_stateEst(void *model, matrix_t *state, matrix_t *state_est, matrix_t *U, time_t timeStep)
 {
 	/* values from state vector */
 	const quat_t qState = { .a = kmn_vecAt(state, QA), .i = kmn_vecAt(state, QB), .j = kmn_vecAt(state, QC), .k = kmn_vecAt(state, QD) };
@@ -300,20 +476,20 @@ static void kmn_stateEst(matrix_t *state, matrix_t *state_est, matrix_t *U, time
 	const vec_t vState = { .x = kmn_vecAt(state, VX), .y = kmn_vecAt(state, VY), .z = kmn_vecAt(state, VZ) };
 	const vec_t baState = { .x = kmn_vecAt(state, BAX), .y = kmn_vecAt(state, BAY), .z = kmn_vecAt(state, BAZ) };
 
-	/* quaternionized angular rate from U vector */
-	quat_t wMeas = { .a = 0, .i = kmn_vecAt(U, UWX), .j = kmn_vecAt(U, UWY), .k = kmn_vecAt(U, UWZ) }; /* quaternionized vector */
-	vec_t aMeas = { .x = kmn_vecAt(U, UAX), .y = kmn_vecAt(U, UAY), .z = kmn_vecAt(U, UAZ) };
-
-	/* quaternionized angular rate and rotation quaternion estimates */
-	quat_t qEst, qTmp;
-	vec_t aEst;
+	/* preintegrated rotation and velocity change from U vector */
+	const quat_t dqMeas = { .a = kmn_vecAt(U, UQA), .i = kmn_vecAt(U, UQB), .j = kmn_vecAt(U, UQC), .k = kmn_vecAt(U, UQD) };
+	const vec_t dvMeas = { .x = kmn_vecAt(U, UVX), .y = kmn_vecAt(U, UVY), .z = kmn_vecAt(U, UVZ) };
+	const float dt = kmn_vecAt(U, UDT);
 
-	const float dt = (float)timeStep / 1000000.f;
+	/* bias correction and rotation quaternion estimates */
+	quat_t qEst, qBias, qTmp;
+	vec_t dvEst, baDt;
 
-	/* quaternion estimation: q = q * ( q_iden + h/2 * (wMeas - bw) ) */
-	quat_dif(&wMeas, &bwState, &qTmp);
-	quat_times(&qTmp, dt / 2);
-	qTmp.a += 1;
+	/* quaternion estimation: q = q * dq * ( q_iden - h/2 * bw ) */
+	qBias = bwState;
+	quat_times(&qBias, -dt / 2);
+	qBias.a += 1;
+	quat_mlt(&dqMeas, &qBias, &qTmp);
 	quat_mlt(&qState, &qTmp, &qEst);
 	quat_normalize(&qEst);
 
@@ -327,15 +503,17 @@ static void kmn_stateEst(matrix_t *state, matrix_t *state_est, matrix_t *U, time
 	*matrix_at(state_est, BWY, 0) = kmn_vecAt(state, BWY);
 	*matrix_at(state_est, BWZ, 0) = kmn_vecAt(state, BWZ);
 
-	/* velocity estimation */
-	vec_dif(&aMeas, &baState, &aEst);
-	quat_vecRot(&aEst, &qState);
-	aEst.z += EARTH_G;
+	/* velocity estimation: v = v + q * (dv - h * ba) + h * g */
+	baDt = baState;
+	vec_times(&baDt, dt);
+	vec_dif(&dvMeas, &baDt, &dvEst);
+	quat_vecRot(&dvEst, &qState);
+	dvEst.z += EARTH_G * dt;
 
 	/* Integrating z acceleration as is. Low impact from attitude error */
-	*matrix_at(state_est, VZ, 0) = kmn_vecAt(state, VZ) + aEst.z * dt;
-	*matrix_at(state_est, VX, 0) = kmn_vecAt(state, VX) + aEst.x * dt;
-	*matrix_at(state_est, VY, 0) = kmn_vecAt(state, VY) + aEst.y * dt;
+	*matrix_at(state_est, VZ, 0) = kmn_vecAt(state, VZ) + dvEst.z;
+	*matrix_at(state_est, VX, 0) = kmn_vecAt(state, VX) + dvEst.x;
+	*matrix_at(state_est, VY, 0) = kmn_vecAt(state, VY) + dvEst.y;
 
 	/* accelerometer bias estimation: SIMPLIFICATION: we use constant value as prediction */
 	*matrix_at(state_est, BAX, 0) = kmn_vecAt(state, BAX);
@@ -350,51 +528,50 @@ static void kmn_stateEst(matrix_t *state, matrix_t *state_est, matrix_t *U, time
 
 
 /* prediction step jacobian calculation function */
-static void kmn_predJcb(matrix_t *F, matrix_t *state, matrix_t *U, time_t timeStep)
+static void kmn_predJcb(void *model, matrix_t *F, matrix_t *state, matrix_t *U, time_t timeStep)
 {
+	kmn_ctx_t *kmn = model;
+
 	const quat_t qState = { .a = kmn_vecAt(state, QA), .i = kmn_vecAt(state, QB), .j = kmn_vecAt(state, QC), .k = kmn_vecAt(state, QD) };
 	const quat_t bwState = { .a = 0, .i = kmn_vecAt(state, BWX), .j = kmn_vecAt(state, BWY), .k = kmn_vecAt(state, BWZ) };
 	const vec_t baState = { .x = kmn_vecAt(state, BAX), .y = kmn_vecAt(state, BAY), .z = kmn_vecAt(state, BAZ) };
 
-	const quat_t wMeas = { .a = 0, .i = kmn_vecAt(U, UWX), .j = kmn_vecAt(U, UWY), .k = kmn_vecAt(U, UWZ) };
-	const vec_t aMeas = { .x = kmn_vecAt(U, UAX), .y = kmn_vecAt(U, UAY), .z = kmn_vecAt(U, UAZ) };
+	const quat_t dqMeas = { .a = kmn_vecAt(U, UQA), .i = kmn_vecAt(U, UQB), .j = kmn_vecAt(U, UQC), .k = kmn_vecAt(U, UQD) };
+	const vec_t dvMeas = { .x = kmn_vecAt(U, UVX), .y = kmn_vecAt(U, UVY), .z = kmn_vecAt(U, UVZ) };
 
-	const float dt = (float)timeStep / 1000000;
+	const float dt = kmn_vecAt(U, UDT);
 
-	/* d(f_q)/d(q) variables */
-	float dfqdqData[4 * 4];
-	matrix_t dfqdq = { .data = dfqdqData, .rows = 4, .cols = 4, .transposed = 0 };
-	quat_t p; /* quaternion derivative product second term */
+	/* d(f_q)/d(q) variables, computed directly in F */
+	matrix_t dfqdq;
+	quat_t p, qBias; /* quaternion derivative product second term */
 
-	/* d(f_q)/d(bw) variables */
-	float dfqdbwData[4 * 3];
-	matrix_t dfqdbw = { .data = dfqdbwData, .rows = 4, .cols = 3, .transposed = 0 };
-	vec_t aTrue; /* measured acceleration without bias */
+	/* d(f_q)/d(bw) variables, computed directly in F */
+	matrix_t dfqdbw;
+	quat_t qdq;   /* attitude rotated by preintegrated rotation */
+	vec_t dvTrue;  /* preintegrated velocity change without bias */
 
 	/* d(f_v)/d(q) variables */
 	float dfvdqData[3 * 4];
 	matrix_t dfvdq = { .data = dfvdqData, .rows = 3, .cols = 4, .transposed = 0 };
 
-	/* d(f_v)/d(ba) variables */
-	float dfvdbaData[3 * 3];
-	matrix_t dfvdba = { .data = dfvdbaData, .rows = 3, .cols = 3, .transposed = 0 };
+	/* d(f_v)/d(ba) variables, computed directly in F */
+	matrix_t dfvdba;
+
+	matrix_view(F, QA, QA, 4, 4, &dfqdq);
+	matrix_view(F, QA, BWX, 4, 3, &dfqdbw);
+	matrix_view(F, VX, BAX, 3, 3, &dfvdba);
 
 	/* d(f_q)/d(q) calculations */
-	quat_dif(&wMeas, &bwState, &p);
-	quat_times(&p, dt / 2);
-	p.a = 1;
+	qBias = bwState;
+	quat_times(&qBias, -dt / 2);
+	qBias.a = 1;
+	quat_mlt(&dqMeas, &qBias, &p);
 	qvdiff_qpDiffQ(&p, &dfqdq);
-	/* d(f_q)/d(q) write into F */
-	matrix_writeSubmatrix(F, QA, QA, &dfqdq);
 
 	/* d(f_q)/d(bw) calculations */
-	qvdiff_qpDiffP(&qState, &dfqdbw);
+	quat_mlt(&qState, &dqMeas, &qdq);
+	qvdiff_qpDiffP(&qdq, &dfqdbw);
 	matrix_times(&dfqdbw, -dt / 2);
-	/* d(f_q)/d(b_w) write into F */
-	matrix_writeSubmatrix(F, QA, BWX, &dfqdbw);
-
-	/* d(f_bw)/d(bw) calculations */
-	*matrix_at(F, BWX, BWX) = *matrix_at(F, BWY, BWY) = *matrix_at(F, BWZ, BWZ) = 1;
 
 	/*
 	* DISABLED USE OF POSITION DERIVATIVES
@@ -402,40 +579,91 @@ static void kmn_predJcb(matrix_t *F, matrix_t *state, matrix_t *U, time_t timeSt
 	*/
 
 	/* d(f_v)/d(q) calculations */
-	vec_dif(&aMeas, &baState, &aTrue);
-	qvdiff_qvqDiffQ(&qState, &aTrue, &dfvdq);
-	matrix_times(&dfvdq, 2 * dt);
+	dvTrue = baState;
+	vec_times(&dvTrue, -dt);
+	vec_add(&dvTrue, &dvMeas);
+	qvdiff_qvqDiffQ(&qState, &dvTrue, &dfvdq);
+	matrix_times(&dfvdq, 2);
 	/* d(f_v)/d(q) write into F */
 	/* matrix_writeSubmatrix(F, VX, QA, &dfvdq); */
 
 	/* d(f_v)/d(ba) calculations */
 	qvdiff_qvqDiffV(&qState, &dfvdba);
 	matrix_times(&dfvdba, -dt);
-	/* d(f_v)/d(ba) write into F */
-	matrix_writeSubmatrix(F, VX, BAX, &dfvdba);
 
-	/* d(f_v)/d(v) calculations */
-	*matrix_at(F, VX, VX) = *matrix_at(F, VY, VY) = *matrix_at(F, VZ, VZ) = 1;
+	/* d(f_r)/d(v), identities of biases, velocity and position are written once by kmn_predJcbInit() */
+	if (dt != kmn->jcbDt) {
+		*matrix_at(F, RX, VX) = *matrix_at(F, RY, VY) = *matrix_at(F, RZ, VZ) = dt;
+		kmn->jcbDt = dt;
+	}
+}
 
-	/* d(f_ba)/d(ba) calculations */
+
+/* marks with ones `rows` x `cols` block of M at (`row`, `col`) */
+static void kmn_blockMark(matrix_t *M, unsigned int row, unsigned int col, unsigned int rows, unsigned int cols)
+{
+	unsigned int i, j;
+
+	for (i = 0; i < rows; i++) {
+		for (j = 0; j < cols; j++) {
+			*matrix_at(M, row + i, col + j) = 1;
+		}
+	}
+}
+
+
+/* writes ones to every element of F that can be set by kmn_predJcb(), regardless of state values. Must be kept consistent with it */
+static void kmn_predJcbPattern(matrix_t *F)
+{
+	matrix_zeroes(F);
+
+	/* d(f_q)/d(q) and d(f_q)/d(bw) */
+	kmn_blockMark(F, QA, QA, 4, 4);
+	kmn_blockMark(F, QA, BWX, 4, 3);
+
+	/* d(f_v)/d(ba) */
+	kmn_blockMark(F, VX, BAX, 3, 3);
+
+	/* identities of biases, velocity and position, d(f_r)/d(v) */
+	*matrix_at(F, BWX, BWX) = *matrix_at(F, BWY, BWY) = *matrix_at(F, BWZ, BWZ) = 1;
+	*matrix_at(F, VX, VX) = *matrix_at(F, VY, VY) = *matrix_at(F, VZ, VZ) = 1;
 	*matrix_at(F, BAX, BAX) = *matrix_at(F, BAY, BAY) = *matrix_at(F, BAZ, BAZ) = 1;
+	*matrix_at(F, RX, RX) = *matrix_at(F, RY, RY) = *matrix_at(F, RZ, RZ) = 1;
+	*matrix_at(F, RX, VX) = *matrix_at(F, RY, VY) = *matrix_at(F, RZ, VZ) = 1;
+}
 
-	/* d(f_r)/d(r) and d(f_r)/d(v) */
+
+/* writes elements of F that do not depend on state and time step, other elements are zeroed */
+static void kmn_predJcbInit(kmn_ctx_t *kmn, matrix_t *F)
+{
+	matrix_zeroes(F);
+
+	/* d(f_bw)/d(bw), d(f_v)/d(v), d(f_ba)/d(ba) and d(f_r)/d(r) */
+	*matrix_at(F, BWX, BWX) = *matrix_at(F, BWY, BWY) = *matrix_at(F, BWZ, BWZ) = 1;
+	*matrix_at(F, VX, VX) = *matrix_at(F, VY, VY) = *matrix_at(F, VZ, VZ) = 1;
+	*matrix_at(F, BAX, BAX) = *matrix_at(F, BAY, BAY) = *matrix_at(F, BAZ, BAZ) = 1;
 	*matrix_at(F, RX, RX) = *matrix_at(F, RY, RY) = *matrix_at(F, RZ, RZ) = 1;
-	*matrix_at(F, RX, VX) = *matrix_at(F, RY, VY) = *matrix_at(F, RZ, VZ) = dt;
+
+	kmn->jcbDt = 0;
 }
 
 
-static void kmn_getNoiseQ(matrix_t *state, matrix_t *U, matrix_t *Q, time_t timestep)
+/*
+ * Q elements outside of the quaternion block and the diagonal are zeroed once in kmn_predInit().
+ * Noise is accumulated over preintegration interval `UDT`, so `timestep` of the loop is not used here.
+ */
+static void kmn_getNoiseQ(void *model, matrix_t *state, matrix_t *U, matrix_t *Q, time_t timestep)
 {
-	/* Submatrix for quaternion process noise */
-	float qNoiseData[4 * 4] = { 0 };
-	matrix_t qNoise = { .data = qNoiseData, .rows = 4, .cols = 4, .transposed = 0 };
+	kmn_ctx_t *kmn = model;
+
+	/* Submatrix of Q for quaternion process noise */
+	matrix_t qNoise;
 
 	const quat_t q = { .a = kmn_vecAt(state, QA), .i = kmn_vecAt(state, QB), .j = kmn_vecAt(state, QC), .k = kmn_vecAt(state, QD) };
-	const float dtSq = ((float)timestep / 1000000.f) * ((float)timestep / 1000000.f);
+	const float dt = kmn_vecAt(U, UDT);
+	const float dtSq = dt * dt;
 
-	matrix_zeroes(Q);
+	matrix_view(Q, QA, QA, 4, 4, &qNoise);
 
 	/* QUATERNION PROCESS NOISE: diagonal terms */
 	*matrix_at(&qNoise, 0, 0) = 1 - q.a * q.a;
@@ -451,19 +679,24 @@ static void kmn_getNoiseQ(matrix_t *state, matrix_t *U, matrix_t *Q, time_t time
 	*matrix_at(&qNoise, 1, 3) = *matrix_at(&qNoise, 3, 1) = -q.i * q.k;
 	*matrix_at(&qNoise, 2, 3) = *matrix_at(&qNoise, 3, 2) = -q.j * q.k;
 
-	matrix_times(&qNoise, pred_common.inits->Q_wstdev * pred_common.inits->Q_wstdev * dtSq / 4);
-	matrix_writeSubmatrix(Q, QA, QA, &qNoise);
+	matrix_times(&qNoise, kmn->inits->Q_wstdev * kmn->inits->Q_wstdev * dtSq / 4);
+
+	/* remaining terms depend only on time step */
+	if (dt == kmn->noiseDt) {
+		return;
+	}
+	kmn->noiseDt = dt;
 
 	/* GYRO BIAS PROCESS NOISE */
-	*matrix_at(Q, BWX, BWX) = *matrix_at(Q, BWY, BWY) = *matrix_at(Q, BWZ, BWZ) = pred_common.inits->Q_bwDotstdev * pred_common.inits->Q_bwDotstdev * dtSq;
+	*matrix_at(Q, BWX, BWX) = *matrix_at(Q, BWY, BWY) = *matrix_at(Q, BWZ, BWZ) = kmn->inits->Q_bwDotstdev * kmn->inits->Q_bwDotstdev * dtSq;
 
 	/* VELOCITY PROCESS NOISE: only diagonal terms */
-	*matrix_at(Q, VX, VX) = *matrix_at(Q, VY, VY) = *matrix_at(Q, VZ, VZ) = dtSq * pred_common.inits->Q_astdev * pred_common.inits->Q_astdev;
+	*matrix_at(Q, VX, VX) = *matrix_at(Q, VY, VY) = *matrix_at(Q, VZ, VZ) = dtSq * kmn->inits->Q_astdev * kmn->inits->Q_astdev;
 
 	/* ACCEL BIAS PROCESS NOISE */
-	*matrix_at(Q, BAX, BAX) = *matrix_at(Q, BAY, BAY) = *matrix_at(Q, BAZ, BAZ) = pred_common.inits->Q_baDotstdev * pred_common.inits->Q_baDotstdev * dtSq;
+	*matrix_at(Q, BAX, BAX) = *matrix_at(Q, BAY, BAY) = *matrix_at(Q, BAZ, BAZ) = kmn->inits->Q_baDotstdev * kmn->inits->Q_baDotstdev * dtSq;
 
-	*matrix_at(Q, RX, RX) = *matrix_at(Q, RY, RY) = *matrix_at(Q, RZ, RZ) = (dtSq * pred_common.inits->Q_astdev) * (dtSq * pred_common.inits->Q_astdev);
+	*matrix_at(Q, RX, RX) = *matrix_at(Q, RY, RY) = *matrix_at(Q, RZ, RZ) = (dtSq * kmn->inits->Q_astdev) * (dtSq * kmn->inits->Q_astdev);
 }
 
 
@@ -520,19 +753,77 @@ static void kmn_initCov(matrix_t *cov, const kalman_init_t *inits)
 
 
 /* initialization of prediction step matrix values */
-void kmn_predInit(state_engine_t *engine, const meas_calib_t *calib, const kalman_init_t *inits)
+int kmn_predInit(state_engine_t *engine, kmn_ctx_t *kmn, const meas_calib_t *calib)
 {
-	pred_common.inits = inits;
+	const kalman_init_t *inits = kmn->inits;
+
+	/* sparsity of F is fixed by the model, F is overwritten by jacobian in each prediction */
+	kmn_predJcbPattern(&engine->F);
+	if (matrix_sparsityAlloc(&engine->Fpattern, &engine->F) != 0) {
+		return -1;
+	}
+	kmn_predJcbInit(kmn, &engine->F);
 
 	kmn_initState(&engine->state, calib);
 	kmn_initCov(&engine->cov, inits);
 
-	/* prepare noise matrix Q */
+	/* covariance is kept packed, it is symmetric and only its upper triangle is computed anyway */
+	engine->packedCov = true;
+	matrix_symPack(&engine->cov, &engine->covSym);
+
+	/* prepare noise matrix Q, its time step dependent terms are written by first kmn_getNoiseQ() call */
 	matrix_zeroes(&engine->Q);
+	kmn->noiseDt = -1;
+
+	if (kalman_covDecimSet(engine, inits->covDecim) != 0) {
+		return -1;
+	}
 
 	/* save function pointers */
 	engine->estimateState = kmn_stateEst;
 	engine->getJacobian = kmn_predJcb;
 	engine->getControl = kmn_getCtrl;
 	engine->getNoiseQ = kmn_getNoiseQ;
+	engine->model = kmn;
+
+	return 0;
+}
+
+
+void kmn_warmGet(const state_engine_t *engine, float *state, float *cov)
+{
+	matrix_sym_t covSym = { .n = STATE_LENGTH, .data = cov };
+
+	memcpy(state, engine->state.data, sizeof(float) * STATE_LENGTH);
+
+	if (engine->packedCov) {
+		memcpy(cov, engine->covSym.data, sizeof(float) * MATRIX_SYM_LEN(STATE_LENGTH));
+	}
+	else {
+		matrix_symPack(&engine->cov, &covSym);
+	}
+}
+
+
+void kmn_warmSet(state_engine_t *engine, const kalman_init_t *inits, const float *state, const float *cov)
+{
+	const matrix_sym_t covSym = { .n = STATE_LENGTH, .data = (float *)cov };
+	unsigned int i, j;
+
+	memcpy(engine->state.data, state, sizeof(float) * STATE_LENGTH);
+	matrix_symUnpack(&covSym, &engine->cov);
+
+	/* vehicle is known to be stationary, so velocity starts from zero with its initial uncertainty */
+	for (i = VX; i <= VZ; i++) {
+		*matrix_at(&engine->state, i, 0) = 0;
+
+		for (j = 0; j < STATE_LENGTH; j++) {
+			*matrix_at(&engine->cov, i, j) = *matrix_at(&engine->cov, j, i) = 0;
+		}
+		*matrix_at(&engine->cov, i, i) = inits->P_verr;
+	}
+
+	if (engine->packedCov) {
+		matrix_symPack(&engine->cov, &engine->covSym);
+	}
 }
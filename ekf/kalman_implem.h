@@ -32,9 +32,16 @@
 
 #define DEG2RAD 0.0174532925
 
+/* Default minimal periods between update steps in microseconds, used if `UPDATE_RATE` header of `ekf.conf` does not set them */
+#define IMU_UPDATE_TIMEOUT  0
 #define BARO_UPDATE_TIMEOUT 40000
 #define GPS_UPDATE_TIMEOUT  200000
 
+/* Default calibration timeouts in microseconds, 0 means no limit */
+#define IMU_CALIB_TIMEOUT  30000000
+#define BARO_CALIB_TIMEOUT 30000000
+#define GPS_CALIB_TIMEOUT  120000000
+
 /* If the difference between EARTH_G and acceleration length is beyond ACC_SIGMA_THRESHOLD the accelSigma is multiplied by ACC_SIGMA_STEP_FACTOR */
 #define ACC_SIGMA_STEP_THRESHOLD 1.f
 #define ACC_SIGMA_STEP_FACTOR    100
@@ -46,7 +53,7 @@
 /* */
 
 #define STATE_LENGTH     16
-#define CTRL_LENGTH      6
+#define CTRL_LENGTH      8
 #define MEAS_IMU_LENGTH  6
 #define MEAS_BARO_LENGTH 1
 #define MEAS_GPS_LENGTH  4
@@ -75,13 +82,15 @@
 #define RZ 15 /* position z component */
 
 
-/* control vector u */
-#define UWX 0
-#define UWY 1
-#define UWZ 2
-#define UAX 3
-#define UAY 4
-#define UAZ 5
+/* control vector u: IMU data preintegrated since previous prediction */
+#define UQA 0 /* body frame rotation quaternion real part */
+#define UQB 1 /* body frame rotation quaternion i part */
+#define UQC 2 /* body frame rotation quaternion j part */
+#define UQD 3 /* body frame rotation quaternion k part */
+#define UVX 4 /* body frame velocity change x component */
+#define UVY 5 /* body frame velocity change y component */
+#define UVZ 6 /* body frame velocity change z component */
+#define UDT 7 /* integration interval in seconds */
 
 /* IMU measurement vector indexes */
 #define MGX 0
@@ -113,6 +122,12 @@
 #define KMN_USLEEP_MIN  200
 #define KMN_USLEEP_INCR 1
 
+/* Kalman loop modes */
+#define KMN_LOOP_EVENT 0 /* iteration starts when new IMU data is ready */
+#define KMN_LOOP_SLEEP 1 /* iteration starts after sleep tuned to keep loop time within KMN_LOOP_US_MIN..KMN_LOOP_US_MAX */
+
+#define KMN_IMU_WAIT_TIMEOUT 10000 /* maximal wait for IMU data in event loop mode in microseconds */
+
 #define MAX_PATH_LEN 200
 
 
@@ -149,15 +164,46 @@ typedef struct {
 	float Q_baDotstdev;
 	float Q_bwDotstdev;
 
+	/* Minimal periods between update steps in microseconds, 0 means update on every new measurement */
+	time_t imuUpdatePeriod;
+	time_t baroUpdatePeriod;
+	time_t gpsUpdatePeriod;
+
+	/* Maximal durations of sensor calibrations in microseconds, 0 means no limit */
+	time_t imuCalibTimeout;
+	time_t baroCalibTimeout;
+	time_t gpsCalibTimeout;
+
 	/* Misc */
+	int loopMode;     /* KMN_LOOP_EVENT or KMN_LOOP_SLEEP */
+	int covDecim;     /* covariance is propagated once per `covDecim` predictions and before each update step */
+	char warmFile[MAX_PATH_LEN + 1]; /* calibration and state are persisted here for warm start, empty if disabled */
 	float magDeclSin; /* sine of magnetic field declination */
 	float magDeclCos; /* cosine of magnetic field declination */
 } kalman_init_t;
 
 
-/* Function reads ekf configuration file under `path` and fills structure pointed by `initVals`  */
+/* Model data of one filter instance, passed as `model` to callbacks of its prediction and update engines */
+typedef struct {
+	const kalman_init_t *inits;
+	meas_ctx_t *meas;
+
+	/* terms of F and Q that depend only on time step are rewritten only when it changes */
+	float jcbDt;      /* time step of F position terms */
+	float noiseDt;    /* time step of Q diagonal terms, -1 if not written yet */
+
+	/* GPS velocity is derived from consecutive positions */
+	meas_gps_t gpsDataLast;
+	int gpsFirstMeas;
+} kmn_ctx_t;
+
+
+/* Function reads ekf configuration file under `path` and fills structure pointed by `initVals`. Calls are serialized */
 extern int kmn_configRead(const char *configFile, kalman_init_t *initVals);
 
+/* Sets numeric field of `initVals` named as `HEADER/field` of `ekf.conf`, e.g. `Q_MATRIX/wstdev`. Returns -1 on unknown name */
+extern int kmn_paramSet(kalman_init_t *initVals, const char *name, float value);
+
 /* Reads from a matrix like from a untransposed column vector directly. Invalid read returns 0.f */
 static inline float kmn_vecAt(const matrix_t *M, unsigned int i)
 {
@@ -167,17 +213,25 @@ static inline float kmn_vecAt(const matrix_t *M, unsigned int i)
 
 /* PHMATRIX MATRICES INITIALIZATIONS */
 
+/* Engine composers use `kmn` with `inits` and `meas` set as the model of composed engine */
+
 /* initializes matrices related to state prediction step of kalman filter */
-extern void kmn_predInit(state_engine_t *engine, const meas_calib_t *calib, const kalman_init_t *inits);
+extern int kmn_predInit(state_engine_t *engine, kmn_ctx_t *kmn, const meas_calib_t *calib);
+
+/* Writes state vector and packed upper triangle of state covariance of initialized prediction `engine` to `state` and `cov` */
+extern void kmn_warmGet(const state_engine_t *engine, float *state, float *cov);
+
+/* Restores state and covariance written by kmn_warmGet() to `engine` initialized with kmn_predInit(). Velocity is reset to zero */
+extern void kmn_warmSet(state_engine_t *engine, const kalman_init_t *inits, const float *state, const float *cov);
 
 /* imu update engine composer */
-extern void kmn_imuEngInit(update_engine_t *engine, const kalman_init_t *inits);
+extern int kmn_imuEngInit(update_engine_t *engine, kmn_ctx_t *kmn);
 
 /* barometer update engine composer */
-extern void kmn_baroEngInit(update_engine_t *engine, const kalman_init_t *inits);
+extern int kmn_baroEngInit(update_engine_t *engine, kmn_ctx_t *kmn);
 
 /* GPS update engine composer */
-extern void kmn_gpsEngInit(update_engine_t *engine, const kalman_init_t *inits);
+extern int kmn_gpsEngInit(update_engine_t *engine, kmn_ctx_t *kmn);
 
 
 #endif
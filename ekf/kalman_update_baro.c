@@ -32,19 +32,20 @@
 
 
 /* Returns pointer to passed Z matrix filled with newest measurements vector */
-static matrix_t *getMeasurement(matrix_t *Z, matrix_t *state, matrix_t *R, time_t timeStep)
+static matrix_t *getMeasurement(void *model, matrix_t *Z, matrix_t *state, matrix_t *R, time_t timeStep)
 {
+	kmn_ctx_t *kmn = model;
 	float pressure, temp, alt;
 	uint64_t currTstamp;
 
 	/* if there is no pressure measurement available return NULL */
-	if (meas_baroGet(&pressure, &temp, &currTstamp) < 0) {
+	if (meas_baroGet(kmn->meas, &pressure, &temp, &currTstamp) < 0) {
 		return NULL;
 	}
 
 	/* Make measurements negative to account for NED frame convention */
-	alt = -8453.669 * log(meas_calibPressGet() / pressure);
-	fltr_vBaroLpf(&alt);
+	alt = -8453.669 * log(meas_calibPressGet(kmn->meas) / pressure);
+	fltr_vBaroLpf(&kmn->meas->fltr, &alt);
 
 	Z->data[MRZ] = alt;
 
@@ -52,7 +53,7 @@ static matrix_t *getMeasurement(matrix_t *Z, matrix_t *state, matrix_t *R, time_
 }
 
 
-static matrix_t *getMeasurementPrediction(matrix_t *state_est, matrix_t *hx, time_t timestep)
+static matrix_t *getMeasurementPrediction(void *model, matrix_t *state_est, matrix_t *hx, time_t timestep)
 {
 	hx->data[MRZ] = kmn_vecAt(state_est, RZ);
 
@@ -60,7 +61,7 @@ static matrix_t *getMeasurementPrediction(matrix_t *state_est, matrix_t *hx, tim
 }
 
 
-static void getMeasurementPredictionJacobian(matrix_t *H, matrix_t *state, time_t timeStep)
+static void getMeasurementPredictionJacobian(void *model, matrix_t *H, matrix_t *state, time_t timeStep)
 {
 	matrix_zeroes(H);
 
@@ -77,15 +78,27 @@ static void baroUpdateInitializations(matrix_t *H, matrix_t *R, const kalman_ini
 }
 
 
-void kmn_baroEngInit(update_engine_t *engine, const kalman_init_t *inits)
+int kmn_baroEngInit(update_engine_t *engine, kmn_ctx_t *kmn)
 {
 	if (!engine->active) {
-		return;
+		return 0;
 	}
 
-	baroUpdateInitializations(&engine->H, &engine->R, inits);
+	baroUpdateInitializations(&engine->H, &engine->R, kmn->inits);
+
+	/* jacobian does not depend on state, so its nonzero elements are the sparsity of H */
+	getMeasurementPredictionJacobian(kmn, &engine->H, NULL, 0);
+	if (matrix_sparsityAlloc(&engine->Hpattern, &engine->H) != 0) {
+		return -1;
+	}
 
 	engine->getData = getMeasurement;
 	engine->getJacobian = getMeasurementPredictionJacobian;
 	engine->predictMeasurements = getMeasurementPrediction;
+	engine->model = kmn;
+
+	/* R is diagonal */
+	engine->sequential = true;
+
+	return 0;
 }
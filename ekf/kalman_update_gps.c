@@ -31,16 +31,14 @@
 
 
 /* Returns pointer to passed Z matrix filled with newest measurements vector */
-static matrix_t *getMeasurement(matrix_t *Z, matrix_t *state, matrix_t *R, time_t timeStep)
+static matrix_t *getMeasurement(void *model, matrix_t *Z, matrix_t *state, matrix_t *R, time_t timeStep)
 {
-	static meas_gps_t gpsDataLast;
-	static int firstMeas = 0;
-
+	kmn_ctx_t *kmn = model;
 	meas_gps_t gpsData;
 	time_t timeGps;
 
 	/* if there is no gps measurement available return NULL */
-	if (meas_gpsGet(&gpsData, &timeGps) < 0) {
+	if (meas_gpsGet(kmn->meas, &gpsData, &timeGps) < 0) {
 		return NULL;
 	}
 
@@ -48,23 +46,23 @@ static matrix_t *getMeasurement(matrix_t *Z, matrix_t *state, matrix_t *R, time_
 	Z->data[MGPSRX] = gpsData.pos.x;
 	Z->data[MGPSRY] = gpsData.pos.y;
 
-	if (firstMeas == 0) {
+	if (kmn->gpsFirstMeas == 0) {
 		Z->data[MGPSVX] = 0;
 		Z->data[MGPSVY] = 0;
-		firstMeas = 1;
+		kmn->gpsFirstMeas = 1;
 	}
 	else {
-		Z->data[MGPSVX] = (gpsData.pos.x - gpsDataLast.pos.x) / ((float)timeStep / 1000000);
-		Z->data[MGPSVY] = (gpsData.pos.y - gpsDataLast.pos.y) / ((float)timeStep / 1000000);
+		Z->data[MGPSVX] = (gpsData.pos.x - kmn->gpsDataLast.pos.x) / ((float)timeStep / 1000000);
+		Z->data[MGPSVY] = (gpsData.pos.y - kmn->gpsDataLast.pos.y) / ((float)timeStep / 1000000);
 	}
 
-	gpsDataLast = gpsData;
+	kmn->gpsDataLast = gpsData;
 
 	return Z;
 }
 
 
-static matrix_t *getMeasurementPrediction(matrix_t *state_est, matrix_t *hx, time_t timestep)
+static matrix_t *getMeasurementPrediction(void *model, matrix_t *state_est, matrix_t *hx, time_t timestep)
 {
 	hx->data[MGPSRX] = kmn_vecAt(state_est, RX);
 	hx->data[MGPSRY] = kmn_vecAt(state_est, RY);
@@ -76,7 +74,7 @@ static matrix_t *getMeasurementPrediction(matrix_t *state_est, matrix_t *hx, tim
 }
 
 
-static void getMeasurementPredictionJacobian(matrix_t *H, matrix_t *state, time_t timeStep)
+static void getMeasurementPredictionJacobian(void *model, matrix_t *H, matrix_t *state, time_t timeStep)
 {
 	*matrix_at(H, MGPSRX, RX) = 1;
 	*matrix_at(H, MGPSRY, RY) = 1;
@@ -104,15 +102,27 @@ static void gpsUpdateInitializations(matrix_t *H, matrix_t *R, const kalman_init
 }
 
 
-void kmn_gpsEngInit(update_engine_t *engine, const kalman_init_t *inits)
+int kmn_gpsEngInit(update_engine_t *engine, kmn_ctx_t *kmn)
 {
 	if (!engine->active) {
-		return;
+		return 0;
 	}
 
-	gpsUpdateInitializations(&engine->H, &engine->R, inits);
+	gpsUpdateInitializations(&engine->H, &engine->R, kmn->inits);
+
+	/* jacobian does not depend on state, so its nonzero elements are the sparsity of H */
+	getMeasurementPredictionJacobian(kmn, &engine->H, NULL, 0);
+	if (matrix_sparsityAlloc(&engine->Hpattern, &engine->H) != 0) {
+		return -1;
+	}
 
 	engine->getData = getMeasurement;
 	engine->getJacobian = getMeasurementPredictionJacobian;
 	engine->predictMeasurements = getMeasurementPrediction;
+	engine->model = kmn;
+
+	/* R is diagonal */
+	engine->sequential = true;
+
+	return 0;
 }
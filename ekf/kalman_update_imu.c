@@ -31,20 +31,16 @@
 #include "kalman_implem.h"
 
 
-struct {
-	const kalman_init_t *inits;
-} imu_common;
-
-
 /* Returns pointer to passed Z matrix filled with newest measurements vector */
-static matrix_t *getMeasurement(matrix_t *Z, matrix_t *state, matrix_t *R, time_t timeStep)
+static matrix_t *getMeasurement(void *model, matrix_t *Z, matrix_t *state, matrix_t *R, time_t timeStep)
 {
+	kmn_ctx_t *kmn = model;
 	vec_t accel, accelRaw, mag, nedMeasE;
 	float accelSigma, accLen;
 
 	/* Get current sensor readings */
-	meas_accelGet(&accel, &accelRaw);
-	meas_magGet(&mag);
+	meas_accelGet(kmn->meas, &accel, &accelRaw);
+	meas_magGet(kmn->meas, &mag);
 
 	/* earth acceleration is measured by accelerometer UPWARD, which in NED is negative */
 	accel.x = -accel.x;
@@ -55,7 +51,7 @@ static matrix_t *getMeasurement(matrix_t *Z, matrix_t *state, matrix_t *R, time_
 	accelRaw.z = -accelRaw.z;
 
 	/* calculate acceleration uncertainty. Bloat the uncertainty if acceleration value is beyond threshold */
-	accelSigma = imu_common.inits->R_astdev * imu_common.inits->R_astdev / EARTH_G * EARTH_G;
+	accelSigma = kmn->inits->R_astdev * kmn->inits->R_astdev / EARTH_G * EARTH_G;
 	accLen = vec_len(&accel);
 	if (fabs(accLen - EARTH_G) > ACC_SIGMA_STEP_THRESHOLD) {
 		accelSigma *= ACC_SIGMA_STEP_FACTOR;
@@ -82,11 +78,13 @@ static matrix_t *getMeasurement(matrix_t *Z, matrix_t *state, matrix_t *R, time_
 }
 
 
-static matrix_t *getMeasurementPrediction(matrix_t *state_est, matrix_t *hx, time_t timestep)
+static matrix_t *getMeasurementPrediction(void *model, matrix_t *state_est, matrix_t *hx, time_t timestep)
 {
+	kmn_ctx_t *kmn = model;
+
 	/* gravity versor and east versor in NED frame of reference */
 	vec_t nedMeasG = { .x = 0, .y = 0, .z = 1 };
-	vec_t nedMeasE = { .x = -imu_common.inits->magDeclSin, .y = imu_common.inits->magDeclCos, .z = 0 };
+	vec_t nedMeasE = { .x = -kmn->inits->magDeclSin, .y = kmn->inits->magDeclCos, .z = 0 };
 
 	/* Taking conjugation of quaternion as it should rotate from inertial frame to body frame */
 	const quat_t qState = {.a = kmn_vecAt(state_est, QA), .i = -kmn_vecAt(state_est, QB), .j = -kmn_vecAt(state_est, QC), .k = -kmn_vecAt(state_est, QD)};
@@ -108,61 +106,84 @@ static matrix_t *getMeasurementPrediction(matrix_t *state_est, matrix_t *hx, tim
 }
 
 
-static void getMeasurementPredictionJacobian(matrix_t *H, matrix_t *state, time_t timeStep)
+static void getMeasurementPredictionJacobian(void *model, matrix_t *H, matrix_t *state, time_t timeStep)
 {
+	kmn_ctx_t *kmn = model;
 	const quat_t qState = {.a = kmn_vecAt(state, QA), .i = kmn_vecAt(state, QB), .j = kmn_vecAt(state, QC), .k = kmn_vecAt(state, QD)};
-	const vec_t nedMeasE = { .x = -imu_common.inits->magDeclSin, .y = imu_common.inits->magDeclCos, .z = 0 };
-
-	float dgdqData[3 * 4];
-	matrix_t dgdq = { .data = dgdqData, .rows = 3, .cols = 4, .transposed = 0 };
+	const vec_t nedMeasE = { .x = -kmn->inits->magDeclSin, .y = kmn->inits->magDeclCos, .z = 0 };
 
-	float dedqData[3 * 4];
-	matrix_t dedq = { .data = dedqData, .rows = 3, .cols = 4, .transposed = 0 };
+	/* Jacobian blocks are computed directly in H */
+	matrix_t dgdq, dedq;
 
 	matrix_zeroes(H);
+	matrix_view(H, MGX, QA, 3, 4, &dgdq);
+	matrix_view(H, MEX, QA, 3, 4, &dedq);
 
 	/* Derivative of rotated earth acceleration with respect to quaternion */
-	dgdq.data[5] = dgdq.data[8] = qState.a;
-	dgdq.data[2] = -qState.a;
-	dgdq.data[3] = dgdq.data[4] = qState.i;
-	dgdq.data[9] = -qState.i;
-	dgdq.data[7] = qState.j;
-	dgdq.data[10] = dgdq.data[0] = -qState.j;
-	dgdq.data[1] = dgdq.data[6] = dgdq.data[11] = qState.k;
+	MATRIX_DATA(&dgdq, 1, 1) = MATRIX_DATA(&dgdq, 2, 0) = qState.a;
+	MATRIX_DATA(&dgdq, 0, 2) = -qState.a;
+	MATRIX_DATA(&dgdq, 0, 3) = MATRIX_DATA(&dgdq, 1, 0) = qState.i;
+	MATRIX_DATA(&dgdq, 2, 1) = -qState.i;
+	MATRIX_DATA(&dgdq, 1, 3) = qState.j;
+	MATRIX_DATA(&dgdq, 2, 2) = MATRIX_DATA(&dgdq, 0, 0) = -qState.j;
+	MATRIX_DATA(&dgdq, 0, 1) = MATRIX_DATA(&dgdq, 1, 2) = MATRIX_DATA(&dgdq, 2, 3) = qState.k;
 	matrix_times(&dgdq, 2);
 
 	/* Derivative of rotated east versor with respect to quaternion */
 	qvdiff_cqvqDiffQ(&qState, &nedMeasE, &dedq);
+}
+
+
+/* writes ones to every element of H that can be set by getMeasurementPredictionJacobian(), regardless of state values. Must be kept consistent with it */
+static void imuJacobianPattern(matrix_t *H)
+{
+	unsigned int row, col;
+
+	matrix_zeroes(H);
 
-	matrix_writeSubmatrix(H, MGX, QA, &dgdq);
-	matrix_writeSubmatrix(H, MEX, QA, &dedq);
+	/* both measured vectors depend only on attitude quaternion */
+	for (row = MGX; row <= MEZ; row++) {
+		for (col = QA; col <= QD; col++) {
+			*matrix_at(H, row, col) = 1;
+		}
+	}
 }
 
 
 /* initialization function for IMU update step matrices values */
-static void imuUpdateInitializations(matrix_t *H, matrix_t *R)
+static void imuUpdateInitializations(matrix_t *H, matrix_t *R, const kalman_init_t *inits)
 {
 	matrix_zeroes(R);
 
 	/* Noise terms of acceleration measurement */
-	*matrix_at(R, MGX, MGX) = *matrix_at(R, MGY, MGY) = *matrix_at(R, MGZ, MGZ) = imu_common.inits->R_astdev * imu_common.inits->R_astdev / (EARTH_G * EARTH_G);
+	*matrix_at(R, MGX, MGX) = *matrix_at(R, MGY, MGY) = *matrix_at(R, MGZ, MGZ) = inits->R_astdev * inits->R_astdev / (EARTH_G * EARTH_G);
 
 	/* Noise terms of east versor measurement */
-	*matrix_at(R, MEX, MEX) = *matrix_at(R, MEY, MEY) = *matrix_at(R, MEZ, MEZ) = imu_common.inits->R_mstdev * imu_common.inits->R_mstdev;
+	*matrix_at(R, MEX, MEX) = *matrix_at(R, MEY, MEY) = *matrix_at(R, MEZ, MEZ) = inits->R_mstdev * inits->R_mstdev;
 }
 
 
-void kmn_imuEngInit(update_engine_t *engine, const kalman_init_t *inits)
+int kmn_imuEngInit(update_engine_t *engine, kmn_ctx_t *kmn)
 {
 	if (!engine->active) {
-		return;
+		return 0;
 	}
 
-	imu_common.inits = inits;
+	/* sparsity of H is fixed by the model, H is overwritten by jacobian in each update */
+	imuJacobianPattern(&engine->H);
+	if (matrix_sparsityAlloc(&engine->Hpattern, &engine->H) != 0) {
+		return -1;
+	}
 
-	imuUpdateInitializations(&engine->H, &engine->R);
+	imuUpdateInitializations(&engine->H, &engine->R, kmn->inits);
 
 	engine->getData = getMeasurement;
 	engine->getJacobian = getMeasurementPredictionJacobian;
 	engine->predictMeasurements = getMeasurementPrediction;
+	engine->model = kmn;
+
+	/* R is diagonal */
+	engine->sequential = true;
+
+	return 0;
 }
@@ -26,8 +26,6 @@
 #define LOG_TIMESTAMP_SIZE  sizeof(time_t)
 #define LOG_PREFIX_SIZE     (LOG_ID_SIZE + LOG_IDENTIFIER_SIZE + LOG_TIMESTAMP_SIZE)
 
-#define LOG_TYPES_CNT 5
-
 #define TIME_LOG_INDICATOR 'T'
 #define TIME_LOG_SIZE      LOG_PREFIX_SIZE
 
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 
 
 /* clang-format off */
@@ -25,13 +26,6 @@ typedef enum { timeLog = 0, imuLog, gpsLog, baroLog, stateLog } logType_t;
 /* clang-format on */
 
 
-static struct {
-	FILE *file;
-
-	long int fileOffsets[LOG_TYPES_CNT];
-} ekflog_common;
-
-
 static void ekflog_ebadfMsg(void)
 {
 	fprintf(stderr, "Log reader: Invalid log file\n");
@@ -64,7 +58,71 @@ static ssize_t ekflog_logSizeGet(char logIndicator)
 }
 
 
-static int ekflog_logOmit(char logIndicator)
+/* File access wrappers, reading either from file or from memory buffer */
+
+static int ekflog_seek(ekflog_reader_t *reader, long int offset, int whence)
+{
+	long int pos;
+
+	if (reader->file != NULL) {
+		return fseek(reader->file, offset, whence);
+	}
+
+	pos = (whence == SEEK_CUR) ? reader->bufPos + offset : offset;
+	if ((whence != SEEK_CUR && whence != SEEK_SET) || pos < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+	reader->bufPos = pos;
+
+	return 0;
+}
+
+
+static int ekflog_getc(ekflog_reader_t *reader)
+{
+	if (reader->file != NULL) {
+		return fgetc(reader->file);
+	}
+
+	if (reader->bufPos >= (long int)reader->bufSize) {
+		return EOF;
+	}
+
+	return reader->buf[reader->bufPos++];
+}
+
+
+/* Reads `size` bytes to `ptr`. Returns 1 on success, 0 otherwise as fread() with single element */
+static size_t ekflog_read(ekflog_reader_t *reader, void *ptr, size_t size)
+{
+	if (reader->file != NULL) {
+		return fread(ptr, size, 1, reader->file);
+	}
+
+	if (reader->bufPos + size > reader->bufSize) {
+		reader->bufPos = reader->bufSize;
+		return 0;
+	}
+
+	memcpy(ptr, reader->buf + reader->bufPos, size);
+	reader->bufPos += size;
+
+	return 1;
+}
+
+
+static long int ekflog_tell(ekflog_reader_t *reader)
+{
+	if (reader->file != NULL) {
+		return ftell(reader->file);
+	}
+
+	return reader->bufPos;
+}
+
+
+static int ekflog_logOmit(ekflog_reader_t *reader, char logIndicator)
 {
 	const ssize_t prefixLen = LOG_ID_SIZE + LOG_IDENTIFIER_SIZE; /* Without the timestamp */
 	ssize_t logSize = ekflog_logSizeGet(logIndicator);
@@ -72,27 +130,27 @@ static int ekflog_logOmit(char logIndicator)
 		return -1;
 	}
 
-	return fseek(ekflog_common.file, logSize - prefixLen, SEEK_CUR);
+	return ekflog_seek(reader, logSize - prefixLen, SEEK_CUR);
 }
 
 
-static int ekflog_nextLogSeek(char logIndicator)
+static int ekflog_nextLogSeek(ekflog_reader_t *reader, char logIndicator)
 {
 	int actIndicator;
 
 	do {
 		/* Omitting log ID */
-		if (fseek(ekflog_common.file, LOG_ID_SIZE, SEEK_CUR) != 0) {
+		if (ekflog_seek(reader, LOG_ID_SIZE, SEEK_CUR) != 0) {
 			return -1;
 		}
 
-		actIndicator = fgetc(ekflog_common.file);
+		actIndicator = ekflog_getc(reader);
 		if (actIndicator == EOF) {
 			return -1;
 		}
 
 		if (actIndicator != logIndicator) {
-			if (ekflog_logOmit(actIndicator) != 0) {
+			if (ekflog_logOmit(reader, actIndicator) != 0) {
 				ekflog_ebadfMsg();
 				return -1;
 			}
@@ -103,15 +161,15 @@ static int ekflog_nextLogSeek(char logIndicator)
 }
 
 
-static int ekflog_nextFind(logType_t logType, char logIndicator)
+static int ekflog_nextFind(ekflog_reader_t *reader, logType_t logType, char logIndicator)
 {
 	errno = 0;
 
-	if (fseek(ekflog_common.file, ekflog_common.fileOffsets[logType], SEEK_SET) != 0) {
+	if (ekflog_seek(reader, reader->fileOffsets[logType], SEEK_SET) != 0) {
 		return -1;
 	}
 
-	if (ekflog_nextLogSeek(logIndicator) != 0) {
+	if (ekflog_nextLogSeek(reader, logIndicator) != 0) {
 		return -1;
 	}
 
@@ -119,10 +177,10 @@ static int ekflog_nextFind(logType_t logType, char logIndicator)
 }
 
 
-static int ekflog_postStore(logType_t logType)
+static int ekflog_postStore(ekflog_reader_t *reader, logType_t logType)
 {
-	ekflog_common.fileOffsets[logType] = ftell(ekflog_common.file);
-	if (ekflog_common.fileOffsets[logType] < 0) {
+	reader->fileOffsets[logType] = ekflog_tell(reader);
+	if (reader->fileOffsets[logType] < 0) {
 		return EOF;
 	}
 
@@ -130,53 +188,50 @@ static int ekflog_postStore(logType_t logType)
 }
 
 
-int ekflog_timeRead(time_t *timestamp)
+int ekflog_timeRead(ekflog_reader_t *reader, time_t *timestamp)
 {
-	if (ekflog_nextFind(timeLog, TIME_LOG_INDICATOR) != 0) {
+	if (ekflog_nextFind(reader, timeLog, TIME_LOG_INDICATOR) != 0) {
 		return EOF;
 	}
 
-	if (fread(timestamp, LOG_TIMESTAMP_SIZE, 1, ekflog_common.file) != 1) {
+	if (ekflog_read(reader, timestamp, LOG_TIMESTAMP_SIZE) != 1) {
 		if (errno == 0) {
 			ekflog_ebadfMsg();
 		}
 		return EOF;
 	}
 
-	return ekflog_postStore(timeLog);
+	return ekflog_postStore(reader, timeLog);
 }
 
 
-int ekflog_imuRead(sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_t *magEvt)
+/* Reads IMU log found by ekflog_nextFind() */
+static int ekflog_imuParse(ekflog_reader_t *reader, sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_t *magEvt)
 {
 	time_t timestamp;
 
-	if (ekflog_nextFind(imuLog, IMU_LOG_INDICATOR) != 0) {
-		return EOF;
-	}
-
-	if (fread(&timestamp, sizeof(time_t), 1, ekflog_common.file) != 1) {
+	if (ekflog_read(reader, &timestamp, sizeof(time_t)) != 1) {
 		if (errno == 0) {
 			ekflog_ebadfMsg();
 		}
 		return EOF;
 	}
 
-	if (fread(&accEvt->accels, sizeof(accEvt->accels), 1, ekflog_common.file) != 1) {
+	if (ekflog_read(reader, &accEvt->accels, sizeof(accEvt->accels)) != 1) {
 		if (errno == 0) {
 			ekflog_ebadfMsg();
 		}
 		return EOF;
 	}
 
-	if (fread(&gyrEvt->gyro, sizeof(gyrEvt->gyro), 1, ekflog_common.file) != 1) {
+	if (ekflog_read(reader, &gyrEvt->gyro, sizeof(gyrEvt->gyro)) != 1) {
 		if (errno == 0) {
 			ekflog_ebadfMsg();
 		}
 		return EOF;
 	}
 
-	if (fread(&magEvt->mag, sizeof(magEvt->mag), 1, ekflog_common.file) != 1) {
+	if (ekflog_read(reader, &magEvt->mag, sizeof(magEvt->mag)) != 1) {
 		if (errno == 0) {
 			ekflog_ebadfMsg();
 		}
@@ -192,24 +247,69 @@ int ekflog_imuRead(sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_
 	magEvt->type = SENSOR_TYPE_MAG;
 	magEvt->timestamp = timestamp;
 
-	return ekflog_postStore(imuLog);
+	return ekflog_postStore(reader, imuLog);
+}
+
+
+int ekflog_imuRead(ekflog_reader_t *reader, sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_t *magEvt)
+{
+	if (ekflog_nextFind(reader, imuLog, IMU_LOG_INDICATOR) != 0) {
+		return EOF;
+	}
+
+	return ekflog_imuParse(reader, accEvt, gyrEvt, magEvt);
+}
+
+
+int ekflog_imuBatchRead(ekflog_reader_t *reader, sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_t *magEvt, unsigned int n)
+{
+	long int timePos = LONG_MAX;
+	unsigned int cnt = 0;
+
+	/* Batch ends at the next timestamp log, or at the end of file if there is none */
+	if (ekflog_nextFind(reader, timeLog, TIME_LOG_INDICATOR) == 0) {
+		timePos = ekflog_tell(reader);
+	}
+	else if (errno != 0) {
+		return EOF;
+	}
+
+	while (cnt < n) {
+		if (ekflog_nextFind(reader, imuLog, IMU_LOG_INDICATOR) != 0) {
+			if (errno != 0) {
+				return EOF;
+			}
+			break;
+		}
+
+		if (ekflog_tell(reader) > timePos) {
+			break;
+		}
+
+		if (ekflog_imuParse(reader, &accEvt[cnt], &gyrEvt[cnt], &magEvt[cnt]) != 0) {
+			return EOF;
+		}
+		cnt++;
+	}
+
+	return (cnt > 0) ? (int)cnt : EOF;
 }
 
 
-int ekflog_gpsRead(sensor_event_t *gpsEvt)
+int ekflog_gpsRead(ekflog_reader_t *reader, sensor_event_t *gpsEvt)
 {
-	if (ekflog_nextFind(gpsLog, GPS_LOG_INDICATOR) != 0) {
+	if (ekflog_nextFind(reader, gpsLog, GPS_LOG_INDICATOR) != 0) {
 		return EOF;
 	}
 
-	if (fread(&gpsEvt->timestamp, LOG_TIMESTAMP_SIZE, 1, ekflog_common.file) != 1) {
+	if (ekflog_read(reader, &gpsEvt->timestamp, LOG_TIMESTAMP_SIZE) != 1) {
 		if (errno == 0) {
 			ekflog_ebadfMsg();
 		}
 		return EOF;
 	}
 
-	if (fread(&gpsEvt->gps, sizeof(gpsEvt->gps), 1, ekflog_common.file) != 1) {
+	if (ekflog_read(reader, &gpsEvt->gps, sizeof(gpsEvt->gps)) != 1) {
 		if (errno == 0) {
 			ekflog_ebadfMsg();
 		}
@@ -218,24 +318,24 @@ int ekflog_gpsRead(sensor_event_t *gpsEvt)
 
 	gpsEvt->type = SENSOR_TYPE_GPS;
 
-	return ekflog_postStore(gpsLog);
+	return ekflog_postStore(reader, gpsLog);
 }
 
 
-int ekflog_baroRead(sensor_event_t *baroEvt)
+int ekflog_baroRead(ekflog_reader_t *reader, sensor_event_t *baroEvt)
 {
-	if (ekflog_nextFind(baroLog, BARO_LOG_INDICATOR)) {
+	if (ekflog_nextFind(reader, baroLog, BARO_LOG_INDICATOR)) {
 		return EOF;
 	}
 
-	if (fread(&baroEvt->timestamp, LOG_TIMESTAMP_SIZE, 1, ekflog_common.file) != 1) {
+	if (ekflog_read(reader, &baroEvt->timestamp, LOG_TIMESTAMP_SIZE) != 1) {
 		if (errno == 0) {
 			ekflog_ebadfMsg();
 		}
 		return EOF;
 	}
 
-	if (fread(&baroEvt->baro, sizeof(baroEvt->baro), 1, ekflog_common.file) != 1) {
+	if (ekflog_read(reader, &baroEvt->baro, sizeof(baroEvt->baro)) != 1) {
 		if (errno == 0) {
 			ekflog_ebadfMsg();
 		}
@@ -244,55 +344,80 @@ int ekflog_baroRead(sensor_event_t *baroEvt)
 
 	baroEvt->type = SENSOR_TYPE_BARO;
 
-	return ekflog_postStore(baroLog);
+	return ekflog_postStore(reader, baroLog);
 }
 
 
-int ekflog_stateRead(matrix_t *state, time_t *timestamp)
+int ekflog_stateRead(ekflog_reader_t *reader, matrix_t *state, time_t *timestamp)
 {
-	if (ekflog_nextFind(stateLog, STATE_LOG_INDICATOR) != 0) {
+	if (ekflog_nextFind(reader, stateLog, STATE_LOG_INDICATOR) != 0) {
 		return EOF;
 	}
 
-	if (fread(timestamp, LOG_TIMESTAMP_SIZE, 1, ekflog_common.file) != 1) {
+	if (ekflog_read(reader, timestamp, LOG_TIMESTAMP_SIZE) != 1) {
 		if (errno == 0) {
 			ekflog_ebadfMsg();
 		}
 		return EOF;
 	}
 
-	if (fread(state->data, STATE_LOG_SIZE - LOG_PREFIX_SIZE, 1, ekflog_common.file) != 1) {
+	if (ekflog_read(reader, state->data, STATE_LOG_SIZE - LOG_PREFIX_SIZE) != 1) {
 		if (errno == 0) {
 			ekflog_ebadfMsg();
 		}
 		return EOF;
 	}
 
-	return ekflog_postStore(stateLog);
+	return ekflog_postStore(reader, stateLog);
+}
+
+
+int ekflog_readerInit(ekflog_reader_t *reader, const char *path)
+{
+	int i;
+
+	reader->file = fopen(path, "rb");
+	if (reader->file == NULL) {
+		return -1;
+	}
+
+	reader->buf = NULL;
+	reader->bufSize = 0;
+	reader->bufPos = 0;
+
+	for (i = 0; i < EKFLOG_READER_STREAMS; i++) {
+		reader->fileOffsets[i] = 0;
+	}
+
+	return 0;
 }
 
 
-int ekflog_readerInit(const char *path)
+int ekflog_readerBufInit(ekflog_reader_t *reader, const void *buf, size_t size)
 {
 	int i;
 
-	ekflog_common.file = fopen(path, "rb");
-	if (ekflog_common.file == NULL) {
+	if (buf == NULL) {
 		return -1;
 	}
 
-	for (i = 0; i < LOG_TYPES_CNT; i++) {
-		ekflog_common.fileOffsets[i] = 0;
+	reader->file = NULL;
+	reader->buf = buf;
+	reader->bufSize = size;
+	reader->bufPos = 0;
+
+	for (i = 0; i < EKFLOG_READER_STREAMS; i++) {
+		reader->fileOffsets[i] = 0;
 	}
 
 	return 0;
 }
 
 
-int ekflog_readerDone(void)
+int ekflog_readerDone(ekflog_reader_t *reader)
 {
-	if (ekflog_common.file != NULL) {
-		return fclose(ekflog_common.file);
+	if (reader->file != NULL) {
+		return fclose(reader->file);
 	}
 
 	return 0;
@@ -15,16 +15,34 @@
 #define __EKF_LOG_READER_H__
 
 
+#include <stdio.h>
+#include <stdint.h>
+
 #include <libsensors.h>
 #include <matrix.h>
 
 
+#define EKFLOG_READER_STREAMS 5 /* number of log types, each one is read from its own file offset */
+
+
+typedef struct {
+	FILE *file;
+
+	/* logs read from memory if `file` is NULL. Buffer is never written, so it can be shared by many readers */
+	const uint8_t *buf;
+	size_t bufSize;
+	long int bufPos;
+
+	long int fileOffsets[EKFLOG_READER_STREAMS];
+} ekflog_reader_t;
+
+
 /*
  * Reads next timestamp log. In case of a success returns 0.
  * If end-of-file is encountered returns EOF.
  * In case of an error returns EOF and sets appropriate errno value.
  */
-extern int ekflog_timeRead(time_t *timestamp);
+extern int ekflog_timeRead(ekflog_reader_t *reader, time_t *timestamp);
 
 
 /*
@@ -32,7 +50,16 @@ extern int ekflog_timeRead(time_t *timestamp);
  * If end-of-file is encountered returns EOF.
  * In case of an error returns EOF and sets appropriate errno value.
  */
-extern int ekflog_imuRead(sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_t *magEvt);
+extern int ekflog_imuRead(ekflog_reader_t *reader, sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_t *magEvt);
+
+
+/*
+ * Reads next IMU logs that precede the timestamp log following the last one read by ekflog_timeRead(), up to `n` of them.
+ * This way replayed loop iteration gets all IMU samples logged in the same iteration. In case of a success returns number of read logs.
+ * If there are no such logs or end-of-file is encountered returns EOF.
+ * In case of an error returns EOF and sets appropriate errno value.
+ */
+extern int ekflog_imuBatchRead(ekflog_reader_t *reader, sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_t *magEvt, unsigned int n);
 
 
 /*
@@ -40,7 +67,7 @@ extern int ekflog_imuRead(sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor
  * If end-of-file is encountered returns EOF.
  * In case of an error returns EOF and sets appropriate errno value.
  */
-extern int ekflog_gpsRead(sensor_event_t *gpsEvt);
+extern int ekflog_gpsRead(ekflog_reader_t *reader, sensor_event_t *gpsEvt);
 
 
 /*
@@ -48,19 +75,23 @@ extern int ekflog_gpsRead(sensor_event_t *gpsEvt);
  * If end-of-file is encountered returns EOF.
  * In case of an error returns EOF and sets appropriate errno value.
  */
-extern int ekflog_baroRead(sensor_event_t *baroEvt);
+extern int ekflog_baroRead(ekflog_reader_t *reader, sensor_event_t *baroEvt);
 
 
 /* Reads EKF state, State matrix have to be initiated with correct size. */
-extern int ekflog_stateRead(matrix_t *state, time_t *timestamp);
+extern int ekflog_stateRead(ekflog_reader_t *reader, matrix_t *state, time_t *timestamp);
+
+
+/* Initiates `reader`, `path` must leads to binary ekf logs file. On success returns 0. */
+extern int ekflog_readerInit(ekflog_reader_t *reader, const char *path);
 
 
-/* Initiates module, `path` must leads to binary ekf logs file. On success returns 0. */
-extern int ekflog_readerInit(const char *path);
+/* Initiates `reader` to read binary ekf logs of `size` bytes from `buf`. On success returns 0. */
+extern int ekflog_readerBufInit(ekflog_reader_t *reader, const void *buf, size_t size);
 
 
-/* Deinitialize module. On success returns 0. */
-extern int ekflog_readerDone(void);
+/* Deinitialize `reader`. On success returns 0. */
+extern int ekflog_readerDone(ekflog_reader_t *reader);
 
 
 #endif
@@ -31,9 +31,12 @@
 
 #define SHORT_SEQUENCE_LEN 10
 #define LONG_SEQUENCE_LEN  100
+#define IMU_BATCH_MAX      4
 
 
 /* Variables for tests */
+static ekflog_writer_t logWriter;
+static ekflog_reader_t logReader;
 static time_t timeRead;
 static sensor_event_t sensEvt1, sensEvt2, sensEvt3;
 
@@ -44,8 +47,8 @@ TEST_GROUP(group_ekf_logs);
 TEST_SETUP(group_ekf_logs)
 {
 	int writerInitFalgs = EKFLOG_SENSC | EKFLOG_TIME | EKFLOG_STATE | EKFLOG_STRICT_MODE;
-	TEST_ASSERT_EQUAL(0, ekflog_writerInit(EKFLOG_TEST_FILE, writerInitFalgs));
-	TEST_ASSERT_EQUAL(0, ekflog_readerInit(EKFLOG_TEST_FILE));
+	TEST_ASSERT_EQUAL(0, ekflog_writerInit(&logWriter, EKFLOG_TEST_FILE, writerInitFalgs));
+	TEST_ASSERT_EQUAL(0, ekflog_readerInit(&logReader, EKFLOG_TEST_FILE));
 
 	timeRead = 0;
 	ekflogTests_sensorEvtClear(&sensEvt1);
@@ -58,7 +61,7 @@ TEST_SETUP(group_ekf_logs)
 
 TEST_TEAR_DOWN(group_ekf_logs)
 {
-	if (ekflog_readerDone() != 0) {
+	if (ekflog_readerDone(&logReader) != 0) {
 		fprintf(stderr, "ekflog tests: error while reader deinit\n");
 	}
 
@@ -72,14 +75,14 @@ TEST_TEAR_DOWN(group_ekf_logs)
 
 TEST(group_ekf_logs, ekflogs_singleTimeEvt)
 {
-	TEST_ASSERT_EQUAL(0, ekflog_timeWrite(testTimestamp1));
+	TEST_ASSERT_EQUAL(0, ekflog_timeWrite(&logWriter, testTimestamp1));
 
-	TEST_ASSERT_EQUAL(0, ekflog_writerDone());
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
 
-	TEST_ASSERT_EQUAL(0, ekflog_timeRead(&timeRead));
+	TEST_ASSERT_EQUAL(0, ekflog_timeRead(&logReader, &timeRead));
 	TEST_ASSERT_EQUAL(testTimestamp1, timeRead);
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&timeRead));
+	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&logReader, &timeRead));
 	TEST_ASSERT_EQUAL(0, errno);
 }
 
@@ -89,38 +92,38 @@ TEST(group_ekf_logs, ekflogs_multipleTimeEvt)
 	int i;
 
 	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(testTimestamp1));
-		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(testTimestamp2));
+		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(&logWriter, testTimestamp1));
+		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(&logWriter, testTimestamp2));
 	}
 
-	TEST_ASSERT_EQUAL(0, ekflog_writerDone());
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
 
 	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&timeRead));
+		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&logReader, &timeRead));
 		TEST_ASSERT_EQUAL(testTimestamp1, timeRead);
 
-		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&timeRead));
+		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&logReader, &timeRead));
 		TEST_ASSERT_EQUAL(testTimestamp2, timeRead);
 	}
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&timeRead));
+	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&logReader, &timeRead));
 	TEST_ASSERT_EQUAL(0, errno);
 }
 
 
 TEST(group_ekf_logs, ekflogs_singleImuEvt)
 {
-	TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&testAccEvt1, &testGyrEvt1, &testMagEvt1));
+	TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&logWriter, &testAccEvt1, &testGyrEvt1, &testMagEvt1));
 
-	TEST_ASSERT_EQUAL(0, ekflog_writerDone());
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
 
-	TEST_ASSERT_EQUAL(0, ekflog_imuRead(&sensEvt1, &sensEvt2, &sensEvt3));
+	TEST_ASSERT_EQUAL(0, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
 
 	TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testAccEvt1, &sensEvt1));
 	TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGyrEvt1, &sensEvt2));
 	TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testMagEvt1, &sensEvt3));
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_imuRead(&sensEvt1, &sensEvt2, &sensEvt3));
+	TEST_ASSERT_EQUAL(EOF, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
 	TEST_ASSERT_EQUAL(0, errno);
 }
 
@@ -130,41 +133,41 @@ TEST(group_ekf_logs, ekflogs_multipleImuEvt)
 	int i;
 
 	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&testAccEvt1, &testGyrEvt1, &testMagEvt1));
-		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&testAccEvt2, &testGyrEvt2, &testMagEvt2));
+		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&logWriter, &testAccEvt1, &testGyrEvt1, &testMagEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&logWriter, &testAccEvt2, &testGyrEvt2, &testMagEvt2));
 	}
 
-	TEST_ASSERT_EQUAL(0, ekflog_writerDone());
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
 
 	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_imuRead(&sensEvt1, &sensEvt2, &sensEvt3));
+		TEST_ASSERT_EQUAL(0, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
 
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testAccEvt1, &sensEvt1));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGyrEvt1, &sensEvt2));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testMagEvt1, &sensEvt3));
 
-		TEST_ASSERT_EQUAL(0, ekflog_imuRead(&sensEvt1, &sensEvt2, &sensEvt3));
+		TEST_ASSERT_EQUAL(0, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
 
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testAccEvt2, &sensEvt1));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGyrEvt2, &sensEvt2));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testMagEvt2, &sensEvt3));
 	}
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_imuRead(&sensEvt1, &sensEvt2, &sensEvt3));
+	TEST_ASSERT_EQUAL(EOF, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
 	TEST_ASSERT_EQUAL(0, errno);
 }
 
 
 TEST(group_ekf_logs, ekflogs_singleGpsEvt)
 {
-	TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&testGpsEvt1));
+	TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&logWriter, &testGpsEvt1));
 
-	TEST_ASSERT_EQUAL(0, ekflog_writerDone());
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
 
-	TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&sensEvt1));
+	TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&logReader, &sensEvt1));
 	TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGpsEvt1, &sensEvt1));
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_gpsRead(&sensEvt1));
+	TEST_ASSERT_EQUAL(EOF, ekflog_gpsRead(&logReader, &sensEvt1));
 	TEST_ASSERT_EQUAL(0, errno);
 }
 
@@ -174,35 +177,35 @@ TEST(group_ekf_logs, ekflogs_multipleGpsEvt)
 	int i;
 
 	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&testGpsEvt1));
-		TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&testGpsEvt2));
+		TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&logWriter, &testGpsEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&logWriter, &testGpsEvt2));
 	}
 
-	TEST_ASSERT_EQUAL(0, ekflog_writerDone());
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
 
 	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&sensEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&logReader, &sensEvt1));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGpsEvt1, &sensEvt1));
 
-		TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&sensEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&logReader, &sensEvt1));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGpsEvt2, &sensEvt1));
 	}
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_gpsRead(&sensEvt1));
+	TEST_ASSERT_EQUAL(EOF, ekflog_gpsRead(&logReader, &sensEvt1));
 	TEST_ASSERT_EQUAL(0, errno);
 }
 
 
 TEST(group_ekf_logs, ekflogs_singleBaroEvt)
 {
-	TEST_ASSERT_EQUAL(0, ekflog_baroWrite(&testBaroEvt));
+	TEST_ASSERT_EQUAL(0, ekflog_baroWrite(&logWriter, &testBaroEvt));
 
-	TEST_ASSERT_EQUAL(0, ekflog_writerDone());
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
 
-	TEST_ASSERT_EQUAL(0, ekflog_baroRead(&sensEvt1));
+	TEST_ASSERT_EQUAL(0, ekflog_baroRead(&logReader, &sensEvt1));
 	TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testBaroEvt, &sensEvt1));
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_baroRead(&sensEvt1));
+	TEST_ASSERT_EQUAL(EOF, ekflog_baroRead(&logReader, &sensEvt1));
 	TEST_ASSERT_EQUAL(0, errno);
 }
 
@@ -221,16 +224,16 @@ TEST(group_ekf_logs, ekflogs_singleStateEvt)
 		testEkfData[i] = i;
 	}
 
-	TEST_ASSERT_EQUAL(0, ekflog_stateWrite(&ekfState, testTimestamp1));
+	TEST_ASSERT_EQUAL(0, ekflog_stateWrite(&logWriter, &ekfState, testTimestamp1));
 
-	TEST_ASSERT_EQUAL(0, ekflog_writerDone());
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
 
-	TEST_ASSERT_EQUAL(0, ekflog_stateRead(&stateRead, &timeRead));
+	TEST_ASSERT_EQUAL(0, ekflog_stateRead(&logReader, &stateRead, &timeRead));
 
 	TEST_ASSERT_EQUAL_FLOAT_ARRAY(ekfState.data, stateRead.data, STATE_LENGTH);
 	TEST_ASSERT_EQUAL(testTimestamp1, timeRead);
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_stateRead(&stateRead, &timeRead));
+	TEST_ASSERT_EQUAL(EOF, ekflog_stateRead(&logReader, &stateRead, &timeRead));
 	TEST_ASSERT_EQUAL(0, errno);
 }
 
@@ -240,21 +243,21 @@ TEST(group_ekf_logs, ekflogs_shortSequence)
 	int i;
 
 	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(testTimestamp1));
-		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&testAccEvt1, &testGyrEvt1, &testMagEvt1));
-		TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&testGpsEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(&logWriter, testTimestamp1));
+		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&logWriter, &testAccEvt1, &testGyrEvt1, &testMagEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&logWriter, &testGpsEvt1));
 	}
 
-	TEST_ASSERT_EQUAL(0, ekflog_writerDone());
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
 
 	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&timeRead));
+		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&logReader, &timeRead));
 		TEST_ASSERT_EQUAL(testTimestamp1, timeRead);
 		timeRead = 0;
 	}
 
 	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_imuRead(&sensEvt1, &sensEvt2, &sensEvt3));
+		TEST_ASSERT_EQUAL(0, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
 
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testAccEvt1, &sensEvt1));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGyrEvt1, &sensEvt2));
@@ -266,14 +269,14 @@ TEST(group_ekf_logs, ekflogs_shortSequence)
 	}
 
 	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&sensEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&logReader, &sensEvt1));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGpsEvt1, &sensEvt1));
 		ekflogTests_sensorEvtClear(&sensEvt1);
 	}
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&timeRead));
-	TEST_ASSERT_EQUAL(EOF, ekflog_imuRead(&sensEvt1, &sensEvt2, &sensEvt3));
-	TEST_ASSERT_EQUAL(EOF, ekflog_gpsRead(&sensEvt1));
+	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&logReader, &timeRead));
+	TEST_ASSERT_EQUAL(EOF, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
+	TEST_ASSERT_EQUAL(EOF, ekflog_gpsRead(&logReader, &sensEvt1));
 
 	TEST_ASSERT_EQUAL(0, errno);
 }
@@ -284,33 +287,33 @@ TEST(group_ekf_logs, ekflogs_longSequence)
 	int i;
 
 	for (i = 0; i < LONG_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(testTimestamp1));
-		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&testAccEvt1, &testGyrEvt1, &testMagEvt1));
-		TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&testGpsEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(&logWriter, testTimestamp1));
+		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&logWriter, &testAccEvt1, &testGyrEvt1, &testMagEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&logWriter, &testGpsEvt1));
 
-		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(testTimestamp2));
-		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&testAccEvt2, &testGyrEvt2, &testMagEvt2));
-		TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&testGpsEvt2));
+		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(&logWriter, testTimestamp2));
+		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&logWriter, &testAccEvt2, &testGyrEvt2, &testMagEvt2));
+		TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&logWriter, &testGpsEvt2));
 	}
 
-	TEST_ASSERT_EQUAL(0, ekflog_writerDone());
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
 
 	for (i = 0; i < LONG_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&timeRead));
+		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&logReader, &timeRead));
 		TEST_ASSERT_EQUAL(testTimestamp1, timeRead);
 
-		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&timeRead));
+		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&logReader, &timeRead));
 		TEST_ASSERT_EQUAL(testTimestamp2, timeRead);
 	}
 
 	for (i = 0; i < LONG_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_imuRead(&sensEvt1, &sensEvt2, &sensEvt3));
+		TEST_ASSERT_EQUAL(0, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
 
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testAccEvt1, &sensEvt1));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGyrEvt1, &sensEvt2));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testMagEvt1, &sensEvt3));
 
-		TEST_ASSERT_EQUAL(0, ekflog_imuRead(&sensEvt1, &sensEvt2, &sensEvt3));
+		TEST_ASSERT_EQUAL(0, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
 
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testAccEvt2, &sensEvt1));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGyrEvt2, &sensEvt2));
@@ -318,21 +321,87 @@ TEST(group_ekf_logs, ekflogs_longSequence)
 	}
 
 	for (i = 0; i < LONG_SEQUENCE_LEN; i++) {
-		TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&sensEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&logReader, &sensEvt1));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGpsEvt1, &sensEvt1));
 
-		TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&sensEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_gpsRead(&logReader, &sensEvt1));
 		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGpsEvt2, &sensEvt1));
 	}
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&timeRead));
-	TEST_ASSERT_EQUAL(EOF, ekflog_imuRead(&sensEvt1, &sensEvt2, &sensEvt3));
-	TEST_ASSERT_EQUAL(EOF, ekflog_gpsRead(&sensEvt1));
+	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&logReader, &timeRead));
+	TEST_ASSERT_EQUAL(EOF, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
+	TEST_ASSERT_EQUAL(EOF, ekflog_gpsRead(&logReader, &sensEvt1));
 
 	TEST_ASSERT_EQUAL(0, errno);
 }
 
 
+TEST(group_ekf_logs, ekflogs_imuBatchRead)
+{
+	sensor_event_t acc[IMU_BATCH_MAX], gyr[IMU_BATCH_MAX], mag[IMU_BATCH_MAX];
+	int i, j;
+
+	/* Samples logged before the first loop iteration, e.g. by calibration */
+	TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&logWriter, &testAccEvt2, &testGyrEvt2, &testMagEvt2));
+
+	/* Loop iteration `i` logs `i + 1` IMU samples */
+	for (i = 0; i < IMU_BATCH_MAX; i++) {
+		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(&logWriter, testTimestamp1));
+		for (j = 0; j <= i; j++) {
+			TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&logWriter, &testAccEvt1, &testGyrEvt1, &testMagEvt1));
+		}
+		TEST_ASSERT_EQUAL(0, ekflog_gpsWrite(&logWriter, &testGpsEvt1));
+	}
+
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
+
+	TEST_ASSERT_EQUAL(0, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
+	TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testAccEvt2, &sensEvt1));
+
+	for (i = 0; i < IMU_BATCH_MAX; i++) {
+		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&logReader, &timeRead));
+		TEST_ASSERT_EQUAL(i + 1, ekflog_imuBatchRead(&logReader, acc, gyr, mag, IMU_BATCH_MAX));
+
+		for (j = 0; j <= i; j++) {
+			TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testAccEvt1, &acc[j]));
+			TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGyrEvt1, &gyr[j]));
+			TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testMagEvt1, &mag[j]));
+		}
+
+		/* Batch of the iteration is already read */
+		TEST_ASSERT_EQUAL(EOF, ekflog_imuBatchRead(&logReader, acc, gyr, mag, IMU_BATCH_MAX));
+		TEST_ASSERT_EQUAL(0, errno);
+	}
+
+	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&logReader, &timeRead));
+	TEST_ASSERT_EQUAL(EOF, ekflog_imuBatchRead(&logReader, acc, gyr, mag, IMU_BATCH_MAX));
+	TEST_ASSERT_EQUAL(0, errno);
+}
+
+
+TEST(group_ekf_logs, ekflogs_imuBatchLimit)
+{
+	sensor_event_t acc[IMU_BATCH_MAX], gyr[IMU_BATCH_MAX], mag[IMU_BATCH_MAX];
+	int i;
+
+	/* Logs without following timestamp log are read till the end of file */
+	TEST_ASSERT_EQUAL(0, ekflog_timeWrite(&logWriter, testTimestamp1));
+	for (i = 0; i < IMU_BATCH_MAX + 1; i++) {
+		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&logWriter, &testAccEvt1, &testGyrEvt1, &testMagEvt1));
+	}
+
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
+
+	TEST_ASSERT_EQUAL(0, ekflog_timeRead(&logReader, &timeRead));
+	TEST_ASSERT_EQUAL(IMU_BATCH_MAX, ekflog_imuBatchRead(&logReader, acc, gyr, mag, IMU_BATCH_MAX));
+	TEST_ASSERT_EQUAL(1, ekflog_imuBatchRead(&logReader, acc, gyr, mag, IMU_BATCH_MAX));
+	TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGyrEvt1, &gyr[0]));
+
+	TEST_ASSERT_EQUAL(EOF, ekflog_imuBatchRead(&logReader, acc, gyr, mag, IMU_BATCH_MAX));
+	TEST_ASSERT_EQUAL(0, errno);
+}
+
+
 TEST(group_ekf_logs, ekflogs_emptyFileRead)
 {
 	/* Create an empty file */
@@ -340,17 +409,66 @@ TEST(group_ekf_logs, ekflogs_emptyFileRead)
 	TEST_ASSERT_NOT_NULL(file);
 	TEST_ASSERT_EQUAL(0, fclose(file));
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&timeRead));
+	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&logReader, &timeRead));
 	TEST_ASSERT_EQUAL(0, errno);
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_imuRead(&sensEvt1, &sensEvt2, &sensEvt3));
+	TEST_ASSERT_EQUAL(EOF, ekflog_imuRead(&logReader, &sensEvt1, &sensEvt2, &sensEvt3));
 	TEST_ASSERT_EQUAL(0, errno);
 
-	TEST_ASSERT_EQUAL(EOF, ekflog_gpsRead(&sensEvt1));
+	TEST_ASSERT_EQUAL(EOF, ekflog_gpsRead(&logReader, &sensEvt1));
 	TEST_ASSERT_EQUAL(0, errno);
 }
 
 
+TEST(group_ekf_logs, ekflogs_bufferRead)
+{
+	static uint8_t buf[4096];
+	ekflog_reader_t bufReader;
+	size_t size;
+	FILE *file;
+	int i;
+
+	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
+		TEST_ASSERT_EQUAL(0, ekflog_timeWrite(&logWriter, testTimestamp1));
+		TEST_ASSERT_EQUAL(0, ekflog_imuWrite(&logWriter, &testAccEvt1, &testGyrEvt1, &testMagEvt1));
+		TEST_ASSERT_EQUAL(0, ekflog_baroWrite(&logWriter, &testBaroEvt));
+	}
+
+	TEST_ASSERT_EQUAL(0, ekflog_writerDone(&logWriter));
+
+	file = fopen(EKFLOG_TEST_FILE, "rb");
+	TEST_ASSERT_NOT_NULL(file);
+	size = fread(buf, 1, sizeof(buf), file);
+	TEST_ASSERT_EQUAL(0, fclose(file));
+	TEST_ASSERT_TRUE(size > 0 && size < sizeof(buf));
+
+	TEST_ASSERT_EQUAL(0, ekflog_readerBufInit(&bufReader, buf, size));
+
+	/* Streams are read independently, as from a file */
+	for (i = 0; i < SHORT_SEQUENCE_LEN; i++) {
+		TEST_ASSERT_EQUAL(0, ekflog_baroRead(&bufReader, &sensEvt1));
+		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testBaroEvt, &sensEvt1));
+		ekflogTests_sensorEvtClear(&sensEvt1);
+
+		TEST_ASSERT_EQUAL(0, ekflog_imuRead(&bufReader, &sensEvt1, &sensEvt2, &sensEvt3));
+		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testAccEvt1, &sensEvt1));
+		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testGyrEvt1, &sensEvt2));
+		TEST_ASSERT_TRUE(ekflogTests_sensorEvtEqual(&testMagEvt1, &sensEvt3));
+
+		TEST_ASSERT_EQUAL(0, ekflog_timeRead(&bufReader, &timeRead));
+		TEST_ASSERT_EQUAL(testTimestamp1, timeRead);
+	}
+
+	TEST_ASSERT_EQUAL(EOF, ekflog_timeRead(&bufReader, &timeRead));
+	TEST_ASSERT_EQUAL(EOF, ekflog_imuRead(&bufReader, &sensEvt1, &sensEvt2, &sensEvt3));
+	TEST_ASSERT_EQUAL(EOF, ekflog_baroRead(&bufReader, &sensEvt1));
+	TEST_ASSERT_EQUAL(EOF, ekflog_gpsRead(&bufReader, &sensEvt1));
+
+	TEST_ASSERT_EQUAL(0, errno);
+	TEST_ASSERT_EQUAL(0, ekflog_readerDone(&bufReader));
+}
+
+
 TEST_GROUP_RUNNER(group_ekf_logs)
 {
 	RUN_TEST_CASE(group_ekf_logs, ekflogs_singleTimeEvt);
@@ -369,5 +487,10 @@ TEST_GROUP_RUNNER(group_ekf_logs)
 	RUN_TEST_CASE(group_ekf_logs, ekflogs_shortSequence);
 	RUN_TEST_CASE(group_ekf_logs, ekflogs_longSequence);
 
+	RUN_TEST_CASE(group_ekf_logs, ekflogs_imuBatchRead);
+	RUN_TEST_CASE(group_ekf_logs, ekflogs_imuBatchLimit);
+
 	RUN_TEST_CASE(group_ekf_logs, ekflogs_emptyFileRead);
+
+	RUN_TEST_CASE(group_ekf_logs, ekflogs_bufferRead);
 }
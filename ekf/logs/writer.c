@@ -37,50 +37,21 @@
 #include "max_logs.h"
 #endif
 
-#define BUFFS_CAPACITY 1024 * 8
-
 #define PHOENIX_THREAD_PRIO 4
 
 
-typedef struct {
-	uint8_t buff[BUFFS_CAPACITY];
-	bool dirty;
-	int size; /* Used capacity */
-} ekflog_buff_t;
-
-
-static struct {
-	uint32_t logFlags;
-	int fd;
-
-	ekflog_buff_t buffA;
-	ekflog_buff_t buffB;
-
-	ekflog_buff_t *actBuff;
-
-	pthread_mutex_t lock;
-	pthread_cond_t buffEvent;
-	pthread_t tid;
-
-	uint32_t logCnt; /* Number of requests to log a value */
-	volatile int run;
-	bool logsEnabled;
-
-	int lost; /* Number of lost logs */
-} ekflog_common;
-
-
-static inline ekflog_buff_t *ekflog_nextBufferGet(ekflog_buff_t *actBuff)
+static inline ekflog_buff_t *ekflog_nextBufferGet(ekflog_writer_t *writer, ekflog_buff_t *actBuff)
 {
-	return actBuff == &ekflog_common.buffA ? &ekflog_common.buffB : &ekflog_common.buffA;
+	return actBuff == &writer->buffA ? &writer->buffB : &writer->buffA;
 }
 
 
 static void *ekflog_thread(void *args)
 {
-	ekflog_buff_t *outBuff = &ekflog_common.buffA;
+	ekflog_writer_t *writer = args;
+	ekflog_buff_t *outBuff = &writer->buffA;
 
-	pthread_mutex_lock(&ekflog_common.lock);
+	pthread_mutex_lock(&writer->lock);
 
 #ifdef LOG_VOL_CHECK
 	maxLog_start();
@@ -88,19 +59,19 @@ static void *ekflog_thread(void *args)
 #endif
 
 	do {
-		while (outBuff->dirty == false && ekflog_common.run != 0) {
-			pthread_cond_wait(&ekflog_common.buffEvent, &ekflog_common.lock);
+		while (outBuff->dirty == false && writer->run != 0) {
+			pthread_cond_wait(&writer->buffEvent, &writer->lock);
 		}
 
 		while (outBuff->dirty == true) {
-			pthread_mutex_unlock(&ekflog_common.lock);
+			pthread_mutex_unlock(&writer->lock);
 
 #ifdef LOG_VOL_CHECK
 			maxLog_wakeUpReport();
 			maxLog_writeReport(outBuff->size);
 #endif
 
-			if (write(ekflog_common.fd, outBuff->buff, outBuff->size) != outBuff->size) {
+			if (write(writer->fd, outBuff->buff, outBuff->size) != outBuff->size) {
 				fprintf(stderr, "ekflog: error while writing to file\n");
 			}
 
@@ -108,15 +79,15 @@ static void *ekflog_thread(void *args)
 			maxLog_sleepReport();
 #endif
 
-			pthread_mutex_lock(&ekflog_common.lock);
+			pthread_mutex_lock(&writer->lock);
 
 			outBuff->dirty = false;
 			outBuff->size = 0;
 
-			outBuff = ekflog_nextBufferGet(outBuff);
-			pthread_cond_signal(&ekflog_common.buffEvent);
+			outBuff = ekflog_nextBufferGet(writer, outBuff);
+			pthread_cond_signal(&writer->buffEvent);
 		}
-	} while (ekflog_common.run != 0);
+	} while (writer->run != 0);
 
 #ifdef LOG_VOL_CHECK
 	maxLog_wakeUpReport();
@@ -125,26 +96,26 @@ static void *ekflog_thread(void *args)
 #endif
 
 	printf("Logging finished\n");
-	printf("Number of logs requests: %d\n", ekflog_common.logCnt);
-	printf("Lost logs: %d\n", ekflog_common.lost);
+	printf("Number of logs requests: %d\n", writer->logCnt);
+	printf("Lost logs: %d\n", writer->lost);
 
-	pthread_mutex_unlock(&ekflog_common.lock);
+	pthread_mutex_unlock(&writer->lock);
 
 	return NULL;
 }
 
 
-static bool ekflog_actBuffWritable(void)
+static bool ekflog_actBuffWritable(ekflog_writer_t *writer)
 {
-	if (ekflog_common.actBuff->dirty == false) {
+	if (writer->actBuff->dirty == false) {
 		return true;
 	}
 
-	if ((ekflog_common.logFlags & EKFLOG_STRICT_MODE) != 0) {
+	if ((writer->logFlags & EKFLOG_STRICT_MODE) != 0) {
 		/* Waiting for a place to insert logs */
 		do {
-			pthread_cond_wait(&ekflog_common.buffEvent, &ekflog_common.lock);
-		} while (ekflog_common.actBuff->dirty == true);
+			pthread_cond_wait(&writer->buffEvent, &writer->lock);
+		} while (writer->actBuff->dirty == true);
 
 		return true;
 	}
@@ -153,70 +124,70 @@ static bool ekflog_actBuffWritable(void)
 }
 
 
-static int ekflog_write(const void *msg, size_t msgLen, char logIndicator, time_t timestamp)
+static int ekflog_write(ekflog_writer_t *writer, const void *msg, size_t msgLen, char logIndicator, time_t timestamp)
 {
 	size_t remainingBuffSize;
 
-	pthread_mutex_lock(&ekflog_common.lock);
+	pthread_mutex_lock(&writer->lock);
 
-	remainingBuffSize = BUFFS_CAPACITY - ekflog_common.actBuff->size;
+	remainingBuffSize = EKFLOG_BUFFS_CAPACITY - writer->actBuff->size;
 
 	if (remainingBuffSize < msgLen + LOG_PREFIX_SIZE) {
 		/* Changing actual buffer for the next one */
-		ekflog_common.actBuff->dirty = true;
-		ekflog_common.actBuff = ekflog_nextBufferGet(ekflog_common.actBuff);
-		pthread_cond_signal(&ekflog_common.buffEvent);
+		writer->actBuff->dirty = true;
+		writer->actBuff = ekflog_nextBufferGet(writer, writer->actBuff);
+		pthread_cond_signal(&writer->buffEvent);
 	}
 
 	/* Adding log number */
-	ekflog_common.logCnt++;
+	writer->logCnt++;
 
-	if (!ekflog_actBuffWritable()) {
+	if (!ekflog_actBuffWritable(writer)) {
 		/* Dropping the log */
-		ekflog_common.lost++;
-		pthread_mutex_unlock(&ekflog_common.lock);
+		writer->lost++;
+		pthread_mutex_unlock(&writer->lock);
 		return -1;
 	}
 
-	memcpy(ekflog_common.actBuff->buff + ekflog_common.actBuff->size, &ekflog_common.logCnt, sizeof(ekflog_common.logCnt));
-	ekflog_common.actBuff->size += sizeof(ekflog_common.logCnt);
+	memcpy(writer->actBuff->buff + writer->actBuff->size, &writer->logCnt, sizeof(writer->logCnt));
+	writer->actBuff->size += sizeof(writer->logCnt);
 
 	/* Adding log identifier */
-	memcpy(ekflog_common.actBuff->buff + ekflog_common.actBuff->size, &logIndicator, sizeof(logIndicator));
-	ekflog_common.actBuff->size += sizeof(logIndicator);
+	memcpy(writer->actBuff->buff + writer->actBuff->size, &logIndicator, sizeof(logIndicator));
+	writer->actBuff->size += sizeof(logIndicator);
 
 	/* Adding timestamp */
-	memcpy(ekflog_common.actBuff->buff + ekflog_common.actBuff->size, &timestamp, sizeof(timestamp));
-	ekflog_common.actBuff->size += sizeof(timestamp);
+	memcpy(writer->actBuff->buff + writer->actBuff->size, &timestamp, sizeof(timestamp));
+	writer->actBuff->size += sizeof(timestamp);
 
 	if (msgLen > 0) {
-		memcpy(ekflog_common.actBuff->buff + ekflog_common.actBuff->size, msg, msgLen);
-		ekflog_common.actBuff->size += msgLen;
+		memcpy(writer->actBuff->buff + writer->actBuff->size, msg, msgLen);
+		writer->actBuff->size += msgLen;
 	}
 
-	pthread_mutex_unlock(&ekflog_common.lock);
+	pthread_mutex_unlock(&writer->lock);
 
 	return 0;
 }
 
 
-int ekflog_timeWrite(time_t timestamp)
+int ekflog_timeWrite(ekflog_writer_t *writer, time_t timestamp)
 {
 	/* Log call with flags that are not enabled is not an error */
-	if ((ekflog_common.logFlags & EKFLOG_TIME) == 0) {
+	if ((writer->logFlags & EKFLOG_TIME) == 0) {
 		return 0;
 	}
 
-	return ekflog_write(NULL, 0, TIME_LOG_INDICATOR, timestamp);
+	return ekflog_write(writer, NULL, 0, TIME_LOG_INDICATOR, timestamp);
 }
 
 
-int ekflog_imuWrite(const sensor_event_t *accEvt, const sensor_event_t *gyrEvt, const sensor_event_t *magEvt)
+int ekflog_imuWrite(ekflog_writer_t *writer, const sensor_event_t *accEvt, const sensor_event_t *gyrEvt, const sensor_event_t *magEvt)
 {
 	uint8_t buff[IMU_LOG_SIZE - LOG_PREFIX_SIZE];
 
 	/* Log call with flags that are not enabled is not an error */
-	if ((ekflog_common.logFlags & EKFLOG_SENSC) == 0) {
+	if ((writer->logFlags & EKFLOG_SENSC) == 0) {
 		return 0;
 	}
 
@@ -224,79 +195,79 @@ int ekflog_imuWrite(const sensor_event_t *accEvt, const sensor_event_t *gyrEvt,
 	memcpy(buff + sizeof(accEvt->accels), &gyrEvt->gyro, sizeof(gyrEvt->gyro));
 	memcpy(buff + sizeof(accEvt->accels) + sizeof(gyrEvt->gyro), &magEvt->mag, sizeof(magEvt->mag));
 
-	return ekflog_write(buff, sizeof(buff), IMU_LOG_INDICATOR, accEvt->timestamp);
+	return ekflog_write(writer, buff, sizeof(buff), IMU_LOG_INDICATOR, accEvt->timestamp);
 }
 
 
-int ekflog_gpsWrite(const sensor_event_t *gpsEvt)
+int ekflog_gpsWrite(ekflog_writer_t *writer, const sensor_event_t *gpsEvt)
 {
 	/* Log call with flags that are not enabled is not an error */
-	if ((ekflog_common.logFlags & EKFLOG_SENSC) == 0) {
+	if ((writer->logFlags & EKFLOG_SENSC) == 0) {
 		return 0;
 	}
 
-	return ekflog_write(&gpsEvt->gps, sizeof(gpsEvt->gps), GPS_LOG_INDICATOR, gpsEvt->timestamp);
+	return ekflog_write(writer, &gpsEvt->gps, sizeof(gpsEvt->gps), GPS_LOG_INDICATOR, gpsEvt->timestamp);
 }
 
 
-int ekflog_baroWrite(const sensor_event_t *baroEvt)
+int ekflog_baroWrite(ekflog_writer_t *writer, const sensor_event_t *baroEvt)
 {
 	/* Log call with flags that are not enabled is not an error */
-	if ((ekflog_common.logFlags & EKFLOG_SENSC) == 0) {
+	if ((writer->logFlags & EKFLOG_SENSC) == 0) {
 		return 0;
 	}
 
-	return ekflog_write(&baroEvt->baro, sizeof(baroEvt->baro), BARO_LOG_INDICATOR, baroEvt->timestamp);
+	return ekflog_write(writer, &baroEvt->baro, sizeof(baroEvt->baro), BARO_LOG_INDICATOR, baroEvt->timestamp);
 }
 
 
-int ekflog_stateWrite(const matrix_t *state, time_t timestamp)
+int ekflog_stateWrite(ekflog_writer_t *writer, const matrix_t *state, time_t timestamp)
 {
 	/* Log call with flags that are not enabled is not an error */
-	if ((ekflog_common.logFlags & EKFLOG_STATE) == 0) {
+	if ((writer->logFlags & EKFLOG_STATE) == 0) {
 		return 0;
 	}
 
-	return ekflog_write(state->data, STATE_LOG_SIZE - LOG_PREFIX_SIZE, STATE_LOG_INDICATOR, timestamp);
+	return ekflog_write(writer, state->data, STATE_LOG_SIZE - LOG_PREFIX_SIZE, STATE_LOG_INDICATOR, timestamp);
 }
 
 
-int ekflog_writerDone(void)
+int ekflog_writerDone(ekflog_writer_t *writer)
 {
 	int err = 0;
 
-	if (ekflog_common.logsEnabled == false) {
+	if (writer->logsEnabled == false) {
 		return 0;
 	}
 
-	pthread_mutex_lock(&ekflog_common.lock);
-	ekflog_common.run = 0;
-	ekflog_common.actBuff->dirty = true;
-	pthread_mutex_unlock(&ekflog_common.lock);
+	pthread_mutex_lock(&writer->lock);
+	writer->run = 0;
+	writer->actBuff->dirty = true;
+	pthread_mutex_unlock(&writer->lock);
 
-	pthread_cond_signal(&ekflog_common.buffEvent);
+	pthread_cond_signal(&writer->buffEvent);
 
-	if (pthread_join(ekflog_common.tid, NULL) != 0) {
+	if (pthread_join(writer->tid, NULL) != 0) {
 		fprintf(stderr, "ekflog: cannot join logging thread\n");
 		return -1;
 	}
 
-	err |= close(ekflog_common.fd);
-	err |= pthread_mutex_destroy(&ekflog_common.lock);
-	err |= pthread_cond_destroy(&ekflog_common.buffEvent);
+	err |= close(writer->fd);
+	err |= pthread_mutex_destroy(&writer->lock);
+	err |= pthread_cond_destroy(&writer->buffEvent);
 
 	return err;
 }
 
 
-int ekflog_writerInit(const char *path, uint32_t flags)
+int ekflog_writerInit(ekflog_writer_t *writer, const char *path, uint32_t flags)
 {
 	pthread_attr_t attr;
 	int ret;
 
 	if (flags == 0) {
-		ekflog_common.logsEnabled = false;
-		ekflog_common.logFlags = 0;
+		writer->logsEnabled = false;
+		writer->logFlags = 0;
 		return 0;
 	}
 
@@ -305,30 +276,30 @@ int ekflog_writerInit(const char *path, uint32_t flags)
 		return -1;
 	}
 
-	ekflog_common.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
-	if (ekflog_common.fd == -1) {
+	writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
+	if (writer->fd == -1) {
 		fprintf(stderr, "ekflog: can`t open %s to write\n", path);
 		return -1;
 	}
 
-	if (pthread_mutex_init(&ekflog_common.lock, NULL) != 0) {
+	if (pthread_mutex_init(&writer->lock, NULL) != 0) {
 		fprintf(stderr, "ekflog: cannot initialize lock\n");
-		close(ekflog_common.fd);
+		close(writer->fd);
 		return -1;
 	}
 
-	if (pthread_cond_init(&ekflog_common.buffEvent, NULL) != 0) {
+	if (pthread_cond_init(&writer->buffEvent, NULL) != 0) {
 		fprintf(stderr, "ekflog: cannot initialize conditional variable\n");
-		close(ekflog_common.fd);
-		pthread_mutex_destroy(&ekflog_common.lock);
+		close(writer->fd);
+		pthread_mutex_destroy(&writer->lock);
 		return -1;
 	}
 
 	if (pthread_attr_init(&attr) != 0) {
 		fprintf(stderr, "ekflog: cannot initialize conditional variable\n");
-		close(ekflog_common.fd);
-		pthread_mutex_destroy(&ekflog_common.lock);
-		pthread_cond_destroy(&ekflog_common.buffEvent);
+		close(writer->fd);
+		pthread_mutex_destroy(&writer->lock);
+		pthread_cond_destroy(&writer->buffEvent);
 		return -1;
 	}
 
@@ -337,36 +308,36 @@ int ekflog_writerInit(const char *path, uint32_t flags)
 
 	if (pthread_attr_setschedparam(&attr, &((struct sched_param) { .sched_priority = PHOENIX_THREAD_PRIO })) != 0) {
 		printf("ekflog: cannot set thread priority\n");
-		close(ekflog_common.fd);
-		pthread_mutex_destroy(&ekflog_common.lock);
-		pthread_cond_destroy(&ekflog_common.buffEvent);
+		close(writer->fd);
+		pthread_mutex_destroy(&writer->lock);
+		pthread_cond_destroy(&writer->buffEvent);
 		pthread_attr_destroy(&attr);
 		return -1;
 	}
 
 #endif
 
-	ekflog_common.logFlags = flags;
+	writer->logFlags = flags;
 
-	ekflog_common.buffA.dirty = false;
-	ekflog_common.buffA.size = 0;
+	writer->buffA.dirty = false;
+	writer->buffA.size = 0;
 
-	ekflog_common.buffB.dirty = false;
-	ekflog_common.buffB.size = 0;
+	writer->buffB.dirty = false;
+	writer->buffB.size = 0;
 
-	ekflog_common.actBuff = &ekflog_common.buffA;
-	ekflog_common.logCnt = 0;
-	ekflog_common.run = 1;
-	ekflog_common.logsEnabled = true;
-	ekflog_common.lost = 0;
+	writer->actBuff = &writer->buffA;
+	writer->logCnt = 0;
+	writer->run = 1;
+	writer->logsEnabled = true;
+	writer->lost = 0;
 
-	ret = pthread_create(&ekflog_common.tid, &attr, ekflog_thread, NULL);
+	ret = pthread_create(&writer->tid, &attr, ekflog_thread, writer);
 	pthread_attr_destroy(&attr);
 	if (ret != 0) {
 		fprintf(stderr, "ekflog: cannot start a log thread\n");
-		close(ekflog_common.fd);
-		pthread_mutex_destroy(&ekflog_common.lock);
-		pthread_cond_destroy(&ekflog_common.buffEvent);
+		close(writer->fd);
+		pthread_mutex_destroy(&writer->lock);
+		pthread_cond_destroy(&writer->buffEvent);
 		return -1;
 	}
 
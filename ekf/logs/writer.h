@@ -15,6 +15,10 @@
 #ifndef _EKF_LOG_WRITER_
 #define _EKF_LOG_WRITER_
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
 #include <libsensors.h>
 #include <matrix.h>
 
@@ -32,33 +36,64 @@
  */
 #define EKFLOG_STRICT_MODE (1 << 30)
 
+#define EKFLOG_BUFFS_CAPACITY (1024 * 8)
+
+
+typedef struct {
+	uint8_t buff[EKFLOG_BUFFS_CAPACITY];
+	bool dirty;
+	int size; /* Used capacity */
+} ekflog_buff_t;
+
+
+/* Log writer instance. Fields are private to the writer module */
+typedef struct {
+	uint32_t logFlags;
+	int fd;
+
+	ekflog_buff_t buffA;
+	ekflog_buff_t buffB;
+
+	ekflog_buff_t *actBuff;
+
+	pthread_mutex_t lock;
+	pthread_cond_t buffEvent;
+	pthread_t tid;
+
+	uint32_t logCnt; /* Number of requests to log a value */
+	volatile int run;
+	bool logsEnabled;
+
+	int lost; /* Number of lost logs */
+} ekflog_writer_t;
+
 
 /* Logs timestamp */
-extern int ekflog_timeWrite(time_t timestamp);
+extern int ekflog_timeWrite(ekflog_writer_t *writer, time_t timestamp);
 
 
 /* Logs data form IMU sensor */
-extern int ekflog_imuWrite(const sensor_event_t *accEvt, const sensor_event_t *gyrEvt, const sensor_event_t *magEvt);
+extern int ekflog_imuWrite(ekflog_writer_t *writer, const sensor_event_t *accEvt, const sensor_event_t *gyrEvt, const sensor_event_t *magEvt);
 
 
 /* Logs data from GPS */
-extern int ekflog_gpsWrite(const sensor_event_t *gpsEvt);
+extern int ekflog_gpsWrite(ekflog_writer_t *writer, const sensor_event_t *gpsEvt);
 
 
 /* Logs data from barometer */
-extern int ekflog_baroWrite(const sensor_event_t *baroEvt);
+extern int ekflog_baroWrite(ekflog_writer_t *writer, const sensor_event_t *baroEvt);
 
 
 /* Logs EKF state */
-extern int ekflog_stateWrite(const matrix_t *state, time_t timestamp);
+extern int ekflog_stateWrite(ekflog_writer_t *writer, const matrix_t *state, time_t timestamp);
 
 
-/* Deinitialize ekflog writer module */
-extern int ekflog_writerDone(void);
+/* Deinitialize ekflog `writer` */
+extern int ekflog_writerDone(ekflog_writer_t *writer);
 
 
-/* Initialize log module for `flags` log messages and `path` destination file. Returns 0 on success */
-extern int ekflog_writerInit(const char *path, uint32_t flags);
+/* Initialize `writer` for `flags` log messages and `path` destination file. Returns 0 on success */
+extern int ekflog_writerInit(ekflog_writer_t *writer, const char *path, uint32_t flags);
 
 
 #endif
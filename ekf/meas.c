@@ -14,6 +14,7 @@
  */
 
 #include <errno.h>
+#include <stdbool.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -43,70 +44,148 @@
 #define BARO_CALIB_AVG 100
 #define GPS_CALIB_AVG  10
 
+#define IMU_POLL_MAX 16 /* Max number of buffered IMU samples integrated by one poll, older ones are merged into the oldest used one */
+
 #define MAX_CONSECUTIVE_FAILS 10 /* Max amount of fails during sensor data acquisition before returning an error */
 
+/* Warm start check */
+#define WARM_IMU_AVG       100    /* IMU samples */
+#define WARM_BARO_AVG      10     /* barometer samples */
+#define WARM_GYRO_MAX      0.02f  /* max difference between mean angular rate and gyro bias in rad/s */
+#define WARM_ACC_STDEV_MAX 0.2f   /* max standard deviation of acceleration in m/s^2 */
+#define WARM_GRAV_COS_MIN  0.996f /* cosine of max angle between gravity and its direction expected from attitude (5 deg) */
+#define WARM_MAG_COS_MIN   0.985f /* cosine of max angle between magnetic field and its direction expected from attitude (10 deg) */
+#define WARM_PRESS_TOL     50.f   /* max difference from persisted pressure in Pa, about 4 m of height */
+
 #define MAX_U32_DELTAANGLE     0x7fffffff /* Half of the u32 buffer span is max delta angle expected in one step (roughly 2147 radians) */
 #define GYRO_MAX_SENSIBLE_READ 157        /* 50 pi radians per second is the largest absolute value of angular speed deemed possible */
 
-static struct {
-	meas_sourceType_t sourceType;
 
-	int (*baroAcq)(sensor_event_t *);
-	int (*gpsAcq)(sensor_event_t *);
-	int (*imuAcq)(sensor_event_t *, sensor_event_t *, sensor_event_t *);
-	int (*timeAcq)(time_t *);
 
-	meas_calib_t calib;
+/* Data source adapters. Sensor client is process-wide, so these ignore `meas` */
+
+static int meas_senscImuGet(meas_ctx_t *meas, sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_t *magEvt)
+{
+	return sensc_imuGet(accEvt, gyrEvt, magEvt);
+}
+
+
+static int meas_senscImuGetAll(meas_ctx_t *meas, sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_t *magEvt, unsigned int n)
+{
+	return sensc_imuGetAll(accEvt, gyrEvt, magEvt, n);
+}
+
+
+static int meas_senscBaroGet(meas_ctx_t *meas, sensor_event_t *baroEvt)
+{
+	return sensc_baroGet(baroEvt);
+}
+
+
+static int meas_senscGpsGet(meas_ctx_t *meas, sensor_event_t *gpsEvt)
+{
+	return sensc_gpsGet(gpsEvt);
+}
+
+
+static int meas_senscTimeGet(meas_ctx_t *meas, time_t *timestamp)
+{
+	return sensc_timeGet(timestamp);
+}
+
+
+static int meas_logImuRead(meas_ctx_t *meas, sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_t *magEvt)
+{
+	return ekflog_imuRead(&meas->reader, accEvt, gyrEvt, magEvt);
+}
 
-	struct {
-		/* IMU related */
-		vec_t accelRaw;
-		vec_t accelFltr;
-		vec_t gyroRaw;
-		vec_t gyroFltr;
-		time_t timeImu;
 
-		/* Magnetometer */
-		vec_t mag;
-		time_t timeMag;
+static int meas_logImuReadAll(meas_ctx_t *meas, sensor_event_t *accEvt, sensor_event_t *gyrEvt, sensor_event_t *magEvt, unsigned int n)
+{
+	return ekflog_imuBatchRead(&meas->reader, accEvt, gyrEvt, magEvt, n);
+}
 
-		/* Baro related */
-		float pressure;
-		float temp;
-		time_t timeBaro;
 
-		/* Gps related */
-		meas_gps_t gps;
-		time_t timeGps;
-	} data;
-} meas_common;
+static int meas_logBaroRead(meas_ctx_t *meas, sensor_event_t *baroEvt)
+{
+	return ekflog_baroRead(&meas->reader, baroEvt);
+}
 
 
-int meas_init(meas_sourceType_t sourceType, const char *path, int senscInitFlags)
+static int meas_logGpsRead(meas_ctx_t *meas, sensor_event_t *gpsEvt)
 {
-	meas_common.sourceType = sourceType;
+	return ekflog_gpsRead(&meas->reader, gpsEvt);
+}
 
+
+static int meas_logTimeRead(meas_ctx_t *meas, time_t *timestamp)
+{
+	return ekflog_timeRead(&meas->reader, timestamp);
+}
+
+
+static void meas_imuPreintReset(meas_ctx_t *meas)
+{
+	quat_idenWrite(&meas->preint.sum.dq);
+	meas->preint.sum.dv = (vec_t) { .x = 0, .y = 0, .z = 0 };
+	meas->preint.sum.dt = 0;
+}
+
+
+/* Clears `meas` and initializes its source independent parts */
+static int meas_ctxInit(meas_ctx_t *meas, meas_sourceType_t sourceType, ekflog_writer_t *log)
+{
+	memset(meas, 0, sizeof(*meas));
+	meas->sourceType = sourceType;
+	meas->log = log;
+
+	if (fltr_init(&meas->fltr) != 0) {
+		return -1;
+	}
+
+	meas_imuPreintReset(meas);
+
+	return 0;
+}
+
+
+static void meas_logSourceSet(meas_ctx_t *meas)
+{
+	meas->imuAcq = meas_logImuRead;
+	meas->imuAllAcq = meas_logImuReadAll;
+	meas->imuWait = NULL;
+	meas->gpsAcq = meas_logGpsRead;
+	meas->timeAcq = meas_logTimeRead;
+	meas->baroAcq = meas_logBaroRead;
+}
+
+
+int meas_init(meas_ctx_t *meas, meas_sourceType_t sourceType, const char *path, int senscInitFlags, ekflog_writer_t *log)
+{
 	if (access(path, R_OK) != 0) {
 		fprintf(stderr, "meas: program have no read access to file %s\n", path);
 		return -1;
 	}
 
+	if (meas_ctxInit(meas, sourceType, log) != 0) {
+		return -1;
+	}
+
 	switch (sourceType) {
 		case srcSens:
-			meas_common.imuAcq = sensc_imuGet;
-			meas_common.gpsAcq = sensc_gpsGet;
-			meas_common.timeAcq = sensc_timeGet;
-			meas_common.baroAcq = sensc_baroGet;
+			meas->imuAcq = meas_senscImuGet;
+			meas->imuAllAcq = meas_senscImuGetAll;
+			meas->imuWait = sensc_imuWait;
+			meas->gpsAcq = meas_senscGpsGet;
+			meas->timeAcq = meas_senscTimeGet;
+			meas->baroAcq = meas_senscBaroGet;
 
 			return sensc_init(path, CORR_ENBL_ALL, senscInitFlags);
 
 		case srcLog:
-			meas_common.imuAcq = ekflog_imuRead;
-			meas_common.gpsAcq = ekflog_gpsRead;
-			meas_common.timeAcq = ekflog_timeRead;
-			meas_common.baroAcq = ekflog_baroRead;
+			meas_logSourceSet(meas);
 
-			return ekflog_readerInit(path);
+			return ekflog_readerInit(&meas->reader, path);
 
 		default:
 			fprintf(stderr, "%s: unknown source type\n", __FUNCTION__);
@@ -116,15 +195,27 @@ int meas_init(meas_sourceType_t sourceType, const char *path, int senscInitFlags
 }
 
 
-int meas_done(void)
+int meas_logBufInit(meas_ctx_t *meas, const void *buf, size_t size, ekflog_writer_t *log)
 {
-	switch (meas_common.sourceType) {
+	if (meas_ctxInit(meas, srcLog, log) != 0) {
+		return -1;
+	}
+
+	meas_logSourceSet(meas);
+
+	return ekflog_readerBufInit(&meas->reader, buf, size);
+}
+
+
+int meas_done(meas_ctx_t *meas)
+{
+	switch (meas->sourceType) {
 		case srcSens:
 			sensc_deinit();
 			return 0;
 
 		case srcLog:
-			return ekflog_readerDone();
+			return ekflog_readerDone(&meas->reader);
 
 		default:
 			fprintf(stderr, "%s: unknown source type\n", __FUNCTION__);
@@ -133,6 +224,89 @@ int meas_done(void)
 }
 
 
+/* Calibration progress is read by other threads. Release store of stage publishes fields written before it */
+static inline void meas_calibStageSet(meas_calibProgress_t *progress, meas_calibStage_t stage)
+{
+	__atomic_store_n(&progress->stage, stage, __ATOMIC_RELEASE);
+}
+
+
+static inline void meas_calibSamplesSet(meas_calibProgress_t *progress, unsigned int samples)
+{
+	__atomic_store_n(&progress->samples, samples, __ATOMIC_RELAXED);
+}
+
+
+/* Waits `us` microseconds between calibration samples. Logged samples are read right away */
+static void meas_calibSleep(const meas_ctx_t *meas, unsigned int us)
+{
+	if (meas->sourceType == srcSens) {
+		usleep(us);
+	}
+}
+
+
+static time_t meas_calibNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (time_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+/* Returns true and marks calibration as timed out if `deadline` passed. Logged samples are read right away, so only sensors time out */
+static bool meas_calibExpired(const meas_ctx_t *meas, meas_calibProgress_t *progress, time_t deadline)
+{
+	if (meas->sourceType != srcSens || deadline == 0 || meas_calibNow() < deadline) {
+		return false;
+	}
+
+	meas_calibStageSet(progress, calibTimeout);
+
+	return true;
+}
+
+
+/* meas_calibSleep() shortened to not sleep past `deadline` */
+static void meas_calibSleepMax(const meas_ctx_t *meas, unsigned int us, time_t deadline)
+{
+	time_t left;
+
+	if (deadline != 0) {
+		left = deadline - meas_calibNow();
+		if (left < (time_t)us) {
+			us = (left > 0) ? left : 0;
+		}
+	}
+
+	meas_calibSleep(meas, us);
+}
+
+
+/* Runs calibration procedure `run` of `total` samples limited by `timeout` and reports its result in `progress` */
+static int meas_calibRun(meas_ctx_t *meas, meas_calibProgress_t *progress, unsigned int total, time_t timeout,
+	int (*run)(meas_ctx_t *, meas_calibProgress_t *, time_t))
+{
+	time_t deadline = (timeout != 0) ? meas_calibNow() + timeout : 0;
+
+	meas_calibSamplesSet(progress, 0);
+	progress->total = total;
+
+	if (run(meas, progress, deadline) != 0) {
+		if (__atomic_load_n(&progress->stage, __ATOMIC_RELAXED) != calibTimeout) {
+			meas_calibStageSet(progress, calibFailed);
+		}
+		return -1;
+	}
+
+	meas_calibStageSet(progress, calibDone);
+
+	return 0;
+}
+
+
 static void meas_gps2geo(const sensor_event_t *gpsEvt, meas_geodetic_t *geo)
 {
 	geo->lat = (double)gpsEvt->gps.lat / 1e9;
@@ -192,7 +366,7 @@ static void meas_geo2ned(const meas_geodetic_t *geo, const meas_geodetic_t *refG
 }
 
 
-extern int meas_latlon2en(double lat, double lon, float *east, float *north)
+int meas_latlon2en(meas_ctx_t *meas, double lat, double lon, float *east, float *north)
 {
 	meas_geodetic_t geo;
 	vec_t ned = { 0 };
@@ -206,7 +380,7 @@ extern int meas_latlon2en(double lat, double lon, float *east, float *north)
 	geo.cosLon = cos(geo.lon * DEG2RAD);
 	geo.sinLon = sin(geo.lon * DEG2RAD);
 
-	meas_geo2ned(&geo, &meas_common.calib.gps.refGeodetic, meas_common.calib.gps.refEcef, &ned);
+	meas_geo2ned(&geo, &meas->calib.gps.refGeodetic, meas->calib.gps.refEcef, &ned);
 	*east = ned.y;
 	*north = ned.x;
 
@@ -214,77 +388,96 @@ extern int meas_latlon2en(double lat, double lon, float *east, float *north)
 }
 
 
-int meas_gpsCalib(void)
+static int meas_gpsCalibRun(meas_ctx_t *meas, meas_calibProgress_t *progress, time_t deadline)
 {
 	int i, avg = GPS_CALIB_AVG, fails = 0;
 	sensor_event_t gpsEvt;
 	meas_geodetic_t refPos = { 0 };
 
+	meas_calibStageSet(progress, calibWaiting);
+
 	/* Assuring gps fix */
 	while (1) {
-		if (meas_common.gpsAcq(&gpsEvt) != 0) {
+		if (meas_calibExpired(meas, progress, deadline)) {
+			return -1;
+		}
+
+		if (meas->gpsAcq(meas, &gpsEvt) != 0) {
 			return -1;
 		}
-		ekflog_gpsWrite(&gpsEvt);
+		ekflog_gpsWrite(meas->log, &gpsEvt);
 		if (gpsEvt.gps.fix > 0) {
 			break;
 		}
 		printf("Awaiting GPS fix...\n");
-		sleep(4);
+		meas_calibSleepMax(meas, 4000000, deadline);
 	}
 
 	/* Assuring gps fix */
 	while (1) {
-		if (meas_common.gpsAcq(&gpsEvt) != 0) {
+		if (meas_calibExpired(meas, progress, deadline)) {
+			return -1;
+		}
+
+		if (meas->gpsAcq(meas, &gpsEvt) != 0) {
 			return -1;
 		}
-		ekflog_gpsWrite(&gpsEvt);
+		ekflog_gpsWrite(meas->log, &gpsEvt);
 		if (gpsEvt.gps.hdop < 500) {
 			break;
 		}
 		printf("Awaiting good quality GPS (current hdop = %d)\n", gpsEvt.gps.hdop);
-		sleep(4);
+		meas_calibSleepMax(meas, 4000000, deadline);
 	}
 
+	meas_calibStageSet(progress, calibSampling);
+
 	i = 0;
-	printf("Sampling gps position");
 	while (i < avg) {
-		if (meas_common.gpsAcq(&gpsEvt) < 0) {
+		if (meas_calibExpired(meas, progress, deadline)) {
+			return -1;
+		}
+
+		if (meas->gpsAcq(meas, &gpsEvt) < 0) {
 			if (++fails > MAX_CONSECUTIVE_FAILS) {
 				return -1;
 			}
 
-			sleep(1);
+			meas_calibSleep(meas, 1000000);
 			continue;
 		}
-		printf(".");
-		ekflog_gpsWrite(&gpsEvt);
+		ekflog_gpsWrite(meas->log, &gpsEvt);
 		refPos.lat += (double)gpsEvt.gps.lat / 1e9;
 		refPos.lon += (double)gpsEvt.gps.lon / 1e9;
 		refPos.h += gpsEvt.gps.alt / 1e3;
-		i++;
+		meas_calibSamplesSet(progress, ++i);
 	}
-	printf("\n");
 	refPos.lat /= avg;
 	refPos.lon /= avg;
 	refPos.h /= avg;
 
 	/* Calculating geodetic reference point */
-	meas_common.calib.gps.refGeodetic = refPos;
+	meas->calib.gps.refGeodetic = refPos;
 
-	meas_common.calib.gps.refGeodetic.sinLat = sin(meas_common.calib.gps.refGeodetic.lat * DEG2RAD);
-	meas_common.calib.gps.refGeodetic.cosLat = cos(meas_common.calib.gps.refGeodetic.lat * DEG2RAD);
-	meas_common.calib.gps.refGeodetic.sinLon = sin(meas_common.calib.gps.refGeodetic.lon * DEG2RAD);
-	meas_common.calib.gps.refGeodetic.cosLon = cos(meas_common.calib.gps.refGeodetic.lon * DEG2RAD);
+	meas->calib.gps.refGeodetic.sinLat = sin(meas->calib.gps.refGeodetic.lat * DEG2RAD);
+	meas->calib.gps.refGeodetic.cosLat = cos(meas->calib.gps.refGeodetic.lat * DEG2RAD);
+	meas->calib.gps.refGeodetic.sinLon = sin(meas->calib.gps.refGeodetic.lon * DEG2RAD);
+	meas->calib.gps.refGeodetic.cosLon = cos(meas->calib.gps.refGeodetic.lon * DEG2RAD);
 
-	meas_geo2ecef(&meas_common.calib.gps.refGeodetic, meas_common.calib.gps.refEcef);
+	meas_geo2ecef(&meas->calib.gps.refGeodetic, meas->calib.gps.refEcef);
 
-	printf("Acquired GPS position of (lat/lon/h): %f/%f/%f\n", meas_common.calib.gps.refGeodetic.lat, meas_common.calib.gps.refGeodetic.lon, meas_common.calib.gps.refGeodetic.h);
+	printf("Acquired GPS position of (lat/lon/h): %f/%f/%f\n", meas->calib.gps.refGeodetic.lat, meas->calib.gps.refGeodetic.lon, meas->calib.gps.refGeodetic.h);
 
 	return 0;
 }
 
 
+int meas_gpsCalib(meas_ctx_t *meas, time_t timeout)
+{
+	return meas_calibRun(meas, &meas->calibProgress.gps, GPS_CALIB_AVG, timeout, meas_gpsCalibRun);
+}
+
+
 static void meas_acc2si(sensor_event_t *evt, vec_t *vec)
 {
 	vec->x = evt->accels.accelX / 1000.F;
@@ -347,7 +540,7 @@ static void meas_mag2si(sensor_event_t *evt, vec_t *vec)
 }
 
 
-int meas_imuCalib(void)
+static int meas_imuCalibRun(meas_ctx_t *meas, meas_calibProgress_t *progress, time_t deadline)
 {
 	static const vec_t nedG = { .x = 0, .y = 0, .z = -1 }; /* earth acceleration versor in NED frame of reference */
 	static const vec_t nedY = { .x = 0, .y = 1, .z = 0 };  /* earth y versor (east) in NED frame of reference */
@@ -360,12 +553,16 @@ int meas_imuCalib(void)
 	quat_idenWrite(&idenQuat);
 	accAvg = gyrAvg = magAvg = (vec_t) { .x = 0, .y = 0, .z = 0 };
 
-	printf("IMU calibration...\n");
+	meas_calibStageSet(progress, calibSampling);
 
 	i = 0;
 	while (i < avg) {
-		if (meas_common.imuAcq(&accEvt, &gyrEvt, &magEvt) >= 0) {
-			ekflog_imuWrite(&accEvt, &gyrEvt, &magEvt);
+		if (meas_calibExpired(meas, progress, deadline)) {
+			return -1;
+		}
+
+		if (meas->imuAcq(meas, &accEvt, &gyrEvt, &magEvt) >= 0) {
+			ekflog_imuWrite(meas->log, &accEvt, &gyrEvt, &magEvt);
 			meas_acc2si(&accEvt, &acc);
 			meas_gyr2si(&gyrEvt, &gyr);
 			meas_mag2si(&magEvt, &mag);
@@ -373,219 +570,453 @@ int meas_imuCalib(void)
 			vec_add(&accAvg, &acc);
 			vec_add(&gyrAvg, &gyr);
 			vec_add(&magAvg, &mag);
-			usleep(1000 * 5);
-			i++;
+			meas_calibSleep(meas, 1000 * 5);
+			meas_calibSamplesSet(progress, ++i);
 		}
 		else {
 			if (++fails > MAX_CONSECUTIVE_FAILS) {
 				return -1;
 			}
 
-			usleep(1000 * 1);
+			meas_calibSleep(meas, 1000 * 1);
 		}
 	}
 	vec_times(&accAvg, 1. / (float)avg);
 	vec_times(&gyrAvg, 1. / (float)avg);
 	vec_times(&magAvg, 1. / (float)avg);
 
-	meas_common.calib.imu.gyroBias = gyrAvg; /* save gyro drift parameters */
-	meas_common.calib.imu.initMag = magAvg;  /* save initial magnetometer reading */
+	meas->calib.imu.gyroBias = gyrAvg; /* save gyro drift parameters */
+	meas->calib.imu.initMag = magAvg;  /* save initial magnetometer reading */
 
 	/* calculate initial rotation */
 	vec_normalize(&accAvg);
 	vec_normalize(&magAvg);
 	vec_cross(&magAvg, &accAvg, &bodyY);
-	quat_frameRot(&accAvg, &bodyY, &nedG, &nedY, &meas_common.calib.imu.initQuat, &idenQuat);
+	quat_frameRot(&accAvg, &bodyY, &nedG, &nedY, &meas->calib.imu.initQuat, &idenQuat);
 
 	return 0;
 }
 
-int meas_baroCalib(void)
+
+int meas_imuCalib(meas_ctx_t *meas, time_t timeout)
+{
+	return meas_calibRun(meas, &meas->calibProgress.imu, IMU_CALIB_AVG, timeout, meas_imuCalibRun);
+}
+
+
+static int meas_baroCalibRun(meas_ctx_t *meas, meas_calibProgress_t *progress, time_t deadline)
 {
 	int i, avg = BARO_CALIB_AVG, fails = 0;
 	uint64_t press = 0, temp = 0;
 	sensor_event_t baroEvt;
 
-	printf("Barometer calibration...\n");
+	meas_calibStageSet(progress, calibSampling);
 
 	i = 0;
 	while (i < avg) {
-		if (meas_common.baroAcq(&baroEvt) >= 0) {
-			ekflog_baroWrite(&baroEvt);
+		if (meas_calibExpired(meas, progress, deadline)) {
+			return -1;
+		}
+
+		if (meas->baroAcq(meas, &baroEvt) >= 0) {
+			ekflog_baroWrite(meas->log, &baroEvt);
 			press += baroEvt.baro.pressure;
 			temp += baroEvt.baro.temp;
-			i++;
-			usleep(1000 * 20);
+			meas_calibSamplesSet(progress, ++i);
+			meas_calibSleep(meas, 1000 * 20);
 		}
 		else {
 			if (++fails > MAX_CONSECUTIVE_FAILS) {
 				return -1;
 			}
 
-			usleep(1000 * 10);
+			meas_calibSleep(meas, 1000 * 10);
 		}
 	}
 
-	meas_common.calib.baro.basePress = (float)press / avg;
-	meas_common.calib.baro.baseTemp = (float)temp / avg;
+	meas->calib.baro.basePress = (float)press / avg;
+	meas->calib.baro.baseTemp = (float)temp / avg;
 
 	return 0;
 }
 
 
-int meas_imuPoll(time_t *timestamp)
+int meas_baroCalib(meas_ctx_t *meas, time_t timeout)
+{
+	return meas_calibRun(meas, &meas->calibProgress.baro, BARO_CALIB_AVG, timeout, meas_baroCalibRun);
+}
+
+
+/* Returns 0 if IMU is stationary and measured gravity and magnetic field agree with attitude `att` persisted along with `calib` */
+static int meas_warmImuCheck(meas_ctx_t *meas, const meas_calib_t *calib, const quat_t *att)
 {
-	static sensor_event_t gyrEvtOld = { 0 };
+	static const vec_t nedG = { .x = 0, .y = 0, .z = -1 }; /* earth acceleration versor in NED frame of reference */
 
+	int i, fails = 0;
+	float accSqAvg = 0, accVar;
+	vec_t acc, gyr, mag, accAvg, gyrAvg, magAvg, magRef;
 	sensor_event_t accEvt, gyrEvt, magEvt;
 
-	if (meas_common.imuAcq(&accEvt, &gyrEvt, &magEvt) < 0) {
-		return EOF;
+	accAvg = gyrAvg = magAvg = (vec_t) { .x = 0, .y = 0, .z = 0 };
+
+	i = 0;
+	while (i < WARM_IMU_AVG) {
+		if (meas->imuAcq(meas, &accEvt, &gyrEvt, &magEvt) >= 0) {
+			ekflog_imuWrite(meas->log, &accEvt, &gyrEvt, &magEvt);
+			meas_acc2si(&accEvt, &acc);
+			meas_gyr2si(&gyrEvt, &gyr);
+			meas_mag2si(&magEvt, &mag);
+
+			vec_add(&accAvg, &acc);
+			vec_add(&gyrAvg, &gyr);
+			vec_add(&magAvg, &mag);
+			accSqAvg += vec_dot(&acc, &acc);
+			meas_calibSleep(meas, 1000 * 5);
+			i++;
+		}
+		else {
+			if (++fails > MAX_CONSECUTIVE_FAILS) {
+				return -1;
+			}
+
+			meas_calibSleep(meas, 1000 * 1);
+		}
+	}
+	vec_times(&accAvg, 1. / WARM_IMU_AVG);
+	vec_times(&gyrAvg, 1. / WARM_IMU_AVG);
+	vec_times(&magAvg, 1. / WARM_IMU_AVG);
+	accSqAvg /= WARM_IMU_AVG;
+
+	/* stationary IMU measures only gyro bias and constant acceleration */
+	vec_sub(&gyrAvg, &calib->imu.gyroBias);
+	accVar = accSqAvg - vec_dot(&accAvg, &accAvg);
+	if (vec_len(&gyrAvg) > WARM_GYRO_MAX || accVar > WARM_ACC_STDEV_MAX * WARM_ACC_STDEV_MAX) {
+		printf("Warm start: IMU is not stationary\n");
+		return -1;
 	}
 
-	if (timestamp != NULL) {
-		*timestamp = gyrEvt.timestamp;
+	/* vehicle was not turned: body frame measurements rotated with `att` point where they pointed at calibration */
+	vec_normalize(&accAvg);
+	quat_vecRot(&accAvg, att);
+
+	vec_normalize(&magAvg);
+	quat_vecRot(&magAvg, att);
+	magRef = calib->imu.initMag;
+	vec_normalize(&magRef);
+	quat_vecRot(&magRef, &calib->imu.initQuat);
+
+	if (vec_dot(&accAvg, &nedG) < WARM_GRAV_COS_MIN || vec_dot(&magAvg, &magRef) < WARM_MAG_COS_MIN) {
+		printf("Warm start: attitude differs from persisted one\n");
+		return -1;
 	}
 
-	/* these timestamps do not need to be very accurate */
-	meas_common.data.timeImu = gyrEvt.timestamp;
+	return 0;
+}
 
-	ekflog_imuWrite(&accEvt, &gyrEvt, &magEvt);
 
-	meas_acc2si(&accEvt, &meas_common.data.accelRaw); /* accelerations from mm/s^2 -> m/s^2 */
-	meas_mag2si(&magEvt, &meas_common.data.mag);      /* only magnitude matters from geomagnetism */
+/* Returns 0 if mean pressure is within WARM_PRESS_TOL from `press` */
+static int meas_warmBaroCheck(meas_ctx_t *meas, float press)
+{
+	int i, fails = 0;
+	uint64_t sum = 0;
+	sensor_event_t baroEvt;
 
-	/* If sensorhub integral values produce wrongful data (too long/short timestep) use direct gyro output */
-	if (meas_dAngle2si(&gyrEvt, &gyrEvtOld, &meas_common.data.gyroRaw) != 0) {
-		meas_gyr2si(&gyrEvt, &meas_common.data.gyroRaw);
+	i = 0;
+	while (i < WARM_BARO_AVG) {
+		if (meas->baroAcq(meas, &baroEvt) >= 0) {
+			ekflog_baroWrite(meas->log, &baroEvt);
+			sum += baroEvt.baro.pressure;
+			i++;
+			meas_calibSleep(meas, 1000 * 20);
+		}
+		else {
+			if (++fails > MAX_CONSECUTIVE_FAILS) {
+				return -1;
+			}
+
+			meas_calibSleep(meas, 1000 * 10);
+		}
 	}
 
-	/* gyro niveling */
-	vec_sub(&meas_common.data.gyroRaw, &meas_common.calib.imu.gyroBias);
+	if (fabs((float)sum / WARM_BARO_AVG - press) > WARM_PRESS_TOL) {
+		printf("Warm start: pressure differs from persisted one\n");
+		return -1;
+	}
 
-	meas_common.data.accelFltr = meas_common.data.accelRaw;
-	meas_common.data.gyroFltr = meas_common.data.gyroRaw;
-	fltr_accLpf(&meas_common.data.accelFltr);
-	fltr_gyroLpf(&meas_common.data.gyroFltr);
+	return 0;
+}
+
+
+int meas_warmCheck(meas_ctx_t *meas, const meas_calib_t *calib, const quat_t *att, float press)
+{
+	printf("Warm start check...\n");
+
+	if (meas_warmImuCheck(meas, calib, att) != 0) {
+		return -1;
+	}
+
+	if (press > 0 && meas_warmBaroCheck(meas, press) != 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+
+int meas_imuWait(meas_ctx_t *meas, time_t timeout)
+{
+	/* logged samples can be read right away */
+	if (meas->imuWait == NULL) {
+		return 0;
+	}
+
+	return meas->imuWait((int)((timeout + 999) / 1000));
+}
+
+
+/* Adds IMU sample to preintegrated rotation and velocity change. `gyro` and `accel` are treated as constant since previous sample */
+static void meas_imuPreintegrate(meas_ctx_t *meas, const vec_t *gyro, const vec_t *accel, time_t timestamp)
+{
+	vec_t dAngle, dVelo, dVeloSum, tmp;
+	quat_t dq, q;
+	float dt;
+
+	/* first sample and repeated reads of the same sample only set the interval start */
+	if (meas->preint.lastTime == 0 || timestamp <= meas->preint.lastTime) {
+		if (meas->preint.lastTime == 0) {
+			meas->preint.lastTime = timestamp;
+		}
+		return;
+	}
+
+	dt = (float)(timestamp - meas->preint.lastTime) / 1000000.f;
+	meas->preint.sum.dt += timestamp - meas->preint.lastTime;
+	meas->preint.lastTime = timestamp;
+
+	/* sample increments. Gyro rate derived from sensorhub delta angle gives exact angle increment */
+	dAngle = *gyro;
+	vec_times(&dAngle, dt);
+	dVelo = *accel;
+	vec_times(&dVelo, dt);
+
+	/* velocity increment with rotation compensation 1/2 * dAngle x dVelo */
+	vec_cross(&dAngle, &dVelo, &dVeloSum);
+	vec_times(&dVeloSum, 0.5f);
+	vec_add(&dVeloSum, &dVelo);
+
+	/* sculling compensation 1/12 * (dAnglePrev x dVelo + dVeloPrev x dAngle) */
+	vec_cross(&meas->preint.dAnglePrev, &dVelo, &tmp);
+	vec_times(&tmp, 1.f / 12.f);
+	vec_add(&dVeloSum, &tmp);
+	vec_cross(&meas->preint.dVeloPrev, &dAngle, &tmp);
+	vec_times(&tmp, 1.f / 12.f);
+	vec_add(&dVeloSum, &tmp);
+
+	/* velocity increment is expressed in body frame at the sample start, rotation to interval start frame */
+	quat_vecRot(&dVeloSum, &meas->preint.sum.dq);
+	vec_add(&meas->preint.sum.dv, &dVeloSum);
+
+	/* rotation increment with coning compensation 1/12 * dAnglePrev x dAngle */
+	vec_cross(&meas->preint.dAnglePrev, &dAngle, &tmp);
+	vec_times(&tmp, 1.f / 12.f);
+	vec_add(&tmp, &dAngle);
+
+	quat_rotQuat(&tmp, vec_len(&tmp), &dq);
+	quat_mlt(&meas->preint.sum.dq, &dq, &q);
+	quat_normalize(&q);
+	meas->preint.sum.dq = q;
+
+	meas->preint.dAnglePrev = dAngle;
+	meas->preint.dVeloPrev = dVelo;
+}
+
+
+int meas_imuPreintGet(meas_ctx_t *meas, meas_imuPreint_t *preint)
+{
+	*preint = meas->preint.sum;
+	meas_imuPreintReset(meas);
+
+	return 0;
+}
+
+
+int meas_imuPoll(meas_ctx_t *meas, time_t *timestamp)
+{
+	sensor_event_t accEvt[IMU_POLL_MAX], gyrEvt[IMU_POLL_MAX], magEvt[IMU_POLL_MAX];
+	int i, cnt;
+
+	/* every sample buffered since previous poll is integrated, so IMU rate is not limited by loop rate */
+	cnt = meas->imuAllAcq(meas, accEvt, gyrEvt, magEvt, IMU_POLL_MAX);
+	if (cnt <= 0) {
+		return EOF;
+	}
+
+	for (i = 0; i < cnt; i++) {
+		ekflog_imuWrite(meas->log, &accEvt[i], &gyrEvt[i], &magEvt[i]);
+
+		meas_acc2si(&accEvt[i], &meas->data.accelRaw); /* accelerations from mm/s^2 -> m/s^2 */
+
+		/* If sensorhub integral values produce wrongful data (too long/short timestep) use direct gyro output */
+		if (meas_dAngle2si(&gyrEvt[i], &meas->data.gyrEvtOld, &meas->data.gyroRaw) != 0) {
+			meas_gyr2si(&gyrEvt[i], &meas->data.gyroRaw);
+		}
+		meas->data.gyrEvtOld = gyrEvt[i];
+
+		/* gyro niveling */
+		vec_sub(&meas->data.gyroRaw, &meas->calib.imu.gyroBias);
+
+		/* sensorhub provides no delta velocity, acceleration is held constant since previous sample */
+		meas_imuPreintegrate(meas, &meas->data.gyroRaw, &meas->data.accelRaw, gyrEvt[i].timestamp);
+	}
+	cnt--;
+
+	if (timestamp != NULL) {
+		*timestamp = gyrEvt[cnt].timestamp;
+	}
+
+	/* these timestamps do not need to be very accurate */
+	meas->data.timeImu = gyrEvt[cnt].timestamp;
+
+	meas_mag2si(&magEvt[cnt], &meas->data.mag); /* only magnitude matters from geomagnetism */
+
+	/* filters are tuned for loop rate, so they get only the newest sample */
+	meas->data.accelFltr = meas->data.accelRaw;
+	meas->data.gyroFltr = meas->data.gyroRaw;
+	fltr_accLpf(&meas->fltr, &meas->data.accelFltr);
+	fltr_gyroLpf(&meas->fltr, &meas->data.gyroFltr);
 
 	return 0;
 }
 
 
-int meas_baroPoll(void)
+int meas_baroPoll(meas_ctx_t *meas, time_t *timestamp)
 {
 	sensor_event_t baroEvt;
 
-	if (meas_common.baroAcq(&baroEvt) < 0) {
+	if (meas->baroAcq(meas, &baroEvt) < 0) {
 		return EOF;
 	}
 
-	ekflog_baroWrite(&baroEvt);
+	if (timestamp != NULL) {
+		*timestamp = baroEvt.timestamp;
+	}
+
+	ekflog_baroWrite(meas->log, &baroEvt);
 
-	meas_common.data.timeBaro = baroEvt.timestamp;
-	meas_common.data.temp = baroEvt.baro.temp;
-	meas_common.data.pressure = baroEvt.baro.pressure;
+	meas->data.timeBaro = baroEvt.timestamp;
+	meas->data.temp = baroEvt.baro.temp;
+	meas->data.pressure = baroEvt.baro.pressure;
 
 	return 0;
 }
 
 
-int meas_gpsPoll(void)
+int meas_gpsPoll(meas_ctx_t *meas, time_t *timestamp)
 {
 	sensor_event_t gpsEvt;
 	meas_geodetic_t geo;
 
-	if (meas_common.gpsAcq(&gpsEvt) < 0) {
+	if (meas->gpsAcq(meas, &gpsEvt) < 0) {
 		return EOF;
 	}
 
-	ekflog_gpsWrite(&gpsEvt);
+	if (timestamp != NULL) {
+		*timestamp = gpsEvt.timestamp;
+	}
+
+	ekflog_gpsWrite(meas->log, &gpsEvt);
 
 	/* save timestamp */
-	meas_common.data.timeGps = gpsEvt.timestamp;
+	meas->data.timeGps = gpsEvt.timestamp;
 
 	/* Transformation from sensor data -> geodetic -> ned data */
 	meas_gps2geo(&gpsEvt, &geo);
-	meas_geo2ned(&geo, &meas_common.calib.gps.refGeodetic, meas_common.calib.gps.refEcef, &meas_common.data.gps.pos);
-
-	meas_common.data.gps.lat = geo.lat;
-	meas_common.data.gps.lon = geo.lon;
-	meas_common.data.gps.eph = (float)(gpsEvt.gps.eph) / 1000.f;
-	meas_common.data.gps.epv = (float)(gpsEvt.gps.evel) / 1000.f;
-	meas_common.data.gps.fix = gpsEvt.gps.fix;
-	meas_common.data.gps.satsNb = gpsEvt.gps.satsNb;
-	meas_common.data.gps.vel.x = (float)gpsEvt.gps.velNorth / 1e3;
-	meas_common.data.gps.vel.y = (float)gpsEvt.gps.velEast / 1e3;
-	meas_common.data.gps.vel.z = -(float)gpsEvt.gps.velDown / 1e3;
+	meas_geo2ned(&geo, &meas->calib.gps.refGeodetic, meas->calib.gps.refEcef, &meas->data.gps.pos);
+
+	meas->data.gps.lat = geo.lat;
+	meas->data.gps.lon = geo.lon;
+	meas->data.gps.eph = (float)(gpsEvt.gps.eph) / 1000.f;
+	meas->data.gps.epv = (float)(gpsEvt.gps.evel) / 1000.f;
+	meas->data.gps.fix = gpsEvt.gps.fix;
+	meas->data.gps.satsNb = gpsEvt.gps.satsNb;
+	meas->data.gps.vel.x = (float)gpsEvt.gps.velNorth / 1e3;
+	meas->data.gps.vel.y = (float)gpsEvt.gps.velEast / 1e3;
+	meas->data.gps.vel.z = -(float)gpsEvt.gps.velDown / 1e3;
 
 	return 0;
 }
 
 
-int meas_accelGet(vec_t *accels, vec_t *accelsRaw)
+int meas_accelGet(meas_ctx_t *meas, vec_t *accels, vec_t *accelsRaw)
 {
-	*accels = meas_common.data.accelFltr;
-	*accelsRaw = meas_common.data.accelRaw;
+	*accels = meas->data.accelFltr;
+	*accelsRaw = meas->data.accelRaw;
 
 	return 0;
 }
 
 
-int meas_gyroGet(vec_t *gyro, vec_t *gyroRaw)
+int meas_gyroGet(meas_ctx_t *meas, vec_t *gyro, vec_t *gyroRaw)
 {
-	*gyro = meas_common.data.gyroFltr;
-	*gyroRaw = meas_common.data.gyroRaw;
+	*gyro = meas->data.gyroFltr;
+	*gyroRaw = meas->data.gyroRaw;
 
 	return 0;
 }
 
 
-int meas_magGet(vec_t *mag)
+int meas_magGet(meas_ctx_t *meas, vec_t *mag)
 {
-	*mag = meas_common.data.mag;
+	*mag = meas->data.mag;
 
 	return 0;
 }
 
 
-int meas_baroGet(float *pressure, float *temperature, uint64_t *timestamp)
+int meas_baroGet(meas_ctx_t *meas, float *pressure, float *temperature, uint64_t *timestamp)
 {
-	*pressure = meas_common.data.pressure;
-	*temperature = meas_common.data.temp;
-	*timestamp = meas_common.data.timeBaro;
+	*pressure = meas->data.pressure;
+	*temperature = meas->data.temp;
+	*timestamp = meas->data.timeBaro;
 
 	return 0;
 }
 
 
-int meas_timeGet(time_t *useconds)
+int meas_timeGet(meas_ctx_t *meas, time_t *useconds)
 {
-	if (meas_common.timeAcq(useconds) != 0) {
+	if (meas->timeAcq(meas, useconds) != 0) {
 		return -1;
 	}
 
-	ekflog_timeWrite(*useconds);
+	ekflog_timeWrite(meas->log, *useconds);
 
 	return 0;
 }
 
 
-int meas_gpsGet(meas_gps_t *gpsData, time_t *timestamp)
+int meas_gpsGet(meas_ctx_t *meas, meas_gps_t *gpsData, time_t *timestamp)
 {
-	*gpsData = meas_common.data.gps;
-	*timestamp = meas_common.data.timeGps;
+	*gpsData = meas->data.gps;
+	*timestamp = meas->data.timeGps;
 
 	return 0;
 }
 
 
-const meas_calib_t *meas_calibGet(void)
+const meas_calib_t *meas_calibGet(meas_ctx_t *meas)
+{
+	return &meas->calib;
+}
+
+
+void meas_calibSet(meas_ctx_t *meas, const meas_calib_t *calib)
 {
-	return &meas_common.calib;
+	meas->calib = *calib;
 }
 
 
-float meas_calibPressGet(void)
+float meas_calibPressGet(meas_ctx_t *meas)
 {
-	return meas_common.calib.baro.basePress;
+	return meas->calib.baro.basePress;
 }
@@ -23,6 +23,12 @@
 #ifndef _EKF_MEAS_T_
 #define _EKF_MEAS_T_
 
+#include <libsensors.h>
+
+#include "filters.h"
+#include "logs/reader.h"
+#include "logs/writer.h"
+
 
 /* clang-format off */
 typedef enum { srcSens = 0, srcLog } meas_sourceType_t;
@@ -42,6 +48,22 @@ typedef struct {
 } meas_geodetic_t;
 
 
+/* clang-format off */
+typedef enum { calibPending = 0, calibWaiting, calibSampling, calibDone, calibFailed, calibTimeout } meas_calibStage_t;
+/* clang-format on */
+
+
+/*
+ * Calibration progress of one sensor. Written by its calibration procedure, can be read by other threads:
+ * `stage` and `samples` with __atomic_load_n(), `total` after acquire load of `stage` other than `calibPending`
+ */
+typedef struct {
+	meas_calibStage_t stage;
+	unsigned int samples; /* samples averaged so far */
+	unsigned int total;   /* samples needed */
+} meas_calibProgress_t;
+
+
 /* initial values calculated during calibration */
 typedef struct {
 	struct {
@@ -79,63 +101,157 @@ typedef struct {
 } meas_gps_t;
 
 
-extern int meas_init(meas_sourceType_t sourceType, const char *path, int senscInitFlags);
+/* IMU data integrated over time between two prediction steps */
+typedef struct {
+	quat_t dq; /* rotation of body frame over the interval, maps vectors from final to initial body frame */
+	vec_t dv;  /* velocity change in initial body frame of reference, gravity not removed (m/s) */
+	time_t dt; /* interval length in microseconds */
+} meas_imuPreint_t;
+
+
+typedef struct meas_ctx meas_ctx_t;
+
 
+/* Measurement acquisition context. Sensor client is process-wide, so only one context may use `srcSens` source at a time */
+struct meas_ctx {
+	meas_sourceType_t sourceType;
 
-extern int meas_done(void);
+	int (*baroAcq)(meas_ctx_t *, sensor_event_t *);
+	int (*gpsAcq)(meas_ctx_t *, sensor_event_t *);
+	int (*imuAcq)(meas_ctx_t *, sensor_event_t *, sensor_event_t *, sensor_event_t *);
+	int (*imuAllAcq)(meas_ctx_t *, sensor_event_t *, sensor_event_t *, sensor_event_t *, unsigned int); /* returns number of samples */
+	int (*imuWait)(int); /* NULL if IMU data is always available */
+	int (*timeAcq)(meas_ctx_t *, time_t *);
+
+	ekflog_reader_t reader; /* used by `srcLog` source */
+	ekflog_writer_t *log;   /* acquired data is logged here */
+	fltr_ctx_t fltr;
+
+	meas_calib_t calib;
+
+	struct {
+		meas_calibProgress_t imu;
+		meas_calibProgress_t baro;
+		meas_calibProgress_t gps;
+	} calibProgress;
+
+	struct {
+		/* IMU related */
+		vec_t accelRaw;
+		vec_t accelFltr;
+		vec_t gyroRaw;
+		vec_t gyroFltr;
+		time_t timeImu;
+		sensor_event_t gyrEvtOld;
+
+		/* Magnetometer */
+		vec_t mag;
+		time_t timeMag;
+
+		/* Baro related */
+		float pressure;
+		float temp;
+		time_t timeBaro;
+
+		/* Gps related */
+		meas_gps_t gps;
+		time_t timeGps;
+	} data;
+
+	struct {
+		meas_imuPreint_t sum;
+		vec_t dAnglePrev; /* previous sample angle increment for coning/sculling terms */
+		vec_t dVeloPrev;  /* previous sample velocity increment for sculling term */
+		time_t lastTime;  /* timestamp of last integrated sample */
+	} preint;
+};
+
+
+/* Initializes `meas` for data from `sourceType` source. Acquired data is logged to `log` */
+extern int meas_init(meas_ctx_t *meas, meas_sourceType_t sourceType, const char *path, int senscInitFlags, ekflog_writer_t *log);
+
+
+/* Initializes `meas` for logs of `size` bytes read from `buf`. Buffer is only read, so it can be shared by many contexts */
+extern int meas_logBufInit(meas_ctx_t *meas, const void *buf, size_t size, ekflog_writer_t *log);
+
+
+extern int meas_done(meas_ctx_t *meas);
 
 
 /* CALIBRATION INITIALIZERS */
 
+/*
+ * Calibrations of different sensors may run concurrently in separate threads if data source is `srcSens`.
+ * Each of them fails if it does not finish within `timeout` microseconds, 0 means no limit. Logs never time out.
+ */
+
 /* obtain current IMU calibration parameters */
-extern int meas_imuCalib(void);
+extern int meas_imuCalib(meas_ctx_t *meas, time_t timeout);
 
 /* obtain current barometer calibration parameters */
-extern int meas_baroCalib(void);
+extern int meas_baroCalib(meas_ctx_t *meas, time_t timeout);
 
 /* obtain current gps calibration parameters */
-extern int meas_gpsCalib(void);
+extern int meas_gpsCalib(meas_ctx_t *meas, time_t timeout);
+
+/*
+ * Quickly checks if calibration `calib` and attitude `att` persisted before restart are still valid: IMU has to be stationary
+ * and measure gravity and magnetic field in directions expected from `att`. If `press` is positive, pressure has to be close to it.
+ * Returns 0 if they are valid, -1 otherwise.
+ */
+extern int meas_warmCheck(meas_ctx_t *meas, const meas_calib_t *calib, const quat_t *att, float press);
 
 
 /* CALIBRATION GETTERS */
 
 /* Return pointer to full calibration data */
-extern const meas_calib_t *meas_calibGet(void);
+extern const meas_calib_t *meas_calibGet(meas_ctx_t *meas);
+
+/* Replaces calibration data, e.g. with one persisted before restart */
+extern void meas_calibSet(meas_ctx_t *meas, const meas_calib_t *calib);
 
 /* returns the calibration pressure in Pascals */
-extern float meas_calibPressGet(void);
+extern float meas_calibPressGet(meas_ctx_t *meas);
 
 
 /* MEASUREMENT ACQUISITION */
 
+/* Waits up to `timeout` microseconds for new IMU data. Returns 0 if data is ready, -1 on timeout or error */
+extern int meas_imuWait(meas_ctx_t *meas, time_t timeout);
+
+
 /*
+ * Poll functions write timestamp of acquired measurement to `timestamp` if it is not NULL.
  * In case of success poll functions returns 0;
  * If end-of-file is encountered returns EOF.
  * In case of an error returns EOF and sets appropriate errno value.
  */
 
-extern int meas_imuPoll(time_t *timestamp);
+extern int meas_imuPoll(meas_ctx_t *meas, time_t *timestamp);
+
+extern int meas_baroPoll(meas_ctx_t *meas, time_t *timestamp);
 
-extern int meas_baroPoll(void);
+extern int meas_gpsPoll(meas_ctx_t *meas, time_t *timestamp);
 
-extern int meas_gpsPoll(void);
+/* Returns IMU data preintegrated since previous call and starts new integration interval */
+extern int meas_imuPreintGet(meas_ctx_t *meas, meas_imuPreint_t *preint);
 
 /* Returns prepared IMU data in SI units */
-extern int meas_accelGet(vec_t *accels, vec_t *accelsRaw);
+extern int meas_accelGet(meas_ctx_t *meas, vec_t *accels, vec_t *accelsRaw);
 
-extern int meas_gyroGet(vec_t *gyro, vec_t *gyroRaw);
+extern int meas_gyroGet(meas_ctx_t *meas, vec_t *gyro, vec_t *gyroRaw);
 
-extern int meas_magGet(vec_t *mag);
+extern int meas_magGet(meas_ctx_t *meas, vec_t *mag);
 
 /* Returns prepared barometer data in SI units */
-extern int meas_baroGet(float *pressure, float *temperature, uint64_t *dtBaroUs);
+extern int meas_baroGet(meas_ctx_t *meas, float *pressure, float *temperature, uint64_t *dtBaroUs);
 
 /* Returns prepared GPS data in SI units */
-extern int meas_gpsGet(meas_gps_t *gpsData, time_t *timestamp);
+extern int meas_gpsGet(meas_ctx_t *meas, meas_gps_t *gpsData, time_t *timestamp);
 
-extern int meas_timeGet(time_t *useconds);
+extern int meas_timeGet(meas_ctx_t *meas, time_t *useconds);
 
 /* Returns (east, north) local frame coords of lat/lon  geodesic point */
-extern int meas_latlon2en(double lat, double lon, float *east, float *north);
+extern int meas_latlon2en(meas_ctx_t *meas, double lat, double lon, float *east, float *north);
 
 #endif
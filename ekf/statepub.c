@@ -0,0 +1,130 @@
+/*
+ * Phoenix-Pilot
+ *
+ * extended kalman filter
+ *
+ * state snapshot published by stepping thread to any number of readers
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include "statepub.h"
+
+
+int statepub_init(statepub_t *pub)
+{
+	pthread_condattr_t attr;
+
+	pub->seq = 0;
+	pub->waiters = 0;
+
+	if (pthread_condattr_init(&attr) != 0) {
+		return -1;
+	}
+
+	/* statepub_wait() timeouts are measured with monotonic clock */
+	if (pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) != 0) {
+		pthread_condattr_destroy(&attr);
+		return -1;
+	}
+
+	if (pthread_cond_init(&pub->cond, &attr) != 0) {
+		pthread_condattr_destroy(&attr);
+		return -1;
+	}
+	pthread_condattr_destroy(&attr);
+
+	if (pthread_mutex_init(&pub->lock, NULL) != 0) {
+		pthread_cond_destroy(&pub->cond);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+void statepub_done(statepub_t *pub)
+{
+	pthread_cond_destroy(&pub->cond);
+	pthread_mutex_destroy(&pub->lock);
+}
+
+
+void statepub_write(statepub_t *pub, const ekf_state_t *state)
+{
+	uint64_t seq;
+
+	/* only this thread writes the snapshot, so `seq` can be read plainly */
+	seq = pub->seq;
+	__atomic_store_n(&pub->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	pub->state = *state;
+	__atomic_store_n(&pub->seq, seq + 2, __ATOMIC_RELEASE);
+
+	/* full fence pairs with the one in statepub_wait(): either waiter is seen here or it sees the new `seq` before sleeping */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&pub->waiters, __ATOMIC_RELAXED) != 0) {
+		pthread_mutex_lock(&pub->lock);
+		pthread_cond_broadcast(&pub->cond);
+		pthread_mutex_unlock(&pub->lock);
+	}
+}
+
+
+uint64_t statepub_read(statepub_t *pub, ekf_state_t *state)
+{
+	uint64_t seq;
+
+	/* copy is retried if new snapshot was published in the meantime */
+	do {
+		seq = __atomic_load_n(&pub->seq, __ATOMIC_ACQUIRE);
+		*state = pub->state;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) != 0 || seq != __atomic_load_n(&pub->seq, __ATOMIC_RELAXED));
+
+	return seq >> 1;
+}
+
+
+int statepub_wait(statepub_t *pub, ekf_state_t *state, time_t timeoutUs, uint64_t *seq)
+{
+	struct timespec deadline;
+	uint64_t published;
+	int err = 0;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &deadline) != 0) {
+		statepub_read(pub, state);
+		return -1;
+	}
+
+	deadline.tv_sec += timeoutUs / 1000000;
+	deadline.tv_nsec += (timeoutUs % 1000000) * 1000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	__atomic_add_fetch(&pub->waiters, 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	pthread_mutex_lock(&pub->lock);
+	while ((__atomic_load_n(&pub->seq, __ATOMIC_ACQUIRE) >> 1) == *seq && err == 0) {
+		err = pthread_cond_timedwait(&pub->cond, &pub->lock, &deadline);
+	}
+	pthread_mutex_unlock(&pub->lock);
+
+	__atomic_sub_fetch(&pub->waiters, 1, __ATOMIC_RELAXED);
+
+	published = statepub_read(pub, state);
+	if (published == *seq) {
+		return -1;
+	}
+
+	*seq = published;
+
+	return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Phoenix-Pilot
+ *
+ * extended kalman filter
+ *
+ * state snapshot published by stepping thread to any number of readers
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#ifndef _EKF_STATEPUB_
+#define _EKF_STATEPUB_
+
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "ekflib.h"
+
+
+/* Snapshot is guarded by a sequence lock, so readers never block the writer. Odd `seq` means snapshot is being written */
+typedef struct {
+	uint64_t seq;
+	ekf_state_t state;
+
+	/* wakes up statepub_wait() callers, not used by statepub_read(). Condition is signalled only if `waiters` is nonzero */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned int waiters;
+} statepub_t;
+
+
+extern int statepub_init(statepub_t *pub);
+
+
+extern void statepub_done(statepub_t *pub);
+
+
+/* Publishes `state`. Only one thread may publish to `pub` */
+extern void statepub_write(statepub_t *pub, const ekf_state_t *state);
+
+
+/* Copies the latest snapshot to `state` and returns its sequence number, i.e. the number of completed publications */
+extern uint64_t statepub_read(statepub_t *pub, ekf_state_t *state);
+
+
+/*
+ * Waits up to `timeoutUs` microseconds for snapshot with sequence number different from `*seq` and copies it to `state`.
+ * `*seq` is updated to sequence number of copied snapshot. On timeout the latest snapshot is copied anyway and -1 is returned.
+ */
+extern int statepub_wait(statepub_t *pub, ekf_state_t *state, time_t timeoutUs, uint64_t *seq);
+
+
+#endif
@@ -0,0 +1,32 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Unit tests of ekf core algorithms
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <unity_fixture.h>
+
+
+void runner(void)
+{
+	RUN_TEST_GROUP(group_kalman_update);
+	RUN_TEST_GROUP(group_kalman_updateAll);
+	RUN_TEST_GROUP(group_kalman_covDecim);
+	RUN_TEST_GROUP(group_warm);
+	RUN_TEST_GROUP(group_imu_preint);
+	RUN_TEST_GROUP(group_kmn_pred);
+	RUN_TEST_GROUP(group_statepub);
+}
+
+
+int main(int argc, char **argv)
+{
+	UnityMain(argc, (const char **)argv, runner);
+	return 0;
+}
@@ -0,0 +1,434 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Unit tests of ekf core algorithms
+ *
+ * IMU preintegration and prediction model driven by preintegrated data
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <unity_fixture.h>
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "../../meas.h"
+#include "../../kalman_core.h"
+#include "../../kalman_implem.h"
+#include "../../logs/writer.h"
+
+
+/* measurement filters read their windows relative to working directory, so tests run in this one */
+#define PREINT_TEST_DIR  "/tmp/ekf_preint_test"
+#define PREINT_TEST_FILE "imu.bin"
+
+#define PREINT_SAMPLES   11   /* number of logged IMU samples, one less integrated intervals */
+#define PREINT_PERIOD    1000 /* sample period in microseconds */
+#define PREINT_TIME0     5000 /* timestamp of first sample */
+#define PREINT_LOOP_STEP 2500 /* time step of the loop passed to model callbacks, differs from integration interval */
+
+#define PREINT_DELTA  1e-6f
+#define PREINT_QREL   1e-5f /* relative tolerance of noise terms */
+
+
+static uint8_t logBuf[4096];
+static size_t logLen;
+
+static ekflog_writer_t nolog;
+static meas_ctx_t meas;
+
+static const char *windows[] = { "etc/ekf_windows/gyro.txt", "etc/ekf_windows/accel.txt", "etc/ekf_windows/baro.txt" };
+static char cwd[PATH_MAX];
+
+
+/* Enters test directory with single tap filter windows, so filters pass samples unchanged */
+static void preintTests_dirEnter(void)
+{
+	unsigned int i;
+	FILE *file;
+	int err;
+
+	TEST_ASSERT_NOT_NULL(getcwd(cwd, sizeof(cwd)));
+
+	mkdir(PREINT_TEST_DIR, 0777);
+	mkdir(PREINT_TEST_DIR "/etc", 0777);
+	mkdir(PREINT_TEST_DIR "/etc/ekf_windows", 0777);
+	TEST_ASSERT_EQUAL_INT(0, chdir(PREINT_TEST_DIR));
+
+	for (i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+		file = fopen(windows[i], "w");
+		TEST_ASSERT_NOT_NULL(file);
+		fputs("1\n", file);
+		err = fclose(file);
+		TEST_ASSERT_EQUAL_INT(0, err);
+	}
+
+	TEST_ASSERT_EQUAL_INT(0, ekflog_writerInit(&nolog, NULL, 0));
+}
+
+
+static void preintTests_dirLeave(void)
+{
+	unsigned int i;
+
+	remove(PREINT_TEST_FILE);
+	for (i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+		remove(windows[i]);
+	}
+
+	chdir(cwd);
+
+	rmdir(PREINT_TEST_DIR "/etc/ekf_windows");
+	rmdir(PREINT_TEST_DIR "/etc");
+	rmdir(PREINT_TEST_DIR);
+}
+
+
+/*
+ * Writes IMU samples of constant angular rate `w` (rad/s) and specific force `a` (m/s^2) taken at `timestamps`.
+ * Sensorhub delta angle counters are cumulative, so they are consistent with `w` even for out of order timestamps.
+ */
+static void preintTests_logWrite(const vec_t *w, const vec_t *a, const time_t *timestamps, unsigned int n)
+{
+	sensor_event_t accEvt, gyrEvt, magEvt;
+	ekflog_writer_t writer;
+	unsigned int i;
+	FILE *file;
+	int err;
+
+	memset(&accEvt, 0, sizeof(accEvt));
+	memset(&gyrEvt, 0, sizeof(gyrEvt));
+	memset(&magEvt, 0, sizeof(magEvt));
+
+	accEvt.type = SENSOR_TYPE_ACCEL;
+	gyrEvt.type = SENSOR_TYPE_GYRO;
+	magEvt.type = SENSOR_TYPE_MAG;
+
+	/* mm/s^2 and mrad/s */
+	accEvt.accels.accelX = lroundf(a->x * 1000.f);
+	accEvt.accels.accelY = lroundf(a->y * 1000.f);
+	accEvt.accels.accelZ = lroundf(a->z * 1000.f);
+	gyrEvt.gyro.gyroX = lroundf(w->x * 1000.f);
+	gyrEvt.gyro.gyroY = lroundf(w->y * 1000.f);
+	gyrEvt.gyro.gyroZ = lroundf(w->z * 1000.f);
+	magEvt.mag.magX = 1;
+
+	TEST_ASSERT_EQUAL_INT(0, ekflog_writerInit(&writer, PREINT_TEST_FILE, EKFLOG_SENSC | EKFLOG_STRICT_MODE));
+
+	for (i = 0; i < n; i++) {
+		accEvt.timestamp = gyrEvt.timestamp = magEvt.timestamp = timestamps[i];
+
+		/* urad, rate in rad/s times time in us */
+		gyrEvt.gyro.dAngleX = (uint32_t)lroundf(w->x * (float)timestamps[i]);
+		gyrEvt.gyro.dAngleY = (uint32_t)lroundf(w->y * (float)timestamps[i]);
+		gyrEvt.gyro.dAngleZ = (uint32_t)lroundf(w->z * (float)timestamps[i]);
+
+		TEST_ASSERT_EQUAL_INT(0, ekflog_imuWrite(&writer, &accEvt, &gyrEvt, &magEvt));
+	}
+
+	TEST_ASSERT_EQUAL_INT(0, ekflog_writerDone(&writer));
+
+	file = fopen(PREINT_TEST_FILE, "rb");
+	TEST_ASSERT_NOT_NULL(file);
+	logLen = fread(logBuf, 1, sizeof(logBuf), file);
+	err = fclose(file);
+	TEST_ASSERT_EQUAL_INT(0, err);
+	TEST_ASSERT_GREATER_THAN(0, logLen);
+	TEST_ASSERT_LESS_THAN(sizeof(logBuf), logLen);
+
+	TEST_ASSERT_EQUAL_INT(0, meas_logBufInit(&meas, logBuf, logLen, &nolog));
+}
+
+
+/* Writes evenly spaced samples and integrates all of them */
+static void preintTests_run(const vec_t *w, const vec_t *a, meas_imuPreint_t *preint)
+{
+	time_t timestamps[PREINT_SAMPLES];
+	unsigned int i;
+
+	for (i = 0; i < PREINT_SAMPLES; i++) {
+		timestamps[i] = PREINT_TIME0 + i * PREINT_PERIOD;
+	}
+
+	preintTests_logWrite(w, a, timestamps, PREINT_SAMPLES);
+
+	TEST_ASSERT_EQUAL_INT(0, meas_imuPoll(&meas, NULL));
+	TEST_ASSERT_EQUAL_INT(0, meas_imuPreintGet(&meas, preint));
+}
+
+
+/* Checks that `q` is rotation by `|w| * t` about `w` */
+static void preintTests_rotCheck(const vec_t *w, float t, const quat_t *q)
+{
+	const float len = vec_len(w);
+	const float s = sinf(len * t / 2) / len;
+
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, cosf(len * t / 2), q->a);
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, w->x * s, q->i);
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, w->y * s, q->j);
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, w->z * s, q->k);
+}
+
+
+/* ##############################################################################
+ * ----------------------        IMU preintegration tests       -----------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_imu_preint);
+
+
+TEST_SETUP(group_imu_preint)
+{
+	preintTests_dirEnter();
+}
+
+
+TEST_TEAR_DOWN(group_imu_preint)
+{
+	meas_done(&meas);
+	preintTests_dirLeave();
+}
+
+
+TEST(group_imu_preint, preint_constRate)
+{
+	const vec_t w = { .x = 0.5f, .y = -0.3f, .z = 0.8f };
+	const vec_t a = { .x = 0, .y = 0, .z = 0 };
+	meas_imuPreint_t preint;
+
+	preintTests_run(&w, &a, &preint);
+
+	/* first sample only starts the interval */
+	TEST_ASSERT_EQUAL_INT64((PREINT_SAMPLES - 1) * PREINT_PERIOD, preint.dt);
+	preintTests_rotCheck(&w, (PREINT_SAMPLES - 1) * PREINT_PERIOD / 1000000.f, &preint.dq);
+
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, 0, preint.dv.x);
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, 0, preint.dv.y);
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, 0, preint.dv.z);
+}
+
+
+TEST(group_imu_preint, preint_constForce)
+{
+	const vec_t w = { .x = 0, .y = 0, .z = 0 };
+	const vec_t a = { .x = 1.f, .y = -2.f, .z = 9.81f };
+	const float t = (PREINT_SAMPLES - 1) * PREINT_PERIOD / 1000000.f;
+	meas_imuPreint_t preint;
+
+	preintTests_run(&w, &a, &preint);
+
+	TEST_ASSERT_EQUAL_INT64((PREINT_SAMPLES - 1) * PREINT_PERIOD, preint.dt);
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, a.x * t, preint.dv.x);
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, a.y * t, preint.dv.y);
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, a.z * t, preint.dv.z);
+
+	TEST_ASSERT_EQUAL_FLOAT(1.f, preint.dq.a);
+	TEST_ASSERT_EQUAL_FLOAT(0, preint.dq.i);
+	TEST_ASSERT_EQUAL_FLOAT(0, preint.dq.j);
+	TEST_ASSERT_EQUAL_FLOAT(0, preint.dq.k);
+}
+
+
+TEST(group_imu_preint, preint_nonIncreasingTime)
+{
+	/* repeated sample and sample older than previous one are not integrated */
+	const time_t timestamps[] = { 1000, 2000, 2000, 1500, 3000, 4000, 4000 };
+	const vec_t w = { .x = 0.2f, .y = 0.4f, .z = -0.6f };
+	const vec_t a = { .x = 0, .y = 0, .z = 9.81f };
+	meas_imuPreint_t preint;
+
+	preintTests_logWrite(&w, &a, timestamps, sizeof(timestamps) / sizeof(timestamps[0]));
+
+	TEST_ASSERT_EQUAL_INT(0, meas_imuPoll(&meas, NULL));
+	TEST_ASSERT_EQUAL_INT(0, meas_imuPreintGet(&meas, &preint));
+
+	TEST_ASSERT_EQUAL_INT64(3000, preint.dt);
+	preintTests_rotCheck(&w, 0.003f, &preint.dq);
+}
+
+
+TEST(group_imu_preint, preint_emptyInterval)
+{
+	const vec_t w = { .x = 0.5f, .y = -0.3f, .z = 0.8f };
+	const vec_t a = { .x = 1.f, .y = -2.f, .z = 9.81f };
+	meas_imuPreint_t preint;
+
+	preintTests_run(&w, &a, &preint);
+
+	/* nothing was polled since previous call */
+	TEST_ASSERT_EQUAL_INT(0, meas_imuPreintGet(&meas, &preint));
+
+	TEST_ASSERT_EQUAL_INT64(0, preint.dt);
+	TEST_ASSERT_EQUAL_FLOAT(1.f, preint.dq.a);
+	TEST_ASSERT_EQUAL_FLOAT(0, preint.dq.i);
+	TEST_ASSERT_EQUAL_FLOAT(0, preint.dq.j);
+	TEST_ASSERT_EQUAL_FLOAT(0, preint.dq.k);
+	TEST_ASSERT_EQUAL_FLOAT(0, preint.dv.x);
+	TEST_ASSERT_EQUAL_FLOAT(0, preint.dv.y);
+	TEST_ASSERT_EQUAL_FLOAT(0, preint.dv.z);
+}
+
+
+TEST_GROUP_RUNNER(group_imu_preint)
+{
+	RUN_TEST_CASE(group_imu_preint, preint_constRate);
+	RUN_TEST_CASE(group_imu_preint, preint_constForce);
+	RUN_TEST_CASE(group_imu_preint, preint_nonIncreasingTime);
+	RUN_TEST_CASE(group_imu_preint, preint_emptyInterval);
+}
+
+
+/* ##############################################################################
+ * ---------------------        preintegrated prediction tests       -----------
+ * ############################################################################## */
+
+
+static kalman_init_t inits;
+static kmn_ctx_t kmn;
+static state_engine_t engine;
+
+
+TEST_GROUP(group_kmn_pred);
+
+
+TEST_SETUP(group_kmn_pred)
+{
+	const vec_t w = { .x = 0.5f, .y = -0.3f, .z = 0.8f };
+	const vec_t a = { .x = 1.f, .y = -2.f, .z = 9.81f };
+	time_t timestamps[PREINT_SAMPLES];
+	meas_calib_t calib;
+	unsigned int i;
+
+	for (i = 0; i < PREINT_SAMPLES; i++) {
+		timestamps[i] = PREINT_TIME0 + i * PREINT_PERIOD;
+	}
+
+	preintTests_dirEnter();
+	preintTests_logWrite(&w, &a, timestamps, PREINT_SAMPLES);
+
+	memset(&inits, 0, sizeof(inits));
+	inits.P_qerr = inits.P_verr = inits.P_baerr = inits.P_bwerr = inits.P_rerr = 0.1f;
+	inits.Q_astdev = 2.f;
+	inits.Q_wstdev = 0.5f;
+	inits.Q_baDotstdev = 0.1f;
+	inits.Q_bwDotstdev = 0.01f;
+	inits.covDecim = 1;
+
+	memset(&calib, 0, sizeof(calib));
+	calib.imu.initQuat.a = 1.f;
+
+	memset(&kmn, 0, sizeof(kmn));
+	kmn.inits = &inits;
+	kmn.meas = &meas;
+
+	TEST_ASSERT_EQUAL_INT(0, kalman_predictAlloc(&engine, STATE_LENGTH, CTRL_LENGTH));
+	TEST_ASSERT_EQUAL_INT(0, kmn_predInit(&engine, &kmn, &calib));
+}
+
+
+TEST_TEAR_DOWN(group_kmn_pred)
+{
+	kalman_predictDealloc(&engine);
+	meas_done(&meas);
+	preintTests_dirLeave();
+}
+
+
+/* Q is scaled by preintegration interval, not by time step of the loop */
+TEST(group_kmn_pred, kmn_noiseQ)
+{
+	const float t = (PREINT_SAMPLES - 1) * PREINT_PERIOD / 1000000.f;
+	float expected;
+
+	TEST_ASSERT_EQUAL_INT(0, meas_imuPoll(&meas, NULL));
+	engine.getControl(engine.model, &engine.U);
+	TEST_ASSERT_EQUAL_FLOAT(t, kmn_vecAt(&engine.U, UDT));
+
+	engine.getNoiseQ(engine.model, &engine.state, &engine.U, &engine.Q, PREINT_LOOP_STEP);
+
+	expected = t * t * inits.Q_astdev * inits.Q_astdev;
+	TEST_ASSERT_FLOAT_WITHIN(expected * PREINT_QREL, expected, *matrix_at(&engine.Q, VX, VX));
+
+	expected = t * t * inits.Q_bwDotstdev * inits.Q_bwDotstdev;
+	TEST_ASSERT_FLOAT_WITHIN(expected * PREINT_QREL, expected, *matrix_at(&engine.Q, BWZ, BWZ));
+
+	/* attitude is identity, so quaternion noise is diagonal in vector part */
+	expected = t * t * inits.Q_wstdev * inits.Q_wstdev / 4;
+	TEST_ASSERT_FLOAT_WITHIN(expected * PREINT_QREL, expected, *matrix_at(&engine.Q, QB, QB));
+}
+
+
+/* interval without IMU samples does not rotate, does not change velocity and adds no noise */
+TEST(group_kmn_pred, kmn_emptyInterval)
+{
+	unsigned int i, j;
+
+	/* noise of nonempty interval is written first, so it has to be overwritten */
+	TEST_ASSERT_EQUAL_INT(0, meas_imuPoll(&meas, NULL));
+	engine.getControl(engine.model, &engine.U);
+	engine.getNoiseQ(engine.model, &engine.state, &engine.U, &engine.Q, PREINT_LOOP_STEP);
+
+	engine.getControl(engine.model, &engine.U);
+
+	TEST_ASSERT_EQUAL_FLOAT(1.f, kmn_vecAt(&engine.U, UQA));
+	for (i = UQB; i <= UDT; i++) {
+		TEST_ASSERT_EQUAL_FLOAT(0, kmn_vecAt(&engine.U, i));
+	}
+
+	engine.getNoiseQ(engine.model, &engine.state, &engine.U, &engine.Q, PREINT_LOOP_STEP);
+
+	for (i = 0; i < STATE_LENGTH; i++) {
+		for (j = 0; j < STATE_LENGTH; j++) {
+			TEST_ASSERT_EQUAL_FLOAT(0, *matrix_at(&engine.Q, i, j));
+		}
+	}
+
+	engine.estimateState(engine.model, &engine.state, &engine.state_est, &engine.U, PREINT_LOOP_STEP);
+
+	for (i = 0; i < STATE_LENGTH; i++) {
+		TEST_ASSERT_EQUAL_FLOAT(kmn_vecAt(&engine.state, i), kmn_vecAt(&engine.state_est, i));
+	}
+}
+
+
+/* position is propagated over preintegration interval with velocity from state, also in jacobian */
+TEST(group_kmn_pred, kmn_stateEstInterval)
+{
+	const float t = (PREINT_SAMPLES - 1) * PREINT_PERIOD / 1000000.f;
+
+	*matrix_at(&engine.state, VX, 0) = 3.f;
+
+	TEST_ASSERT_EQUAL_INT(0, meas_imuPoll(&meas, NULL));
+	engine.getControl(engine.model, &engine.U);
+	engine.estimateState(engine.model, &engine.state, &engine.state_est, &engine.U, PREINT_LOOP_STEP);
+
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, 3.f * t, kmn_vecAt(&engine.state_est, RX) - kmn_vecAt(&engine.state, RX));
+
+	engine.getJacobian(engine.model, &engine.F, &engine.state, &engine.U, PREINT_LOOP_STEP);
+	TEST_ASSERT_EQUAL_FLOAT(t, *matrix_at(&engine.F, RX, VX));
+
+	/* attitude is rotated by preintegrated rotation */
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, kmn_vecAt(&engine.U, UQA), kmn_vecAt(&engine.state_est, QA));
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, kmn_vecAt(&engine.U, UQB), kmn_vecAt(&engine.state_est, QB));
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, kmn_vecAt(&engine.U, UQC), kmn_vecAt(&engine.state_est, QC));
+	TEST_ASSERT_FLOAT_WITHIN(PREINT_DELTA, kmn_vecAt(&engine.U, UQD), kmn_vecAt(&engine.state_est, QD));
+}
+
+
+TEST_GROUP_RUNNER(group_kmn_pred)
+{
+	RUN_TEST_CASE(group_kmn_pred, kmn_noiseQ);
+	RUN_TEST_CASE(group_kmn_pred, kmn_emptyInterval);
+	RUN_TEST_CASE(group_kmn_pred, kmn_stateEstInterval);
+}
@@ -0,0 +1,216 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Unit tests of ekf core algorithms
+ *
+ * State publication: snapshots published by one thread and awaited by another
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <unity_fixture.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../statepub.h"
+
+
+#define STATEPUB_STATES     2000
+#define STATEPUB_TIMEOUT    1000000 /* wait timeout long enough to be reached only by lost wakeup */
+#define STATEPUB_SHORT_WAIT 20000
+
+
+typedef struct {
+	uint64_t observed; /* sequence number of the last awaited state, read by publisher */
+	int done;          /* waiter finished, successfully or not */
+
+	/* results checked after join, as assertions can not be used in other thread */
+	int timeouts;
+	int gaps;
+	int mismatches;
+} statepubTests_waiter_t;
+
+
+static statepub_t pub;
+static statepubTests_waiter_t waiter;
+
+
+static void statepubTests_stateFill(ekf_state_t *state, uint64_t seq)
+{
+	memset(state, 0, sizeof(*state));
+	state->stateTime = (time_t)seq;
+	state->roll = (float)seq;
+}
+
+
+static time_t statepubTests_timeUs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (time_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+
+static void *statepubTests_waiterThread(void *arg)
+{
+	ekf_state_t state;
+	uint64_t seq = 0;
+
+	(void)arg;
+
+	while (seq < STATEPUB_STATES) {
+		if (statepub_wait(&pub, &state, STATEPUB_TIMEOUT, &seq) != 0) {
+			waiter.timeouts++;
+			break;
+		}
+
+		/* publisher waits for each state to be observed, so none can be skipped */
+		if (seq != waiter.observed + 1) {
+			waiter.gaps++;
+		}
+
+		if (state.stateTime != (time_t)seq || state.roll != (float)seq) {
+			waiter.mismatches++;
+		}
+
+		__atomic_store_n(&waiter.observed, seq, __ATOMIC_RELEASE);
+	}
+
+	__atomic_store_n(&waiter.done, 1, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+
+/* ##############################################################################
+ * -------------------------        state publication tests       ---------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_statepub);
+
+
+TEST_SETUP(group_statepub)
+{
+	memset(&waiter, 0, sizeof(waiter));
+	TEST_ASSERT_EQUAL_INT(0, statepub_init(&pub));
+}
+
+
+TEST_TEAR_DOWN(group_statepub)
+{
+	statepub_done(&pub);
+}
+
+
+TEST(group_statepub, statepub_readLatest)
+{
+	ekf_state_t state;
+	uint64_t i;
+
+	TEST_ASSERT_EQUAL_UINT(0, statepub_read(&pub, &state));
+
+	for (i = 1; i <= 3; i++) {
+		statepubTests_stateFill(&state, i);
+		statepub_write(&pub, &state);
+	}
+
+	memset(&state, 0, sizeof(state));
+	TEST_ASSERT_EQUAL_UINT(3, statepub_read(&pub, &state));
+	TEST_ASSERT_EQUAL_INT(3, state.stateTime);
+}
+
+
+/* every publication wakes up the waiter, which has to see strictly increasing sequence numbers */
+TEST(group_statepub, statepub_waitEach)
+{
+	pthread_t tid;
+	ekf_state_t state;
+	uint64_t i;
+
+	TEST_ASSERT_EQUAL_INT(0, pthread_create(&tid, NULL, statepubTests_waiterThread, NULL));
+
+	for (i = 1; i <= STATEPUB_STATES; i++) {
+		/* next state is published when waiter is about to wait or already sleeps */
+		while (__atomic_load_n(&waiter.observed, __ATOMIC_ACQUIRE) != i - 1 && __atomic_load_n(&waiter.done, __ATOMIC_ACQUIRE) == 0) {
+			sched_yield();
+		}
+
+		if (__atomic_load_n(&waiter.done, __ATOMIC_ACQUIRE) != 0) {
+			break;
+		}
+
+		statepubTests_stateFill(&state, i);
+		statepub_write(&pub, &state);
+	}
+
+	TEST_ASSERT_EQUAL_INT(0, pthread_join(tid, NULL));
+
+	TEST_ASSERT_EQUAL_INT(0, waiter.timeouts);
+	TEST_ASSERT_EQUAL_INT(0, waiter.gaps);
+	TEST_ASSERT_EQUAL_INT(0, waiter.mismatches);
+	TEST_ASSERT_EQUAL_UINT(STATEPUB_STATES, waiter.observed);
+}
+
+
+TEST(group_statepub, statepub_waitTimeout)
+{
+	ekf_state_t state;
+	uint64_t seq;
+	time_t start;
+
+	statepubTests_stateFill(&state, 1);
+	statepub_write(&pub, &state);
+
+	memset(&state, 0, sizeof(state));
+	seq = statepub_read(&pub, &state);
+	TEST_ASSERT_EQUAL_UINT(1, seq);
+
+	start = statepubTests_timeUs();
+	TEST_ASSERT_EQUAL_INT(-1, statepub_wait(&pub, &state, STATEPUB_SHORT_WAIT, &seq));
+	TEST_ASSERT_TRUE(statepubTests_timeUs() - start >= STATEPUB_SHORT_WAIT);
+
+	/* latest state is copied anyway and sequence number is kept */
+	TEST_ASSERT_EQUAL_UINT(1, seq);
+	TEST_ASSERT_EQUAL_INT(1, state.stateTime);
+}
+
+
+/* state published before the call is returned right away */
+TEST(group_statepub, statepub_waitPublished)
+{
+	ekf_state_t state;
+	uint64_t seq = 0;
+	time_t start;
+
+	statepubTests_stateFill(&state, 1);
+	statepub_write(&pub, &state);
+	statepubTests_stateFill(&state, 2);
+	statepub_write(&pub, &state);
+
+	start = statepubTests_timeUs();
+	TEST_ASSERT_EQUAL_INT(0, statepub_wait(&pub, &state, STATEPUB_TIMEOUT, &seq));
+	TEST_ASSERT_TRUE(statepubTests_timeUs() - start < STATEPUB_TIMEOUT);
+
+	TEST_ASSERT_EQUAL_UINT(2, seq);
+	TEST_ASSERT_EQUAL_INT(2, state.stateTime);
+}
+
+
+TEST_GROUP_RUNNER(group_statepub)
+{
+	RUN_TEST_CASE(group_statepub, statepub_readLatest);
+	RUN_TEST_CASE(group_statepub, statepub_waitEach);
+	RUN_TEST_CASE(group_statepub, statepub_waitTimeout);
+	RUN_TEST_CASE(group_statepub, statepub_waitPublished);
+}
@@ -0,0 +1,639 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Unit tests of ekf core algorithms
+ *
+ * Filter engines are tested with a simple model of 1D motion: state is [position, velocity],
+ * control is acceleration and position and velocity are measured directly.
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <unity_fixture.h>
+
+#include <stdbool.h>
+#include <time.h>
+#include <matrix.h>
+
+#include "../../kalman_core.h"
+
+
+#define STATE_LEN 2
+#define CTRL_LEN  1
+#define MEAS_LEN  2
+
+/* prediction time step in microseconds */
+#define TIME_STEP 10000
+
+#define INIT_POS  1.f
+#define INIT_VEL  -0.5f
+#define INIT_ACC  0.2f
+#define INIT_VAR  1.f
+#define NOISE_Q   0.1f
+#define NOISE_R   0.01f
+#define MEAS_POS  2.f
+#define MEAS_VEL  0.5f
+
+#define DELTA 1e-5f
+
+/* covariance decimation tests */
+#define DECIM_STEPS 10
+#define DECIM_DELTA 1e-4f
+
+
+typedef struct {
+	float acc;
+	float q; /* process noise */
+	float z[MEAS_LEN];
+	float r[MEAS_LEN];
+	bool noData;
+} coreTests_model_t;
+
+
+static coreTests_model_t model, otherModel;
+static state_engine_t stateEngine;
+static update_engine_t updateEngine, otherEngine;
+static matrix_t stateEst, covEst; /* apriori estimates of the tested step */
+static state_engine_t decimEngine;
+
+
+static matrix_t *coreTests_getControl(void *m, matrix_t *U)
+{
+	U->data[0] = ((coreTests_model_t *)m)->acc;
+
+	return U;
+}
+
+
+static void coreTests_getJacobian(void *m, matrix_t *F, matrix_t *state, matrix_t *U, time_t timeStep)
+{
+	matrix_diag(F);
+	MATRIX_DATA(F, 0, 1) = timeStep * 1e-6f;
+}
+
+
+static void coreTests_estimateState(void *m, matrix_t *state, matrix_t *state_est, matrix_t *U, time_t timeStep)
+{
+	float dt = timeStep * 1e-6f;
+
+	state_est->data[0] = state->data[0] + state->data[1] * dt;
+	state_est->data[1] = state->data[1] + U->data[0] * dt;
+}
+
+
+static void coreTests_getNoiseQ(void *m, matrix_t *state, matrix_t *U, matrix_t *Q, time_t timeStep)
+{
+	float dt = timeStep * 1e-6f;
+
+	matrix_zeroes(Q);
+	MATRIX_DATA(Q, 0, 0) = ((coreTests_model_t *)m)->q * dt * dt;
+	MATRIX_DATA(Q, 1, 1) = ((coreTests_model_t *)m)->q;
+}
+
+
+static matrix_t *coreTests_getData(void *m, matrix_t *Z, matrix_t *state, matrix_t *R, time_t timeStep)
+{
+	coreTests_model_t *mdl = m;
+	unsigned int i;
+
+	if (mdl->noData) {
+		return NULL;
+	}
+
+	matrix_zeroes(R);
+	for (i = 0; i < MEAS_LEN; i++) {
+		Z->data[i] = mdl->z[i];
+		MATRIX_DATA(R, i, i) = mdl->r[i];
+	}
+
+	return Z;
+}
+
+
+static void coreTests_getUpdateJacobian(void *m, matrix_t *H, matrix_t *state, time_t timeStep)
+{
+	matrix_diag(H);
+}
+
+
+static matrix_t *coreTests_predictMeasurements(void *m, matrix_t *state_est, matrix_t *hx, time_t timeStep)
+{
+	matrix_writeSubmatrix(hx, 0, 0, state_est);
+
+	return hx;
+}
+
+
+/* Checks if every element of `actual` is within DELTA of `expected` */
+static void coreTests_matrixCheck(const matrix_t *expected, const matrix_t *actual)
+{
+	unsigned int i;
+
+	TEST_ASSERT_EQUAL_UINT(expected->rows, actual->rows);
+	TEST_ASSERT_EQUAL_UINT(expected->cols, actual->cols);
+
+	for (i = 0; i < expected->rows * expected->cols; i++) {
+		TEST_ASSERT_FLOAT_WITHIN(DELTA, expected->data[i], actual->data[i]);
+	}
+}
+
+
+/* Checks if x_(k|k) and P_(k|k) are equal to apriori estimates made by prediction */
+static void coreTests_aprioriCheck(void)
+{
+	coreTests_matrixCheck(&stateEst, &stateEngine.state);
+	coreTests_matrixCheck(&covEst, &stateEngine.cov);
+}
+
+
+static void coreTests_stateEngineInit(state_engine_t *engine)
+{
+	TEST_ASSERT_EQUAL_INT(0, kalman_predictAlloc(engine, STATE_LEN, CTRL_LEN));
+	engine->getControl = coreTests_getControl;
+	engine->getJacobian = coreTests_getJacobian;
+	engine->estimateState = coreTests_estimateState;
+	engine->getNoiseQ = coreTests_getNoiseQ;
+	engine->model = &model;
+	engine->packedCov = false;
+
+	engine->state.data[0] = INIT_POS;
+	engine->state.data[1] = INIT_VEL;
+	matrix_diag(&engine->cov);
+	matrix_times(&engine->cov, INIT_VAR);
+	matrix_symPack(&engine->cov, &engine->covSym);
+
+	coreTests_getJacobian(&model, &engine->F, NULL, NULL, TIME_STEP);
+	TEST_ASSERT_EQUAL_INT(0, matrix_sparsityAlloc(&engine->Fpattern, &engine->F));
+}
+
+
+static void coreTests_updateEngineInit(update_engine_t *engine, coreTests_model_t *mdl)
+{
+	TEST_ASSERT_EQUAL_INT(0, kalman_updateAlloc(engine, STATE_LEN, MEAS_LEN));
+	engine->getData = coreTests_getData;
+	engine->getJacobian = coreTests_getUpdateJacobian;
+	engine->predictMeasurements = coreTests_predictMeasurements;
+	engine->model = mdl;
+	engine->active = true;
+	engine->sequential = false;
+
+	matrix_diag(&engine->H);
+	TEST_ASSERT_EQUAL_INT(0, matrix_sparsityAlloc(&engine->Hpattern, &engine->H));
+}
+
+
+/* Initializes engines, so that prediction of the tested step is done and its apriori estimates are saved */
+static void coreTests_enginesInit(void)
+{
+	model = (coreTests_model_t) { .acc = INIT_ACC, .q = NOISE_Q, .z = { MEAS_POS, MEAS_VEL }, .r = { NOISE_R, NOISE_R }, .noData = false };
+	otherModel = (coreTests_model_t) { .acc = INIT_ACC, .q = NOISE_Q, .z = { -MEAS_POS, -MEAS_VEL }, .r = { NOISE_R, NOISE_R }, .noData = false };
+
+	coreTests_stateEngineInit(&stateEngine);
+	coreTests_updateEngineInit(&updateEngine, &model);
+	coreTests_updateEngineInit(&otherEngine, &otherModel);
+
+	kalman_predict(&stateEngine, TIME_STEP, 0);
+
+	TEST_ASSERT_EQUAL_INT(0, matrix_bufAlloc(&stateEst, STATE_LEN, 1));
+	TEST_ASSERT_EQUAL_INT(0, matrix_bufAlloc(&covEst, STATE_LEN, STATE_LEN));
+	matrix_writeSubmatrix(&stateEst, 0, 0, &stateEngine.state_est);
+	matrix_writeSubmatrix(&covEst, 0, 0, &stateEngine.cov_est);
+}
+
+
+static void coreTests_enginesDone(void)
+{
+	kalman_predictDealloc(&stateEngine);
+	kalman_updateDealloc(&updateEngine);
+	kalman_updateDealloc(&otherEngine);
+	matrix_bufFree(&stateEst);
+	matrix_bufFree(&covEst);
+}
+
+
+/* Checks if x_(k|k) and P_(k|k) are equal to result of single update by `engine` started from apriori estimates of the tested step */
+static void coreTests_singleUpdateCheck(update_engine_t *engine)
+{
+	matrix_t state, cov;
+
+	TEST_ASSERT_EQUAL_INT(0, matrix_bufAlloc(&state, STATE_LEN, 1));
+	TEST_ASSERT_EQUAL_INT(0, matrix_bufAlloc(&cov, STATE_LEN, STATE_LEN));
+	matrix_writeSubmatrix(&state, 0, 0, &stateEngine.state);
+	matrix_writeSubmatrix(&cov, 0, 0, &stateEngine.cov);
+
+	matrix_writeSubmatrix(&stateEngine.state_est, 0, 0, &stateEst);
+	matrix_writeSubmatrix(&stateEngine.cov_est, 0, 0, &covEst);
+	TEST_ASSERT_EQUAL_INT(0, kalman_update(TIME_STEP, 0, engine, &stateEngine));
+
+	coreTests_matrixCheck(&stateEngine.state, &state);
+	coreTests_matrixCheck(&stateEngine.cov, &cov);
+
+	matrix_bufFree(&state);
+	matrix_bufFree(&cov);
+}
+
+
+/* ##############################################################################
+ * ---------------------        kalman_update tests       -----------------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_kalman_update);
+
+
+TEST_SETUP(group_kalman_update)
+{
+	coreTests_enginesInit();
+}
+
+
+TEST_TEAR_DOWN(group_kalman_update)
+{
+	coreTests_enginesDone();
+}
+
+
+TEST(group_kalman_update, kalman_update_std)
+{
+	const matrix_t *P = &stateEngine.cov_est, *x = &stateEngine.state_est;
+	float s00, s01, s11, det, y0, y1, k00, k01, k10, k11;
+
+	TEST_ASSERT_EQUAL_INT(0, kalman_update(TIME_STEP, 0, &updateEngine, &stateEngine));
+
+	/* H_k = I, so K_k = P_(k|k-1) * inverse(P_(k|k-1) + R) */
+	s00 = MATRIX_DATA(P, 0, 0) + NOISE_R;
+	s01 = MATRIX_DATA(P, 0, 1);
+	s11 = MATRIX_DATA(P, 1, 1) + NOISE_R;
+	det = s00 * s11 - s01 * s01;
+
+	k00 = (MATRIX_DATA(P, 0, 0) * s11 - MATRIX_DATA(P, 0, 1) * s01) / det;
+	k01 = (MATRIX_DATA(P, 0, 1) * s00 - MATRIX_DATA(P, 0, 0) * s01) / det;
+	k10 = (MATRIX_DATA(P, 1, 0) * s11 - MATRIX_DATA(P, 1, 1) * s01) / det;
+	k11 = (MATRIX_DATA(P, 1, 1) * s00 - MATRIX_DATA(P, 1, 0) * s01) / det;
+
+	y0 = MEAS_POS - x->data[0];
+	y1 = MEAS_VEL - x->data[1];
+
+	TEST_ASSERT_FLOAT_WITHIN(DELTA, x->data[0] + k00 * y0 + k01 * y1, stateEngine.state.data[0]);
+	TEST_ASSERT_FLOAT_WITHIN(DELTA, x->data[1] + k10 * y0 + k11 * y1, stateEngine.state.data[1]);
+}
+
+
+/* Sequential scalar updates give the same result as the update with whole S_k */
+TEST(group_kalman_update, kalman_update_sequential)
+{
+	matrix_t state, cov;
+
+	TEST_ASSERT_EQUAL_INT(0, matrix_bufAlloc(&state, STATE_LEN, 1));
+	TEST_ASSERT_EQUAL_INT(0, matrix_bufAlloc(&cov, STATE_LEN, STATE_LEN));
+
+	TEST_ASSERT_EQUAL_INT(0, kalman_update(TIME_STEP, 0, &updateEngine, &stateEngine));
+	matrix_writeSubmatrix(&state, 0, 0, &stateEngine.state);
+	matrix_writeSubmatrix(&cov, 0, 0, &stateEngine.cov);
+
+	updateEngine.sequential = true;
+	TEST_ASSERT_EQUAL_INT(0, kalman_update(TIME_STEP, 0, &updateEngine, &stateEngine));
+
+	coreTests_matrixCheck(&state, &stateEngine.state);
+	coreTests_matrixCheck(&cov, &stateEngine.cov);
+
+	matrix_bufFree(&state);
+	matrix_bufFree(&cov);
+}
+
+
+TEST(group_kalman_update, kalman_update_noData)
+{
+	model.noData = true;
+
+	TEST_ASSERT_EQUAL_INT(-1, kalman_update(TIME_STEP, 0, &updateEngine, &stateEngine));
+
+	/* failed update leaves apriori estimates intact and their commit to the caller */
+	kalman_estimateCommit(&stateEngine);
+	coreTests_aprioriCheck();
+}
+
+
+/* S_k is not positive definite, as variance of measurement noise is negative */
+TEST(group_kalman_update, kalman_update_notPositiveDefinite)
+{
+	model.r[1] = -2 * (INIT_VAR + NOISE_Q);
+
+	TEST_ASSERT_EQUAL_INT(-1, kalman_update(TIME_STEP, 0, &updateEngine, &stateEngine));
+
+	kalman_estimateCommit(&stateEngine);
+	coreTests_aprioriCheck();
+}
+
+
+TEST(group_kalman_update, kalman_update_seqNotPositiveDefinite)
+{
+	model.r[0] = -2 * (INIT_VAR + NOISE_Q);
+	model.r[1] = -2 * (INIT_VAR + NOISE_Q);
+	updateEngine.sequential = true;
+
+	TEST_ASSERT_EQUAL_INT(-1, kalman_update(TIME_STEP, 0, &updateEngine, &stateEngine));
+
+	kalman_estimateCommit(&stateEngine);
+	coreTests_aprioriCheck();
+}
+
+
+/* Measurement with non-positive innovation variance is skipped, the other one is applied and update succeeds */
+TEST(group_kalman_update, kalman_update_seqPartial)
+{
+	model.r[1] = -2 * (INIT_VAR + NOISE_Q);
+	updateEngine.sequential = true;
+
+	TEST_ASSERT_EQUAL_INT(0, kalman_update(TIME_STEP, 0, &updateEngine, &stateEngine));
+
+	const matrix_t *P = &stateEngine.cov_est, *x = &stateEngine.state_est;
+	float y0 = (MEAS_POS - x->data[0]) / (MATRIX_DATA(P, 0, 0) + NOISE_R);
+
+	/* only position is applied: x_(k|k) = x_(k|k-1) + P_(k|k-1) * transpose(h) * y / s for h = [1, 0] */
+	TEST_ASSERT_FLOAT_WITHIN(DELTA, x->data[0] + MATRIX_DATA(P, 0, 0) * y0, stateEngine.state.data[0]);
+	TEST_ASSERT_FLOAT_WITHIN(DELTA, x->data[1] + MATRIX_DATA(P, 1, 0) * y0, stateEngine.state.data[1]);
+	TEST_ASSERT_TRUE(MATRIX_DATA(&stateEngine.cov, 0, 0) < MATRIX_DATA(P, 0, 0));
+}
+
+
+TEST_GROUP_RUNNER(group_kalman_update)
+{
+	RUN_TEST_CASE(group_kalman_update, kalman_update_std);
+	RUN_TEST_CASE(group_kalman_update, kalman_update_sequential);
+	RUN_TEST_CASE(group_kalman_update, kalman_update_noData);
+	RUN_TEST_CASE(group_kalman_update, kalman_update_notPositiveDefinite);
+	RUN_TEST_CASE(group_kalman_update, kalman_update_seqNotPositiveDefinite);
+	RUN_TEST_CASE(group_kalman_update, kalman_update_seqPartial);
+}
+
+
+/* ##############################################################################
+ * -------------------        kalman_updateAll tests       ----------------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_kalman_updateAll);
+
+
+TEST_SETUP(group_kalman_updateAll)
+{
+	coreTests_enginesInit();
+}
+
+
+TEST_TEAR_DOWN(group_kalman_updateAll)
+{
+	coreTests_enginesDone();
+}
+
+
+TEST(group_kalman_updateAll, kalman_updateAll_noEngines)
+{
+	TEST_ASSERT_EQUAL_INT(0, kalman_updateAll(NULL, 0, NULL, 0, &stateEngine));
+
+	coreTests_aprioriCheck();
+}
+
+
+/* Prediction must not be dropped if all pending updates fail */
+TEST(group_kalman_updateAll, kalman_updateAll_allFailed)
+{
+	update_engine_t *engines[] = { &updateEngine, &otherEngine };
+	const time_t timeSteps[] = { TIME_STEP, TIME_STEP };
+
+	model.noData = true;
+	otherModel.r[0] = -2 * (INIT_VAR + NOISE_Q);
+
+	TEST_ASSERT_EQUAL_INT(0, kalman_updateAll(timeSteps, 0, engines, 2, &stateEngine));
+
+	coreTests_aprioriCheck();
+}
+
+
+/* Update failing after a successful one keeps its result */
+TEST(group_kalman_updateAll, kalman_updateAll_lastFailed)
+{
+	update_engine_t *engines[] = { &updateEngine, &otherEngine };
+	const time_t timeSteps[] = { TIME_STEP, TIME_STEP };
+
+	otherModel.noData = true;
+
+	TEST_ASSERT_EQUAL_INT(1, kalman_updateAll(timeSteps, 0, engines, 2, &stateEngine));
+
+	coreTests_singleUpdateCheck(&updateEngine);
+}
+
+
+/* Update after a failed one starts from apriori estimates */
+TEST(group_kalman_updateAll, kalman_updateAll_firstFailed)
+{
+	update_engine_t *engines[] = { &updateEngine, &otherEngine };
+	const time_t timeSteps[] = { TIME_STEP, TIME_STEP };
+
+	model.r[1] = -2 * (INIT_VAR + NOISE_Q);
+
+	TEST_ASSERT_EQUAL_INT(1, kalman_updateAll(timeSteps, 0, engines, 2, &stateEngine));
+
+	coreTests_singleUpdateCheck(&otherEngine);
+}
+
+
+/* Successful updates are chained: the second one starts from result of the first one */
+TEST(group_kalman_updateAll, kalman_updateAll_chained)
+{
+	update_engine_t *engines[] = { &updateEngine, &otherEngine };
+	const time_t timeSteps[] = { TIME_STEP, TIME_STEP };
+	matrix_t state, cov;
+
+	TEST_ASSERT_EQUAL_INT(2, kalman_updateAll(timeSteps, 0, engines, 2, &stateEngine));
+
+	TEST_ASSERT_EQUAL_INT(0, matrix_bufAlloc(&state, STATE_LEN, 1));
+	TEST_ASSERT_EQUAL_INT(0, matrix_bufAlloc(&cov, STATE_LEN, STATE_LEN));
+	matrix_writeSubmatrix(&state, 0, 0, &stateEngine.state);
+	matrix_writeSubmatrix(&cov, 0, 0, &stateEngine.cov);
+
+	/* reference: both updates done one after another from apriori estimates */
+	matrix_writeSubmatrix(&stateEngine.state_est, 0, 0, &stateEst);
+	matrix_writeSubmatrix(&stateEngine.cov_est, 0, 0, &covEst);
+	TEST_ASSERT_EQUAL_INT(0, kalman_update(TIME_STEP, 0, &updateEngine, &stateEngine));
+	kalman_updateChain(&stateEngine);
+	TEST_ASSERT_EQUAL_INT(0, kalman_update(TIME_STEP, 0, &otherEngine, &stateEngine));
+
+	coreTests_matrixCheck(&stateEngine.state, &state);
+	coreTests_matrixCheck(&stateEngine.cov, &cov);
+
+	matrix_bufFree(&state);
+	matrix_bufFree(&cov);
+}
+
+
+TEST_GROUP_RUNNER(group_kalman_updateAll)
+{
+	RUN_TEST_CASE(group_kalman_updateAll, kalman_updateAll_noEngines);
+	RUN_TEST_CASE(group_kalman_updateAll, kalman_updateAll_allFailed);
+	RUN_TEST_CASE(group_kalman_updateAll, kalman_updateAll_lastFailed);
+	RUN_TEST_CASE(group_kalman_updateAll, kalman_updateAll_firstFailed);
+	RUN_TEST_CASE(group_kalman_updateAll, kalman_updateAll_chained);
+}
+
+
+/* ##############################################################################
+ * -----------------        covariance decimation tests       -------------------
+ * ############################################################################## */
+
+
+/* Time steps differ, so that every prediction has different F and Q */
+static time_t coreTests_decimStep(unsigned int i)
+{
+	return TIME_STEP * (1 + i % 3);
+}
+
+
+/* Performs `n` predictions with no update step on both engines */
+static void coreTests_decimPredict(unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		kalman_predict(&stateEngine, coreTests_decimStep(i), 0);
+		kalman_estimateCommit(&stateEngine);
+
+		kalman_predict(&decimEngine, coreTests_decimStep(i), 0);
+		kalman_estimateCommit(&decimEngine);
+	}
+}
+
+
+/*
+ * Checks if P_(k|k) of engine with decimated covariance equals P_(k|k) of engine propagating covariance in every step.
+ * Transition is accumulated exactly, so they are equal if there is no process noise
+ */
+static void coreTests_decimCheck(void)
+{
+	unsigned int i;
+
+	coreTests_matrixCheck(&stateEngine.state, &decimEngine.state);
+
+	if (stateEngine.packedCov) {
+		matrix_symUnpack(&stateEngine.covSym, &stateEngine.cov);
+		matrix_symUnpack(&decimEngine.covSym, &decimEngine.cov);
+	}
+
+	for (i = 0; i < STATE_LEN * STATE_LEN; i++) {
+		TEST_ASSERT_FLOAT_WITHIN(DECIM_DELTA, stateEngine.cov.data[i], decimEngine.cov.data[i]);
+	}
+}
+
+
+TEST_GROUP(group_kalman_covDecim);
+
+
+TEST_SETUP(group_kalman_covDecim)
+{
+	model = (coreTests_model_t) { .acc = INIT_ACC, .q = NOISE_Q, .z = { MEAS_POS, MEAS_VEL }, .r = { NOISE_R, NOISE_R }, .noData = false };
+
+	coreTests_stateEngineInit(&stateEngine);
+	coreTests_stateEngineInit(&decimEngine);
+	coreTests_updateEngineInit(&updateEngine, &model);
+
+	TEST_ASSERT_EQUAL_INT(0, kalman_covDecimSet(&decimEngine, DECIM_STEPS));
+
+	/* process noise is accumulated with first order approximation, it is tested separately */
+	model.q = 0;
+}
+
+
+TEST_TEAR_DOWN(group_kalman_covDecim)
+{
+	kalman_predictDealloc(&stateEngine);
+	kalman_predictDealloc(&decimEngine);
+	kalman_updateDealloc(&updateEngine);
+}
+
+
+TEST(group_kalman_covDecim, kalman_covDecim_predictions)
+{
+	coreTests_decimPredict(DECIM_STEPS);
+
+	TEST_ASSERT_EQUAL_UINT(0, decimEngine.covSteps);
+	coreTests_decimCheck();
+
+	coreTests_decimPredict(2 * DECIM_STEPS);
+
+	coreTests_decimCheck();
+}
+
+
+TEST(group_kalman_covDecim, kalman_covDecim_packedCov)
+{
+	stateEngine.packedCov = true;
+	decimEngine.packedCov = true;
+
+	coreTests_decimPredict(DECIM_STEPS);
+
+	coreTests_decimCheck();
+}
+
+
+/* Update step propagates covariance of predictions accumulated so far */
+TEST(group_kalman_covDecim, kalman_covDecim_update)
+{
+	coreTests_decimPredict(DECIM_STEPS / 2);
+
+	kalman_predict(&stateEngine, TIME_STEP, 0);
+	kalman_predict(&decimEngine, TIME_STEP, 0);
+	TEST_ASSERT_EQUAL_INT(0, kalman_update(TIME_STEP, 0, &updateEngine, &stateEngine));
+	TEST_ASSERT_EQUAL_INT(0, kalman_update(TIME_STEP, 0, &updateEngine, &decimEngine));
+
+	TEST_ASSERT_EQUAL_UINT(0, decimEngine.covSteps);
+	coreTests_decimCheck();
+
+	coreTests_decimPredict(DECIM_STEPS);
+
+	coreTests_decimCheck();
+}
+
+
+/* Process noise of accumulated predictions is summed without propagation by their transitions */
+TEST(group_kalman_covDecim, kalman_covDecim_noise)
+{
+	matrix_t Q, Qsum;
+	unsigned int i;
+
+	TEST_ASSERT_EQUAL_INT(0, matrix_bufAlloc(&Q, STATE_LEN, STATE_LEN));
+	TEST_ASSERT_EQUAL_INT(0, matrix_bufAlloc(&Qsum, STATE_LEN, STATE_LEN));
+
+	model.q = NOISE_Q;
+	matrix_zeroes(&decimEngine.cov);
+	matrix_zeroes(&Qsum);
+
+	for (i = 0; i < DECIM_STEPS; i++) {
+		coreTests_getNoiseQ(&model, NULL, NULL, &Q, coreTests_decimStep(i));
+		matrix_add(&Qsum, &Q, NULL);
+
+		kalman_predict(&decimEngine, coreTests_decimStep(i), 0);
+		kalman_estimateCommit(&decimEngine);
+	}
+
+	TEST_ASSERT_EQUAL_UINT(0, decimEngine.covSteps);
+	for (i = 0; i < STATE_LEN * STATE_LEN; i++) {
+		TEST_ASSERT_FLOAT_WITHIN(DECIM_DELTA, Qsum.data[i], decimEngine.cov.data[i]);
+	}
+
+	matrix_bufFree(&Q);
+	matrix_bufFree(&Qsum);
+}
+
+
+TEST_GROUP_RUNNER(group_kalman_covDecim)
+{
+	RUN_TEST_CASE(group_kalman_covDecim, kalman_covDecim_predictions);
+	RUN_TEST_CASE(group_kalman_covDecim, kalman_covDecim_packedCov);
+	RUN_TEST_CASE(group_kalman_covDecim, kalman_covDecim_update);
+	RUN_TEST_CASE(group_kalman_covDecim, kalman_covDecim_noise);
+}
@@ -0,0 +1,197 @@
+/*
+ * Phoenix-Pilot
+ *
+ * Unit tests of ekf core algorithms
+ *
+ * Warm start data file: round-trip and rejection of damaged or incompatible files
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <unity_fixture.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../warm.h"
+
+
+#define WARM_TEST_FILE "/tmp/ekf_warm_test.bin"
+
+/* warm_save() writes 16 bytes header of magic, version, size and CRC-32, followed by data */
+#define WARM_HDR_SIZE       16
+#define WARM_VERSION_OFFSET 4
+
+
+static warm_data_t saved, loaded;
+
+
+/* Fills `data` with pattern depending on `seed`, padding included, so compared structures are equal bytewise */
+static void warmTests_fill(warm_data_t *data, unsigned int seed)
+{
+	unsigned int i;
+
+	memset(data, 0, sizeof(*data));
+
+	data->modelFlags = seed;
+	data->press = 101325.f + seed;
+	data->calib.imu.gyroBias.x = 0.01f * seed;
+	data->calib.imu.initQuat.a = 1.f;
+
+	for (i = 0; i < STATE_LENGTH; i++) {
+		data->state[i] = (float)(i + seed) / 7.f;
+	}
+
+	for (i = 0; i < MATRIX_SYM_LEN(STATE_LENGTH); i++) {
+		data->cov[i] = (float)(i * seed) / 13.f;
+	}
+}
+
+
+/* Reads whole test file to `buf` of `size` bytes. Returns number of read bytes */
+static size_t warmTests_fileRead(uint8_t *buf, size_t size)
+{
+	FILE *file = fopen(WARM_TEST_FILE, "rb");
+	size_t len;
+	int err;
+
+	TEST_ASSERT_NOT_NULL(file);
+	len = fread(buf, 1, size, file);
+	err = fclose(file);
+	TEST_ASSERT_EQUAL_INT(0, err);
+
+	return len;
+}
+
+
+static void warmTests_fileWrite(const uint8_t *buf, size_t size)
+{
+	FILE *file = fopen(WARM_TEST_FILE, "wb");
+	size_t len;
+	int err;
+
+	TEST_ASSERT_NOT_NULL(file);
+	len = fwrite(buf, 1, size, file);
+	err = fclose(file);
+	TEST_ASSERT_EQUAL(size, len);
+	TEST_ASSERT_EQUAL_INT(0, err);
+}
+
+
+/* ##############################################################################
+ * -------------------------        warm file tests       -----------------------
+ * ############################################################################## */
+
+
+TEST_GROUP(group_warm);
+
+
+TEST_SETUP(group_warm)
+{
+	warmTests_fill(&saved, 3);
+	memset(&loaded, 0, sizeof(loaded));
+	remove(WARM_TEST_FILE);
+}
+
+
+TEST_TEAR_DOWN(group_warm)
+{
+	remove(WARM_TEST_FILE);
+}
+
+
+TEST(group_warm, warm_roundTrip)
+{
+	TEST_ASSERT_EQUAL_INT(0, warm_save(WARM_TEST_FILE, &saved));
+	TEST_ASSERT_EQUAL_INT(0, warm_load(WARM_TEST_FILE, &loaded));
+
+	TEST_ASSERT_EQUAL_MEMORY(&saved, &loaded, sizeof(saved));
+
+	/* temporary file is renamed to the target one */
+	TEST_ASSERT_NOT_EQUAL(0, access(WARM_TEST_FILE ".tmp", F_OK));
+}
+
+
+TEST(group_warm, warm_overwrite)
+{
+	TEST_ASSERT_EQUAL_INT(0, warm_save(WARM_TEST_FILE, &saved));
+
+	warmTests_fill(&saved, 5);
+	TEST_ASSERT_EQUAL_INT(0, warm_save(WARM_TEST_FILE, &saved));
+	TEST_ASSERT_EQUAL_INT(0, warm_load(WARM_TEST_FILE, &loaded));
+
+	TEST_ASSERT_EQUAL_MEMORY(&saved, &loaded, sizeof(saved));
+}
+
+
+TEST(group_warm, warm_missingFile)
+{
+	TEST_ASSERT_EQUAL_INT(-1, warm_load(WARM_TEST_FILE, &loaded));
+}
+
+
+TEST(group_warm, warm_truncated)
+{
+	static uint8_t buf[WARM_HDR_SIZE + sizeof(warm_data_t)];
+
+	TEST_ASSERT_EQUAL_INT(0, warm_save(WARM_TEST_FILE, &saved));
+	TEST_ASSERT_EQUAL(sizeof(buf), warmTests_fileRead(buf, sizeof(buf)));
+
+	/* data cut short */
+	warmTests_fileWrite(buf, sizeof(buf) - 1);
+	TEST_ASSERT_EQUAL_INT(-1, warm_load(WARM_TEST_FILE, &loaded));
+
+	/* header cut short */
+	warmTests_fileWrite(buf, WARM_HDR_SIZE / 2);
+	TEST_ASSERT_EQUAL_INT(-1, warm_load(WARM_TEST_FILE, &loaded));
+}
+
+
+TEST(group_warm, warm_badCrc)
+{
+	static uint8_t buf[WARM_HDR_SIZE + sizeof(warm_data_t)];
+
+	TEST_ASSERT_EQUAL_INT(0, warm_save(WARM_TEST_FILE, &saved));
+	TEST_ASSERT_EQUAL(sizeof(buf), warmTests_fileRead(buf, sizeof(buf)));
+
+	/* single bit flipped in the middle of data */
+	buf[WARM_HDR_SIZE + sizeof(warm_data_t) / 2] ^= 0x10;
+	warmTests_fileWrite(buf, sizeof(buf));
+
+	TEST_ASSERT_EQUAL_INT(-1, warm_load(WARM_TEST_FILE, &loaded));
+}
+
+
+TEST(group_warm, warm_versionMismatch)
+{
+	static uint8_t buf[WARM_HDR_SIZE + sizeof(warm_data_t)];
+	uint32_t version;
+
+	TEST_ASSERT_EQUAL_INT(0, warm_save(WARM_TEST_FILE, &saved));
+	TEST_ASSERT_EQUAL(sizeof(buf), warmTests_fileRead(buf, sizeof(buf)));
+
+	/* data and its CRC stay valid, only version differs */
+	memcpy(&version, &buf[WARM_VERSION_OFFSET], sizeof(version));
+	version++;
+	memcpy(&buf[WARM_VERSION_OFFSET], &version, sizeof(version));
+	warmTests_fileWrite(buf, sizeof(buf));
+
+	TEST_ASSERT_EQUAL_INT(-1, warm_load(WARM_TEST_FILE, &loaded));
+}
+
+
+TEST_GROUP_RUNNER(group_warm)
+{
+	RUN_TEST_CASE(group_warm, warm_roundTrip);
+	RUN_TEST_CASE(group_warm, warm_overwrite);
+	RUN_TEST_CASE(group_warm, warm_missingFile);
+	RUN_TEST_CASE(group_warm, warm_truncated);
+	RUN_TEST_CASE(group_warm, warm_badCrc);
+	RUN_TEST_CASE(group_warm, warm_versionMismatch);
+}
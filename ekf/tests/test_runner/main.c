@@ -1,7 +1,7 @@
 /*
  * EKF test runner
  *
- * Executes ekf via devekf with adjusted `ekf.conf` file.
+ * Replays scenario logs through ekf with adjusted `ekf.conf` file.
  * Compares final ekf state with expected one.
  *
  * Copyright 2023 Phoenix Systems
@@ -18,32 +18,24 @@
 #include <string.h>
 
 #include <hmap.h>
+#include <ekflib.h>
 
 #include "config_file_handler.h"
 #include "result_check.h"
 
 
-#define LOG_FILE "ekf_log.bin"
+#define LOG_FILE        "ekf_log.bin"
+#define EKF_CONFIG_FILE "etc/ekf.conf"
 
 
-static int ekftests_testSetUp(const char *scenarioName)
+static int ekftests_testSetUp(void)
 {
-	const size_t changes = 4;
+	const size_t changes = 2;
 	const char *fieldsToChange[changes];
-	const size_t scenarioFieldSize = MAX_FILE_TO_CHANGE_STR_LEN + 1;
-	char scenarioField[scenarioFieldSize];
 
-	if (strlen(scenarioName) > MAX_VALUE_LEN) {
-		fprintf(stderr, "Path to scenario file is too long\n");
-		return -1;
-	}
-
-	snprintf(scenarioField, scenarioFieldSize, "DATA_SOURCE/file=%s", scenarioName);
-
-	fieldsToChange[0] = "DATA_SOURCE/source=LOGS";
-	fieldsToChange[1] = "LOGGING/log=ALL";
-	fieldsToChange[2] = "LOGGING/mode=STRICT";
-	fieldsToChange[3] = scenarioField;
+	/* Data source is set by ekf_replay(), final state is read from ekf logs */
+	fieldsToChange[0] = "LOGGING/log=ALL";
+	fieldsToChange[1] = "LOGGING/mode=STRICT";
 
 	return ekftests_configPrepare(fieldsToChange, changes);
 }
@@ -92,12 +84,12 @@ int main(int argc, char **argv)
 	scenarioName = argv[1];
 	expectedResult = argv[2];
 
-	if (ekftests_testSetUp(scenarioName) != 0) {
+	if (ekftests_testSetUp() != 0) {
 		fprintf(stderr, "\033[31m\nTEST FAILED\033[39m: Error occurred during test set up\n");
 		return EXIT_FAILURE;
 	}
 
-	if (system("usr/bin/devekf 1") != 0) {
+	if (ekf_replay(EKF_CONFIG_FILE, scenarioName, LOG_FILE, NULL, NULL, NULL) != 0) {
 		fprintf(stderr, "\033[31m\nTEST FAILED\033[39m: Error occurred during ekf execution\n");
 		ekftests_testTearDown();
 
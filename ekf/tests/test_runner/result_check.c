@@ -119,16 +119,17 @@ static int ekftests_finalStateGet(const char *logFile, matrix_t *finalState)
 {
 	/* Timestamp is needed only to pass valid pointer to `ekflog_stateRead`. Currently we are not checking timestamps */
 	time_t timestamp;
+	ekflog_reader_t reader;
 
-	if (ekflog_readerInit(logFile) != 0) {
+	if (ekflog_readerInit(&reader, logFile) != 0) {
 		return -1;
 	}
 
 	errno = 0;
 
 	/* Getting the last ekf state */
-	while (ekflog_stateRead(finalState, &timestamp) == 0) { }
-	if (ekflog_readerDone() != 0) {
+	while (ekflog_stateRead(&reader, finalState, &timestamp) == 0) { }
+	if (ekflog_readerDone(&reader) != 0) {
 		return -1;
 	}
 
@@ -0,0 +1,120 @@
+/*
+ * Phoenix-Pilot
+ *
+ * extended kalman filter
+ *
+ * persisted calibration and state for warm start
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "warm.h"
+
+
+#define WARM_MAGIC   0x4d524157u /* "WARM" */
+#define WARM_VERSION 1
+
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size; /* size of warm_data_t, changes with state layout */
+	uint32_t crc;  /* CRC-32 of data */
+} warm_header_t;
+
+
+static uint32_t warm_crc(const void *buf, size_t size)
+{
+	const uint8_t *data = buf;
+	uint32_t crc = 0xffffffffu;
+	size_t i;
+	int bit;
+
+	for (i = 0; i < size; i++) {
+		crc ^= data[i];
+		for (bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+		}
+	}
+
+	return ~crc;
+}
+
+
+int warm_save(const char *path, const warm_data_t *data)
+{
+	char tmpPath[MAX_PATH_LEN + 5];
+	warm_header_t hdr;
+	FILE *file;
+	int err = 0;
+
+	hdr.magic = WARM_MAGIC;
+	hdr.version = WARM_VERSION;
+	hdr.size = sizeof(*data);
+	hdr.crc = warm_crc(data, sizeof(*data));
+
+	if (strlen(path) > MAX_PATH_LEN) {
+		return -1;
+	}
+	sprintf(tmpPath, "%s.tmp", path);
+
+	file = fopen(tmpPath, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "ekf: cannot open %s to write\n", tmpPath);
+		return -1;
+	}
+
+	if (fwrite(&hdr, sizeof(hdr), 1, file) != 1 || fwrite(data, sizeof(*data), 1, file) != 1) {
+		err = -1;
+	}
+
+	if (fclose(file) != 0 || err != 0) {
+		fprintf(stderr, "ekf: cannot write %s\n", tmpPath);
+		remove(tmpPath);
+		return -1;
+	}
+
+	if (rename(tmpPath, path) != 0) {
+		fprintf(stderr, "ekf: cannot replace %s\n", path);
+		remove(tmpPath);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+int warm_load(const char *path, warm_data_t *data)
+{
+	warm_header_t hdr;
+	FILE *file;
+	int err = 0;
+
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		return -1;
+	}
+
+	if (fread(&hdr, sizeof(hdr), 1, file) != 1 || hdr.magic != WARM_MAGIC || hdr.version != WARM_VERSION || hdr.size != sizeof(*data)) {
+		err = -1;
+	}
+	else if (fread(data, sizeof(*data), 1, file) != 1 || warm_crc(data, sizeof(*data)) != hdr.crc) {
+		err = -1;
+	}
+
+	fclose(file);
+
+	if (err != 0) {
+		fprintf(stderr, "ekf: invalid warm start file %s\n", path);
+	}
+
+	return err;
+}
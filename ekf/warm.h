@@ -0,0 +1,41 @@
+/*
+ * Phoenix-Pilot
+ *
+ * extended kalman filter
+ *
+ * persisted calibration and state for warm start
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#ifndef _EKF_WARM_
+#define _EKF_WARM_
+
+#include <matrix.h>
+
+#include "kalman_implem.h"
+#include "meas.h"
+
+
+typedef struct {
+	int modelFlags;                          /* update models active when data was saved */
+	meas_calib_t calib;                      /* calibration of saved instance */
+	float press;                             /* last measured pressure in Pa, 0 if barometer was not used */
+	float state[STATE_LENGTH];               /* final state */
+	float cov[MATRIX_SYM_LEN(STATE_LENGTH)]; /* final state covariance, packed upper triangle */
+} warm_data_t;
+
+
+/* Saves `data` to file `path`. File is replaced atomically, so interrupted save keeps the previous one */
+extern int warm_save(const char *path, const warm_data_t *data);
+
+
+/* Loads `data` saved with warm_save(). Returns -1 if file is missing, corrupted or saved by incompatible version */
+extern int warm_load(const char *path, warm_data_t *data);
+
+
+#endif
@@ -352,26 +352,38 @@ static void corr_accrot(sensor_event_t *accelEvt, sensor_event_t *gyroEvt, senso
 	vec_t accel = { .x = accelEvt->accels.accelX, .y = accelEvt->accels.accelY, .z = accelEvt->accels.accelZ };
 	vec_t gyro = { .x = gyroEvt->gyro.gyroX, .y = gyroEvt->gyro.gyroY, .z = gyroEvt->gyro.gyroZ };
 	vec_t mag = { .x = magEvt->mag.magX, .y = magEvt->mag.magY, .z = magEvt->mag.magZ };
+	float xs[3], ys[3], zs[3];
 
 	corr_accrotVecSwap(&accel);
 	corr_accrotVecSwap(&gyro);
 	corr_accrotVecSwap(&mag);
 
-	quat_vecRot(&accel, &corr_common.accorth.params.accorth.frameQ);
-	quat_vecRot(&gyro, &corr_common.accorth.params.accorth.frameQ);
-	quat_vecRot(&mag, &corr_common.accorth.params.accorth.frameQ);
+	/* all vectors are rotated by the same quaternion, so they are rotated as one batch */
+	xs[0] = accel.x;
+	ys[0] = accel.y;
+	zs[0] = accel.z;
 
-	accelEvt->accels.accelX = accel.x;
-	accelEvt->accels.accelY = accel.y;
-	accelEvt->accels.accelZ = accel.z;
+	xs[1] = gyro.x;
+	ys[1] = gyro.y;
+	zs[1] = gyro.z;
 
-	gyroEvt->gyro.gyroX = gyro.x;
-	gyroEvt->gyro.gyroY = gyro.y;
-	gyroEvt->gyro.gyroZ = gyro.z;
+	xs[2] = mag.x;
+	ys[2] = mag.y;
+	zs[2] = mag.z;
 
-	magEvt->mag.magX = mag.x;
-	magEvt->mag.magY = mag.y;
-	magEvt->mag.magZ = mag.z;
+	quat_vecRotBatch(&corr_common.accorth.params.accorth.frameQ, xs, ys, zs, 3);
+
+	accelEvt->accels.accelX = xs[0];
+	accelEvt->accels.accelY = ys[0];
+	accelEvt->accels.accelZ = zs[0];
+
+	gyroEvt->gyro.gyroX = xs[1];
+	gyroEvt->gyro.gyroY = ys[1];
+	gyroEvt->gyro.gyroZ = zs[1];
+
+	magEvt->mag.magX = xs[2];
+	magEvt->mag.magY = ys[2];
+	magEvt->mag.magZ = zs[2];
 }
 
 
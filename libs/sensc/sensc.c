@@ -16,6 +16,7 @@
 #include <stdbool.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <sys/time.h>
 
@@ -33,13 +34,18 @@ typedef enum { fd_imuId = 0,
 
 struct {
 	sensors_data_t *data;
-	unsigned char buff[0x400];
+	unsigned char buff[SENSORHUB_PIPES][0x400]; /* buffer per pipe, so different sensors can be read by different threads */
 
 	int fdImu;
 	int fdBaro;
 	int fdGps;
 
 	int corrInitFlags;
+
+	/* latest accelerometer and magnetometer events, gyro events of sensc_imuGetAll() are paired with them */
+	sensor_event_t imuAccLast;
+	sensor_event_t imuMagLast;
+	unsigned int imuLastFlags;
 } sensc_common;
 
 
@@ -57,7 +63,7 @@ static int sensc_setupDescr(int sensFd, int typeFlag)
 
 	ioctl(sensFd, SMIOC_SENSORSSET, &ops);
 
-	if ((ops.evtSz * sizeof(sensor_event_t) + sizeof(((sensors_data_t *)0)->size)) > sizeof(sensc_common.buff)) {
+	if ((ops.evtSz * sizeof(sensor_event_t) + sizeof(((sensors_data_t *)0)->size)) > sizeof(sensc_common.buff[0])) {
 		fprintf(stderr, "Buff is too small\n");
 		return -1;
 	}
@@ -160,15 +166,27 @@ void sensc_deinit(void)
 }
 
 
+int sensc_imuWait(int timeoutMs)
+{
+	struct pollfd pfd = { .fd = sensc_common.fdImu, .events = POLLIN };
+
+	if (poll(&pfd, 1, timeoutMs) <= 0 || (pfd.revents & POLLIN) == 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+
 int sensc_imuGet(sensor_event_t *accelEvt, sensor_event_t *gyroEvt, sensor_event_t *magEvt)
 {
 	sensors_data_t *data;
-	data = (sensors_data_t *)(sensc_common.buff);
+	data = (sensors_data_t *)(sensc_common.buff[fd_imuId]);
 	unsigned int flag = SENSOR_TYPE_ACCEL | SENSOR_TYPE_MAG | SENSOR_TYPE_GYRO;
 	int j;
 
 	/* read from sensorhub */
-	if (read(sensc_common.fdImu, sensc_common.buff, sizeof(sensc_common.buff)) < 0) {
+	if (read(sensc_common.fdImu, sensc_common.buff[fd_imuId], sizeof(sensc_common.buff[fd_imuId])) < 0) {
 		return -1;
 	}
 
@@ -202,13 +220,76 @@ int sensc_imuGet(sensor_event_t *accelEvt, sensor_event_t *gyroEvt, sensor_event
 }
 
 
+int sensc_imuGetAll(sensor_event_t *accelEvt, sensor_event_t *gyroEvt, sensor_event_t *magEvt, unsigned int n)
+{
+	sensors_data_t *data;
+	data = (sensors_data_t *)(sensc_common.buff[fd_imuId]);
+	const unsigned int flag = SENSOR_TYPE_ACCEL | SENSOR_TYPE_MAG;
+	unsigned int skip = 0, cnt = 0;
+	int j;
+
+	/* read from sensorhub */
+	if (read(sensc_common.fdImu, sensc_common.buff[fd_imuId], sizeof(sensc_common.buff[fd_imuId])) < 0) {
+		return -1;
+	}
+
+	/* only `n` newest gyro events are used. Delta angle is cumulative, so the next one still covers omitted interval */
+	for (j = 0; j < data->size; ++j) {
+		if (data->events[j].type == SENSOR_TYPE_GYRO) {
+			skip++;
+		}
+	}
+	skip = (skip > n) ? skip - n : 0;
+
+	/* decompose sensorhub output, events are ordered by time */
+	for (j = 0; j < data->size; ++j) {
+		switch (data->events[j].type) {
+			case SENSOR_TYPE_ACCEL:
+				sensc_common.imuAccLast = data->events[j];
+				sensc_common.imuLastFlags |= SENSOR_TYPE_ACCEL;
+				break;
+
+			case SENSOR_TYPE_MAG:
+				sensc_common.imuMagLast = data->events[j];
+				sensc_common.imuLastFlags |= SENSOR_TYPE_MAG;
+				break;
+
+			case SENSOR_TYPE_GYRO:
+				if (skip > 0) {
+					skip--;
+					break;
+				}
+				if (sensc_common.imuLastFlags != flag) {
+					break;
+				}
+
+				gyroEvt[cnt] = data->events[j];
+				accelEvt[cnt] = sensc_common.imuAccLast;
+				magEvt[cnt] = sensc_common.imuMagLast;
+				accelEvt[cnt].timestamp = gyroEvt[cnt].timestamp;
+				magEvt[cnt].timestamp = gyroEvt[cnt].timestamp;
+
+				/* Corrections */
+				corr_imu(&accelEvt[cnt], &gyroEvt[cnt], &magEvt[cnt]);
+				cnt++;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return (cnt > 0) ? (int)cnt : -1;
+}
+
+
 int sensc_baroGet(sensor_event_t *baroEvt)
 {
 	sensors_data_t *data;
-	data = (sensors_data_t *)(sensc_common.buff);
+	data = (sensors_data_t *)(sensc_common.buff[fd_baroId]);
 
 	/* read from sensorhub */
-	if (read(sensc_common.fdBaro, sensc_common.buff, sizeof(sensc_common.buff)) < 0) {
+	if (read(sensc_common.fdBaro, sensc_common.buff[fd_baroId], sizeof(sensc_common.buff[fd_baroId])) < 0) {
 		return -1;
 	}
 
@@ -224,10 +305,10 @@ int sensc_baroGet(sensor_event_t *baroEvt)
 int sensc_gpsGet(sensor_event_t *gpsEvt)
 {
 	sensors_data_t *data;
-	data = (sensors_data_t *)(sensc_common.buff);
+	data = (sensors_data_t *)(sensc_common.buff[fd_gpsId]);
 
 	/* read from sensorhub */
-	if (read(sensc_common.fdGps, sensc_common.buff, sizeof(sensc_common.buff)) < 0) {
+	if (read(sensc_common.fdGps, sensc_common.buff[fd_gpsId], sizeof(sensc_common.buff[fd_gpsId])) < 0) {
 		return -1;
 	}
 
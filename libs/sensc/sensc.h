@@ -45,9 +45,21 @@ extern int sensc_init(const char *path, int corrInitFlags, int sensInitFlags);
 /* deinitializes all initialized parts of sensor client */
 extern void sensc_deinit(void);
 
+/* waits up to `timeoutMs` milliseconds for new imu data from sensorhub. Returns 0 if data is ready, -1 on timeout or error */
+extern int sensc_imuWait(int timeoutMs);
+
+/* Getters of different sensors have separate buffers, so each sensor may be read from its own thread */
+
 /* returns 0 on successful acquisition of new imu data from sensorhub, -1 on error */
 extern int sensc_imuGet(sensor_event_t *accelEvt, sensor_event_t *gyroEvt, sensor_event_t *magEvt);
 
+/*
+ * Acquires all IMU samples buffered by sensorhub, up to `n` newest ones. Sample `i` consists of gyro event `gyroEvt[i]`
+ * and the latest accelerometer and magnetometer events received up to it, all timestamped with the gyro event.
+ * Returns number of acquired samples, -1 on error or if no complete sample is buffered.
+ */
+extern int sensc_imuGetAll(sensor_event_t *accelEvt, sensor_event_t *gyroEvt, sensor_event_t *magEvt, unsigned int n);
+
 /* returns 0 on successful acquisition of new barometer data from sensorhub, -1 on error */
 extern int sensc_baroGet(sensor_event_t *baroEvt);
 
@@ -67,6 +67,7 @@
 #define ABORT_FRAMES_THRESH 5       /* number of correct abort frames from RC transmitter to initiate abort sequence */
 #define RC_ERROR_TIMEOUT    2000000 /* number of microseconds of continuous rc error that causes flight abort */
 #define LOG_PERIOD          500     /* drone control loop logs data once per 'LOG_PERIOD' milliseconds */
+#define EKF_WAIT_TIMEOUT    10000   /* maximum time (microseconds) control loop waits for new state estimate */
 
 /* Flight modes magic numbers */
 #define QCTRL_HOVER_THRESH_TIME  3000 /* hover time threshold (milliseconds) */
@@ -94,6 +95,7 @@ struct {
 	volatile flight_type_t currFlight;
 
 	time_t lastTime;
+	uint64_t ekfSeq; /* sequence number of last state estimate used by control loop */
 #if TEST_ATTITUDE
 	quad_att_t targetAtt;
 #endif
@@ -410,8 +412,6 @@ static int quad_motorsCtrl(float throttle, int32_t *alt, const vec_t *setPos, co
 		return -1;
 	}
 
-	usleep(1000);
-
 	return 0;
 }
 
@@ -621,6 +621,8 @@ static int quad_takeoff(const flight_mode_t *mode, bool *done)
 	stabTimer = now;
 
 	while (quad_common.currFlight == flight_takeoff && modeComplete == false) {
+		ekf_stateWait(&measure, EKF_WAIT_TIMEOUT, &quad_common.ekfSeq);
+
 		/* Setup timing and logging */
 		now = quad_timeMsGet();
 		quad_periodLogEnable(now);
@@ -629,7 +631,6 @@ static int quad_takeoff(const flight_mode_t *mode, bool *done)
 		quad_levelAtt(&att);
 		quad_rcOverride(&att, NULL, RC_OVRD_LEVEL);
 
-		ekf_stateGet(&measure);
 		alt = measure.enuZ * 1000;
 		if (setPosPtr == NULL) {
 			/* updates setPos only if setPosPtr is not used (position control turned off) */
@@ -805,11 +806,12 @@ static int quad_waypoint(const flight_mode_t *mode, bool *done)
 	stageStart = 0;
 
 	while (modeComplete == false && quad_common.currFlight == flight_waypoint) {
+		ekf_stateWait(&measure, EKF_WAIT_TIMEOUT, &quad_common.ekfSeq);
+
 		/* Setup timing and logging */
 		now = quad_timeMsGet();
 		quad_periodLogEnable(now);
 
-		ekf_stateGet(&measure);
 		alt = measure.enuZ * 1000;
 		pos.curr.x = measure.enuX;
 		pos.curr.y = measure.enuY;
@@ -918,11 +920,12 @@ static int quad_landing(const flight_mode_t *mode, bool *done)
 	stageStart = 0;
 
 	while (modeComplete == false && quad_common.currFlight == flight_landing) {
+		ekf_stateWait(&measure, EKF_WAIT_TIMEOUT, &quad_common.ekfSeq);
+
 		/* Setup timing and logging */
 		now = quad_timeMsGet();
 		quad_periodLogEnable(now);
 
-		ekf_stateGet(&measure);
 		alt = measure.enuZ * 1000;
 
 		switch (stage) {
@@ -1076,7 +1079,7 @@ static int quad_manual(void)
 
 	now = quad_timeMsGet();
 	while (quad_common.currFlight == flight_manual) {
-		ekf_stateGet(&measure);
+		ekf_stateWait(&measure, EKF_WAIT_TIMEOUT, &quad_common.ekfSeq);
 
 		now = quad_timeMsGet();
 		quad_periodLogEnable(now);
@@ -0,0 +1,446 @@
+/*
+ * Phoenix-Pilot
+ *
+ * extended kalman filter
+ *
+ * Parallel parameter sweep over recorded EKF logs
+ *
+ * Logs file is read into memory once and replayed concurrently by a pool of worker threads,
+ * each replay with different values of swept configuration parameters. Configurations are ranked by error metric.
+ *
+ * Copyright 2023 Phoenix Systems
+ *
+ * This file is part of Phoenix-Pilot software
+ *
+ * %LICENSE%
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <pthread.h>
+
+#include <ekflib.h>
+
+
+#define SWEEP_PARAMS_MAX   16
+#define SWEEP_NAME_LEN     32
+#define SWEEP_CONFIGS_MAX  100000
+#define SWEEP_THREADS_MAX  64
+#define SWEEP_DEFAULT_CONF "etc/ekf.conf"
+
+
+enum { metricGps, metricFinal };
+
+
+typedef struct {
+	char name[SWEEP_NAME_LEN];
+	float min;
+	float max;
+	unsigned int steps;
+} sweep_param_t;
+
+
+typedef struct {
+	unsigned int cfg; /* configuration index */
+	float metric;
+	unsigned int gpsCnt;
+	int err;
+} sweep_result_t;
+
+
+static struct {
+	const char *configFile;
+	ekf_replayInput_t input; /* logs buffer shared by all replays */
+	int metric;
+	float ref[3]; /* reference final ENU position */
+
+	sweep_param_t params[SWEEP_PARAMS_MAX];
+	unsigned int paramsCnt;
+
+	float *values; /* `configsCnt` rows of `paramsCnt` parameter values */
+	sweep_result_t *results;
+	unsigned int configsCnt;
+
+	pthread_mutex_t lock;
+	unsigned int next; /* next configuration to replay */
+	unsigned int done;
+} sweep_common;
+
+
+/* Parses `NAME=min:max:steps` */
+static int sweep_paramParse(const char *str, sweep_param_t *param)
+{
+	const char *eq = strchr(str, '=');
+	char *end;
+
+	if (eq == NULL || eq == str || (eq - str) >= SWEEP_NAME_LEN) {
+		return -1;
+	}
+
+	memcpy(param->name, str, eq - str);
+	param->name[eq - str] = '\0';
+
+	param->min = strtof(eq + 1, &end);
+	if (*end != ':') {
+		return -1;
+	}
+
+	param->max = strtof(end + 1, &end);
+	if (*end != ':') {
+		return -1;
+	}
+
+	param->steps = strtoul(end + 1, &end, 10);
+	if (*end != '\0' || param->steps == 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static float sweep_gridValue(const sweep_param_t *param, unsigned int step)
+{
+	if (param->steps == 1) {
+		return param->min;
+	}
+
+	return param->min + (param->max - param->min) * (float)step / (float)(param->steps - 1);
+}
+
+
+/* Fills values of all configurations: full grid if `samples` is 0, otherwise `samples` uniformly random points */
+static int sweep_valuesInit(unsigned int samples, unsigned int seed)
+{
+	const sweep_param_t *param;
+	unsigned long long int cnt = 1;
+	unsigned int cfg, i, rest;
+
+	if (samples == 0) {
+		for (i = 0; i < sweep_common.paramsCnt; i++) {
+			cnt *= sweep_common.params[i].steps;
+			if (cnt > SWEEP_CONFIGS_MAX) {
+				break;
+			}
+		}
+	}
+	else {
+		cnt = samples;
+	}
+
+	if (cnt > SWEEP_CONFIGS_MAX) {
+		fprintf(stderr, "ekf_sweep: more than %d configurations\n", SWEEP_CONFIGS_MAX);
+		return -1;
+	}
+
+	sweep_common.configsCnt = cnt;
+	sweep_common.values = malloc(sizeof(float) * cnt * sweep_common.paramsCnt);
+	sweep_common.results = malloc(sizeof(sweep_result_t) * cnt);
+	if (sweep_common.values == NULL || sweep_common.results == NULL) {
+		fprintf(stderr, "ekf_sweep: allocation failed\n");
+		return -1;
+	}
+
+	srand(seed);
+
+	for (cfg = 0; cfg < cnt; cfg++) {
+		rest = cfg;
+		for (i = 0; i < sweep_common.paramsCnt; i++) {
+			param = &sweep_common.params[i];
+			if (samples == 0) {
+				/* mixed radix decomposition of configuration index */
+				sweep_common.values[cfg * sweep_common.paramsCnt + i] = sweep_gridValue(param, rest % param->steps);
+				rest /= param->steps;
+			}
+			else {
+				sweep_common.values[cfg * sweep_common.paramsCnt + i] = param->min + (param->max - param->min) * (float)rand() / (float)RAND_MAX;
+			}
+		}
+	}
+
+	return 0;
+}
+
+
+static void sweep_replay(unsigned int cfg)
+{
+	ekf_param_t params[SWEEP_PARAMS_MAX];
+	ekf_replayInput_t input = sweep_common.input;
+	ekf_replayStats_t stats;
+	sweep_result_t *res = &sweep_common.results[cfg];
+	unsigned int i;
+	float dx, dy, dz;
+
+	for (i = 0; i < sweep_common.paramsCnt; i++) {
+		params[i].name = sweep_common.params[i].name;
+		params[i].value = sweep_common.values[cfg * sweep_common.paramsCnt + i];
+	}
+	input.params = params;
+	input.paramsCnt = sweep_common.paramsCnt;
+
+	res->cfg = cfg;
+	res->err = ekf_replayInput(sweep_common.configFile, &input, NULL, NULL, NULL, &stats);
+	if (res->err != 0) {
+		res->metric = INFINITY;
+		res->gpsCnt = 0;
+		return;
+	}
+
+	res->gpsCnt = stats.gpsCnt;
+	if (sweep_common.metric == metricGps) {
+		res->metric = (stats.gpsCnt > 0) ? stats.gpsRmse : INFINITY;
+	}
+	else {
+		dx = stats.state.enuX - sweep_common.ref[0];
+		dy = stats.state.enuY - sweep_common.ref[1];
+		dz = stats.state.enuZ - sweep_common.ref[2];
+		res->metric = sqrtf(dx * dx + dy * dy + dz * dz);
+	}
+}
+
+
+static void *sweep_worker(void *arg)
+{
+	unsigned int cfg;
+
+	for (;;) {
+		pthread_mutex_lock(&sweep_common.lock);
+		cfg = sweep_common.next;
+		if (cfg < sweep_common.configsCnt) {
+			sweep_common.next++;
+		}
+		pthread_mutex_unlock(&sweep_common.lock);
+
+		if (cfg >= sweep_common.configsCnt) {
+			break;
+		}
+
+		sweep_replay(cfg);
+
+		pthread_mutex_lock(&sweep_common.lock);
+		sweep_common.done++;
+		fprintf(stderr, "\rekf_sweep: %u/%u", sweep_common.done, sweep_common.configsCnt);
+		pthread_mutex_unlock(&sweep_common.lock);
+	}
+
+	return NULL;
+}
+
+
+static int sweep_resultCmp(const void *a, const void *b)
+{
+	const sweep_result_t *x = a, *y = b;
+
+	if (x->err != y->err) {
+		return (x->err != 0) - (y->err != 0);
+	}
+
+	return (x->metric > y->metric) - (x->metric < y->metric);
+}
+
+
+static void *sweep_fileLoad(const char *path, size_t *size)
+{
+	FILE *file;
+	void *buf = NULL;
+	long int len;
+
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "ekf_sweep: cannot open %s\n", path);
+		return NULL;
+	}
+
+	if (fseek(file, 0, SEEK_END) == 0 && (len = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+		buf = malloc(len);
+		if (buf != NULL && fread(buf, len, 1, file) != 1) {
+			free(buf);
+			buf = NULL;
+		}
+		*size = len;
+	}
+	fclose(file);
+
+	if (buf == NULL) {
+		fprintf(stderr, "ekf_sweep: cannot read %s\n", path);
+	}
+
+	return buf;
+}
+
+
+static void sweep_print(unsigned int top)
+{
+	const sweep_result_t *res;
+	unsigned int i, j;
+
+	printf("%-5s %12s %6s", "rank", (sweep_common.metric == metricGps) ? "gps_rmse[m]" : "final_err[m]", "gps");
+	for (i = 0; i < sweep_common.paramsCnt; i++) {
+		printf(" %20s", sweep_common.params[i].name);
+	}
+	printf("\n");
+
+	for (i = 0; i < sweep_common.configsCnt && i < top; i++) {
+		res = &sweep_common.results[i];
+		if (res->err != 0) {
+			printf("%-5u %12s %6s", i + 1, "error", "-");
+		}
+		else {
+			printf("%-5u %12.4f %6u", i + 1, res->metric, res->gpsCnt);
+		}
+
+		for (j = 0; j < sweep_common.paramsCnt; j++) {
+			printf(" %20g", sweep_common.values[res->cfg * sweep_common.paramsCnt + j]);
+		}
+		printf("\n");
+	}
+}
+
+
+static void sweep_usage(const char *progname)
+{
+	printf("Usage: %s [options] -p NAME=min:max:steps [-p ...] logfile\n\n", progname);
+	printf("  -c  EKF configuration file (default %s)\n", SWEEP_DEFAULT_CONF);
+	printf("  -p  swept parameter, e.g. R_MATRIX/astdev=0.1:2:10. Parameter may be repeated\n");
+	printf("  -j  number of worker threads (default: number of online CPUs)\n");
+	printf("  -n  number of random configurations instead of full grid\n");
+	printf("  -s  random seed (default 1)\n");
+	printf("  -m  error metric: `gps` - RMSE of predicted position at GPS updates (default),\n");
+	printf("      `final` - distance of final position from reference given with -r\n");
+	printf("  -r  reference final ENU position as east:north:up\n");
+	printf("  -t  number of printed best configurations (default all)\n");
+	printf("  -h  shows this help info\n");
+}
+
+
+int main(int argc, char **argv)
+{
+	pthread_t threads[SWEEP_THREADS_MAX];
+	unsigned int samples = 0, seed = 1, top = SWEEP_CONFIGS_MAX, i;
+	long int jobs;
+	void *buf;
+	int opt, err = 0;
+
+	sweep_common.configFile = SWEEP_DEFAULT_CONF;
+	sweep_common.metric = metricGps;
+	jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+	while ((opt = getopt(argc, argv, "c:p:j:n:s:m:r:t:h")) != -1) {
+		switch (opt) {
+			case 'c':
+				sweep_common.configFile = optarg;
+				break;
+
+			case 'p':
+				if (sweep_common.paramsCnt >= SWEEP_PARAMS_MAX || sweep_paramParse(optarg, &sweep_common.params[sweep_common.paramsCnt]) != 0) {
+					fprintf(stderr, "ekf_sweep: invalid parameter %s\n", optarg);
+					return EXIT_FAILURE;
+				}
+				sweep_common.paramsCnt++;
+				break;
+
+			case 'j':
+				jobs = strtol(optarg, NULL, 10);
+				break;
+
+			case 'n':
+				samples = strtoul(optarg, NULL, 10);
+				break;
+
+			case 's':
+				seed = strtoul(optarg, NULL, 10);
+				break;
+
+			case 'm':
+				if (strcmp(optarg, "gps") == 0) {
+					sweep_common.metric = metricGps;
+				}
+				else if (strcmp(optarg, "final") == 0) {
+					sweep_common.metric = metricFinal;
+				}
+				else {
+					fprintf(stderr, "ekf_sweep: unknown metric %s\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+
+			case 'r':
+				if (sscanf(optarg, "%f:%f:%f", &sweep_common.ref[0], &sweep_common.ref[1], &sweep_common.ref[2]) != 3) {
+					fprintf(stderr, "ekf_sweep: invalid reference position %s\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+
+			case 't':
+				top = strtoul(optarg, NULL, 10);
+				break;
+
+			case 'h':
+				sweep_usage(argv[0]);
+				return EXIT_SUCCESS;
+
+			default:
+				sweep_usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (optind != argc - 1 || sweep_common.paramsCnt == 0) {
+		sweep_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (jobs <= 0) {
+		jobs = 1;
+	}
+	else if (jobs > SWEEP_THREADS_MAX) {
+		jobs = SWEEP_THREADS_MAX;
+	}
+
+	buf = sweep_fileLoad(argv[optind], &sweep_common.input.bufSize);
+	if (buf == NULL) {
+		return EXIT_FAILURE;
+	}
+	sweep_common.input.buf = buf;
+
+	if (sweep_valuesInit(samples, seed) != 0) {
+		free(sweep_common.values);
+		free(sweep_common.results);
+		free(buf);
+		return EXIT_FAILURE;
+	}
+
+	pthread_mutex_init(&sweep_common.lock, NULL);
+
+	for (i = 0; i < jobs; i++) {
+		if (pthread_create(&threads[i], NULL, sweep_worker, NULL) != 0) {
+			fprintf(stderr, "ekf_sweep: cannot start worker thread\n");
+			break;
+		}
+	}
+
+	/* at least one worker is needed to process all configurations */
+	if (i == 0) {
+		err = -1;
+	}
+
+	while (i > 0) {
+		pthread_join(threads[--i], NULL);
+	}
+	fprintf(stderr, "\n");
+
+	if (err == 0) {
+		qsort(sweep_common.results, sweep_common.configsCnt, sizeof(sweep_result_t), sweep_resultCmp);
+		sweep_print(top);
+	}
+
+	pthread_mutex_destroy(&sweep_common.lock);
+	free(sweep_common.values);
+	free(sweep_common.results);
+	free(buf);
+
+	return (err == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}